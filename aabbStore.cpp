@@ -0,0 +1,599 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: aabbStore.cpp
+//
+// Desc: Structure-of-arrays AABB store and its batch kernels (see aabbStore.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "aabbStore.h"
+#include "frustum.h"
+
+#ifdef AABB_USE_AVX
+#include <immintrin.h>
+#elif defined(AABB_USE_SSE)
+#include <emmintrin.h>
+#endif
+
+#define AABB_PAD 8
+
+// a zero direction component becomes a tiny one so the slab test needs no
+// special case (the slab times just go to +-huge)
+static float safeInverse(float d)
+{
+	if (d >= 0 && d < 1e-12f) d = 1e-12f;
+	else if (d < 0 && d > -1e-12f) d = -1e-12f;
+	return 1.0f / d;
+}
+
+bool sweepSegmentBox(const float p0[3], const float d[3], const float bmin[3], const float bmax[3], float expand, float& t)
+{
+	float tEnter = 0.0f, tExit = 1.0f;
+	for (int a = 0; a < 3; a++) {
+		float inv = safeInverse(d[a]);
+		float t1 = (bmin[a] - expand - p0[a]) * inv;
+		float t2 = (bmax[a] + expand - p0[a]) * inv;
+		if (t1 > t2) { float tmp = t1; t1 = t2; t2 = tmp; }
+		if (t1 > tEnter) tEnter = t1;
+		if (t2 < tExit) tExit = t2;
+		if (tEnter > tExit)
+			return false;
+	}
+	t = tEnter;
+	return true;
+}
+
+CAabbStore::CAabbStore(void)
+{
+	m_count = 0;
+#if defined(AABB_USE_AVX)
+	m_path = PATH_AVX;
+#elif defined(AABB_USE_SSE)
+	m_path = PATH_SSE;
+#else
+	m_path = PATH_SCALAR;
+#endif
+}
+
+void CAabbStore::clear(void)
+{
+	m_count = 0;
+	m_minX.clear(); m_minY.clear(); m_minZ.clear();
+	m_maxX.clear(); m_maxY.clear(); m_maxZ.clear();
+	m_alive.clear();
+}
+
+void CAabbStore::reserve(int count)
+{
+	int padded = (count + AABB_PAD - 1) / AABB_PAD * AABB_PAD;
+	m_minX.reserve(padded); m_minY.reserve(padded); m_minZ.reserve(padded);
+	m_maxX.reserve(padded); m_maxY.reserve(padded); m_maxZ.reserve(padded);
+	m_alive.reserve(padded);
+}
+
+void CAabbStore::grow(int count)
+{
+	int padded = (count + AABB_PAD - 1) / AABB_PAD * AABB_PAD;
+	if (padded <= (int)m_alive.size())
+		return;
+	// padding boxes are dead and empty, so they never report a hit
+	m_minX.resize(padded, 1.0f); m_minY.resize(padded, 1.0f); m_minZ.resize(padded, 1.0f);
+	m_maxX.resize(padded, -1.0f); m_maxY.resize(padded, -1.0f); m_maxZ.resize(padded, -1.0f);
+	m_alive.resize(padded, 0);
+}
+
+int CAabbStore::add(float minX, float minY, float minZ, float maxX, float maxY, float maxZ)
+{
+	int i = m_count;
+	grow(m_count + 1);
+	m_count++;
+	set(i, minX, minY, minZ, maxX, maxY, maxZ);
+	return i;
+}
+
+void CAabbStore::set(int i, float minX, float minY, float minZ, float maxX, float maxY, float maxZ)
+{
+	m_minX[i] = minX; m_minY[i] = minY; m_minZ[i] = minZ;
+	m_maxX[i] = maxX; m_maxY[i] = maxY; m_maxZ[i] = maxZ;
+	m_alive[i] = -1;
+}
+
+void CAabbStore::kill(int i)
+{
+	m_alive[i] = 0;
+}
+
+void CAabbStore::swap(int i, int j)
+{
+	float f;
+	int a;
+	f = m_minX[i]; m_minX[i] = m_minX[j]; m_minX[j] = f;
+	f = m_minY[i]; m_minY[i] = m_minY[j]; m_minY[j] = f;
+	f = m_minZ[i]; m_minZ[i] = m_minZ[j]; m_minZ[j] = f;
+	f = m_maxX[i]; m_maxX[i] = m_maxX[j]; m_maxX[j] = f;
+	f = m_maxY[i]; m_maxY[i] = m_maxY[j]; m_maxY[j] = f;
+	f = m_maxZ[i]; m_maxZ[i] = m_maxZ[j]; m_maxZ[j] = f;
+	a = m_alive[i]; m_alive[i] = m_alive[j]; m_alive[j] = a;
+}
+
+void CAabbStore::removeLast(void)
+{
+	// back to a padding box: the kernels read past m_count
+	int i = --m_count;
+	m_minX[i] = m_minY[i] = m_minZ[i] = 1.0f;
+	m_maxX[i] = m_maxY[i] = m_maxZ[i] = -1.0f;
+	m_alive[i] = 0;
+}
+
+bool CAabbStore::getBounds(float bmin[3], float bmax[3]) const
+{
+	bool any = false;
+	for (int i = 0; i < m_count; i++) {
+		if (!m_alive[i])
+			continue;
+		if (!any) {
+			bmin[0] = m_minX[i]; bmin[1] = m_minY[i]; bmin[2] = m_minZ[i];
+			bmax[0] = m_maxX[i]; bmax[1] = m_maxY[i]; bmax[2] = m_maxZ[i];
+			any = true;
+			continue;
+		}
+		if (m_minX[i] < bmin[0]) bmin[0] = m_minX[i];
+		if (m_minY[i] < bmin[1]) bmin[1] = m_minY[i];
+		if (m_minZ[i] < bmin[2]) bmin[2] = m_minZ[i];
+		if (m_maxX[i] > bmax[0]) bmax[0] = m_maxX[i];
+		if (m_maxY[i] > bmax[1]) bmax[1] = m_maxY[i];
+		if (m_maxZ[i] > bmax[2]) bmax[2] = m_maxZ[i];
+	}
+	return any;
+}
+
+bool CAabbStore::overlapsSphere(int i, float cx, float cy, float cz, float radius) const
+{
+	if (!m_alive[i])
+		return false;
+	float d, dist2 = 0;
+	d = m_minX[i] - cx; if (d < cx - m_maxX[i]) d = cx - m_maxX[i]; if (d > 0) dist2 += d * d;
+	d = m_minY[i] - cy; if (d < cy - m_maxY[i]) d = cy - m_maxY[i]; if (d > 0) dist2 += d * d;
+	d = m_minZ[i] - cz; if (d < cz - m_maxZ[i]) d = cz - m_maxZ[i]; if (d > 0) dist2 += d * d;
+	return dist2 <= radius * radius;
+}
+
+int CAabbStore::overlapBox(float minX, float minY, float minZ, float maxX, float maxY, float maxZ, std::vector<int>& out) const
+{
+	const float q[6] = { minX, minY, minZ, maxX, maxY, maxZ };
+	switch (m_path) {
+#ifdef AABB_USE_AVX
+	case PATH_AVX: return overlapBoxAVX(q, &out, false);
+#endif
+#ifdef AABB_USE_SSE
+	case PATH_SSE: return overlapBoxSSE(q, &out, false);
+#endif
+	default: return overlapBoxScalar(q, &out, false);
+	}
+}
+
+int CAabbStore::firstOverlapBox(float minX, float minY, float minZ, float maxX, float maxY, float maxZ) const
+{
+	const float q[6] = { minX, minY, minZ, maxX, maxY, maxZ };
+	switch (m_path) {
+#ifdef AABB_USE_AVX
+	case PATH_AVX: return overlapBoxAVX(q, NULL, true);
+#endif
+#ifdef AABB_USE_SSE
+	case PATH_SSE: return overlapBoxSSE(q, NULL, true);
+#endif
+	default: return overlapBoxScalar(q, NULL, true);
+	}
+}
+
+int CAabbStore::overlapSphere(float cx, float cy, float cz, float radius, std::vector<int>& out) const
+{
+	const float q[4] = { cx, cy, cz, radius };
+	switch (m_path) {
+#ifdef AABB_USE_AVX
+	case PATH_AVX: return overlapSphereAVX(q, out);
+#endif
+#ifdef AABB_USE_SSE
+	case PATH_SSE: return overlapSphereSSE(q, out);
+#endif
+	default: return overlapSphereScalar(q, out);
+	}
+}
+
+int CAabbStore::overlapFrustum(const CFrustum& frustum, std::vector<int>& out, int begin, int end) const
+{
+	if (end < 0)
+		end = m_count;
+	if (begin >= end)
+		return 0;
+	switch (m_path) {
+#ifdef AABB_USE_AVX
+	case PATH_AVX: return overlapFrustumAVX(frustum, out, begin, end);
+#endif
+#ifdef AABB_USE_SSE
+	case PATH_SSE: return overlapFrustumSSE(frustum, out, begin, end);
+#endif
+	default: return overlapFrustumScalar(frustum, out, begin, end);
+	}
+}
+
+int CAabbStore::sweepSegment(const float p0[3], const float d[3], float expand, float& tHit) const
+{
+	const float invD[3] = { safeInverse(d[0]), safeInverse(d[1]), safeInverse(d[2]) };
+	switch (m_path) {
+#ifdef AABB_USE_SSE
+	case PATH_AVX:	// the sweep is cheap next to the rest of the frame, SSE is enough
+	case PATH_SSE: return sweepSegmentSSE(p0, invD, expand, tHit);
+#endif
+	default: return sweepSegmentScalar(p0, invD, expand, tHit);
+	}
+}
+
+void CAabbStore::setPath(Path path)
+{
+	if (isPathSupported(path))
+		m_path = path;
+}
+
+bool CAabbStore::isPathSupported(Path path)
+{
+	switch (path) {
+	case PATH_SCALAR: return true;
+#ifdef AABB_USE_SSE
+	case PATH_SSE: return true;
+#endif
+#ifdef AABB_USE_AVX
+	case PATH_AVX: return true;
+#endif
+	default: return false;
+	}
+}
+
+const char* CAabbStore::getPathName(Path path)
+{
+	switch (path) {
+	case PATH_SSE: return "sse";
+	case PATH_AVX: return "avx";
+	default: return "scalar";
+	}
+}
+
+// -----------------------------------------------------------------------------
+// Scalar reference kernels
+// -----------------------------------------------------------------------------
+
+int CAabbStore::overlapBoxScalar(const float q[6], std::vector<int>* out, bool firstOnly) const
+{
+	int hits = 0;
+	for (int i = 0; i < m_count; i++) {
+		if (overlapsBox(i, q[0], q[1], q[2], q[3], q[4], q[5])) {
+			if (firstOnly)
+				return i;
+			out->push_back(i);
+			hits++;
+		}
+	}
+	return firstOnly ? -1 : hits;
+}
+
+int CAabbStore::overlapSphereScalar(const float q[4], std::vector<int>& out) const
+{
+	int hits = 0;
+	for (int i = 0; i < m_count; i++) {
+		if (overlapsSphere(i, q[0], q[1], q[2], q[3])) {
+			out.push_back(i);
+			hits++;
+		}
+	}
+	return hits;
+}
+
+int CAabbStore::sweepSegmentScalar(const float p0[3], const float invD[3], float expand, float& tHit) const
+{
+	int best = -1;
+	float bestT = 2.0f;
+	for (int i = 0; i < m_count; i++) {
+		if (!m_alive[i])
+			continue;
+		float tx1 = (m_minX[i] - expand - p0[0]) * invD[0], tx2 = (m_maxX[i] + expand - p0[0]) * invD[0];
+		float ty1 = (m_minY[i] - expand - p0[1]) * invD[1], ty2 = (m_maxY[i] + expand - p0[1]) * invD[1];
+		float tz1 = (m_minZ[i] - expand - p0[2]) * invD[2], tz2 = (m_maxZ[i] + expand - p0[2]) * invD[2];
+		float tEnter = 0.0f, tExit = 1.0f;
+		if (tx1 > tx2) { float t = tx1; tx1 = tx2; tx2 = t; }
+		if (ty1 > ty2) { float t = ty1; ty1 = ty2; ty2 = t; }
+		if (tz1 > tz2) { float t = tz1; tz1 = tz2; tz2 = t; }
+		if (tx1 > tEnter) tEnter = tx1;
+		if (ty1 > tEnter) tEnter = ty1;
+		if (tz1 > tEnter) tEnter = tz1;
+		if (tx2 < tExit) tExit = tx2;
+		if (ty2 < tExit) tExit = ty2;
+		if (tz2 < tExit) tExit = tz2;
+		if (tEnter <= tExit && tEnter < bestT) {
+			bestT = tEnter;
+			best = i;
+		}
+	}
+	if (best >= 0)
+		tHit = bestT;
+	return best;
+}
+
+int CAabbStore::overlapFrustumScalar(const CFrustum& frustum, std::vector<int>& out, int begin, int end) const
+{
+	int hits = 0;
+	for (int i = begin; i < end; i++) {
+		if (!m_alive[i])
+			continue;
+		float bmin[3] = { m_minX[i], m_minY[i], m_minZ[i] };
+		float bmax[3] = { m_maxX[i], m_maxY[i], m_maxZ[i] };
+		if (frustum.testBox(bmin, bmax)) {
+			out.push_back(i);
+			hits++;
+		}
+	}
+	return hits;
+}
+
+// -----------------------------------------------------------------------------
+// SSE kernels (4 boxes per step)
+// -----------------------------------------------------------------------------
+
+#ifdef AABB_USE_SSE
+int CAabbStore::overlapBoxSSE(const float q[6], std::vector<int>* out, bool firstOnly) const
+{
+	const __m128 qMinX = _mm_set1_ps(q[0]), qMinY = _mm_set1_ps(q[1]), qMinZ = _mm_set1_ps(q[2]);
+	const __m128 qMaxX = _mm_set1_ps(q[3]), qMaxY = _mm_set1_ps(q[4]), qMaxZ = _mm_set1_ps(q[5]);
+	int hits = 0;
+
+	for (int i = 0; i < m_count; i += 4) {
+		__m128 m = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)&m_alive[i]));
+		m = _mm_and_ps(m, _mm_cmple_ps(_mm_loadu_ps(&m_minX[i]), qMaxX));
+		m = _mm_and_ps(m, _mm_cmpge_ps(_mm_loadu_ps(&m_maxX[i]), qMinX));
+		m = _mm_and_ps(m, _mm_cmple_ps(_mm_loadu_ps(&m_minZ[i]), qMaxZ));
+		m = _mm_and_ps(m, _mm_cmpge_ps(_mm_loadu_ps(&m_maxZ[i]), qMinZ));
+		m = _mm_and_ps(m, _mm_cmple_ps(_mm_loadu_ps(&m_minY[i]), qMaxY));
+		m = _mm_and_ps(m, _mm_cmpge_ps(_mm_loadu_ps(&m_maxY[i]), qMinY));
+
+		int mask = _mm_movemask_ps(m);
+		if (mask == 0)
+			continue;
+		for (int b = 0; b < 4; b++) {
+			if (mask & (1 << b)) {
+				if (firstOnly)
+					return i + b;
+				out->push_back(i + b);
+				hits++;
+			}
+		}
+	}
+	return firstOnly ? -1 : hits;
+}
+
+int CAabbStore::overlapSphereSSE(const float q[4], std::vector<int>& out) const
+{
+	const __m128 cx = _mm_set1_ps(q[0]), cy = _mm_set1_ps(q[1]), cz = _mm_set1_ps(q[2]);
+	const __m128 r2 = _mm_set1_ps(q[3] * q[3]);
+	const __m128 zero = _mm_setzero_ps();
+	int hits = 0;
+
+	for (int i = 0; i < m_count; i += 4) {
+		// distance from the center to the box along each axis (0 when inside)
+		__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minX[i]), cx), _mm_sub_ps(cx, _mm_loadu_ps(&m_maxX[i]))), zero);
+		__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minY[i]), cy), _mm_sub_ps(cy, _mm_loadu_ps(&m_maxY[i]))), zero);
+		__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minZ[i]), cz), _mm_sub_ps(cz, _mm_loadu_ps(&m_maxZ[i]))), zero);
+		__m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		__m128 m = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)&m_alive[i]));
+		m = _mm_and_ps(m, _mm_cmple_ps(dist2, r2));
+
+		int mask = _mm_movemask_ps(m);
+		if (mask == 0)
+			continue;
+		for (int b = 0; b < 4; b++) {
+			if (mask & (1 << b)) {
+				out.push_back(i + b);
+				hits++;
+			}
+		}
+	}
+	return hits;
+}
+
+int CAabbStore::overlapFrustumSSE(const CFrustum& frustum, std::vector<int>& out, int begin, int end) const
+{
+	// per plane the corner to test is fixed by the normal's signs, so the
+	// arrays to load are picked once per plane, not per box
+	const float* corner[CFrustum::PLANE_COUNT][3];
+	__m128 plane[CFrustum::PLANE_COUNT][4];
+	for (int p = 0; p < CFrustum::PLANE_COUNT; p++) {
+		const float* n = frustum.getPlane(p);
+		corner[p][0] = n[0] >= 0 ? &m_maxX[0] : &m_minX[0];
+		corner[p][1] = n[1] >= 0 ? &m_maxY[0] : &m_minY[0];
+		corner[p][2] = n[2] >= 0 ? &m_maxZ[0] : &m_minZ[0];
+		for (int a = 0; a < 4; a++)
+			plane[p][a] = _mm_set1_ps(n[a]);
+	}
+	const __m128 zero = _mm_setzero_ps();
+	// room for every box of the range up front (and the lane written past
+	// the last hit): each step writes all its lanes and only counts the
+	// hits, with no branch per box
+	size_t base = out.size();
+	out.resize(base + (end - begin) + 1);
+	int* dst = &out[base];
+	int hits = 0;
+
+	// from the step holding begin; lanes outside [begin, end) are masked off
+	for (int i = begin & ~3; i < end; i += 4) {
+		__m128 m = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)&m_alive[i]));
+		for (int p = 0; p < CFrustum::PLANE_COUNT; p++) {
+			__m128 d = _mm_add_ps(_mm_mul_ps(plane[p][0], _mm_loadu_ps(corner[p][0] + i)), plane[p][3]);
+			d = _mm_add_ps(d, _mm_mul_ps(plane[p][1], _mm_loadu_ps(corner[p][1] + i)));
+			d = _mm_add_ps(d, _mm_mul_ps(plane[p][2], _mm_loadu_ps(corner[p][2] + i)));
+			m = _mm_and_ps(m, _mm_cmpge_ps(d, zero));
+		}
+
+		int mask = _mm_movemask_ps(m);
+		if (i < begin)
+			mask &= ~((1 << (begin - i)) - 1);
+		if (i + 4 > end)
+			mask &= (1 << (end - i)) - 1;
+		for (int b = 0; b < 4; b++) {
+			dst[hits] = i + b;
+			hits += (mask >> b) & 1;
+		}
+	}
+	out.resize(base + hits);
+	return hits;
+}
+#endif
+
+#ifdef AABB_USE_SSE
+int CAabbStore::sweepSegmentSSE(const float p0[3], const float invD[3], float expand, float& tHit) const
+{
+	const __m128 px = _mm_set1_ps(p0[0]), py = _mm_set1_ps(p0[1]), pz = _mm_set1_ps(p0[2]);
+	const __m128 ix = _mm_set1_ps(invD[0]), iy = _mm_set1_ps(invD[1]), iz = _mm_set1_ps(invD[2]);
+	const __m128 e = _mm_set1_ps(expand);
+	const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+	int best = -1;
+	float bestT = 2.0f;
+
+	for (int i = 0; i < m_count; i += 4) {
+		__m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(&m_minX[i]), e), px), ix);
+		__m128 tx2 = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_loadu_ps(&m_maxX[i]), e), px), ix);
+		__m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(&m_minY[i]), e), py), iy);
+		__m128 ty2 = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_loadu_ps(&m_maxY[i]), e), py), iy);
+		__m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(&m_minZ[i]), e), pz), iz);
+		__m128 tz2 = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_loadu_ps(&m_maxZ[i]), e), pz), iz);
+
+		__m128 tEnter = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx1, tx2), _mm_min_ps(ty1, ty2)), _mm_max_ps(_mm_min_ps(tz1, tz2), zero));
+		__m128 tExit = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx1, tx2), _mm_max_ps(ty1, ty2)), _mm_min_ps(_mm_max_ps(tz1, tz2), one));
+
+		__m128 m = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)&m_alive[i]));
+		m = _mm_and_ps(m, _mm_cmple_ps(tEnter, tExit));
+
+		int mask = _mm_movemask_ps(m);
+		if (mask == 0)
+			continue;
+		float t[4];
+		_mm_storeu_ps(t, tEnter);
+		for (int b = 0; b < 4; b++) {
+			if ((mask & (1 << b)) && t[b] < bestT) {
+				bestT = t[b];
+				best = i + b;
+			}
+		}
+	}
+	if (best >= 0)
+		tHit = bestT;
+	return best;
+}
+#endif
+
+// -----------------------------------------------------------------------------
+// AVX kernels (8 boxes per step)
+// -----------------------------------------------------------------------------
+
+#ifdef AABB_USE_AVX
+int CAabbStore::overlapBoxAVX(const float q[6], std::vector<int>* out, bool firstOnly) const
+{
+	const __m256 qMinX = _mm256_set1_ps(q[0]), qMinY = _mm256_set1_ps(q[1]), qMinZ = _mm256_set1_ps(q[2]);
+	const __m256 qMaxX = _mm256_set1_ps(q[3]), qMaxY = _mm256_set1_ps(q[4]), qMaxZ = _mm256_set1_ps(q[5]);
+	int hits = 0;
+
+	for (int i = 0; i < m_count; i += 8) {
+		__m256 m = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*)&m_alive[i]));
+		m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(&m_minX[i]), qMaxX, _CMP_LE_OQ));
+		m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(&m_maxX[i]), qMinX, _CMP_GE_OQ));
+		m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(&m_minZ[i]), qMaxZ, _CMP_LE_OQ));
+		m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(&m_maxZ[i]), qMinZ, _CMP_GE_OQ));
+		m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(&m_minY[i]), qMaxY, _CMP_LE_OQ));
+		m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(&m_maxY[i]), qMinY, _CMP_GE_OQ));
+
+		int mask = _mm256_movemask_ps(m);
+		if (mask == 0)
+			continue;
+		for (int b = 0; b < 8; b++) {
+			if (mask & (1 << b)) {
+				if (firstOnly)
+					return i + b;
+				out->push_back(i + b);
+				hits++;
+			}
+		}
+	}
+	return firstOnly ? -1 : hits;
+}
+
+int CAabbStore::overlapSphereAVX(const float q[4], std::vector<int>& out) const
+{
+	const __m256 cx = _mm256_set1_ps(q[0]), cy = _mm256_set1_ps(q[1]), cz = _mm256_set1_ps(q[2]);
+	const __m256 r2 = _mm256_set1_ps(q[3] * q[3]);
+	const __m256 zero = _mm256_setzero_ps();
+	int hits = 0;
+
+	for (int i = 0; i < m_count; i += 8) {
+		__m256 dx = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(&m_minX[i]), cx), _mm256_sub_ps(cx, _mm256_loadu_ps(&m_maxX[i]))), zero);
+		__m256 dy = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(&m_minY[i]), cy), _mm256_sub_ps(cy, _mm256_loadu_ps(&m_maxY[i]))), zero);
+		__m256 dz = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(&m_minZ[i]), cz), _mm256_sub_ps(cz, _mm256_loadu_ps(&m_maxZ[i]))), zero);
+		__m256 dist2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+
+		__m256 m = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*)&m_alive[i]));
+		m = _mm256_and_ps(m, _mm256_cmp_ps(dist2, r2, _CMP_LE_OQ));
+
+		int mask = _mm256_movemask_ps(m);
+		if (mask == 0)
+			continue;
+		for (int b = 0; b < 8; b++) {
+			if (mask & (1 << b)) {
+				out.push_back(i + b);
+				hits++;
+			}
+		}
+	}
+	return hits;
+}
+
+int CAabbStore::overlapFrustumAVX(const CFrustum& frustum, std::vector<int>& out, int begin, int end) const
+{
+	const float* corner[CFrustum::PLANE_COUNT][3];
+	__m256 plane[CFrustum::PLANE_COUNT][4];
+	for (int p = 0; p < CFrustum::PLANE_COUNT; p++) {
+		const float* n = frustum.getPlane(p);
+		corner[p][0] = n[0] >= 0 ? &m_maxX[0] : &m_minX[0];
+		corner[p][1] = n[1] >= 0 ? &m_maxY[0] : &m_minY[0];
+		corner[p][2] = n[2] >= 0 ? &m_maxZ[0] : &m_minZ[0];
+		for (int a = 0; a < 4; a++)
+			plane[p][a] = _mm256_set1_ps(n[a]);
+	}
+	const __m256 zero = _mm256_setzero_ps();
+	// room for every box of the range up front (and the lane written past
+	// the last hit): each step writes all its lanes and only counts the
+	// hits, with no branch per box
+	size_t base = out.size();
+	out.resize(base + (end - begin) + 1);
+	int* dst = &out[base];
+	int hits = 0;
+
+	for (int i = begin & ~7; i < end; i += 8) {
+		__m256 m = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*)&m_alive[i]));
+		for (int p = 0; p < CFrustum::PLANE_COUNT; p++) {
+			__m256 d = _mm256_add_ps(_mm256_mul_ps(plane[p][0], _mm256_loadu_ps(corner[p][0] + i)), plane[p][3]);
+			d = _mm256_add_ps(d, _mm256_mul_ps(plane[p][1], _mm256_loadu_ps(corner[p][1] + i)));
+			d = _mm256_add_ps(d, _mm256_mul_ps(plane[p][2], _mm256_loadu_ps(corner[p][2] + i)));
+			m = _mm256_and_ps(m, _mm256_cmp_ps(d, zero, _CMP_GE_OQ));
+		}
+
+		int mask = _mm256_movemask_ps(m);
+		if (i < begin)
+			mask &= ~((1 << (begin - i)) - 1);
+		if (i + 8 > end)
+			mask &= (1 << (end - i)) - 1;
+		for (int b = 0; b < 8; b++) {
+			dst[hits] = i + b;
+			hits += (mask >> b) & 1;
+		}
+	}
+	out.resize(base + hits);
+	return hits;
+}
+#endif
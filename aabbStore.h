@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: aabbStore.h
+//
+// Desc: Structure-of-arrays store for axis aligned boxes. Only the collision
+//       data (min/max per axis and an alive mask) lives here, packed so one
+//       query can be tested against many boxes at once with SSE/AVX.
+//       The scalar path is the reference the SIMD paths must agree with.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __aabbStoreH__
+#define __aabbStoreH__
+
+#include <vector>
+
+class CFrustum;
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define AABB_USE_SSE
+#endif
+#if defined(AABB_USE_SSE) && defined(__AVX__)
+#define AABB_USE_AVX
+#endif
+
+// Segment p0 -> p0 + d against a box grown by expand on every side (a swept
+// box/sphere reduces to this). Returns true with the entry time t in [0, 1].
+bool sweepSegmentBox(const float p0[3], const float d[3], const float bmin[3], const float bmax[3], float expand, float& t);
+
+class CAabbStore {
+public:
+	enum Path { PATH_SCALAR, PATH_SSE, PATH_AVX };
+
+	CAabbStore(void);
+	~CAabbStore(void) {}
+
+public:
+	void clear(void);
+	void reserve(int count);
+
+	// returns the index of the new box
+	int add(float minX, float minY, float minZ, float maxX, float maxY, float maxZ);
+	void set(int i, float minX, float minY, float minZ, float maxX, float maxY, float maxZ);
+	void kill(int i);
+	// boxes i and j trade places (for owners that keep the boxes in their own order)
+	void swap(int i, int j);
+	// drops the last box
+	void removeLast(void);
+	bool isAlive(int i) const { return m_alive[i] != 0; }
+	int size(void) const { return m_count; }
+	// bounds of every alive box, false when there is none
+	bool getBounds(float bmin[3], float bmax[3]) const;
+
+	// single box tests on the packed data (used with broadphase candidates)
+	bool overlapsBox(int i, float minX, float minY, float minZ, float maxX, float maxY, float maxZ) const
+	{
+		return m_alive[i] &&
+			m_minX[i] <= maxX && m_maxX[i] >= minX &&
+			m_minY[i] <= maxY && m_maxY[i] >= minY &&
+			m_minZ[i] <= maxZ && m_maxZ[i] >= minZ;
+	}
+	void getBox(int i, float bmin[3], float bmax[3]) const
+	{
+		bmin[0] = m_minX[i]; bmin[1] = m_minY[i]; bmin[2] = m_minZ[i];
+		bmax[0] = m_maxX[i]; bmax[1] = m_maxY[i]; bmax[2] = m_maxZ[i];
+	}
+	bool overlapsSphere(int i, float cx, float cy, float cz, float radius) const;
+	// segment p0 -> p0 + d against box i grown by expand
+	bool sweepsBox(int i, const float p0[3], const float d[3], float expand, float& t) const
+	{
+		if (!m_alive[i])
+			return false;
+		float bmin[3] = { m_minX[i], m_minY[i], m_minZ[i] };
+		float bmax[3] = { m_maxX[i], m_maxY[i], m_maxZ[i] };
+		return sweepSegmentBox(p0, d, bmin, bmax, expand, t);
+	}
+
+	// batch tests against every alive box; append hits to out, return hit count
+	int overlapBox(float minX, float minY, float minZ, float maxX, float maxY, float maxZ, std::vector<int>& out) const;
+	int overlapSphere(float cx, float cy, float cz, float radius, std::vector<int>& out) const;
+	// every alive box at least partly inside the frustum, of those in
+	// [begin, end) (end -1 = to the last one)
+	int overlapFrustum(const CFrustum& frustum, std::vector<int>& out, int begin = 0, int end = -1) const;
+	// index of the first alive box overlapping the query, -1 if none
+	int firstOverlapBox(float minX, float minY, float minZ, float maxX, float maxY, float maxZ) const;
+	// earliest alive box hit by the segment p0 -> p0 + d (boxes grown by expand),
+	// -1 if none; tHit gets the time of impact in [0, 1]
+	int sweepSegment(const float p0[3], const float d[3], float expand, float& tHit) const;
+
+	// which kernels the batch tests use (defaults to the widest compiled in)
+	void setPath(Path path);
+	Path getPath(void) const { return m_path; }
+	static bool isPathSupported(Path path);
+	static const char* getPathName(Path path);
+
+private:
+	int overlapBoxScalar(const float q[6], std::vector<int>* out, bool firstOnly) const;
+	int overlapSphereScalar(const float q[4], std::vector<int>& out) const;
+	int sweepSegmentScalar(const float p0[3], const float invD[3], float expand, float& tHit) const;
+	int overlapFrustumScalar(const CFrustum& frustum, std::vector<int>& out, int begin, int end) const;
+#ifdef AABB_USE_SSE
+	int overlapBoxSSE(const float q[6], std::vector<int>* out, bool firstOnly) const;
+	int overlapSphereSSE(const float q[4], std::vector<int>& out) const;
+	int sweepSegmentSSE(const float p0[3], const float invD[3], float expand, float& tHit) const;
+	int overlapFrustumSSE(const CFrustum& frustum, std::vector<int>& out, int begin, int end) const;
+#endif
+#ifdef AABB_USE_AVX
+	int overlapBoxAVX(const float q[6], std::vector<int>* out, bool firstOnly) const;
+	int overlapSphereAVX(const float q[4], std::vector<int>& out) const;
+	int overlapFrustumAVX(const CFrustum& frustum, std::vector<int>& out, int begin, int end) const;
+#endif
+
+	// arrays are padded with dead boxes to a multiple of 8 so the kernels
+	// never need a remainder loop
+	void grow(int count);
+
+	int						m_count;
+	Path					m_path;
+
+	std::vector<float>		m_minX, m_minY, m_minZ;
+	std::vector<float>		m_maxX, m_maxY, m_maxZ;
+	std::vector<int>		m_alive;	// 0 or -1 (all bits set) per box
+};
+
+#endif // __aabbStoreH__
@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: allocCounter.cpp
+//
+// Desc: Counting replacement of the global operator new / delete, so the
+//       benchmarks and checks can tell how many heap allocations a piece of
+//       code made. Linked into the tanksim tool only (CMakeLists.txt), never
+//       into the game: there every allocation would pay for the counter.
+//       It hands its counter to bench::setAllocationCounter() before main().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "benchmark.h"
+#include <atomic>
+#include <new>
+#include <cstdlib>
+
+static std::atomic<long long> s_allocations(0);
+
+static void* countedAlloc(size_t size)
+{
+	s_allocations++;
+	void* p = malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size)
+{
+	return countedAlloc(size);
+}
+
+void* operator new[](size_t size)
+{
+	return countedAlloc(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
+
+static long long getAllocations(void)
+{
+	return s_allocations;
+}
+
+namespace
+{
+	struct RegisterCounter {
+		RegisterCounter(void) { bench::setAllocationCounter(getAllocations); }
+	} s_register;
+}
@@ -0,0 +1,209 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: arenaLayout.cpp
+//
+// Desc: Standard map data (see arenaLayout.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "arenaLayout.h"
+
+// createMap()'s obstacle calls, same order and values
+static const ArenaRun s_obstacleRuns[] = {
+	// partition walls across the field
+	{ 0.4f, 0.7f, 1.0f, 18, 3, -ARENA_WIDTH / 2 + 0.85f, 0.35f, ARENA_DEPTH / 6, ARENA_ALONG_X },
+	{ 1.5f, 0.5f, 1.5f, 1, 5, -ARENA_WIDTH / 2 + 7.95f, 0.25f, ARENA_DEPTH / 6, ARENA_ALONG_X },
+	{ 0.4f, 0.7f, 1.0f, 10, 3, -ARENA_WIDTH / 2 + 7.95f, 0.35f, ARENA_DEPTH / 6 - 10.25f, ARENA_ALONG_Z },
+	{ 1.5f, 0.5f, 1.5f, 1, 5, -ARENA_WIDTH / 2 + 7.95f, 0.25f, ARENA_DEPTH / 6 - 11.5f, ARENA_ALONG_X },
+
+	{ 0.4f, 0.7f, 1.0f, 18, 3, -ARENA_WIDTH / 2 + 0.85f, 0.35f, -ARENA_DEPTH / 6, ARENA_ALONG_X },
+	{ 1.5f, 0.5f, 1.5f, 1, 5, -ARENA_WIDTH / 2 + 7.95f, 0.25f, -ARENA_DEPTH / 6, ARENA_ALONG_X },
+	{ 0.4f, 0.7f, 1.0f, 10, 3, -ARENA_WIDTH / 2 + 7.95f, 0.35f, -ARENA_DEPTH / 6 + 1.25f, ARENA_ALONG_Z },
+	{ 1.5f, 0.5f, 1.5f, 1, 5, -ARENA_WIDTH / 2 + 7.95f, 0.25f, -ARENA_DEPTH / 6 + 11.25f, ARENA_ALONG_X },
+
+	{ 1.5f, 0.5f, 1.5f, 1, 5, 0.0f, 0.25f, -ARENA_DEPTH / 3, ARENA_ALONG_X },
+	{ 0.4f, 0.7f, 1.0f, 15, 3, 0.95f, 0.35f, -ARENA_DEPTH / 3, ARENA_ALONG_X },
+	{ 1.5f, 0.5f, 1.5f, 1, 5, 7.5f, 0.25f, -ARENA_DEPTH / 3, ARENA_ALONG_X },
+	{ 0.8f, 0.7f, 1.0f, 25, 3, 7.5f, 0.35f, -ARENA_DEPTH / 3 + 1.25f, ARENA_ALONG_Z },
+	{ 1.5f, 0.5f, 1.5f, 1, 5, 7.5f, 0.25f, -ARENA_DEPTH / 3 + 26.5f, ARENA_ALONG_X },
+	{ 0.4f, 0.7f, 1.0f, 15, 3, 0.95f, 0.35f, -ARENA_DEPTH / 3 + 26.5f, ARENA_ALONG_X },
+	{ 1.5f, 0.5f, 1.5f, 1, 5, 0.0f, 0.25f, -ARENA_DEPTH / 3 + 26.5f, ARENA_ALONG_X },
+
+	{ 1.5f, 0.5f, 1.5f, 1, 5, 0.0f, 0.25f, ARENA_DEPTH / 3, ARENA_ALONG_X },
+	{ 0.4f, 0.7f, 1.0f, 15, 3, 0.95f, 0.35f, ARENA_DEPTH / 3, ARENA_ALONG_X },
+	{ 1.5f, 0.5f, 1.5f, 1, 5, 7.5f, 0.25f, ARENA_DEPTH / 3, ARENA_ALONG_X },
+	{ 0.8f, 0.7f, 1.0f, 25, 3, 7.5f, 0.35f, ARENA_DEPTH / 3 - 25.25f, ARENA_ALONG_Z },
+	{ 1.5f, 0.5f, 1.5f, 1, 5, 7.5f, 0.25f, ARENA_DEPTH / 3 - 26.5f, ARENA_ALONG_X },
+	{ 0.4f, 0.7f, 1.0f, 15, 3, 0.95f, 0.35f, ARENA_DEPTH / 3 - 26.5f, ARENA_ALONG_X },
+	{ 1.5f, 0.5f, 1.5f, 1, 5, 0.0f, 0.25f, ARENA_DEPTH / 3 - 26.5f, ARENA_ALONG_X },
+
+	// towers near the center
+	{ 1.2f, 0.5f, 1.2f, 1, 8, -2.0f, 0.25f, 3.0f, ARENA_ALONG_X },
+	{ 1.2f, 0.5f, 1.2f, 1, 8, -2.0f, 0.25f, -3.0f, ARENA_ALONG_X },
+	{ 1.2f, 0.5f, 1.2f, 1, 7, -1.0f, 0.25f, 4.0f, ARENA_ALONG_X },
+	{ 1.2f, 0.5f, 1.2f, 1, 7, -1.0f, 0.25f, -4.0f, ARENA_ALONG_X },
+	{ 1.2f, 0.5f, 1.2f, 1, 9, -3.0f, 0.25f, 1.5f, ARENA_ALONG_X },
+	{ 1.2f, 0.5f, 1.2f, 1, 9, -3.0f, 0.25f, -1.5f, ARENA_ALONG_X },
+
+	// stadium model
+	{ 1.2f, 0.8f, 1.2f, 1, 5, 3.0f, 0.4f, 3.0f, ARENA_ALONG_X },
+
+	{ 0.4f, 0.4f, 0.5f, 10, 1, 3.8f, 1.2f, 3.0f, ARENA_ALONG_X },
+	{ 0.4f, 0.4f, 0.5f, 10, 1, 3.8f, 2.0f, 3.0f, ARENA_ALONG_X },
+	{ 0.4f, 0.4f, 0.5f, 10, 1, 3.8f, 2.8f, 3.0f, ARENA_ALONG_X },
+
+	{ 1.2f, 0.8f, 1.2f, 1, 5, 8.2f, 0.4f, 3.0f, ARENA_ALONG_X },
+
+	{ 0.4f, 0.4f, 0.4f, 12, 1, 8.2f, 1.2f, -2.2f, ARENA_ALONG_Z },
+	{ 0.4f, 0.4f, 0.4f, 12, 1, 8.2f, 2.0f, -2.2f, ARENA_ALONG_Z },
+	{ 0.4f, 0.4f, 0.4f, 12, 1, 8.2f, 2.8f, -2.2f, ARENA_ALONG_Z },
+
+	{ 1.2f, 0.8f, 1.2f, 1, 5, 8.2f, 0.4f, -3.0f, ARENA_ALONG_X },
+
+	{ 0.4f, 0.4f, 0.5f, 10, 1, 3.8f, 1.2f, -3.0f, ARENA_ALONG_X },
+	{ 0.4f, 0.4f, 0.5f, 10, 1, 3.8f, 2.0f, -3.0f, ARENA_ALONG_X },
+	{ 0.4f, 0.4f, 0.5f, 10, 1, 3.8f, 2.8f, -3.0f, ARENA_ALONG_X },
+
+	{ 1.2f, 0.8f, 1.2f, 1, 5, 3.0f, 0.4f, -3.0f, ARENA_ALONG_X },
+
+	{ 0.4f, 0.4f, 0.4f, 12, 1, 3.0f, 1.2f, -2.2f, ARENA_ALONG_Z },
+	{ 0.4f, 0.4f, 0.4f, 12, 1, 3.0f, 2.0f, -2.2f, ARENA_ALONG_Z },
+	{ 0.4f, 0.4f, 0.4f, 12, 1, 3.0f, 2.8f, -2.2f, ARENA_ALONG_Z },
+
+	// U shapes at both ends
+	{ 1.4f, 0.5f, 1.4f, 1, 5, -ARENA_WIDTH / 2 + 14.4f, 0.25f, -ARENA_DEPTH / 4 + 13.4f, ARENA_ALONG_X },
+	{ 0.5f, 0.7f, 1.0f, 12, 3, -ARENA_WIDTH / 2 + 14.4f, 0.35f, -ARENA_DEPTH / 4 + 1.2f, ARENA_ALONG_Z },
+	{ 1.4f, 0.5f, 1.4f, 1, 5, -ARENA_WIDTH / 2 + 14.4f, 0.25f, -ARENA_DEPTH / 4, ARENA_ALONG_X },
+	{ 0.5f, 0.7f, 1.0f, 16, 3, -ARENA_WIDTH / 2 + 5.95f, 0.25f, -ARENA_DEPTH / 4, ARENA_ALONG_X },
+
+	{ 1.4f, 0.5f, 1.4f, 1, 5, -ARENA_WIDTH / 2 + 5.0f, 0.25f, -ARENA_DEPTH / 4, ARENA_ALONG_X },
+	{ 0.5f, 0.7f, 1.0f, 14, 3, -ARENA_WIDTH / 2 + 5.0f, 0.35f, -ARENA_DEPTH / 4 - 14.2f, ARENA_ALONG_Z },
+	{ 1.4f, 0.5f, 1.4f, 1, 5, -ARENA_WIDTH / 2 + 5.0f, 0.25f, -ARENA_DEPTH / 4 - 15.4f, ARENA_ALONG_X },
+	{ 0.5f, 0.7f, 1.0f, 20, 3, -ARENA_WIDTH / 2 + 5.95f, 0.35f, -ARENA_DEPTH / 4 - 15.4f, ARENA_ALONG_X },
+	{ 1.4f, 0.5f, 1.4f, 1, 5, -ARENA_WIDTH / 2 + 16.4f, 0.25f, -ARENA_DEPTH / 4 - 15.4f, ARENA_ALONG_X },
+
+	{ 1.4f, 0.5f, 1.4f, 1, 5, -ARENA_WIDTH / 2 + 14.4f, 0.25f, ARENA_DEPTH / 4 - 13.4f, ARENA_ALONG_X },
+	{ 0.5f, 0.7f, 1.0f, 12, 3, -ARENA_WIDTH / 2 + 14.4f, 0.35f, ARENA_DEPTH / 4 - 12.2f, ARENA_ALONG_Z },
+	{ 1.4f, 0.5f, 1.4f, 1, 5, -ARENA_WIDTH / 2 + 14.4f, 0.25f, ARENA_DEPTH / 4, ARENA_ALONG_X },
+	{ 0.5f, 0.7f, 1.0f, 16, 3, -ARENA_WIDTH / 2 + 5.95f, 0.25f, ARENA_DEPTH / 4, ARENA_ALONG_X },
+
+	{ 1.4f, 0.5f, 1.4f, 1, 5, -ARENA_WIDTH / 2 + 5.0f, 0.25f, ARENA_DEPTH / 4, ARENA_ALONG_X },
+	{ 0.5f, 0.7f, 1.0f, 14, 3, -ARENA_WIDTH / 2 + 5.0f, 0.35f, ARENA_DEPTH / 4 + 1.2f, ARENA_ALONG_Z },
+	{ 1.4f, 0.5f, 1.4f, 1, 5, -ARENA_WIDTH / 2 + 5.0f, 0.25f, ARENA_DEPTH / 4 + 15.4f, ARENA_ALONG_X },
+	{ 0.5f, 0.7f, 1.0f, 20, 3, -ARENA_WIDTH / 2 + 5.95f, 0.25f, ARENA_DEPTH / 4 + 15.4f, ARENA_ALONG_X },
+	{ 1.4f, 0.5f, 1.4f, 1, 5, -ARENA_WIDTH / 2 + 16.4f, 0.25f, ARENA_DEPTH / 4 + 15.4f, ARENA_ALONG_X },
+};
+
+void ArenaBox::getBounds(float bmin[3], float bmax[3]) const
+{
+	for (int a = 0; a < 3; a++) {
+		bmin[a] = center[a] - size[a] / 2;
+		bmax[a] = center[a] + size[a] / 2;
+	}
+}
+
+const ArenaRun* CArenaLayout::getObstacleRuns(int& count)
+{
+	count = (int)(sizeof(s_obstacleRuns) / sizeof(s_obstacleRuns[0]));
+	return s_obstacleRuns;
+}
+
+void CArenaLayout::expandRun(const ArenaRun& run, std::vector<ArenaBox>& out)
+{
+	for (int i = 0; i < run.count; i++) {
+		for (int j = 0; j < run.layers; j++) {
+			ArenaBox box;
+			box.center[0] = run.direction == ARENA_ALONG_X ? run.x + run.width * i : run.x;
+			box.center[1] = run.y + run.height * j;
+			box.center[2] = run.direction == ARENA_ALONG_Z ? run.z + run.depth * i : run.z;
+			box.size[0] = run.width;
+			box.size[1] = run.height;
+			box.size[2] = run.depth;
+			out.push_back(box);
+		}
+	}
+}
+
+void CArenaLayout::buildObstacles(std::vector<ArenaBox>& out)
+{
+	int count;
+	const ArenaRun* runs = getObstacleRuns(count);
+	out.clear();
+	for (int i = 0; i < count; i++)
+		expandRun(runs[i], out);
+}
+
+// an empty list means nothing was destroyed; boxes past its end never existed
+static bool isStanding(const std::vector<bool>& alive, int index)
+{
+	return alive.empty() || (index < (int)alive.size() && alive[index]);
+}
+
+void CArenaLayout::buildOccluders(const std::vector<bool>& alive, std::vector<ArenaBox>& out)
+{
+	int count;
+	const ArenaRun* runs = getObstacleRuns(count);
+	out.clear();
+	int first = 0;		// index of the run's first box
+	for (int r = 0; r < count; r++) {
+		const ArenaRun& run = runs[r];
+		int along = run.direction == ARENA_ALONG_X ? 0 : 2;
+		float step = along == 0 ? run.width : run.depth;
+		int start = 0, startHeight = -1;
+		for (int i = 0; i <= run.count; i++) {
+			// layers standing in column i, counted from the ground up
+			int height = 0;
+			if (i < run.count) {
+				while (height < run.layers && isStanding(alive, first + i * run.layers + height))
+					height++;
+			}
+			if (i > 0 && height == startHeight)
+				continue;
+			// columns start..i-1 stand startHeight layers high
+			if (startHeight > 0) {
+				ArenaBox box;
+				box.center[0] = run.x;
+				box.center[1] = run.y - run.height / 2 + run.height * startHeight / 2;
+				box.center[2] = run.z;
+				box.center[along] += step * (start + i - 1) / 2;
+				box.size[0] = run.width;
+				box.size[1] = run.height * startHeight;
+				box.size[2] = run.depth;
+				box.size[along] = step * (i - start);
+				out.push_back(box);
+			}
+			start = i;
+			startHeight = height;
+		}
+		first += run.count * run.layers;
+	}
+}
+
+static ArenaBox makeBox(float x, float y, float z, float width, float height, float depth)
+{
+	ArenaBox box = { { x, y, z }, { width, height, depth } };
+	return box;
+}
+
+void CArenaLayout::buildWalls(std::vector<ArenaBox>& out)
+{
+	const float W = ARENA_WIDTH, D = ARENA_DEPTH;
+	std::vector<ArenaBox> lwall1, swall1, lwall2, swall2;
+	for (int i = -1; i <= 1; i += 2) {
+		lwall1.push_back(makeBox(0.0f, 1.0f, i * D / 2, W - 1, 2.0f, 1.0f));
+		swall1.push_back(makeBox(0.0f, 1.25f, i * D / 2, 1.0f, 2.5f, 1.5f));
+		lwall2.push_back(makeBox(i * W / 2, 1.0f, 0.0f, 1.0f, 2.0f, D - 1));
+	}
+	for (int i = -1; i <= 1; i += 2) {
+		for (int j = -2; j <= 2; j++)
+			swall2.push_back(makeBox(i * W / 2, 1.25f, j * D / 6, 1.5f, 2.5f, 2.0f));
+		for (int j = -1; j <= 1; j += 2)
+			swall2.push_back(makeBox(i * W / 2, 1.5f, j * D / 2, 1.5f, 3.0f, 1.5f));
+	}
+	out.clear();
+	out.insert(out.end(), lwall1.begin(), lwall1.end());
+	out.insert(out.end(), lwall2.begin(), lwall2.end());
+	out.insert(out.end(), swall1.begin(), swall1.end());
+	out.insert(out.end(), swall2.begin(), swall2.end());
+	out.push_back(makeBox(0.0f, -0.0006f / 5, 0.0f, W, 0.03f, D));
+}
@@ -0,0 +1,56 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: arenaLayout.h
+//
+// Desc: The standard map as plain data: the boundary walls, the floor and
+//       the obstacle runs createMap() lays out. The game builds its objects
+//       from it; benchmarks and tools without a device read the same boxes,
+//       so they measure the real arena instead of a made up one.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __arenaLayoutH__
+#define __arenaLayoutH__
+
+#include <vector>
+
+#define ARENA_WIDTH 24.0f
+#define ARENA_DEPTH 100.0f
+
+enum ArenaDirection { ARENA_ALONG_X, ARENA_ALONG_Z };
+
+struct ArenaBox {
+	float center[3];
+	float size[3];		// width, height, depth
+	void getBounds(float bmin[3], float bmax[3]) const;
+};
+
+// one createWWall / createDWall call: count boxes side by side along x or
+// z, each column stacked layers high, starting at the box centered on x, y, z
+struct ArenaRun {
+	float width, height, depth;
+	int count, layers;
+	float x, y, z;
+	int direction;		// ArenaDirection
+};
+
+class CArenaLayout {
+public:
+	// obstacle runs of the standard map, in createMap() order
+	static const ArenaRun* getObstacleRuns(int& count);
+	// boxes of one run, in the order createWWall / createDWall add them
+	static void expandRun(const ArenaRun& run, std::vector<ArenaBox>& out);
+	// every obstacle box of the standard map; the place in the list is the
+	// obstacle id of CTankSim and the game
+	static void buildObstacles(std::vector<ArenaBox>& out);
+	// occluder boxes for the obstacle runs: neighbouring columns standing
+	// to the same height merge into one box. alive is indexed like
+	// buildObstacles() (empty = nothing destroyed); a column stands up to
+	// its first destroyed box
+	static void buildOccluders(const std::vector<bool>& alive, std::vector<ArenaBox>& out);
+	// boundary walls in g_legoWall order (lwall1, lwall2, swall1, swall2),
+	// then the floor
+	static void buildWalls(std::vector<ArenaBox>& out);
+};
+
+#endif // __arenaLayoutH__
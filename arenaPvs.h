@@ -0,0 +1,117 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: arenaPvs.h
+//
+// Desc: Precomputed potentially visible sets for the arena. The floor is
+//       split into square cells; offline, rays are sampled from the eye
+//       band above every cell to the objects of every other cell, and the
+//       occluder boxes between them decide whether the pair can see each
+//       other. The result is one bit row per cell, so at runtime the draw
+//       set of a viewpoint is a cell lookup and a few bit tests.
+//       Sampled rays can miss a narrow gap, so every visible pair is then
+//       widened by one cell on both ends before the table is stored.
+//       That costs all of the culling on the real map: a viewpoint keeps
+//       every standing obstacle (96% before the widening, which dropped a
+//       few boxes that could be seen). The arena is too open for a cell
+//       table, so the game does not load one and leaves culling to the
+//       occlusion culler; this is for maps with closed-off parts.
+//       Destroyed boxes open their cells: a pair whose cell rectangle holds
+//       an opening counts as visible again, which is conservative because
+//       every sight line between two cells stays inside that rectangle.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __arenaPvsH__
+#define __arenaPvsH__
+
+#include <vector>
+
+struct PvsStats {
+	int cells;
+	int pieces;				// occluder boxes cut at cell borders
+	long long pairs;		// cell pairs tested (not neighbours, not empty)
+	long long visible;		// of all cell pairs, including neighbours
+	long long rays;			// rays cast by build()
+	double buildMs;
+	float getVisibleRatio(void) const { return cells ? (float)visible / ((float)cells * cells) : 0.0f; }
+};
+
+class CArenaPvs {
+public:
+	enum { SAMPLES = 3 };	// sample points per cell side and per height
+
+	CArenaPvs(void);
+	~CArenaPvs(void) {}
+
+public:
+	// offline: cells of cellSize over [minX, minX + width] x [minZ, minZ +
+	// depth]. occluders and targets are boxes (min x, y, z, max x, y, z);
+	// a cell's target column reaches from the floor to its highest target,
+	// at least minTop. Viewpoints are taken between eyeMinY and eyeMaxY
+	void build(const float* occluders, int occluderCount, const float* targets, int targetCount,
+		float minX, float minZ, float width, float depth, float cellSize,
+		float eyeMinY, float eyeMaxY, float minTop);
+	// the standard map: CArenaLayout obstacles as occluders and targets
+	void buildArena(float cellSize, float eyeMinY, float eyeMaxY, float minTop);
+
+	// the file starts with a key made of the occluders and the build
+	// parameters; loadArena() only takes a file buildArena() would make
+	// with the same arguments from the current map
+	bool save(const char* path) const;
+	bool loadArena(const char* path, float cellSize, float eyeMinY, float eyeMaxY, float minTop);
+	bool isBuilt(void) const { return m_cellsX > 0; }
+
+	// -1 outside the grid
+	int getCell(float x, float z) const;
+	int getCellCount(void) const { return m_cellsX * m_cellsZ; }
+	int getRowWords(void) const { return m_rowWords; }
+	bool isCellVisible(int from, int to) const { return (m_bits[from * m_rowWords + (to >> 5)] >> (to & 31)) & 1; }
+
+	// destroyed boxes (the same boxes the map lost); clearOpenings() for a
+	// new map
+	void openBox(const float bmin[3], const float bmax[3]);
+	void clearOpenings(void);
+
+	// once per frame: false (and everything visible) when the eye is off
+	// the grid or outside the eye band. The row is only recomputed when the
+	// cell or the openings changed
+	bool setViewpoint(float x, float y, float z);
+	// after setViewpoint(): may any part of the box be seen
+	bool isBoxVisible(const float bmin[3], const float bmax[3]) const;
+	const PvsStats& getStats(void) const { return m_stats; }
+
+private:
+	void cellRange(float lo, float hi, float origin, int cells, int& first, int& last) const;
+	bool isPairVisible(int a, int b, std::vector<int>& candidates);
+	void dilate(void);
+	void updateRow(void);
+	static unsigned makeKey(const float* occluders, int count, const float params[4]);
+
+	// grid
+	float					m_minX, m_minZ, m_cellSize;
+	int						m_cellsX, m_cellsZ;
+	float					m_eyeMinY, m_eyeMaxY;
+	unsigned				m_key;			// makeKey() of the build
+	int						m_rowWords;
+	std::vector<unsigned>	m_bits;			// row per cell
+
+	// build only: target column height and occluders cut per cell
+	std::vector<float>		m_tops;
+	std::vector<float>		m_pieces;
+	std::vector<int>		m_cellPieces;	// first piece of cell c (cells + 1 entries)
+
+	// destruction
+	std::vector<int>		m_openings;		// opened boxes touching each cell
+	std::vector<int>		m_openSum;		// summed area table of m_openings
+	int						m_openVersion;
+
+	// viewpoint
+	int						m_viewCell;
+	int						m_rowVersion;	// m_openVersion m_row was made for
+	std::vector<unsigned>	m_row;
+	bool					m_active;
+
+	PvsStats				m_stats;
+};
+
+#endif // __arenaPvsH__
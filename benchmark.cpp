@@ -0,0 +1,2809 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: benchmark.cpp
+//
+// Desc: Headless micro benchmarks (see benchmark.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "benchmark.h"
+#include "spatialGrid.h"
+#include "aabbStore.h"
+#include "firingTable.h"
+#include "collisionWorld.h"
+#include "handlePool.h"
+#include "projectiles.h"
+#include "compoundCollider.h"
+#include "renderQueue.h"
+#include "meshCache.h"
+#include "chunkedBatch.h"
+#include "frustum.h"
+#include "sphereLod.h"
+#include "softRaster.h"
+#include "arenaLayout.h"
+#include "hudText.h"
+#include "occlusionCuller.h"
+#include "arenaPvs.h"
+#include "tankSim.h"
+#include "simScript.h"
+#include "lazyTransform.h"
+#include "entityRegistry.h"
+#include "jobSystem.h"
+#include "simThread.h"
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#ifdef BENCH_D3DX
+#include <d3dx9.h>	// the game build: bench::Transforms against D3DX itself
+#endif
+
+using namespace std;
+
+// set by allocCounter.cpp before main(); NULL in the game
+static long long (*s_allocationCounter)(void) = NULL;
+
+void bench::setAllocationCounter(long long (*counter)(void))
+{
+	s_allocationCounter = counter;
+}
+
+long long bench::getAllocationCount(void)
+{
+	return s_allocationCounter != NULL ? s_allocationCounter() : -1;
+}
+
+// same arena as virtualLego.cpp
+#define BENCH_WORLD_WIDTH 24.0f
+#define BENCH_WORLD_DEPTH 100.0f
+
+namespace
+{
+	double nowNs()
+	{
+		return (double)chrono::duration_cast<chrono::nanoseconds>(
+			chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Mirrors the memory layout of a CObstacle (matrix, material, mesh pointer
+	// next to the collision data) so the linear scan pays the same cache cost.
+	struct BenchObstacle {
+		float x, y, z;
+		float width, depth, height;
+		bool created;
+		float mLocal[16];
+		float mtrl[17];
+		void* mesh;
+	};
+
+	bool overlapXZ(const BenchObstacle& o, float minX, float minZ, float maxX, float maxZ)
+	{
+		return o.x - o.width / 2 <= maxX && o.x + o.width / 2 >= minX &&
+			o.z - o.depth / 2 <= maxZ && o.z + o.depth / 2 >= minZ;
+	}
+
+	BenchObstacle makeWall(float x, float y, float z, float width, float height, float depth)
+	{
+		BenchObstacle o;
+		memset(&o, 0, sizeof(o));
+		o.x = x;
+		o.y = y;
+		o.z = z;
+		o.width = width;
+		o.height = height;
+		o.depth = depth;
+		o.created = true;
+		return o;
+	}
+
+	// the boundary walls and pillars made by createWall()
+	void makeArenaWalls(vector<vector<BenchObstacle> >& out)
+	{
+		const float W = BENCH_WORLD_WIDTH, D = BENCH_WORLD_DEPTH;
+		vector<BenchObstacle> lwall1, swall1, lwall2, swall2;
+		for (int i = -1; i <= 1; i += 2) {
+			lwall1.push_back(makeWall(0.0f, 1.0f, i * D / 2, W - 1, 2.0f, 1.0f));
+			swall1.push_back(makeWall(0.0f, 1.25f, i * D / 2, 1.0f, 2.5f, 1.5f));
+			lwall2.push_back(makeWall(i * W / 2, 1.0f, 0.0f, 1.0f, 2.0f, D - 1));
+		}
+		for (int i = -1; i <= 1; i += 2) {
+			for (int j = -2; j <= 2; j++)
+				swall2.push_back(makeWall(i * W / 2, 1.25f, j * D / 6, 1.5f, 2.5f, 2.0f));
+			for (int j = -1; j <= 1; j += 2)
+				swall2.push_back(makeWall(i * W / 2, 1.5f, j * D / 2, 1.5f, 3.0f, 1.5f));
+		}
+		out.clear();
+		out.push_back(lwall1);
+		out.push_back(lwall2);
+		out.push_back(swall1);
+		out.push_back(swall2);
+	}
+
+	// what buildCollisionWorld() makes of the walls and the floor
+	void buildArenaWorld(const vector<vector<BenchObstacle> >& walls, CCollisionWorld& world)
+	{
+		world.clear();
+		for (size_t i = 0; i < walls.size(); i++) {
+			for (size_t j = 0; j < walls[i].size(); j++) {
+				const BenchObstacle& o = walls[i][j];
+				float bmin[3] = { o.x - o.width / 2, o.y - o.height / 2, o.z - o.depth / 2 };
+				float bmax[3] = { o.x + o.width / 2, o.y + o.height / 2, o.z + o.depth / 2 };
+				world.add(bmin, bmax, CCollisionWorld::KIND_WALL);
+			}
+		}
+		float fmin[3] = { -BENCH_WORLD_WIDTH / 2, -0.015f, -BENCH_WORLD_DEPTH / 2 };
+		float fmax[3] = { BENCH_WORLD_WIDTH / 2, 0.015f, BENCH_WORLD_DEPTH / 2 };
+		world.add(fmin, fmax, CCollisionWorld::KIND_FLOOR);
+		world.build();
+	}
+
+	bool overlapBox(const BenchObstacle& o, const float bmin[3], const float bmax[3])
+	{
+		return o.x - o.width / 2 <= bmax[0] && o.x + o.width / 2 >= bmin[0] &&
+			o.y - o.height / 2 <= bmax[1] && o.y + o.height / 2 >= bmin[1] &&
+			o.z - o.depth / 2 <= bmax[2] && o.z + o.depth / 2 >= bmin[2];
+	}
+
+	// the old Tank::tankUpdate took the walls by value
+	bool scanWallsByValue(vector<vector<BenchObstacle> > walls, const float bmin[3], const float bmax[3])
+	{
+		bool hit = false;
+		for (size_t i = 0; i < walls.size(); i++) {
+			for (size_t j = 0; j < walls[i].size(); j++) {
+				if (overlapBox(walls[i][j], bmin, bmax))
+					hit = true;
+			}
+		}
+		return hit;
+	}
+
+	RenderMaterial makeMaterial(float r, float g, float b)
+	{
+		RenderMaterial m;
+		memset(&m, 0, sizeof(m));
+		float c[4] = { r, g, b, 1.0f };
+		memcpy(m.diffuse, c, sizeof(c));
+		memcpy(m.ambient, c, sizeof(c));
+		memcpy(m.specular, c, sizeof(c));
+		m.power = 5.0f;
+		return m;
+	}
+
+	// allocates and fills buffers the size D3DXCreateBox/D3DXCreateSphere
+	// would (position + normal vertices, 16 bit indices)
+	class BenchMeshFactory : public CMeshFactory {
+	public:
+		void* createMesh(const MeshKey& key, unsigned& bytes)
+		{
+			unsigned vertices = 24, faces = 12;
+			if (key.shape == MeshKey::SPHERE) {
+				vertices = key.slices * (key.stacks - 1) + 2;
+				faces = 2 * key.slices * (key.stacks - 1);
+			}
+			bytes = vertices * 24 + faces * 3 * 2;
+			char* mesh = new char[bytes];
+			memset(mesh, 0x3f, bytes);
+			return mesh;
+		}
+		void destroyMesh(void* mesh) { delete[] static_cast<char*>(mesh); }
+	};
+
+	// obstacles with the partition sizes used by createMap()
+	void makeObstacles(int count, mt19937& rng, vector<BenchObstacle>& out)
+	{
+		static const float sizes[][3] = {
+			{ 0.4f, 0.7f, 1.0f }, { 1.5f, 0.5f, 1.5f }, { 0.5f, 0.7f, 1.0f },
+			{ 1.2f, 0.5f, 1.2f }, { 0.4f, 0.4f, 0.5f }, { 0.8f, 0.7f, 1.0f }
+		};
+		uniform_real_distribution<float> px(-BENCH_WORLD_WIDTH / 2, BENCH_WORLD_WIDTH / 2);
+		uniform_real_distribution<float> pz(-BENCH_WORLD_DEPTH / 2, BENCH_WORLD_DEPTH / 2);
+		uniform_int_distribution<int> ps(0, 5);
+
+		out.resize(count);
+		for (int i = 0; i < count; i++) {
+			BenchObstacle& o = out[i];
+			memset(&o, 0, sizeof(o));
+			const float* s = sizes[ps(rng)];
+			o.x = px(rng);
+			o.z = pz(rng);
+			o.y = s[1] / 2;
+			o.width = s[0];
+			o.height = s[1];
+			o.depth = s[2];
+			o.created = true;
+		}
+	}
+
+	// D3DXMatrixLookAtLH with up = (0, 1, 0)
+	void makeView(const float eye[3], const float at[3], float view[16])
+	{
+		float z[3] = { at[0] - eye[0], at[1] - eye[1], at[2] - eye[2] };
+		float len = sqrtf(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+		for (int a = 0; a < 3; a++)
+			z[a] /= len;
+		float x[3] = { z[2], 0.0f, -z[0] };	// up (0, 1, 0) cross z
+		len = sqrtf(x[0] * x[0] + x[2] * x[2]);
+		x[0] /= len;
+		x[2] /= len;
+		float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+		const float* axis[3] = { x, y, z };
+		memset(view, 0, 16 * sizeof(float));
+		for (int c = 0; c < 3; c++) {
+			for (int r = 0; r < 3; r++)
+				view[r * 4 + c] = axis[c][r];
+			view[12 + c] = -(axis[c][0] * eye[0] + axis[c][1] * eye[1] + axis[c][2] * eye[2]);
+		}
+		view[15] = 1.0f;
+	}
+
+	// D3DXMatrixPerspectiveFovLH(pi / 4, aspect, 1, 100), as in Setup()
+	void makeProjection(float aspect, float proj[16])
+	{
+		const float zn = 1.0f, zf = 100.0f;
+		float ys = 1.0f / tanf(3.14159265f / 8), q = zf / (zf - zn);
+		memset(proj, 0, 16 * sizeof(float));
+		proj[0] = ys / aspect;
+		proj[5] = ys;
+		proj[10] = q;
+		proj[11] = 1.0f;
+		proj[14] = -zn * q;
+	}
+
+	// game camera (4 / 3 unless told otherwise): view * projection
+	void makeViewProj(const float eye[3], const float at[3], float out[16], float aspect = 4.0f / 3.0f)
+	{
+		float view[16], proj[16];
+		makeView(eye, at, view);
+		makeProjection(aspect, proj);
+		for (int r = 0; r < 4; r++) {
+			const float* v = &view[r * 4];
+			out[r * 4] = v[0] * proj[0];
+			out[r * 4 + 1] = v[1] * proj[5];
+			out[r * 4 + 2] = v[2] * proj[10] + v[3] * proj[14];
+			out[r * 4 + 3] = v[2];
+		}
+	}
+	// values the HUD shows in one frame
+	struct HudFrame {
+		int remain;
+		double degree, distance;
+		int tankDistance;
+		int tris;
+	};
+
+	// the HUD lines as Render() used to build them
+	void formatHudOld(const HudFrame& f, string out[4])
+	{
+		out[0] = "TIME: " + to_string(f.remain);
+		ostringstream oss;
+		oss << "FIRE Degree: " << fixed << setprecision(2) << f.degree << HUD_DEGREE_SIGN;
+		out[1] = oss.str();
+		oss.str("");
+		oss << "FIRE Distance: " << std::fixed << std::setprecision(2) << f.distance;
+		out[2] = oss.str();
+		out[3] = "Tank Distance: " + to_string(f.tankDistance);
+	}
+
+	// the same lines through CHudText, as Render() does now
+	void printHud(CHudText& hud, const HudFrame& f, bool stats)
+	{
+		hud.printInt(0, f.remain > 5 ? 0xff000000 : 0xffff0000, "TIME: ", f.remain);
+		hud.printFixed(1, 0xff000000, "FIRE Degree: ", f.degree, 2, HUD_DEGREE_SIGN);
+		hud.printFixed(2, 0xff000000, "FIRE Distance: ", f.distance, 2);
+		hud.printInt(3, 0xff000000, "Tank Distance: ", f.tankDistance);
+		if (stats)
+			hud.format(4, 0xff000000, "Spheres: %d  Tris: %d / %d", 3, f.tris, 313000);
+	}
+}
+
+bool bench::SpatialGrid(FILE* fp)
+{
+	const int TICKS = 2000;
+	const float TANK_HALF_WIDTH = 0.35f, TANK_HALF_DEPTH = 0.75f;
+
+	fprintf(fp, "== tank vs obstacle broadphase (2 tanks per tick, %d ticks) ==\n", TICKS);
+	fprintf(fp, "%10s %14s %14s %10s %8s\n", "obstacles", "linear ns/tick", "grid ns/tick", "speedup", "hits");
+
+	mt19937 rng(1234);
+	uniform_real_distribution<float> px(-BENCH_WORLD_WIDTH / 2, BENCH_WORLD_WIDTH / 2);
+	uniform_real_distribution<float> pz(-BENCH_WORLD_DEPTH / 2, BENCH_WORLD_DEPTH / 2);
+
+	vector<float> tankX(TICKS * 2), tankZ(TICKS * 2);
+	for (int i = 0; i < TICKS * 2; i++) {
+		tankX[i] = px(rng);
+		tankZ[i] = pz(rng);
+	}
+
+	bool ok = true;
+	for (int count = 1000; count <= 64000; count *= 2) {
+		vector<BenchObstacle> obstacles;
+		makeObstacles(count, rng, obstacles);
+
+		CSpatialGrid grid;
+		grid.init(-BENCH_WORLD_WIDTH / 2 - 1, -BENCH_WORLD_DEPTH / 2 - 1, BENCH_WORLD_WIDTH + 2, BENCH_WORLD_DEPTH + 2, 2.0f);
+		for (int i = 0; i < count; i++) {
+			const BenchObstacle& o = obstacles[i];
+			grid.insert(i, o.x - o.width / 2, o.z - o.depth / 2, o.x + o.width / 2, o.z + o.depth / 2);
+		}
+
+		int linearHits = 0;
+		double t0 = nowNs();
+		for (int t = 0; t < TICKS * 2; t++) {
+			float minX = tankX[t] - TANK_HALF_WIDTH, maxX = tankX[t] + TANK_HALF_WIDTH;
+			float minZ = tankZ[t] - TANK_HALF_DEPTH, maxZ = tankZ[t] + TANK_HALF_DEPTH;
+			for (int i = 0; i < count; i++) {
+				if (obstacles[i].created && overlapXZ(obstacles[i], minX, minZ, maxX, maxZ))
+					linearHits++;
+			}
+		}
+		double linearNs = (nowNs() - t0) / TICKS;
+
+		int gridHits = 0;
+		vector<int> nearby;
+		t0 = nowNs();
+		for (int t = 0; t < TICKS * 2; t++) {
+			float minX = tankX[t] - TANK_HALF_WIDTH, maxX = tankX[t] + TANK_HALF_WIDTH;
+			float minZ = tankZ[t] - TANK_HALF_DEPTH, maxZ = tankZ[t] + TANK_HALF_DEPTH;
+			nearby.clear();
+			grid.query(minX, minZ, maxX, maxZ, nearby);
+			for (size_t k = 0; k < nearby.size(); k++) {
+				const BenchObstacle& o = obstacles[nearby[k]];
+				if (o.created && overlapXZ(o, minX, minZ, maxX, maxZ))
+					gridHits++;
+			}
+		}
+		double gridNs = (nowNs() - t0) / TICKS;
+
+		bool same = linearHits == gridHits;
+		ok = ok && same;
+		fprintf(fp, "%10d %14.0f %14.0f %9.1fx %8s\n", count, linearNs, gridNs,
+			linearNs / (gridNs > 0 ? gridNs : 1), same ? "match" : "DIFF");
+	}
+	fprintf(fp, "\n");
+	return ok;
+}
+
+bool bench::Explosion(FILE* fp)
+{
+	const int IMPACTS = 2000;
+	const float RADIUS = 0.06f + 1.5f;	// MISSILE_EXPOLSION_RADIUS
+
+	fprintf(fp, "== missile explosion (%d impacts) ==\n", IMPACTS);
+	fprintf(fp, "%10s %16s %16s %10s %8s\n", "obstacles", "rescan ns/impact", "query ns/impact", "speedup", "removed");
+
+	mt19937 rng(4321);
+	uniform_real_distribution<float> px(-BENCH_WORLD_WIDTH / 2, BENCH_WORLD_WIDTH / 2);
+	uniform_real_distribution<float> pz(-BENCH_WORLD_DEPTH / 2, BENCH_WORLD_DEPTH / 2);
+	vector<float> hitX(IMPACTS), hitZ(IMPACTS);
+	for (int i = 0; i < IMPACTS; i++) {
+		hitX[i] = px(rng);
+		hitZ[i] = pz(rng);
+	}
+
+	bool ok = true;
+	for (int count = 1000; count <= 64000; count *= 2) {
+		vector<BenchObstacle> obstacles;
+		makeObstacles(count, rng, obstacles);
+
+		CSpatialGrid grid;
+		grid.init(-BENCH_WORLD_WIDTH / 2 - 1, -BENCH_WORLD_DEPTH / 2 - 1, BENCH_WORLD_WIDTH + 2, BENCH_WORLD_DEPTH + 2, 2.0f);
+		for (int i = 0; i < count; i++) {
+			const BenchObstacle& o = obstacles[i];
+			grid.insert(i, o.x - o.width / 2, o.z - o.depth / 2, o.x + o.width / 2, o.z + o.depth / 2);
+		}
+
+		// nothing is destroyed here so both passes see the same field every impact
+		int rescanRemoved = 0;
+		double t0 = nowNs();
+		for (int n = 0; n < IMPACTS; n++) {
+			for (int i = 0; i < count; i++) {
+				if (obstacles[i].created && overlapXZ(obstacles[i], hitX[n] - RADIUS, hitZ[n] - RADIUS, hitX[n] + RADIUS, hitZ[n] + RADIUS))
+					rescanRemoved++;
+			}
+		}
+		double rescanNs = (nowNs() - t0) / IMPACTS;
+
+		int queryRemoved = 0;
+		vector<int> blast;
+		t0 = nowNs();
+		for (int n = 0; n < IMPACTS; n++) {
+			blast.clear();
+			grid.query(hitX[n] - RADIUS, hitZ[n] - RADIUS, hitX[n] + RADIUS, hitZ[n] + RADIUS, blast);
+			for (size_t k = 0; k < blast.size(); k++) {
+				const BenchObstacle& o = obstacles[blast[k]];
+				if (o.created && overlapXZ(o, hitX[n] - RADIUS, hitZ[n] - RADIUS, hitX[n] + RADIUS, hitZ[n] + RADIUS))
+					queryRemoved++;
+			}
+		}
+		double queryNs = (nowNs() - t0) / IMPACTS;
+
+		bool same = rescanRemoved == queryRemoved;
+		ok = ok && same;
+		fprintf(fp, "%10d %16.0f %16.0f %9.1fx %8.1f%s\n", count, rescanNs, queryNs,
+			rescanNs / (queryNs > 0 ? queryNs : 1), (double)queryRemoved / IMPACTS, same ? "" : " DIFF");
+	}
+	fprintf(fp, "\n");
+	return ok;
+}
+
+bool bench::AabbBatch(FILE* fp)
+{
+	const int QUERIES = 256;
+	const float R = 0.06f * 0.8f;	// missile box half size
+
+	fprintf(fp, "== missile vs all boxes (%d queries, boxes tested per ns) ==\n", QUERIES);
+	fprintf(fp, "%10s %10s %10s %10s %10s %10s %8s\n", "boxes", "aos", "scalar", "sse", "avx", "sphere", "hits");
+
+	mt19937 rng(777);
+	uniform_real_distribution<float> px(-BENCH_WORLD_WIDTH / 2, BENCH_WORLD_WIDTH / 2);
+	uniform_real_distribution<float> py(0.0f, 3.0f);
+	uniform_real_distribution<float> pz(-BENCH_WORLD_DEPTH / 2, BENCH_WORLD_DEPTH / 2);
+	vector<float> qx(QUERIES), qy(QUERIES), qz(QUERIES);
+	for (int i = 0; i < QUERIES; i++) {
+		qx[i] = px(rng);
+		qy[i] = py(rng);
+		qz[i] = pz(rng);
+	}
+
+	bool ok = true;
+	for (int count = 1000; count <= 64000; count *= 2) {
+		vector<BenchObstacle> obstacles;
+		makeObstacles(count, rng, obstacles);
+
+		CAabbStore store;
+		store.reserve(count);
+		for (int i = 0; i < count; i++) {
+			const BenchObstacle& o = obstacles[i];
+			store.add(o.x - o.width / 2, o.y - o.height / 2, o.z - o.depth / 2,
+				o.x + o.width / 2, o.y + o.height / 2, o.z + o.depth / 2);
+		}
+		// a quarter of the field already destroyed
+		for (int i = 0; i < count; i += 4) {
+			obstacles[i].created = false;
+			store.kill(i);
+		}
+
+		double tested = (double)count * QUERIES;
+		int aosHits = 0;
+		double t0 = nowNs();
+		for (int n = 0; n < QUERIES; n++) {
+			for (int i = 0; i < count; i++) {
+				const BenchObstacle& o = obstacles[i];
+				if (o.created &&
+					qx[n] <= o.x + o.width / 2 + R && qx[n] >= o.x - o.width / 2 - R &&
+					qy[n] <= o.y + o.height / 2 + R && qy[n] >= o.y - o.height / 2 - R &&
+					qz[n] <= o.z + o.depth / 2 + R && qz[n] >= o.z - o.depth / 2 - R)
+					aosHits++;
+			}
+		}
+		double aosRate = tested / (nowNs() - t0);
+
+		double rate[3] = { 0, 0, 0 };
+		int hits[3] = { 0, 0, 0 };
+		vector<int> out;
+		out.reserve(count);
+		for (int p = CAabbStore::PATH_SCALAR; p <= CAabbStore::PATH_AVX; p++) {
+			if (!CAabbStore::isPathSupported((CAabbStore::Path)p))
+				continue;
+			store.setPath((CAabbStore::Path)p);
+			t0 = nowNs();
+			for (int n = 0; n < QUERIES; n++) {
+				out.clear();
+				hits[p] += store.overlapBox(qx[n] - R, qy[n] - R, qz[n] - R, qx[n] + R, qy[n] + R, qz[n] + R, out);
+			}
+			rate[p] = tested / (nowNs() - t0);
+		}
+
+		// exact sphere test on the widest path
+		t0 = nowNs();
+		for (int n = 0; n < QUERIES; n++) {
+			out.clear();
+			store.overlapSphere(qx[n], qy[n], qz[n], 0.06f, out);
+		}
+		double sphereRate = tested / (nowNs() - t0);
+
+		bool agree = hits[0] == aosHits;
+		for (int p = 1; p <= 2; p++) {
+			if (CAabbStore::isPathSupported((CAabbStore::Path)p) && hits[p] != hits[0])
+				agree = false;
+		}
+		ok = ok && agree;
+		fprintf(fp, "%10d %10.2f %10.2f %10.2f %10.2f %10.2f %8s\n", count, aosRate, rate[0], rate[1], rate[2],
+			sphereRate, agree ? "match" : "DIFF");
+	}
+	fprintf(fp, "(0.00 = path not compiled in)\n\n");
+	return ok;
+}
+
+void bench::FiringTable(FILE* fp)
+{
+	const int QUERIES = 4096;
+	const int ARC_POINTS = 48;
+
+	// same numbers as CTankSim::buildFiringTable()
+	FiringModel model;
+	model.power = 1.25f;
+	model.gravity = 3.5f;
+	model.decreaseRate = 0.9985f;
+	model.moveScale = 3.3f;
+	model.tickDelta = 0.7f / 120.0f;
+	model.launchHeight = 0.73f;
+	model.groundHeight = 0.06f;
+	model.maxTicks = 20000;
+
+	CFiringTable table;
+	double t0 = nowNs();
+	table.build(model, 89.0f, 1.0f, 16.0f, 0.25f);
+	double buildMs = (nowNs() - t0) / 1e6;
+
+	// aims a player can reach: blue ball 0.4 ~ 15 ahead, up to 10 above the turret
+	mt19937 rng(4242);
+	uniform_real_distribution<float> pd(0.4f, 15.0f);
+	uniform_real_distribution<float> ph(0.0f, 10.0f);
+	vector<float> degree(QUERIES), distance(QUERIES);
+	for (int i = 0; i < QUERIES; i++) {
+		distance[i] = pd(rng);
+		degree[i] = (float)(atan2(ph(rng), distance[i]) * 180 / 3.14159265);
+	}
+
+	double simSum = 0;
+	t0 = nowNs();
+	for (int i = 0; i < QUERIES; i++) {
+		float range;
+		int ticks;
+		table.simulate(degree[i], distance[i], range, ticks);
+		simSum += range;
+	}
+	double simNs = (nowNs() - t0) / QUERIES;
+
+	double lookupSum = 0, maxError = 0;
+	t0 = nowNs();
+	for (int i = 0; i < QUERIES; i++) {
+		float range, ticks;
+		table.lookup(degree[i], distance[i], range, ticks);
+		lookupSum += range;
+	}
+	double lookupNs = (nowNs() - t0) / QUERIES;
+
+	vector<float> ground(ARC_POINTS), height(ARC_POINTS);
+	t0 = nowNs();
+	for (int i = 0; i < QUERIES; i++)
+		table.sampleArc(degree[i], distance[i], ARC_POINTS, &ground[0], &height[0]);
+	double arcNs = (nowNs() - t0) / QUERIES;
+
+	for (int i = 0; i < QUERIES; i++) {
+		float exact, range, ticks;
+		int n;
+		table.simulate(degree[i], distance[i], exact, n);
+		table.lookup(degree[i], distance[i], range, ticks);
+		double e = fabs((double)range - exact);
+		if (e > maxError)
+			maxError = e;
+	}
+
+	fprintf(fp, "== aim preview (%d aims, %d table entries built in %.2f ms) ==\n", QUERIES, table.getEntryCount(), buildMs);
+	fprintf(fp, "%14s %14s %14s %14s\n", "simulate ns", "lookup ns", "arc ns", "max error");
+	fprintf(fp, "%14.1f %14.1f %14.1f %14.4f\n", simNs, lookupNs, arcNs, maxError);
+	fprintf(fp, "(mean range %.3f simulated, %.3f looked up)\n\n", simSum / QUERIES, lookupSum / QUERIES);
+}
+
+bool bench::ArenaWalls(FILE* fp)
+{
+	const int TICKS = 20000;
+
+	vector<vector<BenchObstacle> > walls;
+	makeArenaWalls(walls);
+	CCollisionWorld world;
+	buildArenaWorld(walls, world);
+	int wallCount = world.getBoxCount() - 1;
+
+	// two tank bodies and one missile step per tick, anywhere in the arena
+	mt19937 rng(99);
+	uniform_real_distribution<float> px(-BENCH_WORLD_WIDTH / 2, BENCH_WORLD_WIDTH / 2);
+	uniform_real_distribution<float> pz(-BENCH_WORLD_DEPTH / 2, BENCH_WORLD_DEPTH / 2);
+	uniform_real_distribution<float> step(-0.2f, 0.2f);
+	vector<float> tx(TICKS * 2), tz(TICKS * 2), p(TICKS * 3), d(TICKS * 3);
+	for (int i = 0; i < TICKS * 2; i++) {
+		tx[i] = px(rng);
+		tz[i] = pz(rng);
+	}
+	for (int i = 0; i < TICKS; i++) {
+		p[i * 3] = px(rng);
+		p[i * 3 + 1] = 1.0f;
+		p[i * 3 + 2] = pz(rng);
+		for (int a = 0; a < 3; a++)
+			d[i * 3 + a] = step(rng);
+	}
+	const float R = 0.06f * 0.8f;
+
+	int oldHits = 0;
+	double t0 = nowNs();
+	for (int n = 0; n < TICKS; n++) {
+		for (int k = 0; k < 2; k++) {
+			float bmin[3] = { tx[n * 2 + k] - 0.5f, 0.2f, tz[n * 2 + k] - 0.7f };
+			float bmax[3] = { tx[n * 2 + k] + 0.5f, 0.56f, tz[n * 2 + k] + 0.7f };
+			if (scanWallsByValue(walls, bmin, bmax))
+				oldHits++;
+		}
+		float best = 1.0f, t;
+		for (size_t i = 0; i < walls.size(); i++) {
+			for (size_t j = 0; j < walls[i].size(); j++) {
+				const BenchObstacle& o = walls[i][j];
+				float bmin[3] = { o.x - o.width / 2, o.y - o.height / 2, o.z - o.depth / 2 };
+				float bmax[3] = { o.x + o.width / 2, o.y + o.height / 2, o.z + o.depth / 2 };
+				if (sweepSegmentBox(&p[n * 3], &d[n * 3], bmin, bmax, R, t) && t < best)
+					best = t;
+			}
+		}
+		if (best < 1.0f)
+			oldHits++;
+	}
+	double oldNs = (nowNs() - t0) / TICKS;
+
+	int newHits = 0;
+	t0 = nowNs();
+	for (int n = 0; n < TICKS; n++) {
+		for (int k = 0; k < 2; k++) {
+			float bmin[3] = { tx[n * 2 + k] - 0.5f, 0.2f, tz[n * 2 + k] - 0.7f };
+			float bmax[3] = { tx[n * 2 + k] + 0.5f, 0.56f, tz[n * 2 + k] + 0.7f };
+			if (world.overlaps(bmin, bmax, CCollisionWorld::KIND_WALL))
+				newHits++;
+		}
+		float t;
+		if (world.sweepSegment(&p[n * 3], &d[n * 3], R, CCollisionWorld::KIND_WALL, t) >= 0 && t < 1.0f)
+			newHits++;
+	}
+	double newNs = (nowNs() - t0) / TICKS;
+
+	bool same = oldHits == newHits;
+	fprintf(fp, "== arena walls per tick (%d walls, %d BVH nodes, 2 tanks + 1 missile) ==\n", wallCount, world.getNodeCount());
+	fprintf(fp, "%14s %14s %10s\n", "copy+scan ns", "bvh ns", "hits");
+	fprintf(fp, "%14.1f %14.1f %10s\n\n", oldNs, newNs, same ? "match" : "DIFF");
+	return same;
+}
+
+bool bench::ObstaclePool(FILE* fp)
+{
+	const int COUNT = 16000;
+	const int FRAMES = 200;
+
+	fprintf(fp, "== obstacle loop per frame (%d obstacles, ns per frame) ==\n", COUNT);
+	fprintf(fp, "%10s %12s %12s %12s %8s\n", "destroyed", "vector", "pool", "compact us", "check");
+
+	mt19937 rng(2024);
+	vector<BenchObstacle> obstacles;
+	makeObstacles(COUNT, rng, obstacles);
+
+	bool ok = true;
+	for (int percent = 0; percent <= 90; percent += 30) {
+		vector<BenchObstacle> flat = obstacles;
+		CHandlePool<BenchObstacle> pool;
+		pool.reserve(COUNT);
+		vector<PoolHandle> handles(COUNT);
+		for (int i = 0; i < COUNT; i++)
+			handles[i] = pool.add(flat[i]);
+
+		// destroy the same random obstacles in both
+		vector<int> order(COUNT);
+		for (int i = 0; i < COUNT; i++)
+			order[i] = i;
+		shuffle(order.begin(), order.end(), rng);
+		int destroyed = COUNT * percent / 100;
+		for (int k = 0; k < destroyed; k++) {
+			flat[order[k]].created = false;
+			pool.remove(handles[order[k]]);
+		}
+		double t0 = nowNs();
+		pool.compact();
+		double compactUs = (nowNs() - t0) / 1e3;
+
+		// what Render does with every obstacle still standing
+		double flatSum = 0;
+		t0 = nowNs();
+		for (int f = 0; f < FRAMES; f++) {
+			for (size_t i = 0; i < flat.size(); i++) {
+				if (flat[i].created)
+					flatSum += flat[i].x + flat[i].z;
+			}
+		}
+		double flatNs = (nowNs() - t0) / FRAMES;
+
+		double poolSum = 0;
+		t0 = nowNs();
+		for (int f = 0; f < FRAMES; f++) {
+			for (int i = 0; i < pool.size(); i++) {
+				if (pool.isLiveAt(i))
+					poolSum += pool.at(i).x + pool.at(i).z;
+			}
+		}
+		double poolNs = (nowNs() - t0) / FRAMES;
+
+		// old handles still find their obstacle after compaction, dead ones do not
+		bool handlesOk = true;
+		for (int k = 0; k < COUNT; k++) {
+			const BenchObstacle* o = pool.get(handles[order[k]]);
+			if ((k < destroyed) != (o == NULL) || (o && o->x != obstacles[order[k]].x))
+				handlesOk = false;
+		}
+
+		bool same = handlesOk && flatSum == poolSum;
+		ok = ok && same;
+		fprintf(fp, "%9d%% %12.0f %12.0f %12.1f %8s\n", percent, flatNs, poolNs, compactUs,
+			same ? "match" : "DIFF");
+	}
+	fprintf(fp, "\n");
+	return ok;
+}
+
+bool bench::Projectiles(FILE* fp)
+{
+	const int TICKS = 240;
+	const int OBSTACLES = 2000;
+	const float DT = 0.7f / 120.0f;	// SIM_TIME_SCALE / SIM_TICK_RATE
+
+	ProjectileModel model;
+	model.gravity = 3.5f;
+	model.decreaseRate = 0.9985f;
+	model.moveScale = 3.3f;
+	model.groundHeight = 0.06f;
+	model.expand = 0.06f * 0.8f;
+
+	vector<vector<BenchObstacle> > walls;
+	makeArenaWalls(walls);
+	CCollisionWorld world;
+	buildArenaWorld(walls, world);
+
+	mt19937 rng(31337);
+	vector<BenchObstacle> obstacles;
+	makeObstacles(OBSTACLES, rng, obstacles);
+	CSpatialGrid grid;
+	grid.init(-BENCH_WORLD_WIDTH / 2 - 1.0f, -BENCH_WORLD_DEPTH / 2 - 1.0f, BENCH_WORLD_WIDTH + 2.0f, BENCH_WORLD_DEPTH + 2.0f, 2.0f);
+	CAabbStore boxes;
+	for (int i = 0; i < OBSTACLES; i++) {
+		const BenchObstacle& o = obstacles[i];
+		boxes.add(o.x - o.width / 2, o.y - o.height / 2, o.z - o.depth / 2, o.x + o.width / 2, o.y + o.height / 2, o.z + o.depth / 2);
+		grid.insert(i, o.x - o.width / 2, o.z - o.depth / 2, o.x + o.width / 2, o.z + o.depth / 2);
+	}
+
+	// shells fired from anywhere in the arena the way VK_SPACE fires them
+	uniform_real_distribution<float> px(-BENCH_WORLD_WIDTH / 2 + 1, BENCH_WORLD_WIDTH / 2 - 1);
+	uniform_real_distribution<float> pz(-BENCH_WORLD_DEPTH / 2 + 1, BENCH_WORLD_DEPTH / 2 - 1);
+	uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+	uniform_real_distribution<float> land(0.4f, 15.0f);
+	uniform_real_distribution<float> sky(0.0f, 10.0f);
+
+	fprintf(fp, "== missile pool (%d obstacles, %d ticks, shells kept alive by refiring) ==\n", OBSTACLES, TICKS);
+	fprintf(fp, "%8s %12s %12s %12s %12s %12s %12s %8s\n", "shells", "scalar ns", "sse ns", "avx ns",
+		"collide ns", "tick us", "worst us", "check");
+
+	bool ok = true;
+	for (int count = 1000; count <= 64000; count *= 4) {
+		CProjectilePool pools[3];
+		for (int p = 0; p < 3; p++)
+			pools[p].init(count, model);
+		for (int i = 0; i < count; i++) {
+			float a = angle(rng), l = land(rng);
+			float x = px(rng), z = pz(rng), vy = sky(rng);
+			for (int p = 0; p < 3; p++)
+				pools[p].spawn(x, 0.73f, z, l * cos(a) * 1.25f, vy, l * sin(a) * 1.25f, i);
+		}
+
+		// every path integrates the same shells; they must stay identical
+		double rate[3] = { 0, 0, 0 };
+		bool same = true;
+		for (int p = 0; p < 3; p++) {
+			if (!CProjectilePool::isPathSupported((CProjectilePool::Path)p))
+				continue;
+			pools[p].setPath((CProjectilePool::Path)p);
+			double t0 = nowNs();
+			for (int n = 0; n < 32; n++)
+				pools[p].integrate(DT);
+			rate[p] = (nowNs() - t0) / (32.0 * count);
+			for (int i = 0; i < count; i++) {
+				if (pools[p].getX(i) != pools[0].getX(i) || pools[p].getY(i) != pools[0].getY(i) || pools[p].getZ(i) != pools[0].getZ(i))
+					same = false;
+			}
+		}
+
+		// full ticks on the widest path, refiring every shell that lands
+		CProjectilePool& pool = pools[CProjectilePool::isPathSupported(CProjectilePool::PATH_AVX) ? 2 :
+			CProjectilePool::isPathSupported(CProjectilePool::PATH_SSE) ? 1 : 0];
+		vector<ProjectileHit> hits;
+		hits.reserve(count);
+		double collideNs = 0, tickNs = 0, worstNs = 0;
+		for (int n = 0; n < TICKS; n++) {
+			double t0 = nowNs();
+			pool.integrate(DT);
+			double t1 = nowNs();
+			hits.clear();
+			pool.collide(world, grid, boxes, NULL, hits);
+			double t2 = nowNs();
+			collideNs += t2 - t1;
+			tickNs += t2 - t0;
+			if (t2 - t0 > worstNs)
+				worstNs = t2 - t0;
+			for (size_t k = 0; k < hits.size(); k++) {
+				float a = angle(rng), l = land(rng);
+				pool.spawn(px(rng), 0.73f, pz(rng), l * cos(a) * 1.25f, sky(rng), l * sin(a) * 1.25f, hits[k].tag);
+			}
+		}
+
+		ok = ok && same;
+		fprintf(fp, "%8d %12.2f %12.2f %12.2f %12.1f %12.1f %12.1f %8s\n", count, rate[0], rate[1], rate[2],
+			collideNs / ((double)TICKS * count), tickNs / TICKS / 1e3, worstNs / 1e3, same ? "match" : "DIFF");
+	}
+	fprintf(fp, "(integrate and collide in ns per shell, 0.00 = path not compiled in)\n\n");
+	return ok;
+}
+
+bool bench::TankCollider(FILE* fp)
+{
+	const int TICKS = 200000;
+	const int NEARBY = 4;	// grid candidates under the tank per tick
+
+	// Tank::create() part sizes and Tank::getPartOffset() offsets
+	static const float parts[7][6] = {
+		{ 0, 0, 0, 0.7f, 0.375f, 1.5f }, { 0, 0.35f, 0.3f, 0.55f, 0.32f, 0.825f },
+		{ 0, 0.35f, 0, 0.12f, 0.12f, 1.4f },
+		{ -0.24375f, -0.28f, 0, 0.12f, 0.2f, 1.4f }, { 0.24375f, -0.28f, 0, 0.12f, 0.2f, 1.4f },
+		{ -0.24375f, -0.24f, 0, 0.122f, 0.2f, 1.35f }, { 0.24375f, -0.24f, 0, 0.122f, 0.2f, 1.35f }
+	};
+	CCompoundCollider collider;
+	for (int i = 0; i < 7; i++)
+		collider.addChild(parts[i][0], parts[i][1], parts[i][2], parts[i][3], parts[i][4], parts[i][5], i < 3 ? 1 : 2);
+
+	// the tank wanders, a missile step and a few obstacles land somewhere
+	// within a few metres of it (most of them still miss)
+	mt19937 rng(4242);
+	uniform_real_distribution<float> px(-BENCH_WORLD_WIDTH / 2, BENCH_WORLD_WIDTH / 2);
+	uniform_real_distribution<float> pz(-BENCH_WORLD_DEPTH / 2, BENCH_WORLD_DEPTH / 2);
+	uniform_real_distribution<float> near(-3.0f, 3.0f);
+	uniform_real_distribution<float> high(0.0f, 2.0f);
+	uniform_real_distribution<float> step(-0.2f, 0.2f);
+	uniform_real_distribution<float> size(0.2f, 0.75f);
+	vector<float> tank(TICKS * 3), p(TICKS * 3), d(TICKS * 3), obs(TICKS * NEARBY * 6);
+	for (int n = 0; n < TICKS; n++) {
+		tank[n * 3] = px(rng);
+		tank[n * 3 + 1] = 0.56f;
+		tank[n * 3 + 2] = pz(rng);
+		p[n * 3] = tank[n * 3] + near(rng);
+		p[n * 3 + 1] = high(rng);
+		p[n * 3 + 2] = tank[n * 3 + 2] + near(rng);
+		for (int a = 0; a < 3; a++)
+			d[n * 3 + a] = step(rng);
+		for (int k = 0; k < NEARBY; k++) {
+			float* o = &obs[(n * NEARBY + k) * 6];
+			float cx = tank[n * 3] + near(rng) * 0.5f, cz = tank[n * 3 + 2] + near(rng) * 0.5f;
+			float hw = size(rng), hh = size(rng), hd = size(rng);
+			o[0] = cx - hw; o[1] = 0; o[2] = cz - hd;
+			o[3] = cx + hw; o[4] = 2 * hh; o[5] = cz + hd;
+		}
+	}
+	const float R = 0.06f * 0.8f;
+
+	// old: every move rebuilds the seven world boxes, every query tests them in turn
+	CAabbStore partBoxes;
+	int oldHits = 0;
+	double t0 = nowNs();
+	for (int n = 0; n < TICKS; n++) {
+		partBoxes.clear();
+		for (int i = 0; i < 7; i++) {
+			float cx = tank[n * 3] + parts[i][0], cy = tank[n * 3 + 1] + parts[i][1], cz = tank[n * 3 + 2] + parts[i][2];
+			partBoxes.add(cx - parts[i][3] / 2, cy - parts[i][4] / 2, cz - parts[i][5] / 2,
+				cx + parts[i][3] / 2, cy + parts[i][4] / 2, cz + parts[i][5] / 2);
+		}
+		for (int k = 0; k < NEARBY; k++) {
+			const float* o = &obs[(n * NEARBY + k) * 6];
+			for (int i = 0; i < 3; i++) {
+				if (partBoxes.overlapsBox(i, o[0], o[1], o[2], o[3], o[4], o[5])) {
+					oldHits++;
+					break;
+				}
+			}
+		}
+		float t;
+		if (partBoxes.sweepSegment(&p[n * 3], &d[n * 3], R, t) >= 0)
+			oldHits++;
+	}
+	double oldNs = (nowNs() - t0) / TICKS;
+
+	int newHits = 0;
+	t0 = nowNs();
+	for (int n = 0; n < TICKS; n++) {
+		collider.setOrigin(tank[n * 3], tank[n * 3 + 1], tank[n * 3 + 2]);
+		for (int k = 0; k < NEARBY; k++) {
+			const float* o = &obs[(n * NEARBY + k) * 6];
+			if (collider.overlapsBox(o, o + 3, 1))
+				newHits++;
+		}
+		float t;
+		if (collider.sweepSegment(&p[n * 3], &d[n * 3], R, CCompoundCollider::GROUP_ALL, t) >= 0)
+			newHits++;
+	}
+	double newNs = (nowNs() - t0) / TICKS;
+
+	bool same = oldHits == newHits;
+	fprintf(fp, "== tank collider per tick (%d obstacle candidates + 1 missile step near the tank) ==\n", NEARBY);
+	fprintf(fp, "%14s %14s %10s\n", "7 boxes ns", "compound ns", "hits");
+	fprintf(fp, "%14.1f %14.1f %10s\n\n", oldNs, newNs, same ? "match" : "DIFF");
+	return same;
+}
+
+bool bench::RenderQueue(FILE* fp)
+{
+	const int FRAMES = 200;
+
+	// the frame Render() draws: two tanks, blue ball, a few missiles, floor,
+	// walls and the obstacles; every object has its own mesh (D3DXCreateBox)
+	vector<vector<BenchObstacle> > walls;
+	makeArenaWalls(walls);
+	mt19937 rng(777);
+	const RenderMaterial gray = makeMaterial(0.75f, 0.75f, 0.75f), white = makeMaterial(1, 1, 1);
+	const RenderMaterial sand = makeMaterial(1, 0.9f, 0.7f), black = makeMaterial(0, 0, 0);
+	const RenderMaterial slate = makeMaterial(0.18f, 0.31f, 0.31f), blue = makeMaterial(0, 0, 1);
+	const RenderMaterial tankColor[2] = { makeMaterial(0.3f, 0.5f, 0.2f), makeMaterial(0.6f, 0.5f, 0.3f) };
+
+	fprintf(fp, "== render queue per frame (submit + flush to a recording backend) ==\n");
+	fprintf(fp, "%10s %10s %12s %12s %12s %12s %10s\n", "objects", "draws", "mtrl before", "mtrl after",
+		"unsorted us", "sorted us", "check");
+	bool ok = true;
+
+	for (int count = 250; count <= 4000; count *= 4) {
+		vector<BenchObstacle> obstacles;
+		makeObstacles(count, rng, obstacles);
+
+		struct Item { const void* mesh; const RenderMaterial* material; float world[16]; };
+		vector<Item> scene;
+		intptr_t nextMesh = 16;
+		struct Add {
+			static void item(vector<Item>& scene, intptr_t& nextMesh, const RenderMaterial& m, float x, float y, float z)
+			{
+				Item it;
+				it.mesh = (const void*)(nextMesh += 16);
+				it.material = &m;
+				memset(it.world, 0, sizeof(it.world));
+				it.world[0] = it.world[5] = it.world[10] = it.world[15] = 1;
+				it.world[12] = x; it.world[13] = y; it.world[14] = z;
+				scene.push_back(it);
+			}
+		};
+		// Render() order: tank, ball, missiles, floor, walls, other tank, obstacles
+		static const int partMaterial[7] = { 0, 0, 0, 1, 1, 2, 2 };
+		for (int t = 0; t < 2; t++) {
+			for (int i = 0; i < 7; i++) {
+				const RenderMaterial& m = partMaterial[i] == 0 ? tankColor[t] : partMaterial[i] == 1 ? black : slate;
+				Add::item(scene, nextMesh, m, 0, 0.5f, t ? 40.0f : -40.0f);
+			}
+			if (t == 0) {
+				Add::item(scene, nextMesh, blue, 0, 0.5f, -35.0f);
+				for (int i = 0; i < 4; i++)
+					Add::item(scene, nextMesh, white, 0, 3.0f, -30.0f + i * 10.0f);
+				Add::item(scene, nextMesh, sand, 0, 0, 0);
+				for (size_t i = 0; i < walls.size(); i++)
+					for (size_t j = 0; j < walls[i].size(); j++)
+						Add::item(scene, nextMesh, white, walls[i][j].x, walls[i][j].y, walls[i][j].z);
+			}
+		}
+		for (int i = 0; i < count; i++)
+			Add::item(scene, nextMesh, gray, obstacles[i].x, obstacles[i].y, obstacles[i].z);
+
+		// old draw(): transform, material and draw per object, in scene order
+		CRecordingBackend direct;
+		double t0 = nowNs();
+		for (int f = 0; f < FRAMES; f++) {
+			direct.clear();
+			for (size_t i = 0; i < scene.size(); i++) {
+				direct.setTransform(scene[i].world);
+				direct.setMaterial(*scene[i].material);
+				direct.drawMesh(scene[i].mesh, 0);
+			}
+		}
+		double directUs = (nowNs() - t0) / FRAMES / 1e3;
+
+		CRenderQueue queue;
+		CRecordingBackend sorted;
+		t0 = nowNs();
+		for (int f = 0; f < FRAMES; f++) {
+			sorted.clear();
+			queue.begin(0, 20.0f, -60.0f);
+			for (size_t i = 0; i < scene.size(); i++)
+				queue.submit(scene[i].mesh, 0, *scene[i].material, scene[i].world);
+			queue.flush(sorted);
+		}
+		double sortedUs = (nowNs() - t0) / FRAMES / 1e3;
+
+		bool same = direct.getDrawCalls() == sorted.getDrawCalls() && queue.getStats().drawCalls == sorted.getDrawCalls()
+			&& sorted.getMaterialSets() < direct.getMaterialSets();
+		ok = ok && same;
+		fprintf(fp, "%10d %10d %12d %12d %12.1f %12.1f %10s\n", (int)scene.size(), direct.getDrawCalls(),
+			direct.getMaterialSets(), sorted.getMaterialSets(), directUs, sortedUs, same ? "match" : "DIFF");
+	}
+	fprintf(fp, "(mtrl = SetMaterial calls per frame; us = CPU cost only, the recording backend stands in for the device)\n\n");
+	return ok;
+}
+
+bool bench::MeshCache(FILE* fp)
+{
+	vector<vector<BenchObstacle> > walls;
+	makeArenaWalls(walls);
+	mt19937 rng(2024);
+	BenchMeshFactory factory;
+
+	fprintf(fp, "== mesh creation at startup (walls, 2 tanks, 2 spheres + obstacles) ==\n");
+	fprintf(fp, "%10s %10s %8s %12s %12s %12s %12s\n", "requests", "meshes", "hit %", "before KB", "after KB",
+		"before us", "after us");
+
+	bool ok = true;
+	for (int count = 250; count <= 4000; count *= 4) {
+		vector<BenchObstacle> obstacles;
+		makeObstacles(count, rng, obstacles);
+
+		vector<MeshKey> keys;
+		for (size_t i = 0; i < walls.size(); i++)
+			for (size_t j = 0; j < walls[i].size(); j++)
+				keys.push_back(MeshKey::box(walls[i][j].width, walls[i][j].height, walls[i][j].depth));
+		keys.push_back(MeshKey::box(BENCH_WORLD_WIDTH, 0.03f, BENCH_WORLD_DEPTH));
+		static const float parts[7][3] = {
+			{ 0.7f, 0.375f, 1.5f }, { 0.55f, 0.32f, 0.825f }, { 0.12f, 0.12f, 1.4f },
+			{ 0.12f, 0.2f, 1.4f }, { 0.12f, 0.2f, 1.4f }, { 0.122f, 0.2f, 1.35f }, { 0.122f, 0.2f, 1.35f }
+		};
+		for (int t = 0; t < 2; t++)
+			for (int i = 0; i < 7; i++)
+				keys.push_back(MeshKey::box(parts[i][0], parts[i][1], parts[i][2]));
+		keys.push_back(MeshKey::sphere(0.06f, 50, 50));	// blue ball
+		keys.push_back(MeshKey::sphere(0.06f, 50, 50));	// missile
+		for (int i = 0; i < count; i++)
+			keys.push_back(MeshKey::box(obstacles[i].width, obstacles[i].height, obstacles[i].depth));
+
+		// old create(): every object makes its own mesh
+		vector<void*> own(keys.size());
+		double ownBytes = 0;
+		double t0 = nowNs();
+		for (size_t i = 0; i < keys.size(); i++) {
+			unsigned bytes;
+			own[i] = factory.createMesh(keys[i], bytes);
+			ownBytes += bytes;
+		}
+		double ownUs = (nowNs() - t0) / 1e3;
+		for (size_t i = 0; i < own.size(); i++)
+			factory.destroyMesh(own[i]);
+
+		CMeshCache cache;
+		cache.setFactory(&factory);
+		vector<void*> shared(keys.size());
+		t0 = nowNs();
+		for (size_t i = 0; i < keys.size(); i++)
+			shared[i] = cache.acquire(keys[i]);
+		double sharedUs = (nowNs() - t0) / 1e3;
+		MeshCacheStats stats = cache.getStats();
+		for (size_t i = 0; i < shared.size(); i++)
+			cache.release(shared[i]);
+
+		bool same = cache.getStats().liveMeshes == 0 && stats.liveBytes + stats.savedBytes == ownBytes;
+		ok = ok && same;
+		fprintf(fp, "%10d %10d %8.1f %12.1f %12.1f %12.1f %12.1f%s\n", stats.requests, stats.liveMeshes,
+			stats.getHitRate() * 100, ownBytes / 1024, stats.liveBytes / 1024, ownUs, sharedUs, same ? "" : "  (MISMATCH)");
+	}
+	fprintf(fp, "(buffers sized like the D3DX meshes, allocated in system memory)\n\n");
+	return ok;
+}
+
+bool bench::Instancing(FILE* fp)
+{
+	const int DESTROYS = 200;
+	mt19937 rng(5150);
+
+	fprintf(fp, "== obstacle instancing (one destroy per frame) ==\n");
+	fprintf(fp, "%10s %12s %12s %14s %14s %10s\n", "obstacles", "draws", "batch draws", "rebuild us", "slot us", "check");
+
+	bool ok = true;
+	for (int count = 250; count <= 16000; count *= 4) {
+		vector<BenchObstacle> obstacles;
+		makeObstacles(count, rng, obstacles);
+		CInstanceBatch batch;
+		for (int i = 0; i < count; i++) {
+			const BenchObstacle& o = obstacles[i];
+			batch.add(o.x, o.y, o.z, o.width, o.height, o.depth, 0xffc0c0c0u);
+		}
+		vector<InstanceVertex> vertices;
+		batch.expandAll(vertices);
+		batch.clearDirty();
+
+		// the expansion must put every live box exactly where its own mesh was
+		bool same = true;
+		uniform_int_distribution<int> pick(0, count - 1);
+		vector<int> victims(DESTROYS);
+		for (int k = 0; k < DESTROYS; k++)
+			victims[k] = pick(rng);
+
+		// old way to keep one buffer in sync: expand everything again
+		vector<InstanceVertex> rebuilt;
+		CInstanceBatch copy = batch;
+		double t0 = nowNs();
+		for (int k = 0; k < DESTROYS; k++) {
+			copy.remove(victims[k]);
+			copy.expandAll(rebuilt);
+		}
+		double rebuildUs = (nowNs() - t0) / DESTROYS / 1e3;
+
+		t0 = nowNs();
+		for (int k = 0; k < DESTROYS; k++) {
+			batch.remove(victims[k]);
+			const vector<int>& dirty = batch.getDirtySlots();
+			for (size_t d = 0; d < dirty.size(); d++)
+				batch.expandSlot(dirty[d], &vertices[dirty[d] * CInstanceBatch::VERTICES_PER_INSTANCE]);
+			batch.clearDirty();
+		}
+		double slotUs = (nowNs() - t0) / DESTROYS / 1e3;
+
+		if (memcmp(&vertices[0], &rebuilt[0], vertices.size() * sizeof(InstanceVertex)) != 0)
+			same = false;
+		for (int i = 0; i < count && same; i++) {
+			const BenchObstacle& o = obstacles[i];
+			const InstanceVertex* v = &vertices[i * CInstanceBatch::VERTICES_PER_INSTANCE];
+			float mn[3] = { v[0].x, v[0].y, v[0].z }, mx[3] = { v[0].x, v[0].y, v[0].z };
+			for (int j = 1; j < CInstanceBatch::VERTICES_PER_INSTANCE; j++) {
+				float p[3] = { v[j].x, v[j].y, v[j].z };
+				for (int a = 0; a < 3; a++) {
+					mn[a] = min(mn[a], p[a]);
+					mx[a] = max(mx[a], p[a]);
+				}
+			}
+			if (batch.isLive(i))
+				same = mn[0] == o.x - o.width / 2 && mx[0] == o.x + o.width / 2 && mn[1] == o.y - o.height / 2 &&
+					mx[1] == o.y + o.height / 2 && mn[2] == o.z - o.depth / 2 && mx[2] == o.z + o.depth / 2;
+			else
+				same = mn[0] == mx[0] && mn[1] == mx[1] && mn[2] == mx[2];
+		}
+
+		ok = ok && same;
+		fprintf(fp, "%10d %12d %12d %14.1f %14.2f %10s\n", count, batch.getLiveCount(), batch.getDrawCount(),
+			rebuildUs, slotUs, same ? "match" : "DIFF");
+	}
+	fprintf(fp, "(draws = live obstacles drawn one by one; us = CPU expansion per destroy)\n\n");
+	return ok;
+}
+
+bool bench::ChunkedMesh(FILE* fp)
+{
+	const int EXPLOSIONS = 200;
+	const float RADIUS = 0.06f + 1.5f;	// MISSILE_EXPOLSION_RADIUS
+	mt19937 rng(8086);
+
+	fprintf(fp, "== chunked obstacle mesh (8 m chunks, %d explosions) ==\n", EXPLOSIONS);
+	fprintf(fp, "%10s %10s %10s %14s %14s %14s %8s\n", "obstacles", "draws", "chunks", "full us", "chunk us",
+		"worst chunk us", "check");
+
+	bool ok = true;
+	for (int count = 1000; count <= 16000; count *= 4) {
+		vector<BenchObstacle> obstacles;
+		makeObstacles(count, rng, obstacles);
+		CInstanceBatch batch;
+		for (int i = 0; i < count; i++) {
+			const BenchObstacle& o = obstacles[i];
+			batch.add(o.x, o.y, o.z, o.width, o.height, o.depth, 0xffc0c0c0u);
+		}
+		CChunkedBatch chunks;
+		chunks.build(batch, -BENCH_WORLD_WIDTH / 2 - 1.0f, -BENCH_WORLD_DEPTH / 2 - 1.0f,
+			BENCH_WORLD_WIDTH + 2.0f, BENCH_WORLD_DEPTH + 2.0f, 8.0f);
+		vector<InstanceVertex> vertices(chunks.getBoxCount() * CInstanceBatch::VERTICES_PER_INSTANCE);
+		for (int c = 0; c < chunks.getChunkCount(); c++)
+			chunks.rebuildChunk(c, batch, &vertices[chunks.getChunk(c).first * CInstanceBatch::VERTICES_PER_INSTANCE]);
+		chunks.clearDirty();
+		batch.clearDirty();
+		int draws = count;
+
+		CInstanceBatch copy = batch;
+		vector<InstanceVertex> merged(vertices.size());
+		// the boxes each explosion destroys
+		uniform_int_distribution<int> pick(0, count - 1);
+		vector<vector<int> > blasts(EXPLOSIONS);
+		for (int k = 0; k < EXPLOSIONS; k++) {
+			const BenchObstacle& e = obstacles[pick(rng)];
+			for (int i = 0; i < count; i++) {
+				float dx = obstacles[i].x - e.x, dz = obstacles[i].z - e.z;
+				if (dx * dx + dz * dz <= RADIUS * RADIUS)
+					blasts[k].push_back(i);
+			}
+		}
+
+		// one merged mesh: every explosion merges all live boxes again
+		double fullNs = 0;
+		for (int k = 0; k < EXPLOSIONS; k++) {
+			for (size_t b = 0; b < blasts[k].size(); b++)
+				copy.remove(blasts[k][b]);
+			double t0 = nowNs();
+			int live = 0;
+			for (int s = 0; s < copy.getSlotCount(); s++) {
+				if (copy.isLive(s))
+					copy.expandSlot(s, &merged[(live++) * CInstanceBatch::VERTICES_PER_INSTANCE]);
+			}
+			fullNs += nowNs() - t0;
+		}
+
+		double chunkNs = 0, worstNs = 0;
+		for (int k = 0; k < EXPLOSIONS; k++) {
+			for (size_t b = 0; b < blasts[k].size(); b++)
+				batch.remove(blasts[k][b]);
+			double t0 = nowNs();
+			chunks.takeDirtySlots(batch);
+			const vector<int>& dirty = chunks.getDirtyChunks();
+			for (size_t d = 0; d < dirty.size(); d++)
+				chunks.rebuildChunk(dirty[d], batch, &vertices[chunks.getChunk(dirty[d]).first * CInstanceBatch::VERTICES_PER_INSTANCE]);
+			chunks.clearDirty();
+			double ns = nowNs() - t0;
+			chunkNs += ns;
+			worstNs = max(worstNs, ns);
+		}
+		if (chunks.getDrawCount() > 0)
+			draws = chunks.getDrawCount();
+
+		// every live box is drawn exactly once, inside its chunk
+		bool same = true;
+		int live = 0;
+		for (int c = 0; c < chunks.getChunkCount(); c++) {
+			const CChunkedBatch::Chunk& chunk = chunks.getChunk(c);
+			live += chunk.live;
+			for (int v = 0; v < chunk.live * CInstanceBatch::VERTICES_PER_INSTANCE; v++) {
+				const InstanceVertex& iv = vertices[chunk.first * CInstanceBatch::VERTICES_PER_INSTANCE + v];
+				if (iv.x < chunk.bmin[0] || iv.x > chunk.bmax[0] || iv.z < chunk.bmin[2] || iv.z > chunk.bmax[2])
+					same = false;
+			}
+		}
+		if (live != batch.getLiveCount() || live != copy.getLiveCount())
+			same = false;
+
+		ok = ok && same;
+		fprintf(fp, "%10d %10d %10d %14.1f %14.2f %14.2f %8s\n", count, draws, chunks.getChunkCount(),
+			fullNs / EXPLOSIONS / 1e3, chunkNs / EXPLOSIONS / 1e3, worstNs / 1e3, same ? "match" : "DIFF");
+	}
+	fprintf(fp, "(draws after the explosions; us = mesh rebuild per explosion, one merged mesh vs dirty chunks)\n\n");
+	return ok;
+}
+
+bool bench::FrustumCull(FILE* fp)
+{
+	const int FRAMES = 256;
+
+	// chase cameras behind a tank somewhere in the arena, looking down the field
+	mt19937 rng(2024);
+	uniform_real_distribution<float> px(-BENCH_WORLD_WIDTH / 2, BENCH_WORLD_WIDTH / 2);
+	uniform_real_distribution<float> pz(-BENCH_WORLD_DEPTH / 2, BENCH_WORLD_DEPTH / 2);
+	uniform_real_distribution<float> turn(-0.5f, 0.5f);
+	vector<CFrustum> frusta(FRAMES);
+	for (int n = 0; n < FRAMES; n++) {
+		float dir = (n & 1) ? 1.0f : -1.0f;
+		float eye[3] = { px(rng), 1.0f, pz(rng) };
+		float at[3] = { eye[0] + turn(rng), 0.5f, eye[2] + dir };
+		float m[16];
+		makeViewProj(eye, at, m);
+		frusta[n].extract(m);
+	}
+
+	fprintf(fp, "== frustum cull per frame (%d cameras, boxes tested per ns) ==\n", FRAMES);
+	fprintf(fp, "%10s %10s %10s %10s %10s %10s %10s %8s\n", "boxes", "visible", "single", "scalar", "sse", "avx", "bvh", "hits");
+
+	bool ok = true;
+	for (int count = 1000; count <= 64000; count *= 2) {
+		vector<BenchObstacle> obstacles;
+		makeObstacles(count, rng, obstacles);
+
+		CAabbStore store;
+		CCollisionWorld world;
+		store.reserve(count);
+		vector<float> boxes(count * 6);
+		for (int i = 0; i < count; i++) {
+			const BenchObstacle& o = obstacles[i];
+			float* b = &boxes[i * 6];
+			b[0] = o.x - o.width / 2; b[1] = o.y - o.height / 2; b[2] = o.z - o.depth / 2;
+			b[3] = o.x + o.width / 2; b[4] = o.y + o.height / 2; b[5] = o.z + o.depth / 2;
+			store.add(b[0], b[1], b[2], b[3], b[4], b[5]);
+			world.add(b, b + 3, CCollisionWorld::KIND_WALL);
+		}
+		world.build();
+
+		// one testBox call per object, the way a draw loop would do it
+		double tested = (double)count * FRAMES;
+		int singleHits = 0;
+		double t0 = nowNs();
+		for (int n = 0; n < FRAMES; n++) {
+			for (int i = 0; i < count; i++) {
+				if (frusta[n].testBox(&boxes[i * 6], &boxes[i * 6 + 3]))
+					singleHits++;
+			}
+		}
+		double singleRate = tested / (nowNs() - t0);
+
+		double rate[3] = { 0, 0, 0 };
+		int hits[3] = { 0, 0, 0 };
+		vector<int> out;
+		out.reserve(count);
+		for (int p = CAabbStore::PATH_SCALAR; p <= CAabbStore::PATH_AVX; p++) {
+			if (!CAabbStore::isPathSupported((CAabbStore::Path)p))
+				continue;
+			store.setPath((CAabbStore::Path)p);
+			t0 = nowNs();
+			for (int n = 0; n < FRAMES; n++) {
+				out.clear();
+				hits[p] += store.overlapFrustum(frusta[n], out);
+			}
+			rate[p] = tested / (nowNs() - t0);
+		}
+
+		int bvhHits = 0;
+		t0 = nowNs();
+		for (int n = 0; n < FRAMES; n++) {
+			out.clear();
+			bvhHits += world.cullFrustum(frusta[n], CCollisionWorld::KIND_ALL, out);
+		}
+		double bvhRate = tested / (nowNs() - t0);
+
+		bool agree = hits[0] == singleHits && bvhHits == singleHits;
+		for (int p = 1; p <= 2; p++) {
+			if (CAabbStore::isPathSupported((CAabbStore::Path)p) && hits[p] != hits[0])
+				agree = false;
+		}
+		ok = ok && agree;
+		fprintf(fp, "%10d %9.1f%% %10.2f %10.2f %10.2f %10.2f %10.2f %8s\n", count, 100.0 * singleHits / tested,
+			singleRate, rate[0], rate[1], rate[2], bvhRate, agree ? "match" : "DIFF");
+	}
+	fprintf(fp, "(0.00 = path not compiled in)\n\n");
+	return ok;
+}
+
+void bench::SphereLod(FILE* fp)
+{
+	const int FRAMES = 4000;
+	const int SPHERES = 64;
+	const float RADIUS = 0.06f;
+	const float PROJ_SCALE = 1.0f / tanf(3.14159265f / 8);	// fov pi / 4
+	const float HEIGHT = 1080.0f;
+
+	// missiles flying away from / towards a chase camera, with a few percent
+	// of jitter in the camera distance every frame (camera shake, zoom)
+	mt19937 rng(16);
+	uniform_real_distribution<float> start(0.5f, 60.0f);
+	uniform_real_distribution<float> speed(-0.05f, 0.05f);
+	uniform_real_distribution<float> jitter(-0.03f, 0.03f);
+	vector<float> depth(FRAMES * SPHERES);
+	for (int k = 0; k < SPHERES; k++) {
+		float d = start(rng), v = speed(rng);
+		for (int n = 0; n < FRAMES; n++) {
+			d += v;
+			if (d < 0.5f || d > 60.0f) {
+				v = -v;
+				d += 2 * v;
+			}
+			depth[n * SPHERES + k] = d * (1.0f + jitter(rng));
+		}
+	}
+
+	fprintf(fp, "== sphere LOD (%d spheres of radius %.2f, %d frames, 1080p) ==\n", SPHERES, RADIUS, FRAMES);
+	fprintf(fp, "%12s %12s %12s %12s %14s %10s\n", "hysteresis", "tris/frame", "full tris", "saved", "switches/100f", "ns/select");
+
+	const float margins[] = { 0.0f, 0.05f, 0.15f, 0.3f };
+	for (int h = 0; h < 4; h++) {
+		CSphereLod lod;
+		lod.setHysteresis(margins[h]);
+		vector<int> level(SPHERES, -1);
+		double tris = 0, full = 0;
+		int switches = 0;
+		double t0 = nowNs();
+		for (int n = 0; n < FRAMES; n++) {
+			lod.beginFrame();
+			for (int k = 0; k < SPHERES; k++) {
+				float pixels = CSphereLod::projectRadius(RADIUS, depth[n * SPHERES + k], PROJ_SCALE, HEIGHT);
+				int l = lod.select(pixels, level[k]);
+				if (level[k] >= 0 && l != level[k])
+					switches++;
+				level[k] = l;
+				lod.count(l);
+			}
+			tris += lod.getStats().triangles;
+			full += lod.getStats().fullTriangles;
+		}
+		double ns = (nowNs() - t0) / ((double)FRAMES * SPHERES);
+		fprintf(fp, "%11.0f%% %12.0f %12.0f %11.1f%% %14.2f %10.1f\n", margins[h] * 100, tris / FRAMES, full / FRAMES,
+			100.0 * (1.0 - tris / full), 100.0 * switches / ((double)FRAMES * SPHERES), ns);
+	}
+	fprintf(fp, "\n");
+}
+
+// CSoftRasterizer::getChecksum() of every camera of bench::SoftRaster, solid
+// and wireframe. The rasterizer uses only SSE2 scalar float math, and the
+// queue draws in an order that does not depend on mesh addresses, so every
+// build and heap layout gets exactly these; an intended change to its
+// output has to update them (a failing run prints what it got)
+static const unsigned s_goldenSolid[] = {
+	0x879624a5, 0xa9f6f27f, 0xd9cd9606, 0xc2881504, 0x791409a5, 0x515874f0,
+};
+static const unsigned s_goldenWire[] = {
+	0x2318fca4, 0x888e012a, 0x361096f3, 0x4fe3f1c1, 0x81a5e63f, 0xe92c3d56,
+};
+
+bool bench::SoftRaster(FILE* fp)
+{
+	const int WIDTH = 1280, HEIGHT = 720;
+	const int REPEAT = 4;
+	const float W = BENCH_WORLD_WIDTH, D = BENCH_WORLD_DEPTH;
+
+	// the real map: createWall() + floor, then createMap()'s obstacles
+	vector<ArenaBox> walls, obstacles;
+	CArenaLayout::buildWalls(walls);
+	CArenaLayout::buildObstacles(obstacles);
+
+	CSoftMeshFactory factory;
+	CMeshCache cache;
+	cache.setFactory(&factory);
+	RenderMaterial white = makeMaterial(1.0f, 1.0f, 1.0f);
+	RenderMaterial sand = makeMaterial(1.0f, 1.0f, 240 / 255.0f);
+	RenderMaterial gray = makeMaterial(210 / 255.0f, 210 / 255.0f, 210 / 255.0f);
+	struct Draw {
+		void* mesh;
+		const RenderMaterial* material;
+		float world[16];
+	};
+	vector<Draw> draws;
+	for (size_t i = 0; i < walls.size() + obstacles.size(); i++) {
+		bool wall = i < walls.size();
+		const ArenaBox& b = wall ? walls[i] : obstacles[i - walls.size()];
+		Draw d;
+		d.mesh = cache.acquire(MeshKey::box(b.size[0], b.size[1], b.size[2]));
+		d.material = !wall ? &gray : i + 1 == walls.size() ? &sand : &white;
+		memset(d.world, 0, sizeof(d.world));
+		d.world[0] = d.world[5] = d.world[10] = d.world[15] = 1.0f;
+		memcpy(&d.world[12], b.center, sizeof(b.center));
+		draws.push_back(d);
+	}
+
+	// the two point lights from Setup()
+	SoftLight light;
+	memset(&light, 0, sizeof(light));
+	for (int c = 0; c < 4; c++) {
+		light.diffuse[c] = 1.8f;
+		light.specular[c] = 1.5f;
+		light.ambient[c] = 0.9f;
+	}
+	light.range = 100.0f;
+	light.attenuation1 = 0.3f;
+
+	// overview (camera_option 1) and chase cameras 2 up and 4.4 behind a
+	// tank at several points of the field, both directions
+	vector<vector<float> > cameras;
+	float overview[6] = { 70.0f, 30.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+	cameras.push_back(vector<float>(overview, overview + 6));
+	for (int k = -2; k <= 2; k++) {
+		float dir = (k & 1) ? -1.0f : 1.0f;
+		float head[3] = { (k % 2) * W / 6, 0.6f, k * D / 6 };
+		float cam[6] = { head[0], head[1] + 2.0f, head[2] - dir * 4.4f, head[0], head[1], head[2] };
+		cameras.push_back(vector<float>(cam, cam + 6));
+	}
+	const int FRAMES = (int)cameras.size();
+
+	float proj[16];
+	makeProjection((float)WIDTH / HEIGHT, proj);
+
+	fprintf(fp, "== software rasterizer, real arena (%d boxes, %dx%d, %d cameras) ==\n",
+		(int)draws.size(), WIDTH, HEIGHT, FRAMES);
+	fprintf(fp, "%8s %10s %10s %10s %10s %10s %10s %8s\n", "fill", "threads", "ms/frame", "Mtris/s", "tris", "culled", "binned", "image");
+
+	int threadCounts[4] = { 1, 2, 4, 0 };
+	CSoftRasterizer raster;
+	raster.resize(WIDTH, HEIGHT);
+	raster.setProjection(proj);
+	CRenderQueue queue;
+	bool ok = true;
+	for (int fill = 0; fill < 2; fill++) {
+		raster.setFillMode(fill ? CSoftRasterizer::FILL_WIREFRAME : CSoftRasterizer::FILL_SOLID);
+		const unsigned* golden = fill ? s_goldenWire : s_goldenSolid;
+		vector<unsigned> reference(golden, golden + sizeof(s_goldenSolid) / sizeof(s_goldenSolid[0]));
+		for (int t = 0; t < 4; t++) {
+			raster.setThreadCount(threadCounts[t]);
+			if (t == 3 && raster.getThreadCount() <= 4)
+				break;	// no more hardware threads than the runs above
+
+			vector<unsigned> checksums(FRAMES);
+			double tris = 0, culled = 0, binned = 0;
+			double t0 = nowNs();
+			for (int r = 0; r < REPEAT; r++) {
+				for (int n = 0; n < FRAMES; n++) {
+					const float* cam = &cameras[n][0];
+					float view[16];
+					makeView(cam, cam + 3, view);
+					raster.setView(view);
+					for (int l = 0; l < 2; l++) {
+						light.position[1] = 10.0f;
+						light.position[2] = (l ? -1 : 1) * (D / 4 + 4);
+						raster.setLight(l, light, true);
+					}
+
+					raster.beginFrame(0x00afafaf);
+					queue.begin(cam[0], cam[1], cam[2]);
+					for (size_t i = 0; i < draws.size(); i++)
+						queue.submit(draws[i].mesh, 0, *draws[i].material, draws[i].world);
+					queue.flush(raster);
+					raster.endFrame();
+
+					checksums[n] = raster.getChecksum();
+					tris += raster.getStats().triangles;
+					culled += raster.getStats().culled;
+					binned += raster.getStats().binned;
+					if (r == 0 && n == 0 && t == 0)
+						raster.writePpm(fill ? "softraster_arena_wire.ppm" : "softraster_arena.ppm");
+				}
+			}
+			double ns = nowNs() - t0;
+			bool same = checksums == reference;
+			ok = ok && same;
+			int runs = REPEAT * FRAMES;
+			fprintf(fp, "%8s %10d %10.2f %10.2f %10.0f %10.0f %10.0f %8s\n", fill ? "wire" : "solid",
+				raster.getThreadCount(), ns / runs / 1e6, tris / ns * 1e3, tris / runs, culled / runs, binned / runs,
+				same ? "golden" : "DIFF");
+			if (!same) {
+				fprintf(fp, "  got:");
+				for (int n = 0; n < FRAMES; n++)
+					fprintf(fp, " 0x%08x,", checksums[n]);
+				fprintf(fp, "\n");
+			}
+		}
+	}
+	fprintf(fp, "(images written to softraster_arena.ppm / softraster_arena_wire.ppm)\n\n");
+
+	for (size_t i = 0; i < draws.size(); i++)
+		cache.release(draws[i].mesh);
+	return ok;
+}
+
+bool bench::HudText(FILE* fp)
+{
+	const int FRAMES = 3600;	// a minute at 60 fps
+
+	// what Render() shows: the turn timer ticks once a second, the aim
+	// changes while an arrow key is held (a quarter of the time), the tank
+	// distance every half second; the F3 line changes every frame
+	vector<HudFrame> frames(FRAMES);
+	mt19937 rng(18);
+	uniform_real_distribution<double> step(-0.7, 0.7);
+	double degree = 45.0, distance = 12.0;
+	for (int n = 0; n < FRAMES; n++) {
+		if ((n / 30) % 4 == 0) {
+			degree += step(rng);
+			distance += step(rng) * 0.1;
+		}
+		frames[n].remain = 20 - (n / 60) % 20;
+		frames[n].degree = degree;
+		frames[n].distance = distance;
+		frames[n].tankDistance = 100 - (n / 30) % 100;
+		frames[n].tris = 9000 + (int)(rng() % 3000);
+	}
+
+	// 40 px Tahoma advances, roughly; the layout does not change the cost
+	int advances[CGlyphAtlas::GLYPH_COUNT];
+	for (int i = 0; i < CGlyphAtlas::GLYPH_COUNT; i++)
+		advances[i] = 14 + i % 11;
+	CGlyphAtlas atlas;
+	atlas.layout(advances, 48, 512);
+
+	// same text as the old ostringstream code, every frame
+	bool same = true;
+	CHudText check;
+	for (int n = 0; n < FRAMES && same; n++) {
+		string old[4];
+		formatHudOld(frames[n], old);
+		check.beginFrame();
+		printHud(check, frames[n], false);
+		for (int l = 0; l < 4; l++)
+			same = same && old[l] == check.getText(l);
+	}
+
+	fprintf(fp, "== HUD text per frame (%d frames, text %s the old code) ==\n", FRAMES, same ? "matches" : "DIFFERS from");
+	fprintf(fp, "%-24s %10s %12s %10s %10s %10s\n", "path", "ns/frame", "allocs/frame", "chars", "formatted", "rebuilds");
+
+	bool counted = getAllocationCount() >= 0;
+	bool zero = true;
+	for (int stats = 0; stats < 2; stats++) {
+		// before: ostringstream / to_string / std::string per line
+		size_t chars = 0;
+		long long allocs = getAllocationCount();
+		double t0 = nowNs();
+		for (int n = 0; n < FRAMES; n++) {
+			string old[4];
+			formatHudOld(frames[n], old);
+			for (int l = 0; l < 4; l++)
+				chars += old[l].size();
+			if (stats) {
+				char text[160];
+				snprintf(text, sizeof(text), "Spheres: %d  Tris: %d / %d", 3, frames[n].tris, 313000);
+				chars += strlen(text);
+			}
+		}
+		double oldNs = (nowNs() - t0) / FRAMES;
+		double oldAllocs = (double)(getAllocationCount() - allocs) / FRAMES;
+
+		// after: CHudText line buffers and one quad list
+		CHudText hud;
+		for (int l = 0; l < 5; l++)
+			hud.setLine(l, 10, 10 + 40 * l);
+		int formatted = 0, rebuilds = 0;
+		size_t newChars = 0;
+		allocs = getAllocationCount();
+		t0 = nowNs();
+		for (int n = 0; n < FRAMES; n++) {
+			hud.beginFrame();
+			printHud(hud, frames[n], stats != 0);
+			hud.buildQuads(atlas);
+			for (int l = 0; l < 5; l++)
+				newChars += strlen(hud.getText(l));
+			formatted += hud.getStats().formatted;
+			rebuilds += hud.getStats().rebuilds;
+		}
+		double newNs = (nowNs() - t0) / FRAMES;
+		long long newAllocs = getAllocationCount() - allocs;
+		if (newAllocs)
+			zero = false;
+
+		char oldText[16] = "-", newText[16] = "-";
+		if (counted) {
+			snprintf(oldText, sizeof(oldText), "%.2f", oldAllocs);
+			snprintf(newText, sizeof(newText), "%.2f", (double)newAllocs / FRAMES);
+		}
+		const char* name = stats ? "ostringstream + F3" : "ostringstream";
+		fprintf(fp, "%-24s %10.0f %12s %10.1f %10d %10s\n", name, oldNs, oldText, (double)chars / FRAMES, 4 + stats, "-");
+		name = stats ? "CHudText + F3" : "CHudText";
+		fprintf(fp, "%-24s %10.0f %12s %10.1f %10.2f %10.2f\n", name, newNs, newText,
+			(double)newChars / FRAMES, (double)formatted / FRAMES, (double)rebuilds / FRAMES);
+	}
+	if (counted)
+		fprintf(fp, "zero allocations on the CHudText path: %s\n\n", zero ? "PASS" : "FAIL");
+	else
+		fprintf(fp, "(allocations not counted: allocCounter.cpp is only linked into tanksim)\n\n");
+	return same && zero;
+}
+
+bool bench::Occlusion(FILE* fp)
+{
+	const int REPEAT = 8;
+	const float W = BENCH_WORLD_WIDTH, D = BENCH_WORLD_DEPTH;
+	mt19937 rng(1618);
+
+	vector<ArenaBox> obstacles;
+	CArenaLayout::buildObstacles(obstacles);
+	const int count = (int)obstacles.size();
+
+	// chase cameras (camera_option 0): 2 up and 4.4 behind a tank, in three
+	// lanes down the whole field, both directions, at 1920 x 1080
+	vector<vector<float> > cameras;
+	for (int lane = -1; lane <= 1; lane++) {
+		for (float z = -D / 2 + 6; z <= D / 2 - 6; z += 4.0f) {
+			for (int side = 0; side < 2; side++) {
+				float dir = side ? -1.0f : 1.0f;
+				float head[3] = { lane * W / 4, 0.6f, z };
+				float cam[6] = { head[0], head[1] + 2.0f, head[2] - dir * 4.4f, head[0], head[1], head[2] };
+				cameras.push_back(vector<float>(cam, cam + 6));
+			}
+		}
+	}
+	const int FRAMES = (int)cameras.size();
+
+	fprintf(fp, "== software occlusion culling, real arena (%d obstacles, %dx%d depth, %d chase cameras) ==\n",
+		count, (int)COcclusionCuller::DEFAULT_WIDTH, (int)COcclusionCuller::DEFAULT_HEIGHT, FRAMES);
+	fprintf(fp, "%10s %10s %10s %10s %10s %10s %10s %10s %10s %8s\n", "destroyed", "occluders", "boxes in",
+		"hidden", "chunks in", "hidden", "render ms", "test ms", "async ms", "check");
+
+	bool ok = true;
+	for (int pass = 0; pass < 2; pass++) {
+		// obstacles in game order; the second pass loses 30% of them
+		vector<bool> alive(count, true);
+		CInstanceBatch batch;
+		for (int i = 0; i < count; i++) {
+			const ArenaBox& b = obstacles[i];
+			batch.add(b.center[0], b.center[1], b.center[2], b.size[0], b.size[1], b.size[2], 0xffd2d2d2u);
+		}
+		int destroyed = 0;
+		if (pass == 1) {
+			uniform_real_distribution<float> roll(0.0f, 1.0f);
+			for (int i = 0; i < count; i++) {
+				if (roll(rng) < 0.3f) {
+					alive[i] = false;
+					batch.remove(i);
+					destroyed++;
+				}
+			}
+		}
+		CChunkedBatch chunks;
+		chunks.build(batch, -W / 2 - 1.0f, -D / 2 - 1.0f, W + 2.0f, D + 2.0f, 8.0f);
+		vector<InstanceVertex> vertices(chunks.getBoxCount() * CInstanceBatch::VERTICES_PER_INSTANCE);
+		for (int c = 0; c < chunks.getChunkCount(); c++)
+			chunks.rebuildChunk(c, batch, &vertices[chunks.getChunk(c).first * CInstanceBatch::VERTICES_PER_INSTANCE]);
+		chunks.clearDirty();
+		vector<float> chunkBoxes;
+		for (int c = 0; c < chunks.getChunkCount(); c++) {
+			const CChunkedBatch::Chunk& chunk = chunks.getChunk(c);
+			chunkBoxes.insert(chunkBoxes.end(), chunk.bmin, chunk.bmin + 3);
+			chunkBoxes.insert(chunkBoxes.end(), chunk.bmax, chunk.bmax + 3);
+		}
+
+		// what beginOcclusion() does after a wall was hit
+		vector<ArenaBox> occluders;
+		CArenaLayout::buildOccluders(alive, occluders);
+		vector<float> occluderBoxes(occluders.size() * 6);
+		for (size_t i = 0; i < occluders.size(); i++)
+			occluders[i].getBounds(&occluderBoxes[i * 6], &occluderBoxes[i * 6 + 3]);
+		COcclusionCuller culler;
+		culler.setOccluders(&occluderBoxes[0], (int)occluders.size());
+
+		// only what the frustum test lets through is a candidate
+		vector<float> viewProj(FRAMES * 16);
+		vector<vector<int> > boxesIn(FRAMES), chunksIn(FRAMES);
+		for (int n = 0; n < FRAMES; n++) {
+			float* m = &viewProj[n * 16];
+			makeViewProj(&cameras[n][0], &cameras[n][3], m, 16.0f / 9.0f);
+			CFrustum frustum;
+			frustum.extract(m);
+			for (int i = 0; i < count; i++) {
+				float bmin[3], bmax[3];
+				obstacles[i].getBounds(bmin, bmax);
+				if (alive[i] && frustum.testBox(bmin, bmax))
+					boxesIn[n].push_back(i);
+			}
+			for (int c = 0; c < chunks.getChunkCount(); c++) {
+				if (chunks.getChunk(c).live > 0 && frustum.testBox(&chunkBoxes[c * 6], &chunkBoxes[c * 6 + 3]))
+					chunksIn[n].push_back(c);
+			}
+		}
+
+		bool same = true;
+		double renderNs = 0, testNs = 0, asyncNs = 0;
+		long long boxTotal = 0, boxHidden = 0, chunkTotal = 0, chunkHidden = 0;
+		vector<unsigned char> chunkVisible(chunks.getChunkCount());
+		for (int r = 0; r < REPEAT; r++) {
+			for (int n = 0; n < FRAMES; n++) {
+				double t0 = nowNs();
+				culler.render(&viewProj[n * 16]);
+				double t1 = nowNs();
+				int hidden = 0;
+				for (size_t k = 0; k < chunksIn[n].size(); k++) {
+					int c = chunksIn[n][k];
+					chunkVisible[c] = culler.isVisible(&chunkBoxes[c * 6], &chunkBoxes[c * 6 + 3]);
+					hidden += !chunkVisible[c];
+				}
+				testNs += nowNs() - t1;
+				renderNs += t1 - t0;
+				if (r > 0)
+					continue;
+				chunkTotal += chunksIn[n].size();
+				chunkHidden += hidden;
+
+				// single boxes, and the pyramid against the full resolution buffer
+				for (size_t k = 0; k < boxesIn[n].size(); k++) {
+					float bmin[3], bmax[3];
+					obstacles[boxesIn[n][k]].getBounds(bmin, bmax);
+					bool visible = culler.isVisible(bmin, bmax);
+					if (visible != culler.isVisibleFlat(bmin, bmax))
+						same = false;
+					boxHidden += !visible;
+				}
+				boxTotal += boxesIn[n].size();
+			}
+		}
+
+		// the whole frame on the worker thread gives the same answers
+		for (int r = 0; r < REPEAT; r++) {
+			for (int n = 0; n < FRAMES; n++) {
+				double t0 = nowNs();
+				culler.beginCull(&viewProj[n * 16], &chunkBoxes[0], chunks.getChunkCount());
+				const unsigned char* result = culler.waitCull();
+				asyncNs += nowNs() - t0;
+				if (r > 0)
+					continue;
+				culler.render(&viewProj[n * 16]);
+				for (size_t k = 0; k < chunksIn[n].size(); k++) {
+					int c = chunksIn[n][k];
+					if ((result[c] != 0) != culler.isVisible(&chunkBoxes[c * 6], &chunkBoxes[c * 6 + 3]))
+						same = false;
+				}
+			}
+		}
+
+		int runs = REPEAT * FRAMES;
+		ok = ok && same;
+		fprintf(fp, "%9d%% %10d %10.1f %9.1f%% %10.1f %9.1f%% %10.3f %10.3f %10.3f %8s\n", destroyed * 100 / count,
+			(int)occluders.size(), (double)boxTotal / FRAMES, boxTotal ? boxHidden * 100.0 / boxTotal : 0.0,
+			(double)chunkTotal / FRAMES, chunkTotal ? chunkHidden * 100.0 / chunkTotal : 0.0,
+			renderNs / runs / 1e6, testNs / runs / 1e6, asyncNs / runs / 1e6, same ? "match" : "DIFF");
+	}
+	fprintf(fp, "(boxes / chunks in = per frame after the frustum test; async = beginCull + waitCull for all chunks)\n\n");
+	return ok;
+}
+
+bool bench::Pvs(FILE* fp)
+{
+	const float CELL = 4.0f, EYE_MIN = 0.5f, EYE_MAX = 3.0f, MIN_TOP = 1.0f;
+	const int EYES = 200, LOOKUPS = 64, EXPLOSIONS = 20;
+	const float W = BENCH_WORLD_WIDTH, D = BENCH_WORLD_DEPTH;
+	mt19937 rng(4099);
+
+	CArenaPvs pvs;
+	pvs.buildArena(CELL, EYE_MIN, EYE_MAX, MIN_TOP);
+	PvsStats built = pvs.getStats();
+	fprintf(fp, "== potentially visible sets, real arena (%d cells of %.0f m, %d pieces) ==\n", built.cells, CELL, built.pieces);
+	fprintf(fp, "build %.0f ms, %lld rays, table %d bytes, %.1f%% of cell pairs visible\n", built.buildMs, built.rays,
+		pvs.getCellCount() * pvs.getRowWords() * (int)sizeof(unsigned), built.getVisibleRatio() * 100);
+	fprintf(fp, "%10s %10s %10s %10s %10s %10s %10s %12s %12s\n", "destroyed", "rows %", "boxes in", "kept %", "seen", "missed",
+		"chunks in", "frame ns", "new cell us");
+
+	vector<ArenaBox> obstacles;
+	CArenaLayout::buildObstacles(obstacles);
+	const int count = (int)obstacles.size();
+	uniform_real_distribution<float> ex(-W / 2, W / 2), ez(-D / 2, D / 2), ey(EYE_MIN, EYE_MAX), unit(0.0f, 1.0f);
+
+	bool ok = true;
+	for (int pass = 0; pass < 2; pass++) {
+		vector<bool> alive(count, true);
+		int destroyed = 0;
+		pvs.clearOpenings();
+		if (pass == 1) {
+			// explosions at random obstacles, as destroyObstacle() reports them
+			const float RADIUS = 0.06f + 1.5f;	// MISSILE_EXPOLSION_RADIUS
+			uniform_int_distribution<int> pick(0, count - 1);
+			for (int k = 0; k < EXPLOSIONS; k++) {
+				const ArenaBox& e = obstacles[pick(rng)];
+				for (int i = 0; i < count; i++) {
+					float dx = obstacles[i].center[0] - e.center[0], dz = obstacles[i].center[2] - e.center[2];
+					if (alive[i] && dx * dx + dz * dz <= RADIUS * RADIUS) {
+						float bmin[3], bmax[3];
+						obstacles[i].getBounds(bmin, bmax);
+						pvs.openBox(bmin, bmax);
+						alive[i] = false;
+						destroyed++;
+					}
+				}
+			}
+		}
+		vector<ArenaBox> occluders;
+		CArenaLayout::buildOccluders(alive, occluders);
+		vector<float> occ(occluders.size() * 6);
+		for (size_t i = 0; i < occluders.size(); i++)
+			occluders[i].getBounds(&occ[i * 6], &occ[i * 6 + 3]);
+
+		// rays from random eyes to a point on every standing box: a box a
+		// ray reaches has to be in the viewpoint's set
+		long long boxesIn = 0, seen = 0, missed = 0, rowBits = 0;
+		double rowNs = 0;
+		int eyes = 0;
+		while (eyes < EYES) {
+			float eye[3] = { ex(rng), ey(rng), ez(rng) };
+			bool inside = false;
+			for (size_t o = 0; o < occluders.size() && !inside; o++) {
+				const float* b = &occ[o * 6];
+				inside = eye[0] > b[0] && eye[0] < b[3] && eye[1] > b[1] && eye[1] < b[4] && eye[2] > b[2] && eye[2] < b[5];
+			}
+			if (inside)
+				continue;
+			eyes++;
+			double t0 = nowNs();
+			pvs.setViewpoint(eye[0], eye[1], eye[2]);
+			rowNs += nowNs() - t0;
+			// the viewpoint's row, openings included
+			for (float z = -D / 2 + CELL / 2; z < D / 2; z += CELL) {
+				for (float x = -W / 2 + CELL / 2; x < W / 2; x += CELL) {
+					float bmin[3] = { x - 0.1f, 0.0f, z - 0.1f }, bmax[3] = { x + 0.1f, 1.0f, z + 0.1f };
+					rowBits += pvs.isBoxVisible(bmin, bmax);
+				}
+			}
+
+			for (int i = 0; i < count; i++) {
+				if (!alive[i])
+					continue;
+				float bmin[3], bmax[3];
+				obstacles[i].getBounds(bmin, bmax);
+				bool inPvs = pvs.isBoxVisible(bmin, bmax);
+				boxesIn += inPvs;
+				// a point just outside one face, the face turned to the eye
+				float p[3];
+				int axis = (int)(unit(rng) * 3) % 3;
+				for (int a = 0; a < 3; a++)
+					p[a] = bmin[a] + (bmax[a] - bmin[a]) * unit(rng);
+				p[axis] = eye[axis] < bmin[axis] ? bmin[axis] - 2e-3f : bmax[axis] + 2e-3f;
+				float d[3] = { p[0] - eye[0], p[1] - eye[1], p[2] - eye[2] };
+				bool blocked = false;
+				for (size_t o = 0; o < occluders.size() && !blocked; o++) {
+					const float* b = &occ[o * 6];
+					float t0 = 0.0f, t1 = 1.0f;
+					bool hit = true;
+					for (int a = 0; a < 3 && hit; a++) {
+						if (d[a] == 0.0f) {
+							hit = eye[a] > b[a] && eye[a] < b[a + 3];
+							continue;
+						}
+						float n = (b[a] - eye[a]) / d[a], f = (b[a + 3] - eye[a]) / d[a];
+						if (n > f)
+							swap(n, f);
+						t0 = max(t0, n);
+						t1 = min(t1, f);
+						hit = t0 < t1;
+					}
+					blocked = hit;
+				}
+				if (!blocked) {
+					seen++;
+					missed += !inPvs;
+				}
+			}
+		}
+
+		// per frame: the same cell again, then the 8 m chunks
+		vector<float> chunkBoxes;
+		for (float z = -D / 2; z < D / 2; z += 8.0f) {
+			for (float x = -W / 2; x < W / 2; x += 8.0f) {
+				float b[6] = { x, 0.0f, z, min(x + 8.0f, W / 2), 2.0f, min(z + 8.0f, D / 2) };
+				chunkBoxes.insert(chunkBoxes.end(), b, b + 6);
+			}
+		}
+		int chunks = (int)chunkBoxes.size() / 6, hits = 0;
+		double t0 = nowNs();
+		for (int n = 0; n < LOOKUPS; n++) {
+			pvs.setViewpoint(0.0f, 2.7f, -D / 2 + 5);
+			for (int c = 0; c < chunks; c++)
+				hits += pvs.isBoxVisible(&chunkBoxes[c * 6], &chunkBoxes[c * 6 + 3]);
+		}
+		double frameNs = (nowNs() - t0) / LOOKUPS;
+
+		fprintf(fp, "%9d%% %9.1f%% %10.1f %9.1f%% %10lld %10lld %10.1f %12.0f %12.2f\n", destroyed * 100 / count,
+			rowBits * 100.0 / ((double)EYES * pvs.getCellCount()), (double)boxesIn / EYES,
+			boxesIn * 100.0 / ((double)EYES * (count - destroyed)), seen, missed, (double)hits / LOOKUPS, frameNs,
+			rowNs / EYES / 1e3);
+		ok = ok && missed == 0;
+	}
+	fprintf(fp, "(rows %% = cells in a viewpoint's set; boxes in = standing obstacles passing per viewpoint, kept %% of\n"
+		" the standing ones; seen / missed = boxes a sampled ray reaches / of those, boxes the table dropped;\n"
+		" chunks in / frame ns = of the %d chunk lookups of a frame, those passing / their time)\n\n", (int)(W / 8 + 0.99f) * (int)(D / 8 + 0.99f));
+	return ok;
+}
+
+bool bench::Matches(FILE* fp)
+{
+	const int MATCHES = 8;
+	const long long MAX_TICKS = 1000000;
+
+	CTankSim sim;
+	double t0 = nowNs();
+	sim.init();
+	double initMs = (nowNs() - t0) / 1e6;
+	fprintf(fp, "== headless bot matches (CTankSim, %.0f ticks/s game rate) ==\n", SIM_TICK_RATE);
+	fprintf(fp, "init %.1f ms (arena, collision world, firing table)\n", initMs);
+	fprintf(fp, "%6s %8s %6s %6s %6s %10s %10s %12s %10s\n", "seed", "winner", "turns", "shots", "boxes",
+		"ticks", "ms", "ticks/s", "realtime");
+
+	long long totalTicks = 0;
+	double totalMs = 0;
+	CSimScript record;
+	SimMatchResult recorded;
+	for (int m = 0; m < MATCHES; m++) {
+		CSimBot bot(m + 1);
+		SimMatchResult r;
+		runSimMatch(sim, NULL, &bot, m == 0 ? &record : NULL, MAX_TICKS, r);
+		if (m == 0)
+			recorded = r;
+		double rate = r.ms > 0 ? r.ticks * 1e3 / r.ms : 0.0;
+		fprintf(fp, "%6d %8s %6d %6d %6d %10lld %10.1f %12.0f %9.0fx\n", m + 1,
+			r.winner < 0 ? "-" : (r.winner == 0 ? "P1" : "P2"), r.turns, r.shots, r.obstaclesDestroyed,
+			r.ticks, r.ms, rate, rate / SIM_TICK_RATE);
+		totalTicks += r.ticks;
+		totalMs += r.ms;
+	}
+	fprintf(fp, "total %lld ticks in %.1f ms = %.0f ticks/s\n", totalTicks, totalMs,
+		totalMs > 0 ? totalTicks * 1e3 / totalMs : 0.0);
+
+	// the first match again, from the commands the bot gave
+	SimMatchResult replay;
+	runSimMatch(sim, &record, NULL, NULL, MAX_TICKS, replay);
+	bool same = replay.winner == recorded.winner && replay.ticks == recorded.ticks
+		&& replay.shots == recorded.shots && replay.obstaclesDestroyed == recorded.obstaclesDestroyed;
+	fprintf(fp, "replay of seed 1 (%d commands): %lld ticks, %d boxes, %s\n\n", record.size(), replay.ticks,
+		replay.obstaclesDestroyed, same ? "same result" : "DIFFERENT RESULT");
+	return same;
+}
+
+namespace
+{
+	// The D3DX calls the draw path used. The game build (BENCH_D3DX) calls
+	// D3DX itself; tanksim has no D3DX and uses their scalar forms (same
+	// products, same order of the terms).
+#ifdef BENCH_D3DX
+	const char* REF_NAME = "D3DX";
+
+	void refMultiply(float out[16], const float a[16], const float b[16])
+	{
+		D3DXMatrixMultiply((D3DXMATRIX*)out, (const D3DXMATRIX*)a, (const D3DXMATRIX*)b);
+	}
+
+	void refTranslation(float out[16], float x, float y, float z)
+	{
+		D3DXMatrixTranslation((D3DXMATRIX*)out, x, y, z);
+	}
+
+	void refRotationY(float out[16], float angle)
+	{
+		D3DXMatrixRotationY((D3DXMATRIX*)out, angle);
+	}
+
+	void refTransformCoord(float out[3], const float p[3], const float m[16])
+	{
+		D3DXVec3TransformCoord((D3DXVECTOR3*)out, (const D3DXVECTOR3*)p, (const D3DXMATRIX*)m);
+	}
+#else
+	const char* REF_NAME = "scalar D3DX formulas";
+
+	void refMultiply(float out[16], const float a[16], const float b[16])
+	{
+		float r[16];
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				r[i * 4 + j] = a[i * 4 + 0] * b[0 * 4 + j] + a[i * 4 + 1] * b[1 * 4 + j]
+					+ a[i * 4 + 2] * b[2 * 4 + j] + a[i * 4 + 3] * b[3 * 4 + j];
+		memcpy(out, r, sizeof(r));
+	}
+
+	void refTranslation(float out[16], float x, float y, float z)
+	{
+		memset(out, 0, sizeof(float) * 16);
+		out[0] = out[5] = out[10] = out[15] = 1.0f;
+		out[12] = x;
+		out[13] = y;
+		out[14] = z;
+	}
+
+	void refRotationY(float out[16], float angle)
+	{
+		refTranslation(out, 0, 0, 0);
+		float c = cosf(angle), s = sinf(angle);
+		out[0] = c;
+		out[2] = -s;
+		out[8] = s;
+		out[10] = c;
+	}
+
+	void refTransformCoord(float out[3], const float p[3], const float m[16])
+	{
+		float w = p[0] * m[3] + p[1] * m[7] + p[2] * m[11] + m[15];
+		for (int j = 0; j < 3; j++)
+			out[j] = (p[0] * m[j] + p[1] * m[4 + j] + p[2] * m[8 + j] + m[12 + j]) / w;
+	}
+#endif
+
+	float maxDiff(const float* a, const float* b, int n)
+	{
+		float d = 0;
+		for (int i = 0; i < n; i++)
+			d = max(d, fabsf(a[i] - b[i]));
+		return d;
+	}
+
+	// one drawn object of the transform scene, the old way: the local matrix
+	// is rebuilt by every setPosition, and local * world by every draw
+	struct RefObject {
+		float pos[3];
+		float yaw;
+		float local[16];
+
+		void setPosition(float x, float y, float z)
+		{
+			pos[0] = x;
+			pos[1] = y;
+			pos[2] = z;
+			if (yaw == 0)
+				refTranslation(local, x, y, z);
+			else {
+				refRotationY(local, yaw);
+				local[12] = x;
+				local[13] = y;
+				local[14] = z;
+			}
+		}
+	};
+}
+
+void bench::Transforms(FILE* fp)
+{
+	const int N = 4096;
+	const int REPEAT = 200;
+
+	mt19937 rng(22);
+	uniform_real_distribution<float> value(-2.0f, 2.0f);
+	vector<SimdMat4> a(N), b(N), outRef(N), outSimd(N);
+	vector<SimdVec3> points(N);
+	vector<float> pointRef(N * 3);
+	vector<SimdVec3> pointSimd(N);
+	for (int i = 0; i < N; i++) {
+		// rotations and translations like the ones the game draws with
+		a[i] = SimdMat4::rotationY(value(rng));
+		a[i].m[3][0] = value(rng) * 10;
+		a[i].m[3][1] = value(rng);
+		a[i].m[3][2] = value(rng) * 50;
+		b[i] = simdMultiply(SimdMat4::rotationY(value(rng)), SimdMat4::translation(value(rng), 0, value(rng)));
+		points[i] = SimdVec3(value(rng) * 10, value(rng), value(rng) * 50);
+	}
+
+	fprintf(fp, "== transforms (%d matrices, %s vs simdMath.h) ==\n", N, REF_NAME);
+	fprintf(fp, "%-28s %12s %12s %9s %12s\n", "operation", "ns D3DX", "ns simd", "speedup", "max diff");
+
+	// a * b
+	double t0 = nowNs();
+	for (int r = 0; r < REPEAT; r++)
+		for (int i = 0; i < N; i++)
+			refMultiply(outRef[i].data(), a[i].data(), b[(i + r) & (N - 1)].data());
+	double tRef = nowNs() - t0;
+	t0 = nowNs();
+	for (int r = 0; r < REPEAT; r++)
+		for (int i = 0; i < N; i++)
+			simdMultiply(outSimd[i], a[i], b[(i + r) & (N - 1)]);
+	double tSimd = nowNs() - t0;
+	float diff = maxDiff(outRef[0].data(), outSimd[0].data(), N * 16);
+	fprintf(fp, "%-28s %12.2f %12.2f %8.1fx %12.2g\n", "matrix multiply", tRef / ((double)N * REPEAT),
+		tSimd / ((double)N * REPEAT), tRef / tSimd, diff);
+
+	// translation * world, the draw of a box or a sphere
+	t0 = nowNs();
+	for (int r = 0; r < REPEAT; r++)
+		for (int i = 0; i < N; i++) {
+			float t[16];
+			refTranslation(t, points[i].x, points[i].y, points[i].z);
+			refMultiply(outRef[i].data(), t, b[(i + r) & (N - 1)].data());
+		}
+	tRef = nowNs() - t0;
+	t0 = nowNs();
+	for (int r = 0; r < REPEAT; r++)
+		for (int i = 0; i < N; i++)
+			simdTranslateParent(outSimd[i], points[i].x, points[i].y, points[i].z, b[(i + r) & (N - 1)]);
+	tSimd = nowNs() - t0;
+	diff = maxDiff(outRef[0].data(), outSimd[0].data(), N * 16);
+	fprintf(fp, "%-28s %12.2f %12.2f %8.1fx %12.2g\n", "translation * world", tRef / ((double)N * REPEAT),
+		tSimd / ((double)N * REPEAT), tRef / tSimd, diff);
+
+	// point through a matrix with the divide by w
+	t0 = nowNs();
+	for (int r = 0; r < REPEAT; r++)
+		for (int i = 0; i < N; i++)
+			refTransformCoord(&pointRef[i * 3], &points[i].x, a[(i + r) & (N - 1)].data());
+	tRef = nowNs() - t0;
+	t0 = nowNs();
+	for (int r = 0; r < REPEAT; r++)
+		for (int i = 0; i < N; i++)
+			pointSimd[i] = simdTransformPoint(points[i], a[(i + r) & (N - 1)]);
+	tSimd = nowNs() - t0;
+	diff = 0;
+	for (int i = 0; i < N; i++)
+		for (int j = 0; j < 3; j++)
+			diff = max(diff, fabsf(pointRef[i * 3 + j] - pointSimd[i][j]));
+	fprintf(fp, "%-28s %12.2f %12.2f %8.1fx %12.2g\n", "point transform coord", tRef / ((double)N * REPEAT),
+		tSimd / ((double)N * REPEAT), tRef / tSimd, diff);
+
+	// The scene of a frame: walls, floor and obstacles of the real map, two
+	// tanks of 7 parts and the aim ball. The tank drives for a while, and the
+	// world turns for a while (a right mouse drag); the rest of the frames
+	// nothing moves, which is most of a turn in the game.
+	const int FRAMES = 600;
+	vector<ArenaBox> boxes, obstacles;
+	CArenaLayout::buildWalls(boxes);
+	CArenaLayout::buildObstacles(obstacles);
+	boxes.insert(boxes.end(), obstacles.begin(), obstacles.end());
+	const int TANK_PARTS = 7;
+	const int objects = (int)boxes.size() + 2 * TANK_PARTS + 1;
+
+	vector<RefObject> ref(objects);
+	vector<CLazyTransform> lazy(objects);
+	for (int k = 0; k < objects; k++) {
+		// the barrels (part 2 of each tank) are turned
+		bool barrel = k >= (int)boxes.size() && k < objects - 1 && (k - (int)boxes.size()) % TANK_PARTS == 2;
+		ref[k].yaw = barrel ? 0.5f : 0.0f;
+		if (barrel)
+			lazy[k].setRotationY(0.5f);
+	}
+
+	// where every object is in frame n
+	vector<float> where((size_t)FRAMES * objects * 3);
+	vector<SimdMat4> worlds(FRAMES);
+	for (int n = 0; n < FRAMES; n++) {
+		float drive = (n >= 100 && n < 300) ? (n - 100) * 0.02f : (n >= 300 ? 4.0f : 0.0f);
+		float turn = (n >= 400 && n < 460) ? (n - 400) * 0.01f : (n >= 460 ? 0.6f : 0.0f);
+		worlds[n] = SimdMat4::rotationY(turn);
+		for (int k = 0; k < objects; k++) {
+			float* p = &where[((size_t)n * objects + k) * 3];
+			if (k < (int)boxes.size()) {
+				p[0] = boxes[k].center[0];
+				p[1] = boxes[k].center[1];
+				p[2] = boxes[k].center[2];
+			}
+			else {
+				int part = k - (int)boxes.size();
+				bool first = part < TANK_PARTS;
+				p[0] = (part % TANK_PARTS) * 0.1f;
+				p[1] = 0.3f + (part % TANK_PARTS) * 0.05f;
+				p[2] = (first ? -40.0f + drive : 40.0f);
+				if (k == objects - 1)
+					p[1] = 2.0f;	// the aim ball rides with the first tank
+			}
+		}
+	}
+
+	vector<SimdMat4> drawnRef(objects), drawnLazy(objects);
+	t0 = nowNs();
+	for (int n = 0; n < FRAMES; n++) {
+		const float* world = worlds[n].data();
+		for (int k = 0; k < objects; k++) {
+			const float* p = &where[((size_t)n * objects + k) * 3];
+			if (k >= (int)boxes.size())
+				ref[k].setPosition(p[0], p[1], p[2]);	// the tank model every frame
+			else if (n == 0)
+				ref[k].setPosition(p[0], p[1], p[2]);
+			refMultiply(drawnRef[k].data(), ref[k].local, world);
+		}
+	}
+	tRef = nowNs() - t0;
+
+	CTransformFrame frame;
+	CLazyTransform::resetStats();
+	t0 = nowNs();
+	for (int n = 0; n < FRAMES; n++) {
+		frame.set(worlds[n]);
+		for (int k = 0; k < objects; k++) {
+			const float* p = &where[((size_t)n * objects + k) * 3];
+			if (k >= (int)boxes.size() || n == 0)
+				lazy[k].setPosition(p[0], p[1], p[2]);
+			drawnLazy[k] = lazy[k].getWorld(frame);
+		}
+	}
+	tSimd = nowNs() - t0;
+	TransformStats stats = CLazyTransform::getStats();
+	diff = maxDiff(drawnRef[0].data(), drawnLazy[0].data(), objects * 16);
+
+	fprintf(fp, "scene of %d objects, %d frames (drive 200 frames, turn the world 60 frames):\n", objects, FRAMES);
+	fprintf(fp, "%-28s %12s %14s %12s\n", "path", "ns/frame", "builds/frame", "max diff");
+	fprintf(fp, "%-28s %12.0f %14.1f %12s\n", "rebuild + multiply per draw", tRef / FRAMES, (double)objects, "-");
+	fprintf(fp, "%-28s %12.0f %14.1f %12.2g\n", "CLazyTransform", tSimd / FRAMES, (double)stats.rebuilds / FRAMES, diff);
+	fprintf(fp, "%.1fx faster, %d position changes, %d reads\n\n", tRef / tSimd, stats.changes, stats.reads);
+}
+
+namespace
+{
+	// a CWall / CObstacle as the game kept them before the entity registry:
+	// box, material, mesh and local matrix together in one object per box
+	struct BenchBoxObject {
+		float x, y, z;
+		float width, height, depth;
+		bool created;
+		float mLocal[16];
+		RenderMaterial mtrl;
+		void* mesh;
+
+		void setPosition(float ix, float iy, float iz)
+		{
+			x = ix;
+			y = iy;
+			z = iz;
+			refTranslation(mLocal, x, y, z);
+		}
+		bool draw(CRenderQueue& queue, const CFrustum& frustum, const float world[16])
+		{
+			float bmin[3] = { x - width / 2, y - height / 2, z - depth / 2 };
+			float bmax[3] = { x + width / 2, y + height / 2, z + depth / 2 };
+			if (!created || !frustum.testBox(bmin, bmax))
+				return false;
+			float m[16];
+			refMultiply(m, mLocal, world);
+			queue.submit(mesh, 0, mtrl, m);
+			return true;
+		}
+	};
+
+	// the old Tank: seven part objects moved together, drawn interpolated
+	struct BenchTankObject {
+		BenchBoxObject parts[CSimTank::PART_COUNT];
+		SimVec3 offset[CSimTank::PART_COUNT];
+	};
+}
+
+bool bench::Entities(FILE* fp)
+{
+	const int FRAMES = 200;
+	const float ALPHA = 0.5f;
+
+	vector<ArenaBox> statics, obstacles;
+	CArenaLayout::buildWalls(statics);
+	CArenaLayout::buildObstacles(obstacles);
+	statics.insert(statics.end(), obstacles.begin(), obstacles.end());
+	CSimTank model(0);
+	model.create();
+	model.setPosition(0, 0, 0);
+
+	// chase cameras down the field, like FrustumCull
+	mt19937 rng(23);
+	uniform_real_distribution<float> px(-BENCH_WORLD_WIDTH / 2 + 1, BENCH_WORLD_WIDTH / 2 - 1);
+	uniform_real_distribution<float> pz(-BENCH_WORLD_DEPTH / 2 + 2, BENCH_WORLD_DEPTH / 2 - 2);
+	vector<CFrustum> frusta(FRAMES);
+	for (int n = 0; n < FRAMES; n++) {
+		float dir = (n & 1) ? 1.0f : -1.0f;
+		float eye[3] = { px(rng), 2.0f, pz(rng) };
+		float at[3] = { eye[0], 1.0f, eye[2] + dir * 4 };
+		float m[16];
+		makeViewProj(eye, at, m);
+		frusta[n].extract(m);
+	}
+	SimdMat4 identity = SimdMat4::identity();
+	const float* world = identity.data();
+	CTransformFrame frame;
+	RenderMaterial gray = makeMaterial(0.8f, 0.8f, 0.8f), green = makeMaterial(0.3f, 0.5f, 0.2f);
+	char meshes[8];		// stand-ins, only the pointers matter to the queue
+
+	fprintf(fp, "== entities (real map + tanks of 7 parts, %d chase camera frames, cull + submit) ==\n", FRAMES);
+	fprintf(fp, "%8s %10s %10s %14s %14s %9s %6s\n", "tanks", "entities", "visible", "objects ns/f", "registry ns/f", "speedup", "same");
+
+	bool ok = true;
+	for (int tanks = 2; tanks <= 2048; tanks *= 8) {
+		// where every tank is: spread over the arena. Like in a match, one
+		// tank drives at a time (a turn is 50 frames here) and the rest stand
+		vector<float> tankX(tanks), tankZ(tanks), speed(tanks);
+		for (int t = 0; t < tanks; t++) {
+			tankX[t] = px(rng);
+			tankZ[t] = pz(rng);
+			speed[t] = (t & 1) ? 0.02f : -0.02f;
+		}
+
+		// the objects
+		vector<BenchBoxObject> boxes(statics.size());
+		for (size_t i = 0; i < statics.size(); i++) {
+			BenchBoxObject& o = boxes[i];
+			memset(&o, 0, sizeof(o));
+			o.width = statics[i].size[0];
+			o.height = statics[i].size[1];
+			o.depth = statics[i].size[2];
+			o.created = true;
+			o.mtrl = gray;
+			o.mesh = &meshes[0];
+			o.setPosition(statics[i].center[0], statics[i].center[1], statics[i].center[2]);
+		}
+		vector<BenchTankObject> tankObjects(tanks);
+		for (int t = 0; t < tanks; t++) {
+			for (int k = 0; k < CSimTank::PART_COUNT; k++) {
+				BenchBoxObject& o = tankObjects[t].parts[k];
+				SimVec3 size = CSimTank::getPartSize(k);
+				memset(&o, 0, sizeof(o));
+				o.width = size.x;
+				o.height = size.y;
+				o.depth = size.z;
+				o.created = true;
+				o.mtrl = green;
+				o.mesh = &meshes[1 + k];
+				tankObjects[t].offset[k] = model.getPartCenter(k);
+			}
+		}
+
+		// the same scene as entities
+		CEntityRegistry reg;
+		for (size_t i = 0; i < statics.size(); i++) {
+			const void* mesh = &meshes[0];
+			const ArenaBox& b = statics[i];
+			createDrawable(reg, SimVec3(b.center[0], b.center[1], b.center[2]), SimVec3(b.size[0], b.size[1], b.size[2]),
+				&mesh, 1, gray, RENDER_LAYER_OBSTACLE);
+		}
+		vector<Entity> parts(tanks * CSimTank::PART_COUNT);
+		for (int t = 0; t < tanks; t++) {
+			for (int k = 0; k < CSimTank::PART_COUNT; k++) {
+				const void* mesh = &meshes[1 + k];
+				parts[t * CSimTank::PART_COUNT + k] = createDrawable(reg, SimVec3(0, 0, 0), CSimTank::getPartSize(k),
+					&mesh, 1, green, RENDER_LAYER_ACTOR);
+			}
+		}
+
+		CRenderQueue queue;
+		long long visibleOld = 0, visibleNew = 0;
+		vector<float> z = tankZ;
+		double t0 = nowNs();
+		for (int n = 0; n < FRAMES; n++) {
+			queue.begin(0, 2, 0);
+			for (size_t i = 0; i < boxes.size(); i++)
+				visibleOld += boxes[i].draw(queue, frusta[n], world);
+			int driver = (n / 50) % tanks;
+			for (int t = 0; t < tanks; t++) {
+				float v = t == driver ? speed[t] : 0.0f;
+				float drawZ = z[t] + v * (ALPHA - 1.0f);
+				for (int k = 0; k < CSimTank::PART_COUNT; k++) {
+					BenchTankObject& o = tankObjects[t];
+					o.parts[k].setPosition(tankX[t] + o.offset[k].x, o.offset[k].y, drawZ + o.offset[k].z);
+					visibleOld += o.parts[k].draw(queue, frusta[n], world);
+				}
+				z[t] += v;
+			}
+		}
+		double tOld = nowNs() - t0;
+
+		vector<int> list;
+		z = tankZ;
+		frame.set(identity);
+		t0 = nowNs();
+		for (int n = 0; n < FRAMES; n++) {
+			queue.begin(0, 2, 0);
+			int driver = (n / 50) % tanks;
+			for (int t = 0; t < tanks; t++) {
+				float v = t == driver ? speed[t] : 0.0f;
+				SimVec3 center(tankX[t], 0, z[t]);
+				SimVec3 last(tankX[t], 0, z[t] - v);
+				for (int k = 0; k < CSimTank::PART_COUNT; k++) {
+					const SimVec3& off = tankObjects[t].offset[k];
+					moveEntity(reg, parts[t * CSimTank::PART_COUNT + k], center + off, last + off);
+				}
+				z[t] += v;
+			}
+			interpolateEntities(reg, ALPHA);
+			list.clear();
+			visibleNew += cullEntities(reg, frusta[n], RENDER_LAYER_ALL, list);
+			if (!list.empty())
+				submitEntities(reg, &list[0], (int)list.size(), frame, NULL, queue);
+		}
+		double tNew = nowNs() - t0;
+
+		bool same = visibleOld == visibleNew;
+		ok = ok && same;
+		fprintf(fp, "%8d %10d %10.0f %14.0f %14.0f %8.1fx %6s\n", tanks, reg.getCount(), (double)visibleNew / FRAMES,
+			tOld / FRAMES, tNew / FRAMES, tOld / tNew, same ? "yes" : "NO");
+	}
+	fprintf(fp, "\n");
+	return ok;
+}
+
+namespace
+{
+	// one bot match per index (seed = index + 1), each on its own CTankSim
+	struct BenchMatchJob {
+		CTankSim*		sims;
+		SimMatchResult*	results;
+		long long		maxTicks;
+	};
+
+	void runBenchMatches(void* context, int begin, int end)
+	{
+		BenchMatchJob& job = *(BenchMatchJob*)context;
+		for (int m = begin; m < end; m++) {
+			CSimBot bot(m + 1);
+			runSimMatch(job.sims[m], NULL, &bot, NULL, job.maxTicks, job.results[m]);
+		}
+	}
+
+	// CProjectilePool::sweep over a piece of the shells
+	struct BenchSweepJob {
+		const CProjectilePool*				pool;
+		ProjectileArena						arena;
+		ProjectileHit*						results;
+		vector<ProjectileSweepScratch>*		scratch;
+		int									grain;
+	};
+
+	void runBenchSweep(void* context, int begin, int end)
+	{
+		BenchSweepJob& job = *(BenchSweepJob*)context;
+		job.pool->sweep(begin, end, job.arena, job.results, (*job.scratch)[begin / job.grain]);
+	}
+
+	bool sameMatch(const SimMatchResult& a, const SimMatchResult& b)
+	{
+		return a.winner == b.winner && a.ticks == b.ticks && a.turns == b.turns && a.shots == b.shots
+			&& a.obstaclesDestroyed == b.obstaclesDestroyed;
+	}
+}
+
+bool bench::Jobs(FILE* fp)
+{
+	const int MATCHES = 8;
+	const long long MAX_TICKS = 1000000;
+	const int SWEEP_TICKS = 240;
+	const int MIN_GRAIN = 16;		// shells per sweep job at least
+	const float DT = SIM_TICK_DELTA;
+
+	int hardware = (int)thread::hardware_concurrency();
+	int maxThreads = max(4, hardware);
+	vector<int> threadCounts;
+	for (int t = 1; t < maxThreads; t *= 2)
+		threadCounts.push_back(t);
+	threadCounts.push_back(maxThreads);
+
+	vector<CTankSim> sims(MATCHES);
+	for (int m = 0; m < MATCHES; m++)
+		sims[m].init();
+
+	// whole matches, one job each: the sims share nothing
+	fprintf(fp, "== job system: %d bot matches as jobs (%d hardware threads) ==\n", MATCHES, hardware);
+	fprintf(fp, "%8s %10s %12s %9s %8s %6s\n", "threads", "ms", "ticks/s", "speedup", "stolen", "same");
+	bool ok = true;
+	vector<SimMatchResult> serial(MATCHES);
+	double serialMs = 0;
+	for (size_t c = 0; c < threadCounts.size(); c++) {
+		CJobSystem jobs;
+		jobs.setThreadCount(threadCounts[c]);
+		vector<SimMatchResult> results(MATCHES);
+		BenchMatchJob job = { &sims[0], &results[0], MAX_TICKS };
+		CTaskGraph graph;
+		graph.add(runBenchMatches, &job, 0, MATCHES, 1);
+		double t0 = nowNs();
+		jobs.run(graph);
+		double ms = (nowNs() - t0) / 1e6;
+		long long ticks = 0;
+		bool same = true;
+		for (int m = 0; m < MATCHES; m++) {
+			ticks += results[m].ticks;
+			if (c == 0)
+				serial[m] = results[m];
+			else if (!sameMatch(results[m], serial[m]))
+				same = false;
+		}
+		if (c == 0)
+			serialMs = ms;
+		ok = ok && same;
+		fprintf(fp, "%8d %10.1f %12.0f %8.2fx %8d %6s\n", threadCounts[c], ms, ticks * 1e3 / ms, serialMs / ms,
+			jobs.getStats().stolen, same ? "yes" : "NO");
+	}
+
+	// one tick of a missile barrage against the real arena: integrate, then
+	// the sweep in pieces on the job system, then the hits in order
+	CTankSim& arena = sims[0];
+	arena.reset();
+	ProjectileModel model;
+	model.gravity = (float)MISSILE_GRAVITY_RATE;
+	model.decreaseRate = (float)MISSILE_DECREASE_RATE;
+	model.moveScale = SIM_MOVE_SCALE;
+	model.groundHeight = (float)M_RADIUS;
+	model.expand = (float)M_RADIUS * 0.8f;
+	uniform_real_distribution<float> px(-WORLD_WIDTH / 2 + 1, WORLD_WIDTH / 2 - 1);
+	uniform_real_distribution<float> pz(-WORLD_DEPTH / 2 + 1, WORLD_DEPTH / 2 - 1);
+	uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+	uniform_real_distribution<float> land(0.4f, 15.0f);
+	uniform_real_distribution<float> sky(0.0f, 10.0f);
+
+	fprintf(fp, "\n== job system: missile sweep against the real arena, %d ticks (graph: integrate, sweep pieces, hits) ==\n", SWEEP_TICKS);
+	fprintf(fp, "%8s %8s %8s %12s %12s %9s %6s\n", "shells", "threads", "grain", "serial us", "graph us", "speedup", "same");
+	for (int count = MISSILE_CAPACITY; count <= MISSILE_CAPACITY * 64; count *= 8) {
+		int grain = max(MIN_GRAIN, count / 64);
+		for (size_t c = 0; c < threadCounts.size(); c++) {
+			CProjectilePool serialPool, graphPool;
+			serialPool.init(count, model);
+			graphPool.init(count, model);
+			mt19937 rng(97);
+			for (int i = 0; i < count; i++) {
+				float a = angle(rng), l = land(rng);
+				float x = px(rng), z = pz(rng), vy = sky(rng);
+				serialPool.spawn(x, 0.73f, z, l * cos(a) * 1.25f, vy, l * sin(a) * 1.25f, i);
+				graphPool.spawn(x, 0.73f, z, l * cos(a) * 1.25f, vy, l * sin(a) * 1.25f, i);
+			}
+
+			CJobSystem jobs;
+			jobs.setThreadCount(threadCounts[c]);
+			vector<ProjectileHit> results(count), serialHits, graphHits;
+			vector<ProjectileSweepScratch> scratch((count + grain - 1) / grain);
+			BenchSweepJob job;
+			job.pool = &graphPool;
+			job.results = &results[0];
+			job.scratch = &scratch;
+			job.grain = grain;
+			CTaskGraph graph;
+			int sweep = graph.add(runBenchSweep, &job, 0, count, grain);
+
+			double serialNs = 0, graphNs = 0;
+			bool same = true;
+			for (int n = 0; n < SWEEP_TICKS; n++) {
+				double t0 = nowNs();
+				serialPool.integrate(DT);
+				serialHits.clear();
+				serialPool.collide(arena.getCollisionWorld(), arena.getObstacleGrid(), arena.getObstacleBoxes(), NULL, serialHits);
+				double t1 = nowNs();
+				graphPool.integrate(DT);
+				graphPool.prepareSweep(arena.getCollisionWorld(), arena.getObstacleGrid(), arena.getObstacleBoxes(), NULL, job.arena);
+				graph.setRange(sweep, 0, graphPool.size());
+				jobs.run(graph);
+				graphHits.clear();
+				graphPool.applyHits(&results[0], graphHits);
+				double t2 = nowNs();
+				serialNs += t1 - t0;
+				graphNs += t2 - t1;
+
+				if (serialHits.size() != graphHits.size())
+					same = false;
+				for (size_t k = 0; same && k < serialHits.size(); k++) {
+					const ProjectileHit& a = serialHits[k];
+					const ProjectileHit& b = graphHits[k];
+					if (a.kind != b.kind || a.index != b.index || a.tag != b.tag || a.x != b.x || a.y != b.y || a.z != b.z)
+						same = false;
+				}
+				// refire what landed, the same shells into both pools
+				for (size_t k = 0; k < serialHits.size(); k++) {
+					float a = angle(rng), l = land(rng);
+					float x = px(rng), z = pz(rng), vy = sky(rng);
+					serialPool.spawn(x, 0.73f, z, l * cos(a) * 1.25f, vy, l * sin(a) * 1.25f, serialHits[k].tag);
+					graphPool.spawn(x, 0.73f, z, l * cos(a) * 1.25f, vy, l * sin(a) * 1.25f, serialHits[k].tag);
+				}
+			}
+			ok = ok && same;
+			fprintf(fp, "%8d %8d %8d %12.1f %12.1f %8.2fx %6s\n", count, threadCounts[c], grain,
+				serialNs / SWEEP_TICKS / 1e3, graphNs / SWEEP_TICKS / 1e3, serialNs / graphNs, same ? "yes" : "NO");
+		}
+	}
+
+	fprintf(fp, "\n");
+	return ok;
+}
+
+namespace
+{
+	// the renderer in the loop benchmarks: frames of some CPU work, then
+	// a wait for the display (Present with vsync), or now and then a hitch
+	struct BenchFrameModel {
+		long long	cpuNs;
+		long long	vsyncNs;
+		long long	hitchNs;
+		int			hitchEvery;		// 0: none
+	};
+
+	struct BenchLoopResult {
+		long long	ticks;
+		int			frames;
+		long long	lateTicks;		// started after the next one was due
+		long long	droppedTicks;
+		double		maxLateMs;
+		double		latencySumMs, latencyMaxMs;	// newest tick -> frame shown
+		double		seconds;
+	};
+
+	void benchFrame(const BenchFrameModel& model, int frame, long long startNs)
+	{
+		while (simClockNs() - startNs < model.cpuNs)
+			;
+		bool hitch = model.hitchEvery > 0 && frame % model.hitchEvery == model.hitchEvery - 1;
+		long long wait = startNs + (hitch ? model.hitchNs : model.vsyncNs) - simClockNs();
+		if (wait > 0)
+			this_thread::sleep_for(chrono::nanoseconds(wait));
+	}
+
+	void addLatency(BenchLoopResult& r, long long publishNs)
+	{
+		double ms = (simClockNs() - publishNs) / 1e6;
+		r.latencySumMs += ms;
+		r.latencyMaxMs = max(r.latencyMaxMs, ms);
+	}
+
+	// the game before the simulation thread: fixed-step ticks from an
+	// accumulator, then the frame, on one thread
+	void runCoupledLoop(const BenchFrameModel& model, double seconds, int maxCatchUp, BenchLoopResult& r)
+	{
+		const long long step = (long long)(1e9 / SIM_TICK_RATE);
+		memset(&r, 0, sizeof(r));
+		CTankSim sim;
+		sim.init();
+		CSimBot bot(1);
+		vector<SimCommand> commands;
+
+		long long t0 = simClockNs();
+		long long next = t0, newest = t0;
+		while (simClockNs() - t0 < (long long)(seconds * 1e9)) {
+			long long frameStart = simClockNs();
+			int steps = 0;
+			while (frameStart >= next && steps < maxCatchUp) {
+				long long start = simClockNs();
+				r.maxLateMs = max(r.maxLateMs, (start - next) / 1e6);
+				if (start - next >= step)
+					r.lateTicks++;
+				commands.clear();
+				bot.think(sim, commands);
+				for (size_t k = 0; k < commands.size(); k++)
+					sim.command(commands[k]);
+				sim.tick(SIM_TICK_DELTA);
+				newest = simClockNs();
+				next += step;
+				steps++;
+				r.ticks++;
+			}
+			if (frameStart >= next) {
+				long long dropped = (frameStart - next) / step + 1;
+				next += dropped * step;
+				r.droppedTicks += dropped;
+			}
+			benchFrame(model, r.frames++, frameStart);
+			addLatency(r, newest);
+		}
+		r.seconds = (simClockNs() - t0) / 1e9;
+	}
+
+	// the game now: CSimThread ticks on its own, the frame takes the newest snapshot
+	void runThreadedLoop(const BenchFrameModel& model, double seconds, int maxCatchUp, BenchLoopResult& r)
+	{
+		memset(&r, 0, sizeof(r));
+		CTankSim sim;
+		sim.init();
+		CSimBot bot(1);
+		CSimThread simThread;
+
+		long long t0 = simClockNs();
+		simThread.start(&sim, &bot, maxCatchUp);
+		while (simClockNs() - t0 < (long long)(seconds * 1e9)) {
+			long long frameStart = simClockNs();
+			const SimSnapshot& s = simThread.acquire();
+			benchFrame(model, r.frames++, frameStart);
+			addLatency(r, s.publishNs);
+		}
+		simThread.stop();
+		r.seconds = (simClockNs() - t0) / 1e9;
+
+		SimThreadStats stats = simThread.getStats();
+		r.ticks = stats.ticks;
+		r.lateTicks = stats.lateTicks;
+		r.droppedTicks = stats.droppedTicks;
+		r.maxLateMs = stats.maxLateMs;
+	}
+}
+
+void bench::SimThread(FILE* fp)
+{
+	const double SECONDS = 2.0;
+	const int MAX_CATCH_UP = 8;
+
+	BenchFrameModel models[2] = {
+		{ 3000000, 16666667, 0, 0 },			// 3 ms of CPU work, 60 Hz
+		{ 3000000, 16666667, 100000000, 30 },	// and a 100 ms hitch every 30 frames
+	};
+	const char* modelNames[2] = { "steady", "hitches" };
+
+	fprintf(fp, "== simulation thread: bot match for %.0f s at %.0f ticks/s, frames of 3 ms CPU + 60 Hz vsync (%d hardware threads) ==\n",
+		SECONDS, SIM_TICK_RATE, (int)thread::hardware_concurrency());
+	fprintf(fp, "%8s %10s %9s %7s %7s %8s %9s %10s %10s\n", "model", "loop", "ticks/s", "late", "dropped", "fps",
+		"max late", "lat avg", "lat max");
+	for (int m = 0; m < 2; m++) {
+		for (int threaded = 0; threaded < 2; threaded++) {
+			BenchLoopResult r;
+			if (threaded)
+				runThreadedLoop(models[m], SECONDS, MAX_CATCH_UP, r);
+			else
+				runCoupledLoop(models[m], SECONDS, MAX_CATCH_UP, r);
+			fprintf(fp, "%8s %10s %9.1f %7lld %7lld %8.1f %7.1fms %8.1fms %8.1fms\n", modelNames[m],
+				threaded ? "own thread" : "in frame", r.ticks / r.seconds, r.lateTicks, r.droppedTicks, r.frames / r.seconds,
+				r.maxLateMs, r.frames > 0 ? r.latencySumMs / r.frames : 0.0, r.latencyMaxMs);
+		}
+	}
+	fprintf(fp, "\n");
+}
+
+bool bench::RunAll(FILE* fp)
+{
+	bool ok = true;
+	ok = SpatialGrid(fp) && ok;
+	ok = Explosion(fp) && ok;
+	ok = AabbBatch(fp) && ok;
+	FiringTable(fp);
+	ok = ArenaWalls(fp) && ok;
+	ok = ObstaclePool(fp) && ok;
+	ok = Projectiles(fp) && ok;
+	ok = TankCollider(fp) && ok;
+	ok = RenderQueue(fp) && ok;
+	ok = MeshCache(fp) && ok;
+	ok = Instancing(fp) && ok;
+	ok = ChunkedMesh(fp) && ok;
+	ok = FrustumCull(fp) && ok;
+	SphereLod(fp);
+	ok = SoftRaster(fp) && ok;
+	ok = HudText(fp) && ok;
+	ok = Occlusion(fp) && ok;
+	ok = Pvs(fp) && ok;
+	ok = Matches(fp) && ok;
+	Transforms(fp);
+	ok = Entities(fp) && ok;
+	ok = Jobs(fp) && ok;
+	SimThread(fp);
+	return ok;
+}
@@ -0,0 +1,116 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: benchmark.h
+//
+// Desc: Headless micro benchmarks for the game's hot paths. They build
+//       synthetic data (no D3D device needed) and print timings to a file.
+//       Run the game with "-bench" on the command line to execute them.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __benchmarkH__
+#define __benchmarkH__
+
+#include <cstdio>
+
+namespace bench
+{
+	// heap allocations so far, from allocCounter.cpp when it is linked in
+	// (tanksim); -1 without it (the game)
+	void setAllocationCounter(long long (*counter)(void));
+	long long getAllocationCount(void);
+
+	// per-tick tank-vs-obstacle cost, linear scan vs CSpatialGrid.
+	// false if the grid finds other hits than the scan
+	bool SpatialGrid(FILE* fp);
+
+	// missile impact cost, full obstacle rescan vs grid radius query.
+	// false if the query removes other obstacles than the rescan
+	bool Explosion(FILE* fp);
+
+	// one missile against every obstacle box: AoS objects vs CAabbStore kernels.
+	// false if a compiled-in kernel disagrees with the AoS hits
+	bool AabbBatch(FILE* fp);
+
+	// aim preview cost, tick by tick flight vs CFiringTable lookup/arc
+	void FiringTable(FILE* fp);
+
+	// per-tick arena wall collision, by-value wall copies + scan vs CCollisionWorld.
+	// false if the BVH finds other hits than the scan
+	bool ArenaWalls(FILE* fp);
+
+	// late-game obstacle loop, vector with dead entries vs compacted CHandlePool.
+	// false if the sums differ or a handle finds the wrong obstacle
+	bool ObstaclePool(FILE* fp);
+
+	// tick cost of tens of thousands of shells in CProjectilePool, per integrator path.
+	// false if the compiled-in integrators do not move the shells identically
+	bool Projectiles(FILE* fp);
+
+	// tank-vs-missile and tank-vs-obstacle tests, 7 part boxes vs CCompoundCollider.
+	// false if the compound finds other hits than the part boxes
+	bool TankCollider(FILE* fp);
+
+	// one frame of draw submissions, in scene order vs sorted by CRenderQueue.
+	// false unless the sorted frame draws the same and sets fewer materials
+	bool RenderQueue(FILE* fp);
+
+	// startup mesh creation, one mesh per object vs the shared CMeshCache.
+	// false if a mesh outlives its last release or the bytes do not add up
+	bool MeshCache(FILE* fp);
+
+	// obstacle draw calls and per-destroy upload, per-object vs CInstanceBatch.
+	// false if the slot updates leave a box off its obstacle
+	bool Instancing(FILE* fp);
+
+	// obstacle draw calls and per-explosion rebuild, whole map vs CChunkedBatch chunks.
+	// false if a box leaves its chunk's bounds or live boxes go missing
+	bool ChunkedMesh(FILE* fp);
+
+	// per-frame visibility of every obstacle box, per CAabbStore path vs the BVH.
+	// false if a path keeps other boxes than the single box test
+	bool FrustumCull(FILE* fp);
+
+	// sphere triangles per frame and level switches, one 50 x 50 mesh vs CSphereLod
+	void SphereLod(FILE* fp);
+
+	// CSoftRasterizer frames of the real arena per thread count. false if an
+	// image's checksum is not the stored golden one
+	bool SoftRaster(FILE* fp);
+
+	// HUD text per frame and heap allocations, ostringstream vs CHudText.
+	// false if the text differs or CHudText allocates (where counted)
+	bool HudText(FILE* fp);
+	// share of obstacles and chunks the software Hi-Z buffer hides on the
+	// real map, intact and partly destroyed, with render and test times.
+	// false if the pyramid or the worker disagree with the full buffer
+	bool Occlusion(FILE* fp);
+	// arena PVS build cost and size, share of cells and obstacles a
+	// viewpoint keeps (intact, partly destroyed), per frame lookup cost and
+	// a ray check that nothing visible was dropped
+	bool Pvs(FILE* fp);
+	// whole bot matches on the headless CTankSim: ticks per second against
+	// the game's tick rate, and a recorded match replayed from its script.
+	// false if the replay ends differently
+	bool Matches(FILE* fp);
+	// matrix products and point transforms, D3DX (its scalar formulas in
+	// tanksim) vs the SSE ones of simdMath.h, and a frame of the real
+	// scene drawn with per-draw products vs CLazyTransform (time and
+	// matrices built)
+	void Transforms(FILE* fp);
+	// a frame of the real map with 2 to 1024 tanks: one object per box
+	// (the old CWall / Tank) vs CEntityRegistry arrays and systems.
+	// false if the registry draws other boxes than the objects
+	bool Entities(FILE* fp);
+	// CJobSystem from 1 thread up: bot matches as jobs and the missile sweep
+	// of a barrage in pieces. false if a thread count changes a match or a hit
+	bool Jobs(FILE* fp);
+	// ticks run late or dropped and sim -> display latency with steady
+	// frames and with hitches: ticks inside the frame loop vs CSimThread
+	void SimThread(FILE* fp);
+
+	// runs every benchmark above; false if any of their checks failed
+	bool RunAll(FILE* fp);
+}
+
+#endif // __benchmarkH__
@@ -0,0 +1,122 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: chunkedBatch.cpp
+//
+// Desc: Chunked merged box meshes (see chunkedBatch.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "chunkedBatch.h"
+#include <cstddef>
+
+void CChunkedBatch::clear(void)
+{
+	m_chunks.clear();
+	m_order.clear();
+	m_slotChunk.clear();
+	m_dirty.clear();
+}
+
+void CChunkedBatch::build(const CInstanceBatch& batch, float minX, float minZ, float width, float depth, float chunkSize)
+{
+	clear();
+	int cx = (int)(width / chunkSize) + 1;
+	int cz = (int)(depth / chunkSize) + 1;
+	int slots = batch.getSlotCount();
+
+	// counting sort of the slots by chunk
+	std::vector<int> cellOf(slots), counts(cx * cz, 0);
+	for (int s = 0; s < slots; s++) {
+		float x, y, z;
+		batch.getCenter(s, x, y, z);
+		int ix = (int)((x - minX) / chunkSize);
+		int iz = (int)((z - minZ) / chunkSize);
+		ix = ix < 0 ? 0 : (ix >= cx ? cx - 1 : ix);
+		iz = iz < 0 ? 0 : (iz >= cz ? cz - 1 : iz);
+		cellOf[s] = iz * cx + ix;
+		counts[cellOf[s]]++;
+	}
+
+	// only cells with boxes become chunks
+	std::vector<int> chunkOfCell(cx * cz, -1);
+	int first = 0;
+	for (int cell = 0; cell < cx * cz; cell++) {
+		if (counts[cell] == 0)
+			continue;
+		Chunk c;
+		c.first = first;
+		c.capacity = 0;
+		c.live = 0;
+		c.dirty = true;
+		chunkOfCell[cell] = (int)m_chunks.size();
+		m_dirty.push_back((int)m_chunks.size());
+		m_chunks.push_back(c);
+		first += counts[cell];
+	}
+
+	m_order.resize(slots);
+	m_slotChunk.resize(slots);
+	for (int s = 0; s < slots; s++) {
+		int ci = chunkOfCell[cellOf[s]];
+		Chunk& c = m_chunks[ci];
+		m_order[c.first + c.capacity] = s;
+		m_slotChunk[s] = ci;
+
+		float bmin[3], bmax[3];
+		batch.getBounds(s, bmin, bmax);
+		for (int a = 0; a < 3; a++) {
+			if (c.capacity == 0 || bmin[a] < c.bmin[a]) c.bmin[a] = bmin[a];
+			if (c.capacity == 0 || bmax[a] > c.bmax[a]) c.bmax[a] = bmax[a];
+		}
+		c.capacity++;
+	}
+}
+
+void CChunkedBatch::markSlotDirty(int slot)
+{
+	if (slot < 0 || slot >= (int)m_slotChunk.size())
+		return;
+	Chunk& c = m_chunks[m_slotChunk[slot]];
+	if (!c.dirty) {
+		c.dirty = true;
+		m_dirty.push_back(m_slotChunk[slot]);
+	}
+}
+
+void CChunkedBatch::takeDirtySlots(CInstanceBatch& batch)
+{
+	const std::vector<int>& slots = batch.getDirtySlots();
+	for (size_t i = 0; i < slots.size(); i++)
+		markSlotDirty(slots[i]);
+	batch.clearDirty();
+}
+
+int CChunkedBatch::rebuildChunk(int c, const CInstanceBatch& batch, InstanceVertex* out)
+{
+	Chunk& chunk = m_chunks[c];
+	int live = 0;
+	for (int k = 0; k < chunk.capacity; k++) {
+		int s = m_order[chunk.first + k];
+		if (!batch.isLive(s))
+			continue;
+		batch.expandSlot(s, out + live * CInstanceBatch::VERTICES_PER_INSTANCE);
+		live++;
+	}
+	chunk.live = live;
+	return live;
+}
+
+void CChunkedBatch::clearDirty(void)
+{
+	for (size_t i = 0; i < m_dirty.size(); i++)
+		m_chunks[m_dirty[i]].dirty = false;
+	m_dirty.clear();
+}
+
+int CChunkedBatch::getDrawCount(void) const
+{
+	int draws = 0;
+	for (size_t c = 0; c < m_chunks.size(); c++)
+		draws += (m_chunks[c].live + CInstanceBatch::INSTANCES_PER_DRAW - 1) / CInstanceBatch::INSTANCES_PER_DRAW;
+	return draws;
+}
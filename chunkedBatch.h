@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: chunkedBatch.h
+//
+// Desc: Splits the slots of a CInstanceBatch into square XZ chunks, each a
+//       contiguous range of one vertex buffer holding only its live boxes.
+//       A chunk is drawn with one call; when one of its boxes changes only
+//       that chunk is rebuilt, so the work per destroyed box is bounded by
+//       the chunk size instead of the map size.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __chunkedBatchH__
+#define __chunkedBatchH__
+
+#include "instanceBatch.h"
+#include <vector>
+
+class CChunkedBatch {
+public:
+	struct Chunk {
+		int first;			// first box position in the buffer
+		int capacity;		// boxes assigned to the chunk
+		int live;			// live boxes written at first.. after the last rebuild
+		bool dirty;
+		float bmin[3], bmax[3];	// bounds of every box assigned to the chunk
+	};
+
+	CChunkedBatch(void) { clear(); }
+	~CChunkedBatch(void) {}
+
+public:
+	void clear(void);
+
+	// assigns every slot of batch to the chunk under its center; the grid
+	// covers [minX, minX + width] x [minZ, minZ + depth]. Every chunk starts
+	// dirty. Boxes added to batch later need another build()
+	void build(const CInstanceBatch& batch, float minX, float minZ, float width, float depth, float chunkSize);
+
+	// marks the chunks of the slots batch reports dirty (then clears them)
+	void takeDirtySlots(CInstanceBatch& batch);
+	void markSlotDirty(int slot);
+
+	// writes the live boxes of chunk c at out (the chunk's own range, i.e.
+	// buffer + getChunk(c).first * VERTICES_PER_INSTANCE); returns live count
+	int rebuildChunk(int c, const CInstanceBatch& batch, InstanceVertex* out);
+	// chunks waiting for rebuildChunk(), each listed once
+	const std::vector<int>& getDirtyChunks(void) const { return m_dirty; }
+	void clearDirty(void);
+
+	int getChunkCount(void) const { return (int)m_chunks.size(); }
+	const Chunk& getChunk(int c) const { return m_chunks[c]; }
+	int getBoxCount(void) const { return (int)m_order.size(); }
+	int getChunkOf(int slot) const { return m_slotChunk[slot]; }
+	// draw calls for the live boxes (chunks with nothing left are skipped)
+	int getDrawCount(void) const;
+
+private:
+	std::vector<Chunk>	m_chunks;
+	std::vector<int>	m_order;		// slots grouped by chunk (chunk c at [first, first + capacity))
+	std::vector<int>	m_slotChunk;	// chunk of every slot
+	std::vector<int>	m_dirty;
+};
+
+#endif // __chunkedBatchH__
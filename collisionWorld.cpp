@@ -0,0 +1,307 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: collisionWorld.cpp
+//
+// Desc: Static arena collision BVH (see collisionWorld.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "collisionWorld.h"
+#include "frustum.h"
+#include <algorithm>
+
+#define BVH_LEAF_SIZE 2
+#define BVH_MAX_DEPTH 64
+
+// sweepSegmentBox() with the direction already inverted, since one sweep
+// tests many nodes with the same segment
+static bool sweepSlab(const float p0[3], const float invD[3], const float bmin[3], const float bmax[3], float expand, float& t)
+{
+	float tEnter = 0.0f, tExit = 1.0f;
+	for (int a = 0; a < 3; a++) {
+		float t1 = (bmin[a] - expand - p0[a]) * invD[a];
+		float t2 = (bmax[a] + expand - p0[a]) * invD[a];
+		if (t1 > t2) { float tmp = t1; t1 = t2; t2 = tmp; }
+		if (t1 > tEnter) tEnter = t1;
+		if (t2 < tExit) tExit = t2;
+		if (tEnter > tExit)
+			return false;
+	}
+	t = tEnter;
+	return true;
+}
+
+CCollisionWorld::CCollisionWorld(void)
+{
+	m_built = false;
+}
+
+void CCollisionWorld::clear(void)
+{
+	m_min.clear();
+	m_max.clear();
+	m_kind.clear();
+	m_order.clear();
+	m_nodes.clear();
+	m_built = false;
+}
+
+int CCollisionWorld::add(const float bmin[3], const float bmax[3], int kind)
+{
+	for (int a = 0; a < 3; a++) {
+		m_min.push_back(bmin[a]);
+		m_max.push_back(bmax[a]);
+	}
+	m_kind.push_back(kind);
+	m_built = false;
+	return (int)m_kind.size() - 1;
+}
+
+void CCollisionWorld::build(void)
+{
+	int count = getBoxCount();
+	m_order.resize(count);
+	for (int i = 0; i < count; i++)
+		m_order[i] = i;
+	m_nodes.clear();
+	m_nodes.reserve(count * 2);
+	if (count > 0)
+		buildNode(0, count, 0);
+	m_built = true;
+}
+
+void CCollisionWorld::growBounds(int i, float bmin[3], float bmax[3], bool reset) const
+{
+	for (int a = 0; a < 3; a++) {
+		if (reset) {
+			bmin[a] = m_min[i * 3 + a];
+			bmax[a] = m_max[i * 3 + a];
+		}
+		else {
+			bmin[a] = std::min(bmin[a], m_min[i * 3 + a]);
+			bmax[a] = std::max(bmax[a], m_max[i * 3 + a]);
+		}
+	}
+}
+
+float CCollisionWorld::surfaceArea(const float bmin[3], const float bmax[3])
+{
+	float x = bmax[0] - bmin[0], y = bmax[1] - bmin[1], z = bmax[2] - bmin[2];
+	return x * y + y * z + z * x;
+}
+
+void CCollisionWorld::sortByCenter(int first, int count, int axis)
+{
+	const std::vector<float>& mn = m_min;
+	const std::vector<float>& mx = m_max;
+	std::sort(m_order.begin() + first, m_order.begin() + first + count,
+		[&mn, &mx, axis](int l, int r) {
+			return mn[l * 3 + axis] + mx[l * 3 + axis] < mn[r * 3 + axis] + mx[r * 3 + axis];
+		});
+}
+
+int CCollisionWorld::buildNode(int first, int count, int depth)
+{
+	int index = (int)m_nodes.size();
+	m_nodes.push_back(Node());
+
+	Node node;
+	node.kinds = 0;
+	for (int k = first; k < first + count; k++) {
+		growBounds(m_order[k], node.bmin, node.bmax, k == first);
+		node.kinds |= m_kind[m_order[k]];
+	}
+
+	// the depth cap keeps the fixed traversal stacks safe whatever the input
+	if (count <= BVH_LEAF_SIZE || depth >= BVH_MAX_DEPTH - 2) {
+		node.left = node.right = -1;
+		node.first = first;
+		node.count = count;
+		m_nodes[index] = node;
+		return index;
+	}
+
+	// surface area heuristic: try every split of the boxes sorted by center
+	// on each axis and keep the one with the smallest sum of area * count.
+	// the long boundary walls end up in their own subtrees that way
+	std::vector<float> rightArea(count);
+	int bestAxis = 0, bestHalf = count / 2;
+	float bestCost = -1;
+	for (int axis = 0; axis < 3; axis++) {
+		sortByCenter(first, count, axis);
+
+		float bmin[3], bmax[3];
+		for (int k = count - 1; k > 0; k--) {
+			growBounds(m_order[first + k], bmin, bmax, k == count - 1);
+			rightArea[k] = surfaceArea(bmin, bmax);
+		}
+		for (int k = 1; k < count; k++) {
+			growBounds(m_order[first + k - 1], bmin, bmax, k == 1);
+			float cost = surfaceArea(bmin, bmax) * k + rightArea[k] * (count - k);
+			if (bestCost < 0 || cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestHalf = k;
+			}
+		}
+	}
+	if (bestAxis != 2)
+		sortByCenter(first, count, bestAxis);
+
+	node.first = 0;
+	node.count = 0;
+	node.left = buildNode(first, bestHalf, depth + 1);
+	node.right = buildNode(first + bestHalf, count - bestHalf, depth + 1);
+	m_nodes[index] = node;
+	return index;
+}
+
+bool CCollisionWorld::getBounds(int kinds, float bmin[3], float bmax[3]) const
+{
+	bool any = false;
+	for (int i = 0; i < getBoxCount(); i++) {
+		if (!(m_kind[i] & kinds))
+			continue;
+		growBounds(i, bmin, bmax, !any);
+		any = true;
+	}
+	return any;
+}
+
+bool CCollisionWorld::overlaps(const float bmin[3], const float bmax[3], int kinds) const
+{
+	if (m_nodes.empty())
+		return false;
+
+	int stack[BVH_MAX_DEPTH];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node& node = m_nodes[stack[--top]];
+		if (!(node.kinds & kinds) || !boxOverlaps(node.bmin, node.bmax, bmin, bmax))
+			continue;
+		if (node.count > 0) {
+			for (int k = node.first; k < node.first + node.count; k++) {
+				int i = m_order[k];
+				if ((m_kind[i] & kinds) && boxOverlaps(&m_min[i * 3], &m_max[i * 3], bmin, bmax))
+					return true;
+			}
+		}
+		else {
+			stack[top++] = node.left;
+			stack[top++] = node.right;
+		}
+	}
+	return false;
+}
+
+int CCollisionWorld::overlapAll(const float bmin[3], const float bmax[3], int kinds, std::vector<int>& out) const
+{
+	if (m_nodes.empty())
+		return 0;
+
+	int hits = 0;
+	int stack[BVH_MAX_DEPTH];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node& node = m_nodes[stack[--top]];
+		if (!(node.kinds & kinds) || !boxOverlaps(node.bmin, node.bmax, bmin, bmax))
+			continue;
+		if (node.count > 0) {
+			for (int k = node.first; k < node.first + node.count; k++) {
+				int i = m_order[k];
+				if ((m_kind[i] & kinds) && boxOverlaps(&m_min[i * 3], &m_max[i * 3], bmin, bmax)) {
+					out.push_back(i);
+					hits++;
+				}
+			}
+		}
+		else {
+			stack[top++] = node.left;
+			stack[top++] = node.right;
+		}
+	}
+	return hits;
+}
+
+int CCollisionWorld::cullFrustum(const CFrustum& frustum, int kinds, std::vector<int>& out) const
+{
+	if (m_nodes.empty())
+		return 0;
+
+	// stack entries carry the planes the parent still straddles, so nodes
+	// below a plane the parent is inside of never test it again (0 = inside)
+	const int shift = CFrustum::PLANE_COUNT;
+	int hits = 0;
+	int stack[BVH_MAX_DEPTH];
+	int top = 0;
+	stack[top++] = CFrustum::ALL_PLANES;
+	while (top > 0) {
+		int entry = stack[--top];
+		const Node& node = m_nodes[entry >> shift];
+		if (!(node.kinds & kinds))
+			continue;
+		int planes = entry & CFrustum::ALL_PLANES;
+		if (planes && frustum.classifyBox(node.bmin, node.bmax, planes) == CFrustum::OUTSIDE)
+			continue;
+		if (node.count > 0) {
+			for (int k = node.first; k < node.first + node.count; k++) {
+				int i = m_order[k];
+				if ((m_kind[i] & kinds) && (!planes || frustum.testBox(&m_min[i * 3], &m_max[i * 3], planes))) {
+					out.push_back(i);
+					hits++;
+				}
+			}
+		}
+		else {
+			stack[top++] = (node.left << shift) | planes;
+			stack[top++] = (node.right << shift) | planes;
+		}
+	}
+	return hits;
+}
+
+int CCollisionWorld::sweepSegment(const float p0[3], const float d[3], float expand, int kinds, float& tHit) const
+{
+	if (m_nodes.empty())
+		return -1;
+
+	float invD[3];
+	for (int a = 0; a < 3; a++) {
+		float v = d[a];
+		if (v >= 0 && v < 1e-12f) v = 1e-12f;
+		else if (v < 0 && v > -1e-12f) v = -1e-12f;
+		invD[a] = 1.0f / v;
+	}
+
+	int best = -1;
+	float bestT = 1.0f;
+	int stack[BVH_MAX_DEPTH];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node& node = m_nodes[stack[--top]];
+		float t;
+		// subtrees entered later than the best hit so far cannot win
+		if (!(node.kinds & kinds) || !sweepSlab(p0, invD, node.bmin, node.bmax, expand, t) || t > bestT)
+			continue;
+		if (node.count > 0) {
+			for (int k = node.first; k < node.first + node.count; k++) {
+				int i = m_order[k];
+				if ((m_kind[i] & kinds) && sweepSlab(p0, invD, &m_min[i * 3], &m_max[i * 3], expand, t)
+					&& (best < 0 || t < bestT)) {
+					best = i;
+					bestT = t;
+				}
+			}
+		}
+		else {
+			stack[top++] = node.left;
+			stack[top++] = node.right;
+		}
+	}
+	if (best >= 0)
+		tHit = bestT;
+	return best;
+}
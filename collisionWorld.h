@@ -0,0 +1,79 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: collisionWorld.h
+//
+// Desc: Static collision geometry of the arena (boundary walls, pillars and
+//       the floor). Built once in Setup into an immutable bounding volume
+//       hierarchy and shared by reference with everything that collides.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __collisionWorldH__
+#define __collisionWorldH__
+
+#include <vector>
+
+class CFrustum;
+
+class CCollisionWorld {
+public:
+	// what a box is, so queries can pick walls without the floor and so on
+	enum Kind { KIND_WALL = 1, KIND_FLOOR = 2, KIND_ALL = 3 };
+
+	CCollisionWorld(void);
+	~CCollisionWorld(void) {}
+
+public:
+	void clear(void);
+
+	// add every static box, then build(); the boxes cannot change afterwards
+	int add(const float bmin[3], const float bmax[3], int kind);
+	void build(void);
+	bool isBuilt(void) const { return m_built; }
+
+	// does any box of the given kinds overlap [bmin, bmax]
+	bool overlaps(const float bmin[3], const float bmax[3], int kinds) const;
+	// appends the index of every such box to out, returns the hit count
+	int overlapAll(const float bmin[3], const float bmax[3], int kinds, std::vector<int>& out) const;
+	// earliest box hit by the segment p0 -> p0 + d (boxes grown by expand),
+	// -1 if none; tHit gets the time of impact in [0, 1]
+	int sweepSegment(const float p0[3], const float d[3], float expand, int kinds, float& tHit) const;
+	// append every box of the given kinds that is at least partly inside the
+	// frustum; subtrees fully inside are taken without testing their boxes
+	int cullFrustum(const CFrustum& frustum, int kinds, std::vector<int>& out) const;
+
+	// bounds of every box of the given kinds, false when there is none
+	bool getBounds(int kinds, float bmin[3], float bmax[3]) const;
+
+	int getBoxCount(void) const { return (int)m_kind.size(); }
+	int getNodeCount(void) const { return (int)m_nodes.size(); }
+	int getKind(int i) const { return m_kind[i]; }
+
+private:
+	struct Node {
+		float bmin[3], bmax[3];
+		int kinds;		// union of the kinds below, lets whole subtrees be skipped
+		int left, right;	// inner node: child node indices
+		int first;		// leaf: first entry in m_order
+		int count;		// leaf: box count, 0 for inner nodes
+	};
+
+	int buildNode(int first, int count, int depth);
+	void sortByCenter(int first, int count, int axis);
+	void growBounds(int i, float bmin[3], float bmax[3], bool reset) const;
+	static float surfaceArea(const float bmin[3], const float bmax[3]);
+	bool boxOverlaps(const float* amin, const float* amax, const float* bmin, const float* bmax) const
+	{
+		return amin[0] <= bmax[0] && amax[0] >= bmin[0] &&
+			amin[1] <= bmax[1] && amax[1] >= bmin[1] &&
+			amin[2] <= bmax[2] && amax[2] >= bmin[2];
+	}
+
+	bool					m_built;
+	std::vector<float>		m_min, m_max;	// 3 floats per box
+	std::vector<int>		m_kind;
+	std::vector<int>		m_order;		// box indices, leaves own contiguous ranges
+	std::vector<Node>		m_nodes;		// m_nodes[0] is the root
+};
+
+#endif // __collisionWorldH__
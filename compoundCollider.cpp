@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: compoundCollider.cpp
+//
+// Desc: Compound box collider (see compoundCollider.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "compoundCollider.h"
+#include "aabbStore.h"
+
+CCompoundCollider::CCompoundCollider(void)
+{
+	m_origin[0] = m_origin[1] = m_origin[2] = 0;
+	clear();
+}
+
+void CCompoundCollider::clear(void)
+{
+	m_min.clear();
+	m_max.clear();
+	m_group.clear();
+	for (int m = 0; m <= GROUP_ALL; m++)
+		m_maskUsed[m] = 0;
+}
+
+int CCompoundCollider::addChild(float cx, float cy, float cz, float width, float height, float depth, int group)
+{
+	float bmin[3] = { cx - width / 2, cy - height / 2, cz - depth / 2 };
+	float bmax[3] = { cx + width / 2, cy + height / 2, cz + depth / 2 };
+	group &= GROUP_ALL;
+
+	// grow every mask that selects this child
+	for (int m = 1; m <= GROUP_ALL; m++) {
+		if (!(m & group))
+			continue;
+		for (int a = 0; a < 3; a++) {
+			if (!m_maskUsed[m] || bmin[a] < m_maskMin[m][a]) m_maskMin[m][a] = bmin[a];
+			if (!m_maskUsed[m] || bmax[a] > m_maskMax[m][a]) m_maskMax[m][a] = bmax[a];
+		}
+		m_maskUsed[m] = 1;
+	}
+	for (int a = 0; a < 3; a++) {
+		m_min.push_back(bmin[a]);
+		m_max.push_back(bmax[a]);
+	}
+	m_group.push_back(group);
+	return (int)m_group.size() - 1;
+}
+
+bool CCompoundCollider::localBounds(int groups, float bmin[3], float bmax[3]) const
+{
+	groups &= GROUP_ALL;
+	if (!m_maskUsed[groups])
+		return false;
+	for (int a = 0; a < 3; a++) {
+		bmin[a] = m_maskMin[groups][a];
+		bmax[a] = m_maskMax[groups][a];
+	}
+	return true;
+}
+
+bool CCompoundCollider::getBounds(int groups, float bmin[3], float bmax[3]) const
+{
+	if (!localBounds(groups, bmin, bmax))
+		return false;
+	for (int a = 0; a < 3; a++) {
+		bmin[a] += m_origin[a];
+		bmax[a] += m_origin[a];
+	}
+	return true;
+}
+
+void CCompoundCollider::getChildBounds(int i, float bmin[3], float bmax[3]) const
+{
+	for (int a = 0; a < 3; a++) {
+		bmin[a] = m_min[i * 3 + a] + m_origin[a];
+		bmax[a] = m_max[i * 3 + a] + m_origin[a];
+	}
+}
+
+bool CCompoundCollider::overlapsBox(const float bmin[3], const float bmax[3], int groups) const
+{
+	// the query goes to local space instead of the children to world space
+	float qmin[3], qmax[3], emin[3], emax[3];
+	for (int a = 0; a < 3; a++) {
+		qmin[a] = bmin[a] - m_origin[a];
+		qmax[a] = bmax[a] - m_origin[a];
+	}
+	if (!localBounds(groups, emin, emax))
+		return false;
+	for (int a = 0; a < 3; a++) {
+		if (emin[a] > qmax[a] || emax[a] < qmin[a])
+			return false;
+	}
+
+	for (int i = 0; i < getChildCount(); i++) {
+		if (!(m_group[i] & groups))
+			continue;
+		const float* cmin = &m_min[i * 3];
+		const float* cmax = &m_max[i * 3];
+		if (cmin[0] <= qmax[0] && cmax[0] >= qmin[0] &&
+			cmin[1] <= qmax[1] && cmax[1] >= qmin[1] &&
+			cmin[2] <= qmax[2] && cmax[2] >= qmin[2])
+			return true;
+	}
+	return false;
+}
+
+int CCompoundCollider::sweepSegment(const float p0[3], const float d[3], float expand, int groups, float& tHit) const
+{
+	float local[3] = { p0[0] - m_origin[0], p0[1] - m_origin[1], p0[2] - m_origin[2] };
+	float emin[3], emax[3], t;
+	if (!localBounds(groups, emin, emax) || !sweepSegmentBox(local, d, emin, emax, expand, t))
+		return -1;
+
+	int best = -1;
+	for (int i = 0; i < getChildCount(); i++) {
+		if (!(m_group[i] & groups))
+			continue;
+		if (sweepSegmentBox(local, d, &m_min[i * 3], &m_max[i * 3], expand, t) && (best < 0 || t < tHit)) {
+			best = i;
+			tHit = t;
+		}
+	}
+	return best;
+}
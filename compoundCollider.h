@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: compoundCollider.h
+//
+// Desc: Collider made of several boxes fixed relative to one origin (the
+//       parts of a tank). The child boxes are stored in local space, so
+//       moving the object only moves the origin. Every query first tests
+//       the enclosing box, which turns most queries away after one test.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __compoundColliderH__
+#define __compoundColliderH__
+
+#include <vector>
+
+#define COLLIDER_MAX_GROUPS 4
+
+class CCompoundCollider {
+public:
+	enum { GROUP_ALL = (1 << COLLIDER_MAX_GROUPS) - 1 };
+
+	CCompoundCollider(void);
+	~CCompoundCollider(void) {}
+
+public:
+	void clear(void);
+	// box centered at (cx, cy, cz) from the origin; group is a single bit
+	// (1 << n) so queries can pick which children they care about
+	int addChild(float cx, float cy, float cz, float width, float height, float depth, int group);
+
+	void setOrigin(float x, float y, float z) { m_origin[0] = x; m_origin[1] = y; m_origin[2] = z; }
+	const float* getOrigin(void) const { return m_origin; }
+
+	// world space box around every child in groups, false when there is none
+	bool getBounds(int groups, float bmin[3], float bmax[3]) const;
+	void getChildBounds(int i, float bmin[3], float bmax[3]) const;
+	int getChildCount(void) const { return (int)m_group.size(); }
+
+	// does a child in groups overlap the world box [bmin, bmax]
+	bool overlapsBox(const float bmin[3], const float bmax[3], int groups) const;
+	// earliest child in groups hit by the segment p0 -> p0 + d (children
+	// grown by expand), -1 if none; tHit gets the time of impact in [0, 1]
+	int sweepSegment(const float p0[3], const float d[3], float expand, int groups, float& tHit) const;
+
+private:
+	bool localBounds(int groups, float bmin[3], float bmax[3]) const;
+
+	float					m_origin[3];
+	std::vector<float>		m_min, m_max;	// local space, 3 floats per child
+	std::vector<int>		m_group;
+
+	// local bounds for every combination of groups, so the enclosing box of
+	// a query is one lookup; m_maskUsed has the masks with a child in them
+	float					m_maskMin[1 << COLLIDER_MAX_GROUPS][3];
+	float					m_maskMax[1 << COLLIDER_MAX_GROUPS][3];
+	unsigned char			m_maskUsed[1 << COLLIDER_MAX_GROUPS];
+};
+
+#endif // __compoundColliderH__
@@ -0,0 +1,322 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: entityRegistry.cpp
+//
+// Desc: Entity registry and the per-frame systems (see entityRegistry.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "entityRegistry.h"
+#include "frustum.h"
+#include <cstring>
+#include <algorithm>
+
+// -----------------------------------------------------------------------------
+// CEntityRegistry
+// -----------------------------------------------------------------------------
+
+CEntityRegistry::CEntityRegistry(void)
+{
+	memset(m_groupBegin, 0, sizeof(m_groupBegin));
+}
+
+void CEntityRegistry::clear(void)
+{
+	m_generations.clear();
+	m_freeSlots.clear();
+	m_rows.clear();
+	memset(m_groupBegin, 0, sizeof(m_groupBegin));
+	m_entities.clear();
+	m_transforms.clear();
+	m_bounds.clear();
+	m_renderables.clear();
+	m_velocities.clear();
+	m_destructibles.clear();
+	m_boxes.clear();
+}
+
+Entity CEntityRegistry::create(int layer)
+{
+	Entity e;
+	if (!m_freeSlots.empty()) {
+		e.slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else {
+		m_generations.push_back(1);
+		m_rows.push_back(-1);
+		e.slot = (int)m_generations.size() - 1;
+	}
+	e.generation = m_generations[e.slot];
+
+	// a new row at the end, in the last group, then into its own
+	DestructibleComponent d = { -1, -1 };
+	m_entities.push_back(e);
+	m_transforms.push_back(TransformComponent());
+	m_bounds.push_back(BoundsComponent());
+	m_renderables.push_back(RenderComponent());
+	m_renderables.back().lodLevel = -1;
+	m_velocities.push_back(VelocityComponent());
+	m_destructibles.push_back(d);
+	m_boxes.add(0, 0, 0, 0, 0, 0);
+	m_rows[e.slot] = (int)m_entities.size() - 1;
+	m_groupBegin[GROUP_COUNT]++;
+	moveRow(m_rows[e.slot], layerIndex(layer) * 2 + 1);
+	return e;
+}
+
+bool CEntityRegistry::destroy(Entity e)
+{
+	if (!isValid(e))
+		return false;
+	// to the end of the last group, then off the arrays
+	int row = moveRow(m_rows[e.slot], GROUP_COUNT - 1);
+	int last = (int)m_entities.size() - 1;
+	swapRows(row, last);
+	m_entities.pop_back();
+	m_transforms.pop_back();
+	m_bounds.pop_back();
+	m_renderables.pop_back();
+	m_velocities.pop_back();
+	m_destructibles.pop_back();
+	m_boxes.removeLast();
+	m_groupBegin[GROUP_COUNT]--;
+
+	m_rows[e.slot] = -1;
+	if (++m_generations[e.slot] == 0)
+		m_generations[e.slot] = 1;
+	m_freeSlots.push_back(e.slot);
+	return true;
+}
+
+int CEntityRegistry::setMoving(Entity e, bool moving)
+{
+	int row = getRow(e);
+	if (row < 0)
+		return -1;
+	int group = groupOf(row);
+	if (((group & 1) == 0) != moving)
+		row = moveRow(row, moving ? group - 1 : group + 1);
+	return row;
+}
+
+bool CEntityRegistry::setDestructible(Entity e, const DestructibleComponent& d)
+{
+	int row = getRow(e);
+	if (row < 0)
+		return false;
+	m_destructibles[row] = d;
+	return true;
+}
+
+bool CEntityRegistry::setHidden(Entity e, bool hidden)
+{
+	int row = getRow(e);
+	if (row < 0)
+		return false;
+	m_bounds[row].hidden = hidden;
+	if (hidden) {
+		m_boxes.kill(row);
+		return true;
+	}
+	float bmin[3], bmax[3];	// set() brings it back to life
+	m_boxes.getBox(row, bmin, bmax);
+	m_boxes.set(row, bmin[0], bmin[1], bmin[2], bmax[0], bmax[1], bmax[2]);
+	return true;
+}
+
+void CEntityRegistry::setBox(int row, const SimVec3& center)
+{
+	const BoundsComponent& b = m_bounds[row];
+	m_boxes.set(row, center.x - b.halfSize.x, center.y - b.halfSize.y, center.z - b.halfSize.z,
+		center.x + b.halfSize.x, center.y + b.halfSize.y, center.z + b.halfSize.z);
+	if (b.hidden)
+		m_boxes.kill(row);
+}
+
+TransformComponent* CEntityRegistry::findTransform(Entity e)
+{
+	int row = getRow(e);
+	return row < 0 ? NULL : &m_transforms[row];
+}
+
+RenderComponent* CEntityRegistry::findRenderable(Entity e)
+{
+	int row = getRow(e);
+	return row < 0 ? NULL : &m_renderables[row];
+}
+
+VelocityComponent* CEntityRegistry::findVelocity(Entity e)
+{
+	int row = getRow(e);
+	return row < 0 || !isMoving(row) ? NULL : &m_velocities[row];
+}
+
+const DestructibleComponent* CEntityRegistry::findDestructible(Entity e) const
+{
+	int row = getRow(e);
+	return row < 0 || m_destructibles[row].id < 0 ? NULL : &m_destructibles[row];
+}
+
+int CEntityRegistry::groupOf(int row) const
+{
+	int g = 0;
+	while (row >= m_groupBegin[g + 1])
+		g++;
+	return g;
+}
+
+// One swap per group boundary crossed: the row trades places with the
+// edge row of its group, and the boundary moves past it
+int CEntityRegistry::moveRow(int row, int group)
+{
+	int g = groupOf(row);
+	for (; g < group; g++) {
+		int last = m_groupBegin[g + 1] - 1;
+		swapRows(row, last);
+		row = last;
+		m_groupBegin[g + 1]--;	// now the first row of group g + 1
+	}
+	for (; g > group; g--) {
+		int first = m_groupBegin[g];
+		swapRows(row, first);
+		row = first;
+		m_groupBegin[g]++;		// now the last row of group g - 1
+	}
+	return row;
+}
+
+void CEntityRegistry::swapRows(int a, int b)
+{
+	if (a == b)
+		return;
+	std::swap(m_entities[a], m_entities[b]);
+	std::swap(m_transforms[a], m_transforms[b]);
+	std::swap(m_bounds[a], m_bounds[b]);
+	std::swap(m_renderables[a], m_renderables[b]);
+	std::swap(m_velocities[a], m_velocities[b]);
+	std::swap(m_destructibles[a], m_destructibles[b]);
+	m_boxes.swap(a, b);
+	m_rows[m_entities[a].slot] = a;
+	m_rows[m_entities[b].slot] = b;
+}
+
+// -----------------------------------------------------------------------------
+// systems
+// -----------------------------------------------------------------------------
+
+Entity createDrawable(CEntityRegistry& reg, const SimVec3& center, const SimVec3& size,
+	const void* const* meshes, int meshCount, const RenderMaterial& material, int layer)
+{
+	Entity e = reg.create(layer);
+	int row = reg.getRow(e);
+
+	reg.getTransform(row).draw.setPosition(center.x, center.y, center.z);
+
+	BoundsComponent& b = reg.getBounds(row);
+	b.halfSize = size * 0.5f;
+	b.hidden = false;
+	reg.setBox(row, center);
+
+	RenderComponent& r = reg.getRenderable(row);
+	for (int l = 0; l < SPHERE_LOD_LEVELS; l++)
+		r.mesh[l] = l < meshCount ? meshes[l] : NULL;
+	r.material = material;
+	r.lodRadius = meshCount > 1 ? size.x * 0.5f : 0.0f;
+	r.lodLevel = -1;
+	return e;
+}
+
+// a standing row keeps its position in the velocity component too (with no
+// velocity), so moveEntity() can tell it is already there from that array
+void placeEntity(CEntityRegistry& reg, Entity e, const SimVec3& pos)
+{
+	int row = reg.setMoving(e, false);
+	if (row < 0)
+		return;
+	VelocityComponent& v = reg.getVelocity(row);
+	v.position = pos;
+	v.velocity = SimVec3(0, 0, 0);
+	reg.getTransform(row).draw.setPosition(pos.x, pos.y, pos.z);
+	reg.setBox(row, pos);
+}
+
+// Without movement over the tick it is drawn at pos whatever alpha is, so
+// it is placed instead and stays with the standing rows, which
+// interpolateEntities() skips (most tanks, most of the time)
+void moveEntity(CEntityRegistry& reg, Entity e, const SimVec3& pos, const SimVec3& lastPos)
+{
+	if (pos.x == lastPos.x && pos.y == lastPos.y && pos.z == lastPos.z) {
+		int row = reg.getRow(e);
+		if (row < 0)
+			return;
+		// only standing rows have no velocity. Compared as bytes: placeEntity()
+		// wrote these very values, and any other -0 / 0 just places it again
+		const SimVec3 zero(0, 0, 0);
+		const VelocityComponent& v = reg.getVelocity(row);
+		if (memcmp(&v.velocity, &zero, sizeof(zero)) == 0
+			&& memcmp(&v.position, &pos, sizeof(pos)) == 0)
+			return;		// standing where it stood
+		placeEntity(reg, e, pos);
+		return;
+	}
+	int row = reg.setMoving(e, true);
+	if (row < 0)
+		return;
+	VelocityComponent& v = reg.getVelocity(row);
+	v.position = pos;
+	v.velocity = pos - lastPos;
+}
+
+// the moving rows of each layer, through the velocity, transform and box arrays
+void interpolateEntities(CEntityRegistry& reg, float alpha)
+{
+	float back = alpha - 1.0f;
+	for (int l = 0; l < CEntityRegistry::LAYER_COUNT; l++) {
+		int layer = 1 << l;
+		int end = reg.getMovingEnd(layer);
+		for (int row = reg.getLayerBegin(layer); row < end; row++) {
+			const VelocityComponent& v = reg.getVelocity(row);
+			SimVec3 p = v.position + v.velocity * back;
+			reg.getTransform(row).draw.setPosition(p.x, p.y, p.z);	// no rebuild while it stands still
+			reg.setBox(row, p);
+		}
+	}
+}
+
+int cullEntities(const CEntityRegistry& reg, const CFrustum& frustum, int layerMask,
+	std::vector<int>& out, FrustumStats* stats)
+{
+	// each layer's rows are a range of the box arrays; hidden rows are dead
+	const CAabbStore& boxes = reg.getBoxes();
+	int tested = 0, visible = 0;
+	for (int l = 0; l < CEntityRegistry::LAYER_COUNT; l++) {
+		int layer = 1 << l;
+		if (!(layer & layerMask))
+			continue;
+		int begin = reg.getLayerBegin(layer), end = reg.getLayerEnd(layer);
+		tested += end - begin;
+		visible += boxes.overlapFrustum(frustum, out, begin, end);
+	}
+	if (stats != NULL) {
+		stats->tested += tested;
+		stats->visible += visible;
+	}
+	return visible;
+}
+
+// rows from cullEntities come in order, so the transforms and render
+// components are read front to back with gaps
+void submitEntities(CEntityRegistry& reg, const int* rows, int count, const CTransformFrame& frame,
+	EntityLodSelector lod, CRenderQueue& queue)
+{
+	for (int k = 0; k < count; k++) {
+		RenderComponent& r = reg.getRenderable(rows[k]);
+		const SimdMat4& world = reg.getTransform(rows[k]).draw.getWorld(frame);
+		int level = 0;
+		if (r.lodRadius > 0 && lod != NULL)
+			level = r.lodLevel = lod(world, r.lodRadius, r.lodLevel);
+		if (r.mesh[level] != NULL)
+			queue.submit(r.mesh[level], 0, r.material, world.data());
+	}
+}
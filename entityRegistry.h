@@ -0,0 +1,211 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: entityRegistry.h
+//
+// Desc: Entity-component storage for everything the game draws (walls,
+//       floor, obstacles, tank parts, the aim ball, missiles). An entity is
+//       only a generational handle; its components sit in parallel arrays,
+//       one per kind, all at the entity's row, and the rows are grouped by
+//       layer and by moving or standing. So a pass over the scene walks a
+//       range of rows through the arrays it reads instead of calling into
+//       a class per object or looking entities up. The systems at the end
+//       are those passes: placing and interpolating, culling and submitting
+//       to the render queue.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __entityRegistryH__
+#define __entityRegistryH__
+
+#include "handlePool.h"
+#include "simMath.h"
+#include "lazyTransform.h"
+#include "renderQueue.h"
+#include "sphereLod.h"
+#include "aabbStore.h"
+#include <vector>
+
+class CFrustum;
+struct FrustumStats;
+
+// same slot + generation scheme as CHandlePool; a destroyed entity's
+// handle goes stale
+typedef PoolHandle Entity;
+
+inline Entity NullEntity(void) { return NullPoolHandle(); }
+
+// -----------------------------------------------------------------------------
+// components
+// -----------------------------------------------------------------------------
+
+// where the entity is drawn, with its world matrix (local * frame) cached
+struct TransformComponent {
+	CLazyTransform	draw;
+};
+
+// a moving entity: its position at the last simulation tick and the
+// movement over that tick. It is drawn at position - velocity * (1 - alpha),
+// the same as interpolating from the tick before
+struct VelocityComponent {
+	SimVec3 position;
+	SimVec3 velocity;
+};
+
+enum RenderLayer {
+	RENDER_LAYER_WORLD = 1,		// boundary walls, floor, podium
+	RENDER_LAYER_OBSTACLE = 2,
+	RENDER_LAYER_ACTOR = 4,		// tank parts, aim ball, missiles
+	RENDER_LAYER_ALL = 7
+};
+
+// the box size; the world box at the drawn position is the row's box in
+// the registry's CAabbStore, so the cull pass streams those arrays only
+struct BoundsComponent {
+	SimVec3	halfSize;
+	bool	hidden;		// kept, but not drawn (parts of a destroyed tank)
+};
+
+struct RenderComponent {
+	const void*		mesh[SPHERE_LOD_LEVELS];	// a box draws mesh[0], a sphere one per level
+	RenderMaterial	material;
+	float			lodRadius;	// > 0: a sphere, the level is picked when it is drawn
+	int				lodLevel;	// level drawn last (-1 = not drawn yet)
+};
+
+struct DestructibleComponent {
+	int id;				// index in CArenaLayout::buildObstacles()
+	int batchSlot;		// place in a combined mesh (CInstanceBatch), -1 = none
+};
+
+// -----------------------------------------------------------------------------
+// CEntityRegistry
+// -----------------------------------------------------------------------------
+
+// Every component array shares one dense order: row r of each of them
+// belongs to the same entity. Rows are grouped by layer, and within a layer
+// the moving entities (the ones with a velocity) come first, so a pass
+// walks a range of rows through the arrays it needs, front to back. The
+// world boxes are one more of those arrays, split per axis in a CAabbStore
+// so a layer is culled with its SIMD frustum kernel.
+// Creating, destroying, moveEntity() and placeEntity() can move rows
+// between groups; a row number is good until the next of them
+class CEntityRegistry {
+public:
+	enum { LAYER_COUNT = 3, GROUP_COUNT = LAYER_COUNT * 2 };
+
+	CEntityRegistry(void);
+	~CEntityRegistry(void) {}
+
+public:
+	void clear(void);
+	// a standing entity of one RenderLayer, components default-initialized
+	Entity create(int layer);
+	// drops e and its components; false for a stale handle
+	bool destroy(Entity e);
+	bool isValid(Entity e) const
+	{
+		return e.slot >= 0 && e.slot < (int)m_generations.size() && e.generation != 0
+			&& m_generations[e.slot] == e.generation;
+	}
+	int getCount(void) const { return (int)m_entities.size(); }
+
+	// row of e, -1 for a stale handle
+	int getRow(Entity e) const { return isValid(e) ? m_rows[e.slot] : -1; }
+	Entity getEntity(int row) const { return m_entities[row]; }
+
+	// rows of a layer (a RenderLayer bit): [getLayerBegin, getLayerEnd),
+	// the moving ones first, up to getMovingEnd
+	int getLayerBegin(int layer) const { return m_groupBegin[layerIndex(layer) * 2]; }
+	int getMovingEnd(int layer) const { return m_groupBegin[layerIndex(layer) * 2 + 1]; }
+	int getLayerEnd(int layer) const { return m_groupBegin[layerIndex(layer) * 2 + 2]; }
+	bool isMoving(int row) const { return (groupOf(row) & 1) == 0; }
+
+	// starts or stops e's velocity (moves its row); returns the row it is
+	// in now, -1 for a stale handle
+	int setMoving(Entity e, bool moving);
+	// a destructible component for e (none until set); false for a stale handle
+	bool setDestructible(Entity e, const DestructibleComponent& d);
+	// hides or shows e (its box stays, dead in the store); false for a stale handle
+	bool setHidden(Entity e, bool hidden);
+
+	// the world box of a row: halfSize around center
+	void setBox(int row, const SimVec3& center);
+	const CAabbStore& getBoxes(void) const { return m_boxes; }
+
+	// by row
+	TransformComponent& getTransform(int row) { return m_transforms[row]; }
+	BoundsComponent& getBounds(int row) { return m_bounds[row]; }
+	RenderComponent& getRenderable(int row) { return m_renderables[row]; }
+	VelocityComponent& getVelocity(int row) { return m_velocities[row]; }	// standing: no velocity
+	const TransformComponent& getTransform(int row) const { return m_transforms[row]; }
+	const BoundsComponent& getBounds(int row) const { return m_bounds[row]; }
+	const RenderComponent& getRenderable(int row) const { return m_renderables[row]; }
+	const VelocityComponent& getVelocity(int row) const { return m_velocities[row]; }
+
+	// by handle: NULL for a stale one (a destructible or velocity it lacks)
+	TransformComponent* findTransform(Entity e);
+	RenderComponent* findRenderable(Entity e);
+	VelocityComponent* findVelocity(Entity e);
+	const DestructibleComponent* findDestructible(Entity e) const;
+
+	// 0, 1, 2 for RENDER_LAYER_WORLD, _OBSTACLE, _ACTOR
+	static int layerIndex(int layer)
+	{
+		return layer == RENDER_LAYER_WORLD ? 0 : (layer == RENDER_LAYER_OBSTACLE ? 1 : 2);
+	}
+
+private:
+	int groupOf(int row) const;
+	// moves a row into another group, returns where it is now
+	int moveRow(int row, int group);
+	void swapRows(int a, int b);
+
+	std::vector<unsigned int>	m_generations;	// per slot; a live handle matches it
+	std::vector<int>			m_freeSlots;
+	std::vector<int>			m_rows;			// per slot, -1 = free
+
+	// the rows: moving and standing entities of each layer in turn
+	int										m_groupBegin[GROUP_COUNT + 1];
+	std::vector<Entity>						m_entities;
+	std::vector<TransformComponent>			m_transforms;
+	std::vector<BoundsComponent>			m_bounds;
+	std::vector<RenderComponent>			m_renderables;
+	std::vector<VelocityComponent>			m_velocities;		// standing rows: placed position, 0
+	std::vector<DestructibleComponent>		m_destructibles;	// id -1 = none
+	CAabbStore								m_boxes;			// hidden rows: dead
+};
+
+// -----------------------------------------------------------------------------
+// systems
+// -----------------------------------------------------------------------------
+
+// picks the sphere level for a world matrix (selectSphereLod in the game)
+typedef int (*EntityLodSelector)(const SimdMat4& world, float radius, int lodLevel);
+
+// a box or a sphere drawn with the given meshes: transform, bounds and render
+// components. size is (width, height, depth); a sphere passes its diameter
+Entity createDrawable(CEntityRegistry& reg, const SimVec3& center, const SimVec3& size,
+	const void* const* meshes, int meshCount, const RenderMaterial& material, int layer);
+
+// puts e at pos and stops it (no interpolation)
+void placeEntity(CEntityRegistry& reg, Entity e, const SimVec3& pos);
+// e is at pos this tick and was at lastPos the tick before
+void moveEntity(CEntityRegistry& reg, Entity e, const SimVec3& pos, const SimVec3& lastPos);
+
+// drawn positions and bounds of every moving entity, alpha (0 ~ 1) of the
+// way from the last tick to the current one (the moving rows of each layer)
+void interpolateEntities(CEntityRegistry& reg, float alpha);
+
+// rows of layerMask that are not hidden and whose bounds touch the
+// frustum, appended to out in row order; returns how many were added. Only
+// the rows of the layers asked for are read (stats count them all as tested)
+int cullEntities(const CEntityRegistry& reg, const CFrustum& frustum, int layerMask,
+	std::vector<int>& out, FrustumStats* stats = NULL);
+
+// world = local * frame for each row, handed to the queue; lod picks the
+// level of spheres (NULL = always the finest). The rows are drawn as they
+// are: hidden entities are left out by cullEntities
+void submitEntities(CEntityRegistry& reg, const int* rows, int count, const CTransformFrame& frame,
+	EntityLodSelector lod, CRenderQueue& queue);
+
+#endif // __entityRegistryH__
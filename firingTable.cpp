@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: firingTable.cpp
+//
+// Desc: Missile firing table (see firingTable.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "firingTable.h"
+#include <cmath>
+
+#define FIRING_PI 3.14159265
+
+CFiringTable::CFiringTable(void)
+{
+	m_model.power = 1.0f;
+	m_model.gravity = 1.0f;
+	m_model.decreaseRate = 1.0f;
+	m_model.moveScale = 1.0f;
+	m_model.tickDelta = 0.01f;
+	m_model.launchHeight = 1.0f;
+	m_model.groundHeight = 0.0f;
+	m_model.maxTicks = 1000;
+	m_maxDegree = m_degreeStep = 0;
+	m_maxDistance = m_distanceStep = 0;
+	m_degreeCount = m_distanceCount = 0;
+}
+
+void CFiringTable::build(const FiringModel& model, float maxDegree, float degreeStep, float maxDistance, float distanceStep)
+{
+	m_model = model;
+	m_maxDegree = maxDegree;
+	m_degreeStep = degreeStep;
+	m_maxDistance = maxDistance;
+	m_distanceStep = distanceStep;
+	m_degreeCount = (int)(maxDegree / degreeStep + 0.5f) + 1;
+	m_distanceCount = (int)(maxDistance / distanceStep + 0.5f) + 1;
+
+	m_range.resize(m_degreeCount * m_distanceCount);
+	m_ticks.resize(m_degreeCount * m_distanceCount);
+	for (int i = 0; i < m_degreeCount; i++) {
+		for (int j = 0; j < m_distanceCount; j++) {
+			float range;
+			int ticks;
+			simulate(i * degreeStep, j * distanceStep, range, ticks);
+			m_range[i * m_distanceCount + j] = range;
+			m_ticks[i * m_distanceCount + j] = (float)ticks;
+		}
+	}
+}
+
+void CFiringTable::simulate(float degree, float distance, float& range, int& ticks) const
+{
+	const FiringModel& m = m_model;
+	double vh = distance * m.power;
+	double vy = distance * tan(degree * FIRING_PI / 180);
+	double rate = 1 - (1 - m.decreaseRate) * m.tickDelta * 400;
+	if (rate < 0)
+		rate = 0;
+
+	float x = 0, y = m.launchHeight;
+	ticks = 0;
+	while (ticks < m.maxTicks) {
+		x = x + m.moveScale * m.tickDelta * vh;
+		y = y + m.moveScale * m.tickDelta * vy;
+		ticks++;
+		if (y <= m.groundHeight)
+			break;
+		vh = vh * rate;
+		vy = vy - m.gravity * m.tickDelta;
+	}
+	range = x;
+}
+
+void CFiringTable::lookup(float degree, float distance, float& range, float& ticks) const
+{
+	if (!isBuilt() || degree < 0 || distance < 0 || degree > m_maxDegree || distance > m_maxDistance) {
+		int n;
+		simulate(degree, distance, range, n);
+		ticks = (float)n;
+		return;
+	}
+
+	float fi = degree / m_degreeStep, fj = distance / m_distanceStep;
+	int i = (int)fi, j = (int)fj;
+	if (i > m_degreeCount - 2) i = m_degreeCount - 2;
+	if (j > m_distanceCount - 2) j = m_distanceCount - 2;
+	float u = fi - i, v = fj - j;
+
+	int k = i * m_distanceCount + j;
+	range = (m_range[k] * (1 - v) + m_range[k + 1] * v) * (1 - u)
+		+ (m_range[k + m_distanceCount] * (1 - v) + m_range[k + m_distanceCount + 1] * v) * u;
+	ticks = (m_ticks[k] * (1 - v) + m_ticks[k + 1] * v) * (1 - u)
+		+ (m_ticks[k + m_distanceCount] * (1 - v) + m_ticks[k + m_distanceCount + 1] * v) * u;
+}
+
+void CFiringTable::sampleArc(float degree, float distance, int count, float* ground, float* height) const
+{
+	if (count < 2)
+		return;
+
+	const FiringModel& m = m_model;
+	float range, ticks;
+	lookup(degree, distance, range, ticks);
+
+	// closed form of the tick loop: the horizontal speed decays geometrically
+	// and the vertical speed drops linearly, so point n needs no iteration
+	double vh = distance * m.power;
+	double vy = distance * tan(degree * FIRING_PI / 180);
+	double rate = 1 - (1 - m.decreaseRate) * m.tickDelta * 400;
+	if (rate < 0)
+		rate = 0;
+	double k = m.moveScale * m.tickDelta;
+	double g = m.gravity * m.tickDelta;
+
+	for (int s = 0; s < count; s++) {
+		double n = ticks * s / (count - 1);
+		double x = (rate < 1.0) ? k * vh * (1 - pow(rate, n)) / (1 - rate) : k * vh * n;
+		double y = m.launchHeight + k * (n * vy - g * n * (n - 1) / 2);
+		if (y < m.groundHeight)
+			y = m.groundHeight;
+		ground[s] = (float)x;
+		height[s] = (float)y;
+	}
+	// the table knows exactly where the shell lands
+	ground[count - 1] = range;
+	height[count - 1] = m.groundHeight;
+}
@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: firingTable.h
+//
+// Desc: Precomputed firing table for the missile model in CSphere::ballUpdate.
+//       Impact range and flight time are simulated once for a grid of
+//       (fire degree, fire distance) and bilinearly interpolated at runtime,
+//       which is what the aim preview needs every time the aim changes.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __firingTableH__
+#define __firingTableH__
+
+#include <vector>
+
+// Everything the missile flight depends on. The launch velocity is the one
+// VK_SPACE gives: horizontal speed distance * power, vertical speed
+// distance * tan(degree).
+struct FiringModel {
+	float power;			// MISSILE_POWER
+	float gravity;			// MISSILE_GRAVITY_RATE
+	float decreaseRate;		// MISSILE_DECREASE_RATE
+	float moveScale;		// TIME_SCALE used by CSphere::ballUpdate
+	float tickDelta;		// timeDelta of one simulation tick
+	float launchHeight;		// missile y when it is fired
+	float groundHeight;		// missile y at which it hits the floor
+	int maxTicks;			// flights longer than this are cut off
+};
+
+class CFiringTable {
+public:
+	CFiringTable(void);
+	~CFiringTable(void) {}
+
+public:
+	void build(const FiringModel& model, float maxDegree, float degreeStep, float maxDistance, float distanceStep);
+	bool isBuilt(void) const { return !m_range.empty(); }
+
+	// interpolated ground range and flight time (in ticks) of a shot;
+	// outside the table the shot is simulated directly
+	void lookup(float degree, float distance, float& range, float& ticks) const;
+
+	// tick by tick flight, same arithmetic as CSphere::ballUpdate
+	void simulate(float degree, float distance, float& range, int& ticks) const;
+
+	// count points along the arc in the firing plane (ground distance along
+	// the firing direction, height); the last point is the impact
+	void sampleArc(float degree, float distance, int count, float* ground, float* height) const;
+
+	int getEntryCount(void) const { return (int)m_range.size(); }
+	const FiringModel& getModel(void) const { return m_model; }
+
+private:
+	FiringModel				m_model;
+	float					m_maxDegree, m_degreeStep;
+	float					m_maxDistance, m_distanceStep;
+	int						m_degreeCount, m_distanceCount;
+
+	std::vector<float>		m_range;	// [degree index * m_distanceCount + distance index]
+	std::vector<float>		m_ticks;
+};
+
+#endif // __firingTableH__
@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: frustum.cpp
+//
+// Desc: View frustum planes and single box tests (see frustum.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "frustum.h"
+#include <cmath>
+
+CFrustum::CFrustum(void)
+{
+	// everything inside until the first extract()
+	for (int i = 0; i < PLANE_COUNT; i++) {
+		m_planes[i][0] = m_planes[i][1] = m_planes[i][2] = 0;
+		m_planes[i][3] = 1;
+	}
+}
+
+void CFrustum::extract(const float m[16])
+{
+	// clip = (x, y, z, 1) * M, so clip component j is column j of M;
+	// inside means -w <= x <= w, -w <= y <= w, 0 <= z <= w
+	for (int a = 0; a < 4; a++) {
+		float c0 = m[a * 4], c1 = m[a * 4 + 1], c2 = m[a * 4 + 2], c3 = m[a * 4 + 3];
+		m_planes[0][a] = c3 + c0;	// left
+		m_planes[1][a] = c3 - c0;	// right
+		m_planes[2][a] = c3 + c1;	// bottom
+		m_planes[3][a] = c3 - c1;	// top
+		m_planes[4][a] = c2;		// near
+		m_planes[5][a] = c3 - c2;	// far
+	}
+	for (int i = 0; i < PLANE_COUNT; i++) {
+		float* p = m_planes[i];
+		float len = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+		if (len > 0) {
+			p[0] /= len;
+			p[1] /= len;
+			p[2] /= len;
+			p[3] /= len;
+		}
+	}
+}
+
+bool CFrustum::testBox(const float bmin[3], const float bmax[3], int planeMask) const
+{
+	for (int i = 0; i < PLANE_COUNT; i++) {
+		if (!(planeMask & (1 << i)))
+			continue;
+		const float* p = m_planes[i];
+		float d = p[0] * (p[0] >= 0 ? bmax[0] : bmin[0]) +
+			p[1] * (p[1] >= 0 ? bmax[1] : bmin[1]) +
+			p[2] * (p[2] >= 0 ? bmax[2] : bmin[2]) + p[3];
+		if (d < 0)
+			return false;
+	}
+	return true;
+}
+
+CFrustum::Side CFrustum::classifyBox(const float bmin[3], const float bmax[3], int& planeMask) const
+{
+	for (int i = 0; i < PLANE_COUNT; i++) {
+		if (!(planeMask & (1 << i)))
+			continue;
+		const float* p = m_planes[i];
+		float outer = p[0] * (p[0] >= 0 ? bmax[0] : bmin[0]) +
+			p[1] * (p[1] >= 0 ? bmax[1] : bmin[1]) +
+			p[2] * (p[2] >= 0 ? bmax[2] : bmin[2]) + p[3];
+		if (outer < 0)
+			return OUTSIDE;
+		float inner = p[0] * (p[0] >= 0 ? bmin[0] : bmax[0]) +
+			p[1] * (p[1] >= 0 ? bmin[1] : bmax[1]) +
+			p[2] * (p[2] >= 0 ? bmin[2] : bmax[2]) + p[3];
+		if (inner >= 0)
+			planeMask &= ~(1 << i);
+	}
+	return planeMask ? INTERSECTS : INSIDE;
+}
+
+bool CFrustum::testSphere(float x, float y, float z, float radius) const
+{
+	for (int i = 0; i < PLANE_COUNT; i++) {
+		const float* p = m_planes[i];
+		if (p[0] * x + p[1] * y + p[2] * z + p[3] < -radius)
+			return false;
+	}
+	return true;
+}
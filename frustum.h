@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: frustum.h
+//
+// Desc: View frustum as six planes taken from a view * projection matrix
+//       (D3D conventions: row vectors, z in [0, 1]). Boxes are tested with
+//       the corner furthest along each plane normal; batch tests over many
+//       boxes live with the box containers (CAabbStore, CCollisionWorld).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __frustumH__
+#define __frustumH__
+
+struct FrustumStats {
+	int tested;
+	int visible;
+	int getCulled(void) const { return tested - visible; }
+};
+
+class CFrustum {
+public:
+	enum Side { OUTSIDE, INTERSECTS, INSIDE };
+	enum { PLANE_COUNT = 6, ALL_PLANES = (1 << PLANE_COUNT) - 1 };
+
+	CFrustum(void);
+	~CFrustum(void) {}
+
+public:
+	// viewProj is row major (D3DXMATRIX), e.g. view * projection
+	void extract(const float viewProj[16]);
+
+	// plane i as (a, b, c, d): a point p is inside when a*x + b*y + c*z + d >= 0
+	const float* getPlane(int i) const { return m_planes[i]; }
+	const float (*getPlanes(void) const)[4] { return m_planes; }
+
+	// planeMask: bit i set = test plane i (a parent box already inside the
+	// other planes lets its children skip them)
+	bool testBox(const float bmin[3], const float bmax[3], int planeMask = ALL_PLANES) const;
+	// also tells whether the box is completely inside (for hierarchies);
+	// planeMask is cleared down to the planes the box straddles
+	Side classifyBox(const float bmin[3], const float bmax[3], int& planeMask) const;
+	bool testSphere(float x, float y, float z, float radius) const;
+
+private:
+	float m_planes[PLANE_COUNT][4];
+};
+
+#endif // __frustumH__
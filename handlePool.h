@@ -0,0 +1,171 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: handlePool.h
+//
+// Desc: Pool of objects addressed by generational handles. Objects live in a
+//       dense array that iteration walks front to back; removed objects leave
+//       a hole until compact() squeezes the live ones together again. Handles
+//       go through a slot table, so they survive compaction, and a handle to
+//       a removed object is detected by its stale generation.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __handlePoolH__
+#define __handlePoolH__
+
+#include <vector>
+#include <cstddef>
+
+#define HANDLE_POOL_MIN_DEAD 8	// never compact for fewer holes than this
+
+struct PoolHandle {
+	int				slot;
+	unsigned int	generation;	// 0 = null handle
+};
+
+inline PoolHandle NullPoolHandle(void)
+{
+	PoolHandle h = { -1, 0 };
+	return h;
+}
+
+template <class T>
+class CHandlePool {
+public:
+	CHandlePool(void) { m_liveCount = 0; }
+	~CHandlePool(void) {}
+
+public:
+	void clear(void)
+	{
+		m_items.clear();
+		m_live.clear();
+		m_denseSlot.clear();
+		m_slots.clear();
+		m_freeSlots.clear();
+		m_liveCount = 0;
+	}
+	void reserve(int count)
+	{
+		m_items.reserve(count);
+		m_live.reserve(count);
+		m_denseSlot.reserve(count);
+		m_slots.reserve(count);
+	}
+
+	PoolHandle add(const T& item)
+	{
+		int slot;
+		if (!m_freeSlots.empty()) {
+			slot = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		}
+		else {
+			Slot s = { -1, 1 };
+			m_slots.push_back(s);
+			slot = (int)m_slots.size() - 1;
+		}
+		m_slots[slot].dense = (int)m_items.size();
+		m_items.push_back(item);
+		m_live.push_back(true);
+		m_denseSlot.push_back(slot);
+		m_liveCount++;
+
+		PoolHandle h = { slot, m_slots[slot].generation };
+		return h;
+	}
+
+	// the object stays in the dense array (marked dead) until compact();
+	// the slot is reused right away with a new generation
+	bool remove(PoolHandle h)
+	{
+		int i = indexOf(h);
+		if (i < 0)
+			return false;
+		m_live[i] = false;
+		m_slots[h.slot].dense = -1;
+		if (++m_slots[h.slot].generation == 0)
+			m_slots[h.slot].generation = 1;
+		m_freeSlots.push_back(h.slot);
+		m_liveCount--;
+		return true;
+	}
+
+	bool isValid(PoolHandle h) const { return indexOf(h) >= 0; }
+	// dense index of a live object, -1 for null or stale handles
+	int indexOf(PoolHandle h) const
+	{
+		if (h.slot < 0 || h.slot >= (int)m_slots.size() || m_slots[h.slot].generation != h.generation)
+			return -1;
+		return m_slots[h.slot].dense;
+	}
+	T* get(PoolHandle h)
+	{
+		int i = indexOf(h);
+		return i < 0 ? NULL : &m_items[i];
+	}
+	const T* get(PoolHandle h) const
+	{
+		int i = indexOf(h);
+		return i < 0 ? NULL : &m_items[i];
+	}
+
+	// dense range [0, size()), holes included until the next compact()
+	int size(void) const { return (int)m_items.size(); }
+	int liveCount(void) const { return m_liveCount; }
+	T& at(int i) { return m_items[i]; }
+	const T& at(int i) const { return m_items[i]; }
+	bool isLiveAt(int i) const { return m_live[i]; }
+	PoolHandle handleAt(int i) const
+	{
+		if (!m_live[i])
+			return NullPoolHandle();
+		PoolHandle h = { m_denseSlot[i], m_slots[m_denseSlot[i]].generation };
+		return h;
+	}
+
+	// worth compacting once a quarter of the dense range is holes
+	bool needsCompaction(void) const
+	{
+		int dead = size() - m_liveCount;
+		return dead >= HANDLE_POOL_MIN_DEAD && dead * 4 >= size();
+	}
+
+	// moves the live objects to the front (order kept); dense indices change,
+	// handles do not. Returns the number of holes removed
+	int compact(void)
+	{
+		int n = 0;
+		for (int i = 0; i < size(); i++) {
+			if (!m_live[i])
+				continue;
+			if (n != i) {
+				m_items[n] = m_items[i];
+				m_denseSlot[n] = m_denseSlot[i];
+				m_live[n] = true;
+			}
+			m_slots[m_denseSlot[n]].dense = n;
+			n++;
+		}
+		int removed = size() - n;
+		m_items.erase(m_items.begin() + n, m_items.end());
+		m_live.erase(m_live.begin() + n, m_live.end());
+		m_denseSlot.erase(m_denseSlot.begin() + n, m_denseSlot.end());
+		return removed;
+	}
+
+private:
+	struct Slot {
+		int				dense;		// index into m_items, -1 when free
+		unsigned int	generation;
+	};
+
+	std::vector<T>				m_items;
+	std::vector<bool>			m_live;
+	std::vector<int>			m_denseSlot;	// dense index -> slot
+	std::vector<Slot>			m_slots;
+	std::vector<int>			m_freeSlots;
+	int							m_liveCount;
+};
+
+#endif // __handlePoolH__
@@ -0,0 +1,232 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: hudText.cpp
+//
+// Desc: Allocation free HUD text (see hudText.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "hudText.h"
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <cmath>
+
+// empty space around every atlas cell, so filtering never reads a neighbour
+#define GLYPH_PADDING 1
+
+CGlyphAtlas::CGlyphAtlas(void)
+{
+	memset(m_glyphs, 0, sizeof(m_glyphs));
+	m_width = m_height = 0;
+	m_lineHeight = 0;
+}
+
+static int roundUpPow2(int v)
+{
+	int p = 1;
+	while (p < v)
+		p <<= 1;
+	return p;
+}
+
+void CGlyphAtlas::layout(const int advances[GLYPH_COUNT], int lineHeight, int maxWidth)
+{
+	int x = GLYPH_PADDING, y = GLYPH_PADDING, right = 0;
+	for (int i = 0; i < GLYPH_COUNT; i++) {
+		if (x + advances[i] + GLYPH_PADDING > maxWidth && x > GLYPH_PADDING) {
+			x = GLYPH_PADDING;
+			y += lineHeight + GLYPH_PADDING;
+		}
+		HudGlyph& g = m_glyphs[i];
+		g.x = x;
+		g.y = y;
+		g.width = advances[i];
+		g.height = lineHeight;
+		x += advances[i] + GLYPH_PADDING;
+		if (x > right)
+			right = x;
+	}
+	m_width = roundUpPow2(right);
+	m_height = roundUpPow2(y + lineHeight + GLYPH_PADDING);
+	m_lineHeight = lineHeight;
+}
+
+const HudGlyph& CGlyphAtlas::getGlyph(char c) const
+{
+	int i = (unsigned char)c;
+	if (i < FIRST_CHAR || i > LAST_CHAR)
+		i = '?';
+	return m_glyphs[i - FIRST_CHAR];
+}
+
+CHudText::CHudText(void)
+{
+	memset(m_lines, 0, sizeof(m_lines));
+	m_quadCount = 0;
+	m_dirty = true;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void CHudText::setLine(int line, int x, int y)
+{
+	m_lines[line].x = x;
+	m_lines[line].y = y;
+	m_dirty = true;
+}
+
+void CHudText::beginFrame(void)
+{
+	for (int i = 0; i < MAX_LINES; i++) {
+		m_lines[i].wasShown = m_lines[i].shown;
+		m_lines[i].shown = false;
+	}
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void CHudText::show(Line& l, unsigned color)
+{
+	if (l.color != color)
+		m_dirty = true;
+	l.color = color;
+	l.shown = true;
+	m_stats.lines++;
+}
+
+bool CHudText::isCached(Line& l, unsigned color, int kind, const char* prefix, const char* suffix, double value, int decimals)
+{
+	show(l, color);
+	if (l.kind == kind && l.prefix == prefix && l.suffix == suffix && l.value == value && l.decimals == decimals) {
+		m_stats.cached++;
+		return true;
+	}
+	l.kind = kind;
+	l.prefix = prefix;
+	l.suffix = suffix;
+	l.value = value;
+	l.decimals = decimals;
+	m_stats.formatted++;
+	m_dirty = true;
+	return false;
+}
+
+static void appendText(char* dst, int& length, const char* text)
+{
+	while (*text && length < CHudText::LINE_CAPACITY - 1)
+		dst[length++] = *text++;
+	dst[length] = '\0';
+}
+
+static void appendDigits(char* dst, int& length, unsigned long long v, int minDigits)
+{
+	char digits[24];
+	int n = 0;
+	do {
+		digits[n++] = (char)('0' + v % 10);
+		v /= 10;
+	} while (v || n < minDigits);
+	while (n && length < CHudText::LINE_CAPACITY - 1)
+		dst[length++] = digits[--n];
+	dst[length] = '\0';
+}
+
+void CHudText::printInt(int line, unsigned color, const char* prefix, int value)
+{
+	Line& l = m_lines[line];
+	if (isCached(l, color, KEY_INT, prefix, NULL, value, 0))
+		return;
+	l.length = 0;
+	appendText(l.text, l.length, prefix);
+	long long v = value;
+	if (v < 0) {
+		appendText(l.text, l.length, "-");
+		v = -v;
+	}
+	appendDigits(l.text, l.length, (unsigned long long)v, 1);
+}
+
+void CHudText::printFixed(int line, unsigned color, const char* prefix, double value, int decimals, const char* suffix)
+{
+	Line& l = m_lines[line];
+	if (isCached(l, color, KEY_FIXED, prefix, suffix, value, decimals))
+		return;
+	l.length = 0;
+	appendText(l.text, l.length, prefix);
+	// same digits as std::fixed << setprecision(decimals), apart from
+	// exact halves that printf would round to even
+	double scale = pow(10.0, decimals);
+	double v = value;
+	if (v < 0) {
+		appendText(l.text, l.length, "-");
+		v = -v;
+	}
+	unsigned long long scaled = (unsigned long long)floor(v * scale + 0.5);
+	unsigned long long unit = (unsigned long long)scale;
+	appendDigits(l.text, l.length, scaled / unit, 1);
+	if (decimals > 0) {
+		appendText(l.text, l.length, ".");
+		appendDigits(l.text, l.length, scaled % unit, decimals);
+	}
+	appendText(l.text, l.length, suffix);
+}
+
+void CHudText::printText(int line, unsigned color, const char* text)
+{
+	Line& l = m_lines[line];
+	show(l, color);
+	if (l.kind == KEY_TEXT && strncmp(l.text, text, LINE_CAPACITY - 1) == 0) {
+		m_stats.cached++;
+		return;
+	}
+	l.kind = KEY_TEXT;
+	l.length = 0;
+	appendText(l.text, l.length, text);
+	m_stats.formatted++;
+	m_dirty = true;
+}
+
+void CHudText::format(int line, unsigned color, const char* fmt, ...)
+{
+	char text[LINE_CAPACITY];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(text, sizeof(text), fmt, args);
+	va_end(args);
+	text[LINE_CAPACITY - 1] = '\0';
+	printText(line, color, text);
+}
+
+int CHudText::buildQuads(const CGlyphAtlas& atlas)
+{
+	for (int i = 0; i < MAX_LINES; i++) {
+		if (m_lines[i].shown != m_lines[i].wasShown)
+			m_dirty = true;
+	}
+	if (m_dirty) {
+		m_quadCount = 0;
+		for (int i = 0; i < MAX_LINES; i++) {
+			const Line& l = m_lines[i];
+			if (!l.shown)
+				continue;
+			int x = l.x;
+			for (int c = 0; c < l.length && m_quadCount < MAX_QUADS; c++) {
+				const HudGlyph& g = atlas.getGlyph(l.text[c]);
+				if (l.text[c] != ' ') {
+					HudQuad& q = m_quads[m_quadCount++];
+					q.x = x;
+					q.y = l.y;
+					q.srcX = g.x;
+					q.srcY = g.y;
+					q.width = g.width;
+					q.height = g.height;
+					q.color = l.color;
+				}
+				x += g.width;
+			}
+		}
+		m_dirty = false;
+		m_stats.rebuilds++;
+	}
+	m_stats.quads = m_quadCount;
+	return m_quadCount;
+}
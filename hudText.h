@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: hudText.h
+//
+// Desc: HUD text without per-frame heap allocation. Every HUD line owns a
+//       fixed buffer; numbers are formatted straight into it, and a line
+//       whose prefix and value did not change since last frame is not
+//       formatted again. The visible lines become one list of glyph quads
+//       out of a single CGlyphAtlas texture, rebuilt only when some line
+//       changed, so the game draws all of it in one sprite batch.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __hudTextH__
+#define __hudTextH__
+
+// the atlas keeps the last slot for the degree sign, which is not ASCII
+#define HUD_DEGREE_SIGN "\x7f"
+
+// pixel rectangle of one character in the atlas texture
+struct HudGlyph {
+	int x, y;
+	int width, height;
+};
+
+class CGlyphAtlas {
+public:
+	enum { FIRST_CHAR = 32, LAST_CHAR = 127, GLYPH_COUNT = LAST_CHAR - FIRST_CHAR + 1 };
+
+	CGlyphAtlas(void);
+	~CGlyphAtlas(void) {}
+
+public:
+	// packs one cell per character (its advance wide, lineHeight high) into
+	// rows at most maxWidth wide; the size is rounded up to powers of two
+	void layout(const int advances[GLYPH_COUNT], int lineHeight, int maxWidth);
+	// characters outside the atlas come back as '?'
+	const HudGlyph& getGlyph(char c) const;
+	int getWidth(void) const { return m_width; }
+	int getHeight(void) const { return m_height; }
+	int getLineHeight(void) const { return m_lineHeight; }
+
+private:
+	HudGlyph	m_glyphs[GLYPH_COUNT];
+	int			m_width, m_height;
+	int			m_lineHeight;
+};
+
+// one sprite draw: a glyph rectangle of the atlas at a screen position
+struct HudQuad {
+	int x, y;
+	int srcX, srcY, width, height;
+	unsigned color;		// D3DCOLOR
+};
+
+struct HudStats {
+	int lines;			// lines shown this frame
+	int formatted;		// lines whose text was written again
+	int cached;			// lines whose value had not changed
+	int rebuilds;		// quad list rebuilds (0 or 1 per frame)
+	int quads;
+};
+
+class CHudText {
+public:
+	enum { MAX_LINES = 8, LINE_CAPACITY = 96, MAX_QUADS = MAX_LINES * LINE_CAPACITY };
+
+	CHudText(void);
+	~CHudText(void) {}
+
+public:
+	// screen position of a line's top left corner
+	void setLine(int line, int x, int y);
+
+	// lines not printed between beginFrame() and buildQuads() are hidden
+	void beginFrame(void);
+	// prefix and suffix are compared by pointer, so pass string literals
+	void printInt(int line, unsigned color, const char* prefix, int value);
+	void printFixed(int line, unsigned color, const char* prefix, double value, int decimals, const char* suffix = "");
+	void printText(int line, unsigned color, const char* text);
+	// printf style, for lines with several values; the text is compared
+	// instead of the arguments
+	void format(int line, unsigned color, const char* fmt, ...);
+
+	// lays the shown lines out as atlas quads if anything changed
+	int buildQuads(const CGlyphAtlas& atlas);
+	const HudQuad* getQuads(void) const { return m_quads; }
+	int getQuadCount(void) const { return m_quadCount; }
+
+	const char* getText(int line) const { return m_lines[line].text; }
+	const HudStats& getStats(void) const { return m_stats; }
+
+private:
+	enum KeyKind { KEY_NONE, KEY_INT, KEY_FIXED, KEY_TEXT };
+
+	struct Line {
+		char text[LINE_CAPACITY];
+		int length;
+		int x, y;
+		unsigned color;
+		bool shown, wasShown;
+		// what the text was made from
+		int kind;
+		const char* prefix;
+		const char* suffix;
+		double value;
+		int decimals;
+	};
+
+	bool isCached(Line& l, unsigned color, int kind, const char* prefix, const char* suffix, double value, int decimals);
+	void show(Line& l, unsigned color);
+
+	Line		m_lines[MAX_LINES];
+	HudQuad		m_quads[MAX_QUADS];
+	int			m_quadCount;
+	bool		m_dirty;
+	HudStats	m_stats;
+};
+
+#endif // __hudTextH__
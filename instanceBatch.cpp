@@ -0,0 +1,154 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: instanceBatch.cpp
+//
+// Desc: Box instance batch and its reference expansion (see instanceBatch.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "instanceBatch.h"
+#include <cstddef>
+
+namespace
+{
+	// unit box faces: normal axis/sign and the two in-plane axes, corners
+	// wound clockwise seen from outside (D3D front faces)
+	struct BoxFace {
+		float n[3];
+		float u[3], v[3];
+	};
+	const BoxFace BOX_FACES[6] = {
+		{ { -1, 0, 0 }, { 0, 0, -1 }, { 0, 1, 0 } },
+		{ { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+		{ { 1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+		{ { 0, -1, 0 }, { -1, 0, 0 }, { 0, 0, 1 } },
+		{ { 0, 0, 1 }, { -1, 0, 0 }, { 0, 1, 0 } },
+		{ { 0, 0, -1 }, { 1, 0, 0 }, { 0, 1, 0 } }
+	};
+	const float CORNERS[4][2] = { { -1, -1 }, { -1, 1 }, { 1, 1 }, { 1, -1 } };
+}
+
+void CInstanceBatch::clear(void)
+{
+	m_center.clear();
+	m_size.clear();
+	m_color.clear();
+	m_live.clear();
+	m_isDirty.clear();
+	m_dirty.clear();
+	m_free.clear();
+	m_liveCount = 0;
+}
+
+int CInstanceBatch::add(float x, float y, float z, float width, float height, float depth, unsigned color)
+{
+	int slot;
+	if (!m_free.empty()) {
+		slot = m_free.back();
+		m_free.pop_back();
+	}
+	else {
+		slot = getSlotCount();
+		m_center.resize(m_center.size() + 3);
+		m_size.resize(m_size.size() + 3);
+		m_color.push_back(0);
+		m_live.push_back(0);
+		m_isDirty.push_back(0);
+	}
+	m_center[slot * 3] = x;
+	m_center[slot * 3 + 1] = y;
+	m_center[slot * 3 + 2] = z;
+	m_size[slot * 3] = width;
+	m_size[slot * 3 + 1] = height;
+	m_size[slot * 3 + 2] = depth;
+	m_color[slot] = color;
+	m_live[slot] = 1;
+	m_liveCount++;
+	markDirty(slot);
+	return slot;
+}
+
+void CInstanceBatch::remove(int slot)
+{
+	if (slot < 0 || slot >= getSlotCount() || !m_live[slot])
+		return;
+	m_live[slot] = 0;
+	m_liveCount--;
+	m_free.push_back(slot);
+	markDirty(slot);
+}
+
+void CInstanceBatch::getBounds(int slot, float bmin[3], float bmax[3]) const
+{
+	for (int a = 0; a < 3; a++) {
+		bmin[a] = m_center[slot * 3 + a] - m_size[slot * 3 + a] / 2;
+		bmax[a] = m_center[slot * 3 + a] + m_size[slot * 3 + a] / 2;
+	}
+}
+
+void CInstanceBatch::markDirty(int slot)
+{
+	if (!m_isDirty[slot]) {
+		m_isDirty[slot] = 1;
+		m_dirty.push_back(slot);
+	}
+}
+
+void CInstanceBatch::clearDirty(void)
+{
+	for (size_t i = 0; i < m_dirty.size(); i++)
+		m_isDirty[m_dirty[i]] = 0;
+	m_dirty.clear();
+}
+
+void CInstanceBatch::expandSlot(int slot, InstanceVertex* out) const
+{
+	const float* c = &m_center[slot * 3];
+	float h[3] = { 0, 0, 0 };
+	if (m_live[slot]) {
+		h[0] = m_size[slot * 3] / 2;
+		h[1] = m_size[slot * 3 + 1] / 2;
+		h[2] = m_size[slot * 3 + 2] / 2;
+	}
+
+	for (int f = 0; f < 6; f++) {
+		const BoxFace& face = BOX_FACES[f];
+		for (int k = 0; k < 4; k++) {
+			InstanceVertex& v = out[f * 4 + k];
+			float p[3];
+			for (int a = 0; a < 3; a++)
+				p[a] = c[a] + (face.n[a] + face.u[a] * CORNERS[k][0] + face.v[a] * CORNERS[k][1]) * h[a];
+			v.x = p[0];
+			v.y = p[1];
+			v.z = p[2];
+			v.nx = face.n[0];
+			v.ny = face.n[1];
+			v.nz = face.n[2];
+			v.color = m_color[slot];
+		}
+	}
+}
+
+void CInstanceBatch::expandAll(std::vector<InstanceVertex>& out) const
+{
+	out.resize(m_live.size() * VERTICES_PER_INSTANCE);
+	for (int s = 0; s < getSlotCount(); s++)
+		expandSlot(s, &out[s * VERTICES_PER_INSTANCE]);
+}
+
+void CInstanceBatch::buildIndices(std::vector<unsigned short>& out)
+{
+	out.resize(INSTANCES_PER_DRAW * INDICES_PER_INSTANCE);
+	unsigned short* idx = &out[0];
+	for (int i = 0; i < INSTANCES_PER_DRAW; i++) {
+		for (int f = 0; f < 6; f++) {
+			unsigned short base = (unsigned short)(i * VERTICES_PER_INSTANCE + f * 4);
+			*idx++ = base;
+			*idx++ = base + 1;
+			*idx++ = base + 2;
+			*idx++ = base;
+			*idx++ = base + 2;
+			*idx++ = base + 3;
+		}
+	}
+}
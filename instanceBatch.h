@@ -0,0 +1,81 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: instanceBatch.h
+//
+// Desc: Batch of box instances that differ only in position, size and
+//       colour (the destructible obstacles). Each instance lives in a fixed
+//       slot; the batch expands the slots into one lit vertex stream
+//       (position, normal, colour) that is drawn a few thousand instances
+//       per call. Removing an instance only touches its own slot, which is
+//       reported as dirty so the owner re-uploads just that range.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __instanceBatchH__
+#define __instanceBatchH__
+
+#include <vector>
+
+// matches D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_DIFFUSE
+struct InstanceVertex {
+	float x, y, z;
+	float nx, ny, nz;
+	unsigned color;
+};
+
+class CInstanceBatch {
+public:
+	// D3DXCreateBox layout: 4 vertices and 2 triangles per face
+	enum { VERTICES_PER_INSTANCE = 24, INDICES_PER_INSTANCE = 36 };
+	// instances one draw call can address with 16 bit indices
+	enum { INSTANCES_PER_DRAW = 65536 / VERTICES_PER_INSTANCE };
+
+	CInstanceBatch(void) { clear(); }
+	~CInstanceBatch(void) {}
+
+public:
+	void clear(void);
+
+	// box of (width, height, depth) centered at (x, y, z); returns its slot
+	int add(float x, float y, float z, float width, float height, float depth, unsigned color);
+	// collapses the slot so it draws nothing; the slot can be reused by add()
+	void remove(int slot);
+	bool isLive(int slot) const { return m_live[slot] != 0; }
+	void getCenter(int slot, float& x, float& y, float& z) const
+	{
+		x = m_center[slot * 3];
+		y = m_center[slot * 3 + 1];
+		z = m_center[slot * 3 + 2];
+	}
+	void getBounds(int slot, float bmin[3], float bmax[3]) const;
+	int getSlotCount(void) const { return (int)m_live.size(); }
+	int getLiveCount(void) const { return m_liveCount; }
+	int getDrawCount(void) const { return (getSlotCount() + INSTANCES_PER_DRAW - 1) / INSTANCES_PER_DRAW; }
+
+	// slots changed since the last clearDirty(), each listed once
+	const std::vector<int>& getDirtySlots(void) const { return m_dirty; }
+	void clearDirty(void);
+
+	// the VERTICES_PER_INSTANCE vertices of one slot (all at the center,
+	// i.e. degenerate, when the slot is not live)
+	void expandSlot(int slot, InstanceVertex* out) const;
+	// every slot, slot i at out[i * VERTICES_PER_INSTANCE]
+	void expandAll(std::vector<InstanceVertex>& out) const;
+	// index list for INSTANCES_PER_DRAW instances, shared by every draw call
+	static void buildIndices(std::vector<unsigned short>& out);
+
+private:
+	void markDirty(int slot);
+
+	// per-instance data, one entry per slot
+	std::vector<float>		m_center;	// x, y, z
+	std::vector<float>		m_size;		// width, height, depth
+	std::vector<unsigned>	m_color;
+	std::vector<char>		m_live;
+	std::vector<char>		m_isDirty;
+	std::vector<int>		m_dirty;
+	std::vector<int>		m_free;
+	int						m_liveCount;
+};
+
+#endif // __instanceBatchH__
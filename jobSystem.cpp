@@ -0,0 +1,234 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: jobSystem.cpp
+//
+// Desc: Work-stealing thread pool and task graphs (see jobSystem.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "jobSystem.h"
+#include <algorithm>
+
+// -----------------------------------------------------------------------------
+// CTaskGraph
+// -----------------------------------------------------------------------------
+
+int CTaskGraph::add(TaskFunc fn, void* context, int begin, int end, int grain)
+{
+	Task t;
+	t.fn = fn;
+	t.context = context;
+	t.begin = begin;
+	t.end = end;
+	t.grain = grain;
+	t.dependencies = 0;
+	m_tasks.push_back(t);
+	return (int)m_tasks.size() - 1;
+}
+
+void CTaskGraph::precede(int before, int after)
+{
+	m_tasks[before].successors.push_back(after);
+	m_tasks[after].dependencies++;
+}
+
+void CTaskGraph::setRange(int task, int begin, int end)
+{
+	m_tasks[task].begin = begin;
+	m_tasks[task].end = end;
+}
+
+// -----------------------------------------------------------------------------
+// CJobSystem
+// -----------------------------------------------------------------------------
+
+CJobSystem::CJobSystem(void)
+	: m_queued(0), m_stop(false), m_runs(0), m_jobs(0), m_stolen(0)
+{
+	m_queues.push_back(new Queue);
+}
+
+CJobSystem::~CJobSystem(void)
+{
+	stopWorkers();
+	for (size_t i = 0; i < m_queues.size(); i++)
+		delete m_queues[i];
+}
+
+void CJobSystem::setThreadCount(int count)
+{
+	stopWorkers();
+	if (count <= 0)
+		count = (int)std::thread::hardware_concurrency();
+	count = std::max(count, 1);
+
+	for (size_t i = 0; i < m_queues.size(); i++)
+		delete m_queues[i];
+	m_queues.clear();
+	for (int t = 0; t < count; t++)
+		m_queues.push_back(new Queue);
+	m_queued = 0;
+	m_stop = false;
+	for (int t = 1; t < count; t++)
+		m_workers.push_back(std::thread(&CJobSystem::workerMain, this, t));
+}
+
+void CJobSystem::stopWorkers(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+		m_workers[i].join();
+	m_workers.clear();
+}
+
+JobStats CJobSystem::getStats(void) const
+{
+	JobStats stats;
+	stats.runs = m_runs;
+	stats.jobs = m_jobs;
+	stats.stolen = m_stolen;
+	return stats;
+}
+
+void CJobSystem::resetStats(void)
+{
+	m_runs = 0;
+	m_jobs = 0;
+	m_stolen = 0;
+}
+
+void CJobSystem::run(CTaskGraph& graph)
+{
+	int n = graph.getTaskCount();
+	if (n == 0)
+		return;
+	if ((int)graph.m_waiting.size() != n) {
+		// atomics do not move, so the arrays are made anew at their size
+		std::vector<std::atomic<int> > waiting(n), pieces(n);
+		graph.m_waiting.swap(waiting);
+		graph.m_pieces.swap(pieces);
+	}
+	for (int i = 0; i < n; i++)
+		graph.m_waiting[i] = graph.m_tasks[i].dependencies;
+	graph.m_unfinished = n;
+
+	for (int i = 0; i < n; i++) {
+		if (graph.m_tasks[i].dependencies == 0)
+			schedule(0, graph, i);
+	}
+	// the caller works too, until the last task is done. Once its queue
+	// and the others are empty, what is left is running on other threads
+	while (graph.m_unfinished > 0) {
+		Job job;
+		if (findJob(0, job))
+			execute(0, job);
+		else
+			std::this_thread::yield();
+	}
+
+	m_runs++;
+}
+
+void CJobSystem::schedule(int thread, CTaskGraph& graph, int task)
+{
+	const CTaskGraph::Task& t = graph.m_tasks[task];
+	int count = t.end - t.begin;
+	if (count <= 0) {
+		finishTask(thread, graph, task);
+		return;
+	}
+	int grain = t.grain > 0 ? t.grain : count;
+	int pieces = (count + grain - 1) / grain;
+	graph.m_pieces[task] = pieces;
+	{
+		Queue& q = *m_queues[thread];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		for (int begin = t.begin; begin < t.end; begin += grain) {
+			Job job = { &graph, task, begin, std::min(begin + grain, t.end) };
+			q.jobs.push_back(job);
+		}
+	}
+	m_queued += pieces;
+	if (m_workers.empty())
+		return;
+	// a worker checks m_queued under m_mutex before it sleeps, so taking
+	// the lock here means none of them misses these jobs
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+	}
+	if (pieces > 1)
+		m_wake.notify_all();
+	else
+		m_wake.notify_one();
+}
+
+void CJobSystem::finishTask(int thread, CTaskGraph& graph, int task)
+{
+	const std::vector<int>& next = graph.m_tasks[task].successors;
+	for (size_t k = 0; k < next.size(); k++) {
+		if (--graph.m_waiting[next[k]] == 0)
+			schedule(thread, graph, next[k]);
+	}
+	// last, so run() does not return while successors are still to be queued
+	graph.m_unfinished--;
+}
+
+bool CJobSystem::findJob(int thread, Job& job)
+{
+	if (m_queued <= 0)
+		return false;
+	{
+		// own queue: newest first, its data is likely still in the cache
+		Queue& q = *m_queues[thread];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if (!q.jobs.empty()) {
+			job = q.jobs.back();
+			q.jobs.pop_back();
+			m_queued--;
+			return true;
+		}
+	}
+	int count = (int)m_queues.size();
+	for (int k = 1; k < count; k++) {
+		// the others: oldest first, the far end from their owner
+		Queue& q = *m_queues[(thread + k) % count];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if (!q.jobs.empty()) {
+			job = q.jobs.front();
+			q.jobs.pop_front();
+			m_queued--;
+			m_stolen++;
+			return true;
+		}
+	}
+	return false;
+}
+
+void CJobSystem::execute(int thread, const Job& job)
+{
+	CTaskGraph& graph = *job.graph;
+	const CTaskGraph::Task& t = graph.m_tasks[job.task];
+	t.fn(t.context, job.begin, job.end);
+	m_jobs++;
+	if (--graph.m_pieces[job.task] == 0)
+		finishTask(thread, graph, job.task);
+}
+
+void CJobSystem::workerMain(int thread)
+{
+	for (;;) {
+		Job job;
+		if (findJob(thread, job)) {
+			execute(thread, job);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_wake.wait(lock, [this] { return m_stop || m_queued > 0; });
+		if (m_stop)
+			return;
+	}
+}
@@ -0,0 +1,122 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: jobSystem.h
+//
+// Desc: Work-stealing thread pool and the task graphs it runs. A CTaskGraph
+//       is a set of tasks with "runs after" edges between them; a task calls
+//       its function over an index range, split into jobs of a given size.
+//       CJobSystem::run() starts the tasks nothing waits for and returns
+//       when the whole graph is done. Every thread (the caller is thread 0)
+//       has its own job queue: it takes its newest job from the back, and
+//       when its queue is empty it steals the oldest one of another thread.
+//       Jobs a task's completion makes ready go to the thread that finished
+//       it, so a chain of stages tends to stay on one core.
+//       A graph is built once and run as often as needed (every frame).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __jobSystemH__
+#define __jobSystemH__
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// called with a piece [begin, end) of the task's range
+typedef void (*TaskFunc)(void* context, int begin, int end);
+
+// counted since the last resetStats()
+struct JobStats {
+	int runs;			// graphs run
+	int jobs;			// jobs executed
+	int stolen;			// jobs taken from another thread's queue
+};
+
+class CTaskGraph {
+public:
+	CTaskGraph(void) : m_unfinished(0) {}
+	~CTaskGraph(void) {}
+
+public:
+	void clear(void) { m_tasks.clear(); }
+
+	// a task running fn over [begin, end) in pieces of at most grain indices
+	// (grain <= 0: the whole range in one piece). Returns its id
+	int add(TaskFunc fn, void* context, int begin = 0, int end = 1, int grain = 0);
+	// after does not start before before has finished
+	void precede(int before, int after);
+	// a new range for the next run (e.g. the missiles in flight); an empty
+	// range finishes the task without calling it
+	void setRange(int task, int begin, int end);
+	int getTaskCount(void) const { return (int)m_tasks.size(); }
+
+private:
+	friend class CJobSystem;
+
+	struct Task {
+		TaskFunc			fn;
+		void*				context;
+		int					begin, end, grain;
+		int					dependencies;	// tasks it waits for
+		std::vector<int>	successors;
+	};
+
+	std::vector<Task>				m_tasks;
+	// per run: unfinished predecessors and pieces of every task
+	std::vector<std::atomic<int> >	m_waiting;
+	std::vector<std::atomic<int> >	m_pieces;
+	std::atomic<int>				m_unfinished;	// tasks
+};
+
+class CJobSystem {
+public:
+	CJobSystem(void);
+	~CJobSystem(void);
+
+public:
+	// threads including the caller; 0 = one per hardware thread. With 1,
+	// run() calls every task on the calling thread in dependency order
+	void setThreadCount(int count);
+	int getThreadCount(void) const { return (int)m_queues.size(); }
+
+	// runs the graph and waits for it. Several threads may each run a graph
+	// at once (each works through everybody's jobs until its own is done),
+	// but a graph runs once at a time, and never from inside a task
+	void run(CTaskGraph& graph);
+
+	JobStats getStats(void) const;
+	void resetStats(void);
+
+private:
+	struct Job {
+		CTaskGraph*	graph;
+		int			task;
+		int			begin, end;
+	};
+	struct Queue {
+		std::mutex			mutex;
+		std::deque<Job>		jobs;
+	};
+
+	// every piece of the task into thread's queue
+	void schedule(int thread, CTaskGraph& graph, int task);
+	void finishTask(int thread, CTaskGraph& graph, int task);
+	bool findJob(int thread, Job& job);
+	void execute(int thread, const Job& job);
+	void workerMain(int thread);
+	void stopWorkers(void);
+
+	std::vector<Queue*>			m_queues;	// one per thread, 0 = caller
+	std::vector<std::thread>	m_workers;
+	std::atomic<int>			m_queued;	// jobs in all queues
+	std::mutex					m_mutex;	// sleeping workers
+	std::condition_variable		m_wake;
+	bool						m_stop;
+
+	std::atomic<int>			m_runs, m_jobs, m_stolen;
+};
+
+#endif // __jobSystemH__
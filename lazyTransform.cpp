@@ -0,0 +1,48 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: lazyTransform.cpp
+//
+// Desc: Lazily rebuilt render transforms (see lazyTransform.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "lazyTransform.h"
+#include <cstring>
+
+TransformStats CLazyTransform::s_stats = { 0, 0, 0 };
+
+void CTransformFrame::set(const float m[16])
+{
+	if (memcmp(m_matrix.data(), m, sizeof(float) * 16) == 0)
+		return;
+	memcpy(m_matrix.data(), m, sizeof(float) * 16);
+	if (++m_stamp == 0)
+		m_stamp = 1;	// 0 means "never built" to the transforms
+}
+
+void CTransformFrame::set(const SimdMat4& m)
+{
+	set(m.data());
+}
+
+void CLazyTransform::resetStats(void)
+{
+	memset(&s_stats, 0, sizeof(s_stats));
+}
+
+void CLazyTransform::rebuild(const CTransformFrame& frame)
+{
+	if (m_yaw == 0) {
+		// boxes and spheres: only the parent's last row moves
+		simdTranslateParent(m_world, m_position.x, m_position.y, m_position.z, frame.getMatrix());
+	}
+	else {
+		SimdMat4 local = SimdMat4::rotationY(m_yaw);
+		local.m[3][0] = m_position.x;
+		local.m[3][1] = m_position.y;
+		local.m[3][2] = m_position.z;
+		simdMultiply(m_world, local, frame.getMatrix());
+	}
+	m_frameStamp = frame.getStamp();
+	s_stats.rebuilds++;
+}
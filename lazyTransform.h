@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: lazyTransform.h
+//
+// Desc: Render transforms that are rebuilt only when they are read after a
+//       change. CLazyTransform keeps a position (and a yaw) and the
+//       pre-multiplied world matrix local * parent, ready for
+//       CRenderQueue::submit. setPosition() only stores the numbers; the
+//       matrix is rebuilt by the next getWorld() if the position or the
+//       parent frame changed since the last one. A CTransformFrame is the
+//       parent (g_mWorld in the game); its stamp changes only when its
+//       matrix really does.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __lazyTransformH__
+#define __lazyTransformH__
+
+#include "simdMath.h"
+
+// counted over every CLazyTransform since the last reset
+struct TransformStats {
+	int changes;		// setPosition / setRotationY calls that changed something
+	int reads;			// getWorld calls
+	int rebuilds;		// getWorld calls that built the matrix
+};
+
+class CTransformFrame {
+public:
+	CTransformFrame(void) : m_matrix(SimdMat4::identity()), m_stamp(1) {}
+
+public:
+	// m is row major (D3DXMATRIX); the stamp moves only if m differs
+	void set(const float m[16]);
+	void set(const SimdMat4& m);
+	const SimdMat4& getMatrix(void) const { return m_matrix; }
+	unsigned getStamp(void) const { return m_stamp; }
+
+private:
+	SimdMat4	m_matrix;
+	unsigned	m_stamp;
+};
+
+class CLazyTransform {
+public:
+	CLazyTransform(void) : m_yaw(0), m_frameStamp(0) {}
+
+public:
+	void setPosition(float x, float y, float z)
+	{
+		if (x == m_position.x && y == m_position.y && z == m_position.z)
+			return;
+		m_position = SimdVec3(x, y, z);
+		invalidate();
+	}
+	void setRotationY(float angle)
+	{
+		if (angle == m_yaw)
+			return;
+		m_yaw = angle;
+		invalidate();
+	}
+	const SimdVec3& getPosition(void) const { return m_position; }
+	float getRotationY(void) const { return m_yaw; }
+
+	// local * frame, rebuilt here if anything changed since the last call
+	const SimdMat4& getWorld(const CTransformFrame& frame)
+	{
+		s_stats.reads++;
+		if (m_frameStamp != frame.getStamp())
+			rebuild(frame);
+		return m_world;
+	}
+
+	static const TransformStats& getStats(void) { return s_stats; }
+	static void resetStats(void);
+
+private:
+	void invalidate(void) { m_frameStamp = 0; s_stats.changes++; }
+	void rebuild(const CTransformFrame& frame);
+
+	SimdMat4	m_world;		// valid for m_frameStamp (0 = never)
+	SimdVec3	m_position;
+	float		m_yaw;
+	unsigned	m_frameStamp;
+
+	static TransformStats s_stats;
+};
+
+#endif // __lazyTransformH__
@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: meshCache.cpp
+//
+// Desc: Shared mesh cache (see meshCache.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "meshCache.h"
+#include <cstring>
+
+MeshKey MeshKey::box(float width, float height, float depth)
+{
+	MeshKey k;
+	k.shape = BOX;
+	k.size[0] = width;
+	k.size[1] = height;
+	k.size[2] = depth;
+	k.slices = k.stacks = 0;
+	return k;
+}
+
+MeshKey MeshKey::sphere(float radius, int slices, int stacks)
+{
+	MeshKey k;
+	k.shape = SPHERE;
+	k.size[0] = radius;
+	k.size[1] = k.size[2] = 0;
+	k.slices = slices;
+	k.stacks = stacks;
+	return k;
+}
+
+bool MeshKey::operator<(const MeshKey& o) const
+{
+	if (shape != o.shape) return shape < o.shape;
+	for (int a = 0; a < 3; a++) {
+		if (size[a] != o.size[a]) return size[a] < o.size[a];
+	}
+	if (slices != o.slices) return slices < o.slices;
+	return stacks < o.stacks;
+}
+
+CMeshCache::CMeshCache(void)
+{
+	m_factory = NULL;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void* CMeshCache::acquire(const MeshKey& key)
+{
+	m_stats.requests++;
+	std::map<MeshKey, void*>::iterator it = m_byKey.find(key);
+	if (it != m_byKey.end()) {
+		Entry& e = m_byMesh[it->second];
+		e.refs++;
+		m_stats.hits++;
+		m_stats.savedBytes += e.bytes;
+		return it->second;
+	}
+
+	if (m_factory == NULL)
+		return NULL;
+	unsigned bytes = 0;
+	void* mesh = m_factory->createMesh(key, bytes);
+	if (mesh == NULL)
+		return NULL;
+	Entry e;
+	e.key = key;
+	e.refs = 1;
+	e.bytes = bytes;
+	m_byKey[key] = mesh;
+	m_byMesh[mesh] = e;
+	m_stats.liveMeshes++;
+	m_stats.liveBytes += bytes;
+	return mesh;
+}
+
+void CMeshCache::release(void* mesh)
+{
+	std::map<void*, Entry>::iterator it = m_byMesh.find(mesh);
+	if (it == m_byMesh.end())
+		return;
+	if (--it->second.refs > 0)
+		return;
+
+	m_stats.liveMeshes--;
+	m_stats.liveBytes -= it->second.bytes;
+	m_byKey.erase(it->second.key);
+	m_byMesh.erase(it);
+	if (m_factory != NULL)
+		m_factory->destroyMesh(mesh);
+}
+
+void CMeshCache::clear(void)
+{
+	for (std::map<void*, Entry>::iterator it = m_byMesh.begin(); it != m_byMesh.end(); ++it) {
+		if (m_factory != NULL)
+			m_factory->destroyMesh(it->first);
+	}
+	m_byMesh.clear();
+	m_byKey.clear();
+	m_stats.liveMeshes = 0;
+	m_stats.liveBytes = 0;
+}
+
+int CMeshCache::getRefCount(void* mesh) const
+{
+	std::map<void*, Entry>::const_iterator it = m_byMesh.find(mesh);
+	return it == m_byMesh.end() ? 0 : it->second.refs;
+}
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: meshCache.h
+//
+// Desc: Reference counted cache of generated meshes. A mesh is keyed by its
+//       shape and dimensions (plus tessellation for spheres), so every box
+//       of the same size shares one mesh. The meshes themselves are made and
+//       freed by a CMeshFactory (D3DX in the game, a stand-in in benchmarks).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __meshCacheH__
+#define __meshCacheH__
+
+#include <map>
+
+struct MeshKey {
+	enum Shape { BOX, SPHERE };
+	int shape;
+	float size[3];		// box width/height/depth, sphere radius in size[0]
+	int slices, stacks;	// sphere only
+
+	static MeshKey box(float width, float height, float depth);
+	static MeshKey sphere(float radius, int slices, int stacks);
+	bool operator<(const MeshKey& o) const;
+};
+
+class CMeshFactory {
+public:
+	virtual ~CMeshFactory(void) {}
+	// NULL on failure; bytes gets the vertex + index buffer size
+	virtual void* createMesh(const MeshKey& key, unsigned& bytes) = 0;
+	virtual void destroyMesh(void* mesh) = 0;
+};
+
+struct MeshCacheStats {
+	int requests;
+	int hits;
+	int liveMeshes;
+	double liveBytes;		// buffers actually allocated
+	double savedBytes;		// buffers every hit would have allocated
+	double getHitRate(void) const { return requests ? (double)hits / requests : 0; }
+};
+
+class CMeshCache {
+public:
+	CMeshCache(void);
+	~CMeshCache(void) {}
+
+public:
+	void setFactory(CMeshFactory* factory) { m_factory = factory; }
+
+	// shared mesh for key, made on first use; every acquire needs a release
+	void* acquire(const MeshKey& key);
+	// the mesh is destroyed with its last reference
+	void release(void* mesh);
+	// destroys every mesh still referenced (shutdown)
+	void clear(void);
+
+	int getRefCount(void* mesh) const;
+	const MeshCacheStats& getStats(void) const { return m_stats; }
+
+private:
+	struct Entry {
+		MeshKey key;
+		int refs;
+		unsigned bytes;
+	};
+
+	CMeshFactory*				m_factory;
+	std::map<MeshKey, void*>	m_byKey;
+	std::map<void*, Entry>		m_byMesh;
+	MeshCacheStats				m_stats;
+};
+
+#endif // __meshCacheH__
@@ -0,0 +1,345 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: occlusionCuller.cpp
+//
+// Desc: Software occlusion culling (see occlusionCuller.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "occlusionCuller.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+// a candidate has to be this much farther than the occluder to be hidden,
+// so a box lying on the occluder's face (one of the wall's own boxes) is
+// not lost to rounding
+#define OCCLUSION_DEPTH_BIAS 1e-4f
+
+// box faces as corner indices (bit 0 = max x, bit 1 = max y, bit 2 = max z),
+// clockwise seen from outside like D3D front faces
+static const int s_faces[6][4] = {
+	{ 0, 2, 3, 1 },		// -z
+	{ 5, 7, 6, 4 },		// +z
+	{ 4, 6, 2, 0 },		// -x
+	{ 1, 3, 7, 5 },		// +x
+	{ 1, 5, 4, 0 },		// -y
+	{ 2, 6, 7, 3 }		// +y
+};
+
+COcclusionCuller::COcclusionCuller(void)
+{
+	m_width = m_height = 0;
+	memset(m_viewProj, 0, sizeof(m_viewProj));
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_candidates = 0;
+	m_candidateCount = 0;
+	m_busy = false;
+	m_stop = false;
+	resize(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+	m_worker = std::thread(&COcclusionCuller::workerMain, this);
+}
+
+COcclusionCuller::~COcclusionCuller(void)
+{
+	waitCull();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	m_worker.join();
+}
+
+void COcclusionCuller::resize(int width, int height)
+{
+	waitCull();
+	m_width = width;
+	m_height = height;
+	m_levels.clear();
+	int w = width, h = height;
+	for (;;) {
+		Level level;
+		level.width = w;
+		level.height = h;
+		level.depth.assign(w * h, 0.0f);
+		m_levels.push_back(level);
+		if (w == 1 && h == 1)
+			break;
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+	}
+}
+
+void COcclusionCuller::setOccluders(const float* boxes, int count)
+{
+	waitCull();
+	m_occluders.assign(boxes, boxes + count * 6);
+}
+
+static void transform(const float m[16], float x, float y, float z, float out[4])
+{
+	for (int c = 0; c < 4; c++)
+		out[c] = x * m[c] + y * m[4 + c] + z * m[8 + c] + m[12 + c];
+}
+
+void COcclusionCuller::render(const float viewProj[16])
+{
+	memcpy(m_viewProj, viewProj, sizeof(m_viewProj));
+	std::fill(m_levels[0].depth.begin(), m_levels[0].depth.end(), 0.0f);
+	m_stats.occluders = getOccluderCount();
+	m_stats.triangles = 0;
+	m_stats.tested = 0;
+	m_stats.occluded = 0;
+	for (int i = 0; i < m_stats.occluders; i++)
+		drawBox(&m_occluders[i * 6]);
+	buildPyramid();
+}
+
+void COcclusionCuller::drawBox(const float* box)
+{
+	ClipVertex corners[8];
+	for (int k = 0; k < 8; k++) {
+		float p[4];
+		transform(m_viewProj, box[(k & 1) ? 3 : 0], box[(k & 2) ? 4 : 1], box[(k & 4) ? 5 : 2], p);
+		corners[k].x = p[0];
+		corners[k].y = p[1];
+		corners[k].z = p[2];
+		corners[k].w = p[3];
+	}
+	for (int f = 0; f < 6; f++) {
+		ClipVertex quad[4];
+		for (int k = 0; k < 4; k++)
+			quad[k] = corners[s_faces[f][k]];
+		drawPolygon(quad, 4);
+	}
+}
+
+void COcclusionCuller::drawPolygon(const ClipVertex* v, int count)
+{
+	// clip against the near plane (z >= 0); a quad gains at most one vertex
+	ClipVertex clipped[5];
+	int n = 0;
+	for (int i = 0; i < count; i++) {
+		const ClipVertex& a = v[i];
+		const ClipVertex& b = v[(i + 1) % count];
+		if (a.z >= 0)
+			clipped[n++] = a;
+		if ((a.z >= 0) != (b.z >= 0)) {
+			float t = a.z / (a.z - b.z);
+			ClipVertex& c = clipped[n++];
+			c.x = a.x + (b.x - a.x) * t;
+			c.y = a.y + (b.y - a.y) * t;
+			c.z = 0.0f;
+			c.w = a.w + (b.w - a.w) * t;
+		}
+	}
+	if (n < 3)
+		return;
+
+	// screen x, y and 1 / w
+	float s[5][3];
+	for (int i = 0; i < n; i++) {
+		float iw = 1.0f / clipped[i].w;
+		s[i][0] = (clipped[i].x * iw * 0.5f + 0.5f) * m_width;
+		s[i][1] = (0.5f - clipped[i].y * iw * 0.5f) * m_height;
+		s[i][2] = iw;
+	}
+	for (int i = 1; i + 1 < n; i++)
+		fillTriangle(s[0], s[i], s[i + 1]);
+}
+
+void COcclusionCuller::fillTriangle(const float a[3], const float b[3], const float c[3])
+{
+	// clockwise on screen (y down) is front facing; the back faces of a
+	// closed box are always behind its front faces
+	float area = (b[0] - a[0]) * (c[1] - a[1]) - (c[0] - a[0]) * (b[1] - a[1]);
+	if (area <= 0)
+		return;
+
+	int x0 = std::max((int)floorf(std::min(a[0], std::min(b[0], c[0]))), 0);
+	int y0 = std::max((int)floorf(std::min(a[1], std::min(b[1], c[1]))), 0);
+	int x1 = std::min((int)ceilf(std::max(a[0], std::max(b[0], c[0]))), m_width - 1);
+	int y1 = std::min((int)ceilf(std::max(a[1], std::max(b[1], c[1]))), m_height - 1);
+	if (x0 > x1 || y0 > y1)
+		return;
+	m_stats.triangles++;
+
+	// edge functions at pixel centers, stepped per pixel
+	float inv = 1.0f / area;
+	float px = x0 + 0.5f, py = y0 + 0.5f;
+	float e0 = (c[0] - b[0]) * (py - b[1]) - (c[1] - b[1]) * (px - b[0]);
+	float e1 = (a[0] - c[0]) * (py - c[1]) - (a[1] - c[1]) * (px - c[0]);
+	float e2 = (b[0] - a[0]) * (py - a[1]) - (b[1] - a[1]) * (px - a[0]);
+	float dx0 = -(c[1] - b[1]), dx1 = -(a[1] - c[1]), dx2 = -(b[1] - a[1]);
+	float dy0 = c[0] - b[0], dy1 = a[0] - c[0], dy2 = b[0] - a[0];
+
+	std::vector<float>& depth = m_levels[0].depth;
+	for (int y = y0; y <= y1; y++) {
+		float w0 = e0, w1 = e1, w2 = e2;
+		float* row = &depth[y * m_width];
+		for (int x = x0; x <= x1; x++) {
+			if (w0 >= 0 && w1 >= 0 && w2 >= 0) {
+				// w0..w2 / area are the barycentric weights of a, b, c
+				float z = (w0 * a[2] + w1 * b[2] + w2 * c[2]) * inv;
+				if (z > row[x])
+					row[x] = z;
+			}
+			w0 += dx0;
+			w1 += dx1;
+			w2 += dx2;
+		}
+		e0 += dy0;
+		e1 += dy1;
+		e2 += dy2;
+	}
+}
+
+void COcclusionCuller::buildPyramid(void)
+{
+	// each texel keeps the farthest (smallest 1 / w) of its 2 x 2 children
+	for (size_t l = 1; l < m_levels.size(); l++) {
+		const Level& fine = m_levels[l - 1];
+		Level& coarse = m_levels[l];
+		for (int y = 0; y < coarse.height; y++) {
+			int fy0 = y * 2, fy1 = std::min(y * 2 + 1, fine.height - 1);
+			for (int x = 0; x < coarse.width; x++) {
+				int fx0 = x * 2, fx1 = std::min(x * 2 + 1, fine.width - 1);
+				float d = std::min(std::min(fine.depth[fy0 * fine.width + fx0], fine.depth[fy0 * fine.width + fx1]),
+					std::min(fine.depth[fy1 * fine.width + fx0], fine.depth[fy1 * fine.width + fx1]));
+				coarse.depth[y * coarse.width + x] = d;
+			}
+		}
+	}
+}
+
+bool COcclusionCuller::projectBox(const float bmin[3], const float bmax[3], int rect[4], float& nearest) const
+{
+	float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+	nearest = 0.0f;
+	for (int k = 0; k < 8; k++) {
+		float p[4];
+		transform(m_viewProj, (k & 1) ? bmax[0] : bmin[0], (k & 2) ? bmax[1] : bmin[1], (k & 4) ? bmax[2] : bmin[2], p);
+		if (p[2] < 0)
+			return false;
+		float iw = 1.0f / p[3];
+		float x = (p[0] * iw * 0.5f + 0.5f) * m_width;
+		float y = (0.5f - p[1] * iw * 0.5f) * m_height;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		nearest = std::max(nearest, iw);
+	}
+	// every pixel center the box could cover
+	rect[0] = std::max((int)floorf(minX), 0);
+	rect[1] = std::max((int)floorf(minY), 0);
+	rect[2] = std::min((int)ceilf(maxX), m_width - 1);
+	rect[3] = std::min((int)ceilf(maxY), m_height - 1);
+	return rect[0] <= rect[2] && rect[1] <= rect[3];
+}
+
+bool COcclusionCuller::isHidden(int level, int x, int y, const int rect[4], float nearest) const
+{
+	const Level& l = m_levels[level];
+	if (nearest < l.depth[y * l.width + x] * (1.0f - OCCLUSION_DEPTH_BIAS))
+		return true;
+	if (level == 0)
+		return false;
+	// not enough here; every child inside the rectangle has to hide it
+	const Level& fine = m_levels[level - 1];
+	int shift = level - 1;
+	int cx0 = std::max(x * 2, rect[0] >> shift), cx1 = std::min(std::min(x * 2 + 1, fine.width - 1), rect[2] >> shift);
+	int cy0 = std::max(y * 2, rect[1] >> shift), cy1 = std::min(std::min(y * 2 + 1, fine.height - 1), rect[3] >> shift);
+	for (int cy = cy0; cy <= cy1; cy++) {
+		for (int cx = cx0; cx <= cx1; cx++) {
+			if (!isHidden(level - 1, cx, cy, rect, nearest))
+				return false;
+		}
+	}
+	return true;
+}
+
+bool COcclusionCuller::isVisible(const float bmin[3], const float bmax[3]) const
+{
+	int rect[4];
+	float nearest;
+	if (!projectBox(bmin, bmax, rect, nearest))
+		return true;
+	// start where the rectangle spans at most 2 x 2 texels
+	int level = 0;
+	while (level + 1 < (int)m_levels.size() &&
+		((rect[2] >> level) - (rect[0] >> level) > 1 || (rect[3] >> level) - (rect[1] >> level) > 1))
+		level++;
+	for (int y = rect[1] >> level; y <= rect[3] >> level; y++) {
+		for (int x = rect[0] >> level; x <= rect[2] >> level; x++) {
+			if (!isHidden(level, x, y, rect, nearest))
+				return true;
+		}
+	}
+	return false;
+}
+
+bool COcclusionCuller::isVisibleFlat(const float bmin[3], const float bmax[3]) const
+{
+	int rect[4];
+	float nearest;
+	if (!projectBox(bmin, bmax, rect, nearest))
+		return true;
+	const Level& l = m_levels[0];
+	for (int y = rect[1]; y <= rect[3]; y++) {
+		for (int x = rect[0]; x <= rect[2]; x++) {
+			if (!(nearest < l.depth[y * l.width + x] * (1.0f - OCCLUSION_DEPTH_BIAS)))
+				return true;
+		}
+	}
+	return false;
+}
+
+void COcclusionCuller::cullCandidates(void)
+{
+	m_result.resize(m_candidateCount);
+	for (int i = 0; i < m_candidateCount; i++) {
+		const float* b = &m_candidates[i * 6];
+		m_result[i] = isVisible(b, b + 3) ? 1 : 0;
+		if (!m_result[i])
+			m_stats.occluded++;
+	}
+	m_stats.tested += m_candidateCount;
+}
+
+void COcclusionCuller::beginCull(const float viewProj[16], const float* boxes, int count)
+{
+	waitCull();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	memcpy(m_viewProj, viewProj, sizeof(m_viewProj));
+	m_candidates = boxes;
+	m_candidateCount = count;
+	m_busy = true;
+	m_wake.notify_one();
+}
+
+const unsigned char* COcclusionCuller::waitCull(void)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this] { return !m_busy; });
+	return m_result.empty() ? 0 : &m_result[0];
+}
+
+void COcclusionCuller::workerMain(void)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		m_wake.wait(lock, [this] { return m_busy || m_stop; });
+		if (m_stop)
+			return;
+		lock.unlock();
+		float viewProj[16];
+		memcpy(viewProj, m_viewProj, sizeof(viewProj));
+		render(viewProj);
+		cullCandidates();
+		lock.lock();
+		m_busy = false;
+		m_done.notify_all();
+	}
+}
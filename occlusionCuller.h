@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: occlusionCuller.h
+//
+// Desc: Software occlusion culling. A few large occluder boxes are drawn
+//       into a small CPU depth buffer; a hierarchical Z pyramid over it
+//       keeps the farthest occluder depth of every 2^k block. A candidate
+//       box is hidden when its nearest corner is behind the farthest
+//       occluder depth of every block its screen rectangle touches; the
+//       test starts at the level where the rectangle spans a couple of
+//       texels and only descends where that is not enough.
+//       Depth is stored as 1 / w (0 = nothing drawn), which is linear in
+//       screen space and keeps its precision far from the camera.
+//       beginCull() runs the whole frame (occluders and candidates) on a
+//       worker thread; waitCull() picks the result up.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __occlusionCullerH__
+#define __occlusionCullerH__
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+struct OcclusionStats {
+	int occluders;
+	int triangles;		// occluder triangles rasterized (front facing, after clipping)
+	int tested;			// candidates tested
+	int occluded;		// candidates found hidden
+	float getOccludedRatio(void) const { return tested ? (float)occluded / tested : 0.0f; }
+};
+
+class COcclusionCuller {
+public:
+	enum { DEFAULT_WIDTH = 256, DEFAULT_HEIGHT = 144 };
+
+	COcclusionCuller(void);
+	~COcclusionCuller(void);
+
+public:
+	void resize(int width, int height);
+	int getWidth(void) const { return m_width; }
+	int getHeight(void) const { return m_height; }
+
+	// boxes are min x, y, z, max x, y, z (6 floats each); copied
+	void setOccluders(const float* boxes, int count);
+	int getOccluderCount(void) const { return (int)m_occluders.size() / 6; }
+
+	// draws the occluders seen through viewProj (row major, D3D clip space)
+	// and builds the pyramid
+	void render(const float viewProj[16]);
+	// after render(): false if the box is certainly hidden. Boxes crossing
+	// the near plane or outside the screen count as visible, that is the
+	// frustum test's business
+	bool isVisible(const float bmin[3], const float bmax[3]) const;
+	// the same answer from the full resolution buffer alone (for checking)
+	bool isVisibleFlat(const float bmin[3], const float bmax[3]) const;
+
+	// render() and isVisible() for count candidate boxes on the worker
+	// thread. The boxes and the occluders must stay untouched until
+	// waitCull(); result[i] is nonzero when candidate i may be visible
+	void beginCull(const float viewProj[16], const float* boxes, int count);
+	const unsigned char* waitCull(void);
+
+	// level 0 is the depth buffer
+	int getLevelCount(void) const { return (int)m_levels.size(); }
+	const float* getDepth(void) const { return m_levels.empty() ? 0 : &m_levels[0].depth[0]; }
+	const OcclusionStats& getStats(void) const { return m_stats; }
+
+private:
+	struct Level {
+		int width, height;
+		std::vector<float> depth;
+	};
+	struct ClipVertex {
+		float x, y, z, w;
+	};
+
+	void drawBox(const float* box);
+	void drawPolygon(const ClipVertex* v, int count);
+	void fillTriangle(const float a[3], const float b[3], const float c[3]);
+	void buildPyramid(void);
+	// screen rectangle (level 0 texels) and nearest 1 / w; false when the
+	// box cannot be tested (near plane, off screen)
+	bool projectBox(const float bmin[3], const float bmax[3], int rect[4], float& nearest) const;
+	bool isHidden(int level, int x, int y, const int rect[4], float nearest) const;
+	void cullCandidates(void);
+
+	void workerMain(void);
+
+	int							m_width, m_height;
+	std::vector<Level>			m_levels;
+	std::vector<float>			m_occluders;
+	float						m_viewProj[16];
+	OcclusionStats				m_stats;
+
+	// worker job
+	const float*				m_candidates;
+	int							m_candidateCount;
+	std::vector<unsigned char>	m_result;
+	std::thread					m_worker;
+	std::mutex					m_mutex;
+	std::condition_variable		m_wake, m_done;
+	bool						m_busy, m_stop;
+};
+
+#endif // __occlusionCullerH__
@@ -0,0 +1,309 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: projectiles.cpp
+//
+// Desc: Missile pool, integrator kernels and collision sweeps (see projectiles.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "projectiles.h"
+#include "collisionWorld.h"
+#include "compoundCollider.h"
+#include "spatialGrid.h"
+
+#ifdef AABB_USE_AVX
+#include <immintrin.h>
+#elif defined(AABB_USE_SSE)
+#include <emmintrin.h>
+#endif
+
+#define PROJECTILE_PAD 8
+
+CProjectilePool::CProjectilePool(void)
+{
+	m_model.gravity = 0;
+	m_model.decreaseRate = 1;
+	m_model.moveScale = 1;
+	m_model.groundHeight = 0;
+	m_model.expand = 0;
+	m_count = 0;
+	m_capacity = 0;
+#if defined(AABB_USE_AVX)
+	m_path = PATH_AVX;
+#elif defined(AABB_USE_SSE)
+	m_path = PATH_SSE;
+#else
+	m_path = PATH_SCALAR;
+#endif
+}
+
+void CProjectilePool::init(int capacity, const ProjectileModel& model)
+{
+	m_model = model;
+	m_capacity = capacity;
+	m_count = 0;
+
+	// the kernels also run over the padding lanes, which just hold zeros
+	int padded = (capacity + PROJECTILE_PAD - 1) / PROJECTILE_PAD * PROJECTILE_PAD;
+	m_x.assign(padded, 0.0f); m_y.assign(padded, 0.0f); m_z.assign(padded, 0.0f);
+	m_vx.assign(padded, 0.0f); m_vy.assign(padded, 0.0f); m_vz.assign(padded, 0.0f);
+	m_lx.assign(padded, 0.0f); m_ly.assign(padded, 0.0f); m_lz.assign(padded, 0.0f);
+	m_tag.assign(padded, 0);
+	m_results.resize(padded);
+}
+
+int CProjectilePool::spawn(float x, float y, float z, float vx, float vy, float vz, int tag)
+{
+	if (m_count >= m_capacity)
+		return -1;
+	int i = m_count++;
+	m_x[i] = m_lx[i] = x;
+	m_y[i] = m_ly[i] = y;
+	m_z[i] = m_lz[i] = z;
+	m_vx[i] = vx;
+	m_vy[i] = vy;
+	m_vz[i] = vz;
+	m_tag[i] = tag;
+	return i;
+}
+
+void CProjectilePool::kill(int i)
+{
+	if (i < 0 || i >= m_count)
+		return;
+	// the last shell takes the hole, so the live range stays dense
+	int last = --m_count;
+	m_x[i] = m_x[last]; m_y[i] = m_y[last]; m_z[i] = m_z[last];
+	m_vx[i] = m_vx[last]; m_vy[i] = m_vy[last]; m_vz[i] = m_vz[last];
+	m_lx[i] = m_lx[last]; m_ly[i] = m_ly[last]; m_lz[i] = m_lz[last];
+	m_tag[i] = m_tag[last];
+}
+
+int CProjectilePool::find(int tag) const
+{
+	for (int i = 0; i < m_count; i++) {
+		if (m_tag[i] == tag)
+			return i;
+	}
+	return -1;
+}
+
+void CProjectilePool::integrate(float timeDelta)
+{
+	// same steps as CSphere::ballUpdate
+	float k = m_model.moveScale * timeDelta;
+	float rate = 1 - (1 - m_model.decreaseRate) * timeDelta * 400;
+	if (rate < 0)
+		rate = 0;
+	float fall = m_model.gravity * timeDelta;
+
+	switch (m_path) {
+#ifdef AABB_USE_AVX
+	case PATH_AVX: integrateAVX(k, rate, fall); break;
+#endif
+#ifdef AABB_USE_SSE
+	case PATH_SSE: integrateSSE(k, rate, fall); break;
+#endif
+	default: integrateScalar(k, rate, fall); break;
+	}
+}
+
+void CProjectilePool::integrateScalar(float k, float rate, float fall)
+{
+	float ground = m_model.groundHeight;
+	for (int i = 0; i < m_count; i++) {
+		m_lx[i] = m_x[i];
+		m_ly[i] = m_y[i];
+		m_lz[i] = m_z[i];
+		m_x[i] = m_x[i] + k * m_vx[i];
+		m_y[i] = m_y[i] + k * m_vy[i];
+		m_z[i] = m_z[i] + k * m_vz[i];
+		if (m_y[i] < ground)
+			m_y[i] = ground;
+		m_vx[i] = m_vx[i] * rate;
+		m_vy[i] = m_vy[i] - fall;
+		m_vz[i] = m_vz[i] * rate;
+	}
+}
+
+#ifdef AABB_USE_SSE
+void CProjectilePool::integrateSSE(float k, float rate, float fall)
+{
+	__m128 vk = _mm_set1_ps(k), vrate = _mm_set1_ps(rate), vfall = _mm_set1_ps(fall);
+	__m128 ground = _mm_set1_ps(m_model.groundHeight);
+	for (int i = 0; i < m_count; i += 4) {
+		__m128 x = _mm_loadu_ps(&m_x[i]), y = _mm_loadu_ps(&m_y[i]), z = _mm_loadu_ps(&m_z[i]);
+		__m128 vx = _mm_loadu_ps(&m_vx[i]), vy = _mm_loadu_ps(&m_vy[i]), vz = _mm_loadu_ps(&m_vz[i]);
+		_mm_storeu_ps(&m_lx[i], x);
+		_mm_storeu_ps(&m_ly[i], y);
+		_mm_storeu_ps(&m_lz[i], z);
+		_mm_storeu_ps(&m_x[i], _mm_add_ps(x, _mm_mul_ps(vk, vx)));
+		_mm_storeu_ps(&m_y[i], _mm_max_ps(_mm_add_ps(y, _mm_mul_ps(vk, vy)), ground));
+		_mm_storeu_ps(&m_z[i], _mm_add_ps(z, _mm_mul_ps(vk, vz)));
+		_mm_storeu_ps(&m_vx[i], _mm_mul_ps(vx, vrate));
+		_mm_storeu_ps(&m_vy[i], _mm_sub_ps(vy, vfall));
+		_mm_storeu_ps(&m_vz[i], _mm_mul_ps(vz, vrate));
+	}
+}
+#endif
+
+#ifdef AABB_USE_AVX
+void CProjectilePool::integrateAVX(float k, float rate, float fall)
+{
+	__m256 vk = _mm256_set1_ps(k), vrate = _mm256_set1_ps(rate), vfall = _mm256_set1_ps(fall);
+	__m256 ground = _mm256_set1_ps(m_model.groundHeight);
+	for (int i = 0; i < m_count; i += 8) {
+		__m256 x = _mm256_loadu_ps(&m_x[i]), y = _mm256_loadu_ps(&m_y[i]), z = _mm256_loadu_ps(&m_z[i]);
+		__m256 vx = _mm256_loadu_ps(&m_vx[i]), vy = _mm256_loadu_ps(&m_vy[i]), vz = _mm256_loadu_ps(&m_vz[i]);
+		_mm256_storeu_ps(&m_lx[i], x);
+		_mm256_storeu_ps(&m_ly[i], y);
+		_mm256_storeu_ps(&m_lz[i], z);
+		_mm256_storeu_ps(&m_x[i], _mm256_add_ps(x, _mm256_mul_ps(vk, vx)));
+		_mm256_storeu_ps(&m_y[i], _mm256_max_ps(_mm256_add_ps(y, _mm256_mul_ps(vk, vy)), ground));
+		_mm256_storeu_ps(&m_z[i], _mm256_add_ps(z, _mm256_mul_ps(vk, vz)));
+		_mm256_storeu_ps(&m_vx[i], _mm256_mul_ps(vx, vrate));
+		_mm256_storeu_ps(&m_vy[i], _mm256_sub_ps(vy, vfall));
+		_mm256_storeu_ps(&m_vz[i], _mm256_mul_ps(vz, vrate));
+	}
+}
+#endif
+
+int CProjectilePool::collide(const CCollisionWorld& world, const CSpatialGrid& obstacleGrid, const CAabbStore& obstacles,
+	const CCompoundCollider* target, std::vector<ProjectileHit>& hits)
+{
+	if (m_count == 0)
+		return 0;
+	ProjectileArena arena;
+	prepareSweep(world, obstacleGrid, obstacles, target, arena);
+	sweep(0, m_count, arena, &m_results[0], m_scratch);
+	return applyHits(&m_results[0], hits);
+}
+
+void CProjectilePool::prepareSweep(const CCollisionWorld& world, const CSpatialGrid& obstacleGrid, const CAabbStore& obstacles,
+	const CCompoundCollider* target, ProjectileArena& arena) const
+{
+	float e = m_model.expand;
+	arena.world = &world;
+	arena.obstacleGrid = &obstacleGrid;
+	arena.obstacles = &obstacles;
+	arena.target = target;
+
+	// most of a flight is spent above everything there is to hit; those
+	// shells only need the ground check
+	float bmin[3], bmax[3];
+	arena.wallTop = world.getBounds(CCollisionWorld::KIND_WALL, bmin, bmax) ? bmax[1] + e : -1e30f;
+	arena.obstacleTop = obstacles.getBounds(bmin, bmax) ? bmax[1] + e : -1e30f;
+	arena.targetTop = (target != NULL && target->getBounds(CCompoundCollider::GROUP_ALL, bmin, bmax)) ? bmax[1] + e : -1e30f;
+}
+
+void CProjectilePool::sweep(int begin, int end, const ProjectileArena& arena, ProjectileHit* results,
+	ProjectileSweepScratch& scratch) const
+{
+	float e = m_model.expand;
+	const CCollisionWorld& world = *arena.world;
+	const CAabbStore& obstacles = *arena.obstacles;
+	const CCompoundCollider* target = arena.target;
+
+	for (int i = begin; i < end; i++) {
+		float p0[3] = { m_lx[i], m_ly[i], m_lz[i] };
+		float d[3] = { m_x[i] - m_lx[i], m_y[i] - m_ly[i], m_z[i] - m_lz[i] };
+		float tHit = 2.0f, t;
+		int kind = -1, index = -1;
+		float low = m_y[i] < m_ly[i] ? m_y[i] : m_ly[i];
+
+		if (low <= arena.wallTop) {
+			int w = world.sweepSegment(p0, d, e, CCollisionWorld::KIND_WALL, t);
+			if (w >= 0 && t < tHit) {
+				tHit = t;
+				kind = HIT_WALL;
+				index = w;
+			}
+		}
+
+		if (low <= arena.obstacleTop) {
+			float minX = (d[0] < 0 ? p0[0] + d[0] : p0[0]) - e, maxX = (d[0] < 0 ? p0[0] : p0[0] + d[0]) + e;
+			float minZ = (d[2] < 0 ? p0[2] + d[2] : p0[2]) - e, maxZ = (d[2] < 0 ? p0[2] : p0[2] + d[2]) + e;
+			std::vector<int>& candidates = scratch.candidates;
+			candidates.clear();
+			arena.obstacleGrid->query(minX, minZ, maxX, maxZ, candidates, scratch.marks);
+			for (size_t c = 0; c < candidates.size(); c++) {
+				if (obstacles.sweepsBox(candidates[c], p0, d, e, t) && t < tHit) {
+					tHit = t;
+					kind = HIT_OBSTACLE;
+					index = candidates[c];
+				}
+			}
+		}
+
+		if (target != NULL && low <= arena.targetTop) {
+			int b = target->sweepSegment(p0, d, e, CCompoundCollider::GROUP_ALL, t);
+			if (b >= 0 && t < tHit) {
+				tHit = t;
+				kind = HIT_TARGET;
+				index = b;
+			}
+		}
+
+		ProjectileHit& hit = results[i];
+		if (kind >= 0) {
+			// a hair past the entry point so overlap tests agree with the sweep
+			tHit += 0.001f;
+			if (tHit > 1.0f) tHit = 1.0f;
+			hit.x = p0[0] + d[0] * tHit;
+			hit.y = p0[1] + d[1] * tHit;
+			hit.z = p0[2] + d[2] * tHit;
+		}
+		else if (m_y[i] <= m_model.groundHeight) {
+			kind = HIT_GROUND;
+			hit.x = m_x[i];
+			hit.y = m_y[i];
+			hit.z = m_z[i];
+		}
+		hit.kind = kind;
+		hit.index = index;
+		hit.tag = m_tag[i];
+	}
+}
+
+int CProjectilePool::applyHits(const ProjectileHit* results, std::vector<ProjectileHit>& hits)
+{
+	int found = 0;
+	// backwards, so kill() only ever moves an already checked shell into i
+	for (int i = m_count - 1; i >= 0; i--) {
+		if (results[i].kind < 0)
+			continue;
+		hits.push_back(results[i]);
+		found++;
+		kill(i);
+	}
+	return found;
+}
+
+void CProjectilePool::setPath(Path path)
+{
+	if (isPathSupported(path))
+		m_path = path;
+}
+
+bool CProjectilePool::isPathSupported(Path path)
+{
+	switch (path) {
+	case PATH_SCALAR: return true;
+#ifdef AABB_USE_SSE
+	case PATH_SSE: return true;
+#endif
+#ifdef AABB_USE_AVX
+	case PATH_AVX: return true;
+#endif
+	default: return false;
+	}
+}
+
+const char* CProjectilePool::getPathName(Path path)
+{
+	switch (path) {
+	case PATH_SSE: return "sse";
+	case PATH_AVX: return "avx";
+	default: return "scalar";
+	}
+}
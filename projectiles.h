@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: projectiles.h
+//
+// Desc: Fixed capacity pool of missiles in structure-of-arrays form. One
+//       integrate() call moves every live shell with the same gravity and
+//       decay as CSphere::ballUpdate (SSE/AVX when compiled in), and
+//       collide() sweeps each shell's last tick against the arena and reports
+//       what it hit, so the game decides what every hit means.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __projectilesH__
+#define __projectilesH__
+
+#include "aabbStore.h"
+#include "spatialGrid.h"
+#include <vector>
+
+class CCollisionWorld;
+class CCompoundCollider;
+
+struct ProjectileModel {
+	float gravity;			// MISSILE_GRAVITY_RATE
+	float decreaseRate;		// MISSILE_DECREASE_RATE
+	float moveScale;		// TIME_SCALE used by CSphere::ballUpdate
+	float groundHeight;		// shells never go below this and die on reaching it
+	float expand;			// collision margin added to every box
+};
+
+struct ProjectileHit {
+	int kind;				// CProjectilePool::HitKind
+	int index;				// box index in the structure that was hit (-1 for ground)
+	int tag;				// tag given to spawn()
+	float x, y, z;			// where the shell stopped
+};
+
+// what CProjectilePool::sweep() tests shells against: the arena, and the
+// heights above which a shell cannot hit a kind of thing (so it skips it)
+struct ProjectileArena {
+	const CCollisionWorld*		world;
+	const CSpatialGrid*			obstacleGrid;
+	const CAabbStore*			obstacles;
+	const CCompoundCollider*	target;		// NULL = none
+	float						wallTop, obstacleTop, targetTop;
+};
+
+// what one caller of CProjectilePool::sweep() reuses from call to call
+struct ProjectileSweepScratch {
+	std::vector<int>	candidates;
+	GridQueryMarks		marks;
+};
+
+class CProjectilePool {
+public:
+	enum Path { PATH_SCALAR, PATH_SSE, PATH_AVX };
+	enum HitKind { HIT_GROUND, HIT_WALL, HIT_OBSTACLE, HIT_TARGET };
+
+	CProjectilePool(void);
+	~CProjectilePool(void) {}
+
+public:
+	void init(int capacity, const ProjectileModel& model);
+	void clear(void) { m_count = 0; }
+
+	// returns the index of the new shell, -1 when the pool is full.
+	// indices change when shells die, the tag stays with the shell
+	int spawn(float x, float y, float z, float vx, float vy, float vz, int tag);
+	void kill(int i);
+	// index of the shell with this tag, -1 if it is gone
+	int find(int tag) const;
+
+	int size(void) const { return m_count; }
+	int capacity(void) const { return m_capacity; }
+	float getX(int i) const { return m_x[i]; }
+	float getY(int i) const { return m_y[i]; }
+	float getZ(int i) const { return m_z[i]; }
+	// position before the last integrate(), for sweeps and render interpolation
+	float getLastX(int i) const { return m_lx[i]; }
+	float getLastY(int i) const { return m_ly[i]; }
+	float getLastZ(int i) const { return m_lz[i]; }
+	int getTag(int i) const { return m_tag[i]; }
+
+	// one tick for every live shell
+	void integrate(float timeDelta);
+
+	// sweeps every shell from its last to its current position against the
+	// walls of world, the obstacles (grid candidates tested against the
+	// boxes) and the children of the optional target. A shell that hits something, or the
+	// ground, stops at the hit point, is reported in hits and removed.
+	// Returns the number of hits appended
+	int collide(const CCollisionWorld& world, const CSpatialGrid& obstacleGrid, const CAabbStore& obstacles,
+		const CCompoundCollider* target, std::vector<ProjectileHit>& hits);
+
+	// collide() in steps, so ranges of shells can be swept on several
+	// threads: prepareSweep() once per tick, then sweep() writes what shell
+	// i of [begin, end) hits into results[i] (kind -1: nothing) and changes
+	// nothing, and applyHits() removes the shells that hit and appends them
+	// to hits in collide()'s order. results has one entry per live shell
+	void prepareSweep(const CCollisionWorld& world, const CSpatialGrid& obstacleGrid, const CAabbStore& obstacles,
+		const CCompoundCollider* target, ProjectileArena& arena) const;
+	void sweep(int begin, int end, const ProjectileArena& arena, ProjectileHit* results,
+		ProjectileSweepScratch& scratch) const;
+	int applyHits(const ProjectileHit* results, std::vector<ProjectileHit>& hits);
+
+	void setPath(Path path);
+	Path getPath(void) const { return m_path; }
+	static bool isPathSupported(Path path);
+	static const char* getPathName(Path path);
+
+private:
+	void integrateScalar(float k, float rate, float fall);
+#ifdef AABB_USE_SSE
+	void integrateSSE(float k, float rate, float fall);
+#endif
+#ifdef AABB_USE_AVX
+	void integrateAVX(float k, float rate, float fall);
+#endif
+
+	ProjectileModel			m_model;
+	Path					m_path;
+	int						m_count;
+	int						m_capacity;
+
+	// live shells are [0, m_count); arrays are padded to a multiple of 8
+	std::vector<float>		m_x, m_y, m_z;
+	std::vector<float>		m_vx, m_vy, m_vz;
+	std::vector<float>		m_lx, m_ly, m_lz;
+	std::vector<int>		m_tag;
+
+	std::vector<ProjectileHit>	m_results;
+	ProjectileSweepScratch		m_scratch;
+};
+
+#endif // __projectilesH__
@@ -0,0 +1,198 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: renderQueue.cpp
+//
+// Desc: Sorted render command queue and the recording backend (see renderQueue.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "renderQueue.h"
+#include <algorithm>
+#include <cstring>
+
+CRenderQueue::CRenderQueue(void)
+{
+	m_lastMaterial = -1;
+	m_meshCount = 0;
+	m_frame = 1;
+	m_lastMesh = NULL;
+	m_lastMeshIndex = -1;
+	m_eye[0] = m_eye[1] = m_eye[2] = 0;
+	m_sort = true;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void CRenderQueue::begin(float eyeX, float eyeY, float eyeZ)
+{
+	m_commands.clear();
+	m_meshCount = 0;
+	m_frame++;
+	m_lastMesh = NULL;
+	m_eye[0] = eyeX;
+	m_eye[1] = eyeY;
+	m_eye[2] = eyeZ;
+}
+
+int CRenderQueue::internMaterial(const RenderMaterial& material)
+{
+	// a handful of colors for the whole scene, so a scan is enough
+	if (m_lastMaterial >= 0 && memcmp(&m_materials[m_lastMaterial], &material, sizeof(material)) == 0)
+		return m_lastMaterial;
+	for (size_t i = 0; i < m_materials.size(); i++) {
+		if (memcmp(&m_materials[i], &material, sizeof(material)) == 0) {
+			m_lastMaterial = (int)i;
+			return m_lastMaterial;
+		}
+	}
+	m_materials.push_back(material);
+	m_lastMaterial = (int)m_materials.size() - 1;
+	return m_lastMaterial;
+}
+
+static size_t hashPointer(const void* p)
+{
+	size_t h = (size_t)p;
+	return (h >> 4) ^ (h >> 12) ^ (h >> 20);
+}
+
+int CRenderQueue::internMesh(const void* mesh)
+{
+	if (mesh == m_lastMesh)
+		return m_lastMeshIndex;
+	if ((m_meshCount + 1) * 2 > (int)m_meshSlots.size())
+		growMeshSlots();
+	size_t mask = m_meshSlots.size() - 1;
+	size_t h = hashPointer(mesh) & mask;
+	while (m_meshSlots[h].frame == m_frame && m_meshSlots[h].mesh != mesh)
+		h = (h + 1) & mask;
+	MeshSlot& slot = m_meshSlots[h];
+	if (slot.frame != m_frame) {
+		slot.mesh = mesh;
+		slot.index = m_meshCount++;
+		slot.frame = m_frame;
+	}
+	m_lastMesh = mesh;
+	m_lastMeshIndex = slot.index;
+	return slot.index;
+}
+
+void CRenderQueue::growMeshSlots(void)
+{
+	std::vector<MeshSlot> old;
+	old.swap(m_meshSlots);
+	MeshSlot empty = { NULL, -1, 0 };
+	m_meshSlots.assign(old.empty() ? 64 : old.size() * 2, empty);
+	size_t mask = m_meshSlots.size() - 1;
+	for (size_t i = 0; i < old.size(); i++) {
+		if (old[i].frame != m_frame)
+			continue;
+		size_t h = hashPointer(old[i].mesh) & mask;
+		while (m_meshSlots[h].frame == m_frame)
+			h = (h + 1) & mask;
+		m_meshSlots[h] = old[i];
+	}
+}
+
+void CRenderQueue::submit(const void* mesh, int subset, const RenderMaterial& material, const float world[16])
+{
+	if (mesh == NULL)
+		return;
+	Command c;
+	c.mesh = mesh;
+	c.meshIndex = internMesh(mesh);
+	c.subset = subset;
+	c.material = internMaterial(material);
+	float dx = world[12] - m_eye[0], dy = world[13] - m_eye[1], dz = world[14] - m_eye[2];
+	c.depth = dx * dx + dy * dy + dz * dz;
+	memcpy(c.world, world, sizeof(c.world));
+	m_commands.push_back(c);
+}
+
+bool CRenderQueue::CommandLess::operator()(int a, int b) const
+{
+	const Command& ca = (*commands)[a];
+	const Command& cb = (*commands)[b];
+	// material first: DrawSubset binds its mesh's buffers on every call
+	// anyway, while a material set is only needed when the value changes
+	if (ca.material != cb.material)
+		return ca.material < cb.material;
+	if (ca.meshIndex != cb.meshIndex)
+		return ca.meshIndex < cb.meshIndex;
+	if (ca.subset != cb.subset)
+		return ca.subset < cb.subset;
+	return ca.depth < cb.depth;
+}
+
+void CRenderQueue::flush(CRenderBackend& backend)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_stats.commands = (int)m_commands.size();
+
+	m_order.resize(m_commands.size());
+	for (size_t i = 0; i < m_order.size(); i++)
+		m_order[i] = (int)i;
+	if (m_sort) {
+		CommandLess less = { &m_commands };
+		std::sort(m_order.begin(), m_order.end(), less);
+	}
+
+	const void* mesh = NULL;
+	int material = -1;
+	const float* world = NULL;
+	for (size_t k = 0; k < m_order.size(); k++) {
+		const Command& c = m_commands[m_order[k]];
+		if (c.material != material) {
+			backend.setMaterial(m_materials[c.material]);
+			material = c.material;
+			m_stats.materialChanges++;
+		}
+		else
+			m_stats.skippedChanges++;
+		if (world == NULL || memcmp(world, c.world, sizeof(c.world)) != 0) {
+			backend.setTransform(c.world);
+			world = c.world;
+			m_stats.transformChanges++;
+		}
+		else
+			m_stats.skippedChanges++;
+		if (c.mesh != mesh) {
+			mesh = c.mesh;
+			m_stats.meshChanges++;
+		}
+		backend.drawMesh(c.mesh, c.subset);
+		m_stats.drawCalls++;
+	}
+	m_commands.clear();
+}
+
+void CRecordingBackend::clear(void)
+{
+	m_ops.clear();
+	m_draws = m_materials = m_transforms = m_materialChanges = 0;
+	m_hasMaterial = false;
+}
+
+void CRecordingBackend::setMaterial(const RenderMaterial& material)
+{
+	Op op = { OP_MATERIAL, NULL, 0 };
+	m_ops.push_back(op);
+	m_materials++;
+	if (!m_hasMaterial || memcmp(&m_current, &material, sizeof(material)) != 0)
+		m_materialChanges++;
+	m_current = material;
+	m_hasMaterial = true;
+}
+
+void CRecordingBackend::setTransform(const float[16])
+{
+	Op op = { OP_TRANSFORM, NULL, 0 };
+	m_ops.push_back(op);
+	m_transforms++;
+}
+
+void CRecordingBackend::drawMesh(const void* mesh, int subset)
+{
+	Op op = { OP_DRAW, mesh, subset };
+	m_ops.push_back(op);
+	m_draws++;
+}
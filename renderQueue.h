@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: renderQueue.h
+//
+// Desc: Render command queue. Objects submit a mesh, a material and a world
+//       matrix instead of drawing; flush() sorts the commands by material,
+//       then mesh, then front to back, and sends them to a backend without
+//       the state changes that would repeat the current state. Meshes are
+//       ordered by when the frame first submitted them, not by address, so
+//       the same submissions always draw in the same order.
+//       CRecordingBackend keeps the calls in memory, so the queue runs
+//       without a device (benchmarks, headless checks).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __renderQueueH__
+#define __renderQueueH__
+
+#include <vector>
+
+// same layout as D3DMATERIAL9 (diffuse, ambient, specular, emissive, power)
+struct RenderMaterial {
+	float diffuse[4];
+	float ambient[4];
+	float specular[4];
+	float emissive[4];
+	float power;
+};
+
+struct RenderQueueStats {
+	int commands;
+	int drawCalls;
+	int meshChanges;
+	int materialChanges;
+	int transformChanges;
+	int skippedChanges;		// state changes dropped because nothing changed
+};
+
+class CRenderBackend {
+public:
+	virtual ~CRenderBackend(void) {}
+	virtual void setMaterial(const RenderMaterial& material) = 0;
+	virtual void setTransform(const float world[16]) = 0;
+	// mesh is whatever the backend draws with (ID3DXMesh* for D3D)
+	virtual void drawMesh(const void* mesh, int subset) = 0;
+};
+
+class CRenderQueue {
+public:
+	CRenderQueue(void);
+	~CRenderQueue(void) {}
+
+public:
+	// drops every command; depth is measured from the eye
+	void begin(float eyeX, float eyeY, float eyeZ);
+	// world is row major (D3DXMATRIX), its translation row places the command
+	void submit(const void* mesh, int subset, const RenderMaterial& material, const float world[16]);
+	// sends the commands (sorted unless sorting is off) and fills the stats
+	void flush(CRenderBackend& backend);
+
+	void setSorting(bool sort) { m_sort = sort; }
+	int size(void) const { return (int)m_commands.size(); }
+	int getMaterialCount(void) const { return (int)m_materials.size(); }
+	const RenderQueueStats& getStats(void) const { return m_stats; }
+
+private:
+	struct Command {
+		const void* mesh;
+		int meshIndex;	// order of first submission this frame
+		int subset;
+		int material;	// index into m_materials
+		float depth;	// squared distance to the eye
+		float world[16];
+	};
+	struct CommandLess {
+		const std::vector<Command>* commands;
+		bool operator()(int a, int b) const;
+	};
+
+	// a mesh seen this frame (open addressing on the pointer; a slot
+	// stamped with an earlier frame is free)
+	struct MeshSlot {
+		const void*	mesh;
+		int			index;
+		unsigned	frame;
+	};
+
+	int internMaterial(const RenderMaterial& material);
+	int internMesh(const void* mesh);
+	void growMeshSlots(void);
+
+	std::vector<Command>		m_commands;
+	std::vector<int>			m_order;
+	std::vector<RenderMaterial>	m_materials;	// distinct materials seen so far
+	int							m_lastMaterial;	// last interned, most submits repeat it
+	std::vector<MeshSlot>		m_meshSlots;	// power of two, at most half used
+	int							m_meshCount;	// meshes seen this frame
+	unsigned					m_frame;		// begin() count, stamps m_meshSlots
+	const void*					m_lastMesh;		// last interned and its index
+	int							m_lastMeshIndex;
+	float						m_eye[3];
+	bool						m_sort;
+	RenderQueueStats			m_stats;
+};
+
+// keeps every call; counts what a device would have been asked to do
+class CRecordingBackend : public CRenderBackend {
+public:
+	enum OpType { OP_MATERIAL, OP_TRANSFORM, OP_DRAW };
+	struct Op {
+		OpType type;
+		const void* mesh;	// OP_DRAW only
+		int subset;
+	};
+
+	CRecordingBackend(void) { clear(); }
+
+	void clear(void);
+	void setMaterial(const RenderMaterial& material);
+	void setTransform(const float world[16]);
+	void drawMesh(const void* mesh, int subset);
+
+	const std::vector<Op>& getOps(void) const { return m_ops; }
+	int getDrawCalls(void) const { return m_draws; }
+	int getMaterialSets(void) const { return m_materials; }
+	int getTransformSets(void) const { return m_transforms; }
+	// times the device state really changed (a set with equal values excluded)
+	int getMaterialChanges(void) const { return m_materialChanges; }
+
+private:
+	std::vector<Op>		m_ops;
+	int					m_draws, m_materials, m_transforms, m_materialChanges;
+	RenderMaterial		m_current;
+	bool				m_hasMaterial;
+};
+
+#endif // __renderQueueH__
@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: simMath.h
+//
+// Desc: Vector and matrix types of the simulation core. They have the same
+//       layout as D3DXVECTOR3 / D3DXMATRIX (row vectors, row major,
+//       translation in the last row), so the game can hand them to D3D
+//       as they are, but nothing here needs a D3D header.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __simMathH__
+#define __simMathH__
+
+#include <cmath>
+
+struct SimVec3 {
+	float x, y, z;
+
+	SimVec3(void) : x(0), y(0), z(0) {}
+	SimVec3(float ix, float iy, float iz) : x(ix), y(iy), z(iz) {}
+
+	float operator[](int i) const { return (&x)[i]; }
+	float& operator[](int i) { return (&x)[i]; }
+
+	SimVec3 operator+(const SimVec3& v) const { return SimVec3(x + v.x, y + v.y, z + v.z); }
+	SimVec3 operator-(const SimVec3& v) const { return SimVec3(x - v.x, y - v.y, z - v.z); }
+	SimVec3 operator*(float s) const { return SimVec3(x * s, y * s, z * s); }
+	SimVec3& operator+=(const SimVec3& v) { x += v.x; y += v.y; z += v.z; return *this; }
+	SimVec3& operator-=(const SimVec3& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+	bool operator==(const SimVec3& v) const { return x == v.x && y == v.y && z == v.z; }
+	bool operator!=(const SimVec3& v) const { return !(*this == v); }
+};
+
+inline float simDot(const SimVec3& a, const SimVec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline float simLength(const SimVec3& v) { return sqrtf(simDot(v, v)); }
+// distance on the ground (y ignored)
+inline float simDistanceXZ(const SimVec3& a, const SimVec3& b)
+{
+	float dx = a.x - b.x, dz = a.z - b.z;
+	return sqrtf(dx * dx + dz * dz);
+}
+
+struct SimMat4 {
+	float m[4][4];
+
+	static SimMat4 identity(void)
+	{
+		SimMat4 r;
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				r.m[i][j] = (i == j) ? 1.0f : 0.0f;
+		return r;
+	}
+	static SimMat4 translation(float x, float y, float z)
+	{
+		SimMat4 r = identity();
+		r.m[3][0] = x;
+		r.m[3][1] = y;
+		r.m[3][2] = z;
+		return r;
+	}
+
+	// this first, then b (D3DX order)
+	SimMat4 operator*(const SimMat4& b) const
+	{
+		SimMat4 r;
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				r.m[i][j] = m[i][0] * b.m[0][j] + m[i][1] * b.m[1][j] + m[i][2] * b.m[2][j] + m[i][3] * b.m[3][j];
+		return r;
+	}
+
+	SimVec3 transformPoint(const SimVec3& p) const
+	{
+		return SimVec3(p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + m[3][0],
+			p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + m[3][1],
+			p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + m[3][2]);
+	}
+
+	const float* data(void) const { return &m[0][0]; }
+};
+
+#endif // __simMathH__
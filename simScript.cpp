@@ -0,0 +1,284 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: simScript.cpp
+//
+// Desc: Command scripts, the scripted bot and the match runner
+//       (see simScript.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "simScript.h"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+#define BOT_MAX_DRIVE_TICKS 180		// longest drive at the start of a turn
+#define BOT_MAX_STRAFE_TICKS 60
+#define BOT_AIM_TICKS 900			// fires anyway after this long
+#define BOT_AIM_TOLERANCE 0.01f		// more than half an aim step per tick
+#define BOT_RANGE_ERROR 8.0f		// aimed range is off by up to this much
+#define BOT_MIN_DEGREE 10.0f
+#define BOT_MAX_DEGREE 50.0f
+
+static const char* const s_commandNames[SIM_COMMAND_COUNT] = {
+	"start", "fire",
+	"tank_forward", "tank_back", "tank_left", "tank_right", "tank_stop_x", "tank_stop_z",
+	"aim_left", "aim_right", "aim_forward", "aim_back", "aim_up", "aim_down",
+	"aim_stop_x", "aim_stop_y", "aim_stop_z",
+};
+
+// -----------------------------------------------------------------------------
+// CSimScript
+// -----------------------------------------------------------------------------
+
+void CSimScript::add(long long tick, SimCommand cmd)
+{
+	SimScriptEntry e = { tick, (int)cmd };
+	m_entries.push_back(e);
+}
+
+const char* CSimScript::getCommandName(SimCommand cmd)
+{
+	return (cmd >= 0 && cmd < SIM_COMMAND_COUNT) ? s_commandNames[cmd] : "?";
+}
+
+bool CSimScript::parseCommand(const char* name, SimCommand& cmd)
+{
+	for (int i = 0; i < SIM_COMMAND_COUNT; i++) {
+		if (strcmp(name, s_commandNames[i]) == 0) {
+			cmd = (SimCommand)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool CSimScript::load(const char* path)
+{
+	FILE* fp = fopen(path, "r");
+	if (fp == NULL)
+		return false;
+	m_entries.clear();
+	char line[256];
+	bool ok = true;
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		char* hash = strchr(line, '#');
+		if (hash != NULL)
+			*hash = 0;
+		long long tick;
+		char name[64];
+		int fields = sscanf(line, "%lld %63s", &tick, name);
+		if (fields <= 0)
+			continue;	// empty line
+		SimCommand cmd;
+		if (fields != 2 || !parseCommand(name, cmd)
+			|| (!m_entries.empty() && tick < m_entries.back().tick)) {
+			ok = false;
+			break;
+		}
+		add(tick, cmd);
+	}
+	fclose(fp);
+	return ok;
+}
+
+bool CSimScript::save(const char* path) const
+{
+	FILE* fp = fopen(path, "w");
+	if (fp == NULL)
+		return false;
+	fprintf(fp, "# tick command\n");
+	for (size_t i = 0; i < m_entries.size(); i++)
+		fprintf(fp, "%lld %s\n", m_entries[i].tick, getCommandName((SimCommand)m_entries[i].command));
+	return fclose(fp) == 0;
+}
+
+// -----------------------------------------------------------------------------
+// CSimBot
+// -----------------------------------------------------------------------------
+
+CSimBot::CSimBot(unsigned seed)
+{
+	m_state = seed ? seed : 1;
+	m_turn = -1;
+	m_phase = PHASE_WAIT;
+	m_phaseTicks = 0;
+	m_driveTicks = m_strafeTicks = 0;
+	m_strafe = SIM_CMD_TANK_LEFT;
+}
+
+// xorshift32, so a seed plays the same on every platform
+float CSimBot::random(void)
+{
+	m_state ^= m_state << 13;
+	m_state ^= m_state >> 17;
+	m_state ^= m_state << 5;
+	return (m_state >> 8) * (1.0f / 16777216.0f);
+}
+
+void CSimBot::beginTurn(const CTankSim& sim)
+{
+	m_turn = sim.getStats().turns;
+	m_phase = PHASE_DRIVE;
+	m_phaseTicks = 0;
+	m_driveTicks = random() < 0.3f ? 0 : (int)(random() * BOT_MAX_DRIVE_TICKS);
+	m_strafeTicks = random() < 0.5f ? 0 : (int)(random() * BOT_MAX_STRAFE_TICKS);
+	m_strafe = random() < 0.5f ? SIM_CMD_TANK_LEFT : SIM_CMD_TANK_RIGHT;
+}
+
+SimVec3 CSimBot::pickAim(const CTankSim& sim)
+{
+	const CSimTank& tank = sim.getTank();
+	SimVec3 head = tank.getHead();
+	SimVec3 enemy = sim.getOtherTank().getCenter();
+	float dx = enemy.x - head.x, dz = enemy.z - head.z;
+	float length = sqrtf(dx * dx + dz * dz);
+	float ux = dx / length, uz = dz / length;
+	float range = length + (random() * 2 - 1) * BOT_RANGE_ERROR;
+	float preferred = BOT_MIN_DEGREE + random() * (BOT_MAX_DEGREE - BOT_MIN_DEGREE);
+
+	// the target has to stay in its box around the tank: the ground distance
+	// along the shot direction is limited by both sides of it
+	float best = -1, bestGround = 0, bestDegree = preferred;
+	for (int pass = 0; pass < 2 && (best < 0 || best > 1.0f); pass++) {
+		for (float degree = (pass ? 5.0f : preferred); degree <= (pass ? 85.0f : preferred); degree += 5.0f) {
+			for (float ground = 0.5f; ground <= MAX_BLUEBALL_RADIUS; ground += 0.05f) {
+				float offX = head.x + ux * ground - tank.getCenter().x;
+				float offZ = fabsf(head.z + uz * ground - tank.getCenter().z);
+				if (fabsf(offX) > MAX_BLUEBALL_WIDTH - 0.05f || offZ < MIN_BLUEBALL_RADIUS + 0.05f || offZ > MAX_BLUEBALL_RADIUS - 0.05f)
+					continue;
+				float r, ticks;
+				sim.getFiringTable().lookup(degree, ground, r, ticks);
+				float error = fabsf(r - range);
+				if (best < 0 || error < best) {
+					best = error;
+					bestGround = ground;
+					bestDegree = degree;
+				}
+			}
+		}
+	}
+	if (best < 0)
+		return sim.getTarget().getCenter();	// nowhere to go, fire as it is
+	float height = bestGround * tanf(bestDegree * (float)PI / 180);
+	return SimVec3(head.x + ux * bestGround, head.y + height, head.z + uz * bestGround);
+}
+
+bool CSimBot::steerAxis(float error, float velocity, SimCommand minus, SimCommand plus, SimCommand stop, std::vector<SimCommand>& out)
+{
+	if (fabsf(error) <= BOT_AIM_TOLERANCE) {
+		if (velocity != 0)
+			out.push_back(stop);
+		return false;
+	}
+	float sign = error > 0 ? 1.0f : -1.0f;
+	if (velocity * sign <= 0)
+		out.push_back(error > 0 ? plus : minus);
+	return true;
+}
+
+void CSimBot::think(const CTankSim& sim, std::vector<SimCommand>& out)
+{
+	if (!sim.isStarted()) {
+		out.push_back(SIM_CMD_START);
+		return;
+	}
+	if (sim.isFinished())
+		return;
+	if (sim.getStats().turns != m_turn)
+		beginTurn(sim);
+	if (sim.isFiring())
+		return;
+
+	switch (m_phase) {
+	case PHASE_DRIVE:
+	{
+		if (m_phaseTicks == 0) {
+			if (m_driveTicks > 0)
+				out.push_back(SIM_CMD_TANK_FORWARD);
+			if (m_strafeTicks > 0)
+				out.push_back(m_strafe);
+		}
+		if (m_phaseTicks == m_strafeTicks)
+			out.push_back(SIM_CMD_TANK_STOP_X);
+		if (m_phaseTicks == m_driveTicks)
+			out.push_back(SIM_CMD_TANK_STOP_Z);
+		if (m_phaseTicks >= std::max(m_driveTicks, m_strafeTicks)) {
+			m_phase = PHASE_AIM;
+			m_phaseTicks = 0;
+			return;
+		}
+		m_phaseTicks++;
+		break;
+	}
+	case PHASE_AIM:
+	{
+		if (m_phaseTicks == 0)
+			m_aim = pickAim(sim);
+		// the player's own right and forward (player 1 looks down -z)
+		float side = sim.isOriginTank() ? 1.0f : -1.0f;
+		SimVec3 c = sim.getTarget().getCenter();
+		SimVec3 v = sim.getTarget().getVelocity();
+		bool moving = false;
+		moving |= steerAxis((m_aim.x - c.x) * side, v.x * side, SIM_CMD_AIM_LEFT, SIM_CMD_AIM_RIGHT, SIM_CMD_AIM_STOP_X, out);
+		moving |= steerAxis(m_aim.y - c.y, v.y, SIM_CMD_AIM_DOWN, SIM_CMD_AIM_UP, SIM_CMD_AIM_STOP_Y, out);
+		moving |= steerAxis((m_aim.z - c.z) * side, v.z * side, SIM_CMD_AIM_BACK, SIM_CMD_AIM_FORWARD, SIM_CMD_AIM_STOP_Z, out);
+		if (!moving || ++m_phaseTicks > BOT_AIM_TICKS) {
+			out.push_back(SIM_CMD_AIM_STOP_X);
+			out.push_back(SIM_CMD_AIM_STOP_Y);
+			out.push_back(SIM_CMD_AIM_STOP_Z);
+			out.push_back(SIM_CMD_FIRE);
+			m_phase = PHASE_WAIT;
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// runSimMatch
+// -----------------------------------------------------------------------------
+
+void runSimMatch(CTankSim& sim, const CSimScript* script, CSimBot* bot, CSimScript* record,
+	long long maxTicks, SimMatchResult& result)
+{
+	static std::vector<SimCommand> commands;
+	sim.reset();
+	if (bot != NULL)
+		bot->reset();
+	if (record != NULL)
+		record->clear();
+
+	int next = 0;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	while (!sim.isFinished() && sim.getStats().ticks < maxTicks) {
+		long long tick = sim.getStats().ticks;
+		if (script != NULL) {
+			while (next < script->size() && script->at(next).tick <= tick)
+				sim.command((SimCommand)script->at(next++).command);
+		}
+		else if (bot != NULL) {
+			commands.clear();
+			bot->think(sim, commands);
+			for (size_t k = 0; k < commands.size(); k++) {
+				sim.command(commands[k]);
+				if (record != NULL)
+					record->add(tick, commands[k]);
+			}
+		}
+		sim.tick(SIM_TICK_DELTA);
+	}
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+
+	const SimStats& stats = sim.getStats();
+	result.winner = sim.isFinished() ? sim.getTank().getPlayer() : -1;
+	result.ticks = stats.ticks;
+	result.turns = stats.turns;
+	result.shots = stats.shots;
+	result.obstaclesDestroyed = stats.obstaclesDestroyed;
+	result.ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: simScript.h
+//
+// Desc: Scripted input for CTankSim. A CSimScript is a list of commands,
+//       each tagged with the match tick it is given before; it reads and
+//       writes a plain text file ("<tick> <command>" per line, '#' starts a
+//       comment). CSimBot plays both sides from the state alone: it drives a
+//       little, steers the aim target to a spot picked from the firing table
+//       and fires. runSimMatch() plays one match from either of them.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __simScriptH__
+#define __simScriptH__
+
+#include "tankSim.h"
+#include <vector>
+
+struct SimScriptEntry {
+	long long tick;		// ticks run before the command is given
+	int command;		// SimCommand
+};
+
+class CSimScript {
+public:
+	CSimScript(void) {}
+	~CSimScript(void) {}
+
+public:
+	void clear(void) { m_entries.clear(); }
+	// entries must be added in tick order
+	void add(long long tick, SimCommand cmd);
+	int size(void) const { return (int)m_entries.size(); }
+	const SimScriptEntry& at(int i) const { return m_entries[i]; }
+
+	bool load(const char* path);
+	bool save(const char* path) const;
+
+	static const char* getCommandName(SimCommand cmd);
+	// false for unknown names
+	static bool parseCommand(const char* name, SimCommand& cmd);
+
+private:
+	std::vector<SimScriptEntry> m_entries;
+};
+
+class CSimBot {
+public:
+	explicit CSimBot(unsigned seed);
+	~CSimBot(void) {}
+
+public:
+	// forget the current plan (new match)
+	void reset(void) { m_turn = -1; }
+	// commands for the player whose turn it is, to be given before the next tick
+	void think(const CTankSim& sim, std::vector<SimCommand>& out);
+
+private:
+	enum Phase { PHASE_DRIVE, PHASE_AIM, PHASE_WAIT };
+
+	void beginTurn(const CTankSim& sim);
+	// aim target position that sends a shell at the other tank
+	SimVec3 pickAim(const CTankSim& sim);
+	float random(void);
+	// key down / key up for one axis of the aim target (local: the player's
+	// right, up, forward); false once the axis is close enough
+	bool steerAxis(float error, float velocity, SimCommand minus, SimCommand plus, SimCommand stop, std::vector<SimCommand>& out);
+
+	unsigned	m_state;
+	int			m_turn;			// CTankSim turn count this plan is for
+	Phase		m_phase;
+	int			m_phaseTicks;
+	int			m_driveTicks, m_strafeTicks;
+	SimCommand	m_strafe;
+	SimVec3		m_aim;
+};
+
+struct SimMatchResult {
+	int winner;				// player, -1 if maxTicks ran out first
+	long long ticks;
+	int turns;
+	int shots;
+	int obstaclesDestroyed;
+	double ms;				// wall clock time of the ticks and commands
+};
+
+// resets sim and plays one match, with the script's commands or, without a
+// script, the bot's (record, if given, gets the bot's commands as a script)
+void runSimMatch(CTankSim& sim, const CSimScript* script, CSimBot* bot, CSimScript* record,
+	long long maxTicks, SimMatchResult& result);
+
+#endif // __simScriptH__
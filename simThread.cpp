@@ -0,0 +1,279 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: simThread.cpp
+//
+// Desc: The simulation thread, its snapshots and the sim -> display latency
+//       meter (see simThread.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "simThread.h"
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX		// std::max below
+#endif
+#include <windows.h>
+#include <mmsystem.h>	// timeBeginPeriod, winmm.lib
+#endif
+
+// sleep_for wakes up on the scheduler tick, which is 15.6 ms on Windows until
+// timeBeginPeriod(1) and still up to a millisecond late after it. The thread
+// sleeps until SIM_SPIN_NS before the tick is due and yields from there on
+#define SIM_SPIN_NS 2000000LL
+
+long long simClockNs(void)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// -----------------------------------------------------------------------------
+// CSimThread
+// -----------------------------------------------------------------------------
+
+CSimThread::CSimThread(void)
+	: m_sim(NULL), m_bot(NULL), m_maxCatchUp(8), m_stop(false)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CSimThread::~CSimThread(void)
+{
+	stop();
+}
+
+void CSimThread::start(CTankSim* sim, CSimBot* bot, int maxCatchUp)
+{
+	stop();
+	m_sim = sim;
+	m_bot = bot;
+	m_maxCatchUp = std::max(maxCatchUp, 1);
+	if (m_bot != NULL)
+		m_bot->reset();
+	m_commands.clear();
+	memset(&m_stats, 0, sizeof(m_stats));
+
+	m_sim->setListener(this);
+	m_obstacleAlive.assign(m_sim->getArenaObstacles().size(), 1);
+	savePositions();
+	SimSnapshot first;
+	capture(*m_sim, m_prevCenter, m_prevTarget, m_prevFocus, m_obstacleAlive, first);
+	first.publishNs = simClockNs();
+	m_snapshots.reset(first);
+
+	m_stop = false;
+	m_thread = std::thread(&CSimThread::threadMain, this);
+}
+
+void CSimThread::stop(void)
+{
+	if (!m_thread.joinable())
+		return;
+	m_stop = true;
+	m_thread.join();
+	m_sim->setListener(NULL);
+}
+
+void CSimThread::post(SimCommand cmd)
+{
+	Command c = { cmd, 0, 0 };
+	std::lock_guard<std::mutex> lock(m_commandMutex);
+	m_commands.push_back(c);
+}
+
+void CSimThread::postDrag(float dx, float dy)
+{
+	Command c = { -1, dx, dy };
+	std::lock_guard<std::mutex> lock(m_commandMutex);
+	m_commands.push_back(c);
+}
+
+const SimSnapshot& CSimThread::acquire(void)
+{
+	m_snapshots.update();
+	return m_snapshots.getFront();
+}
+
+SimThreadStats CSimThread::getStats(void) const
+{
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	return m_stats;
+}
+
+// fixed steps at SIM_TICK_RATE, catching up at most maxCatchUp of them and
+// dropping a longer backlog; sleeps between them instead of waiting for a frame
+void CSimThread::threadMain(void)
+{
+#ifdef _WIN32
+	timeBeginPeriod(1);
+#endif
+	const long long step = (long long)(1e9 / SIM_TICK_RATE);
+	long long next = simClockNs();
+	while (!m_stop) {
+		long long now = simClockNs();
+		if (now < next) {
+			if (next - now > SIM_SPIN_NS)
+				std::this_thread::sleep_for(std::chrono::nanoseconds(next - now - SIM_SPIN_NS));
+			else
+				std::this_thread::yield();
+			continue;
+		}
+		// too far behind (breakpoint, a starved core...): drop the backlog
+		// instead of running every later tick late
+		long long behind = (now - next) / step;
+		long long dropped = 0;
+		if (behind >= m_maxCatchUp) {
+			dropped = behind - m_maxCatchUp + 1;
+			next += dropped * step;
+		}
+		double lateMs = (now - next) / 1e6;
+
+		runTick();
+		next += step;
+
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.ticks++;
+		m_stats.droppedTicks += dropped;
+		if (now - next >= 0)	// started after the next one was due
+			m_stats.lateTicks++;
+		m_stats.maxLateMs = std::max(m_stats.maxLateMs, lateMs);
+	}
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+}
+
+void CSimThread::giveCommands(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_commandMutex);
+		m_taken.swap(m_commands);
+	}
+	for (size_t k = 0; k < m_taken.size(); k++) {
+		if (m_taken[k].cmd < 0)
+			m_sim->dragAim(m_taken[k].dx, m_taken[k].dy);
+		else
+			m_sim->command((SimCommand)m_taken[k].cmd);
+	}
+	m_taken.clear();
+
+	if (m_bot != NULL) {
+		m_botCommands.clear();
+		m_bot->think(*m_sim, m_botCommands);
+		for (size_t k = 0; k < m_botCommands.size(); k++)
+			m_sim->command(m_botCommands[k]);
+	}
+}
+
+void CSimThread::runTick(void)
+{
+	giveCommands();
+	savePositions();
+	m_sim->tick(SIM_TICK_DELTA);
+	if (m_sim->isFinished())
+		savePositions();	// the winner was put on the podium
+
+	SimSnapshot& s = m_snapshots.getBack();
+	capture(*m_sim, m_prevCenter, m_prevTarget, m_prevFocus, m_obstacleAlive, s);
+	s.publishNs = simClockNs();
+	m_snapshots.publish();
+}
+
+void CSimThread::savePositions(void)
+{
+	for (int p = 0; p < 2; p++)
+		m_prevCenter[p] = m_sim->getPlayerTank(p).getCenter();
+	m_prevTarget = m_sim->getTarget().getCenter();
+	m_prevFocus = m_sim->getMissileFocus();
+}
+
+void CSimThread::onObstacleDestroyed(int id, const float[3], const float[3])
+{
+	m_obstacleAlive[id] = 0;
+}
+
+static void captureTank(const CSimTank& tank, const SimVec3& prevCenter, SimTankState& out)
+{
+	out.player = tank.getPlayer();
+	out.alive = tank.isAlive();
+	out.center = tank.getCenter();
+	out.lastCenter = prevCenter;
+	for (int i = 0; i < CSimTank::PART_COUNT; i++)
+		out.partCenter[i] = tank.getPartCenter(i);
+	out.head = tank.getHead();
+	out.distance = tank.getDistance();
+	out.distanceZero = tank.getIsDistanceZero();
+}
+
+void CSimThread::capture(const CTankSim& sim, const SimVec3 prevCenter[2], const SimVec3& prevTarget,
+	const SimVec3& prevFocus, const std::vector<unsigned char>& obstacleAlive, SimSnapshot& out)
+{
+	const SimStats& stats = sim.getStats();
+	out.tick = stats.ticks;
+	out.started = sim.isStarted();
+	out.finished = sim.isFinished();
+	out.originTank = sim.isOriginTank();
+	out.firing = sim.isFiring();
+	out.zoomingOut = sim.isZoomingOut();
+	out.introMovement = sim.getIntroMovement();
+	out.zoomOut = sim.getZoomOut();
+	out.turnTime = sim.getTurnTime();
+	out.turnElapsed = sim.getTurnElapsed();
+	out.turns = stats.turns;
+	out.fireDegree = sim.getFireDegree();
+	out.fireDistance = sim.getFireDistance();
+
+	const CSimTank& tank = sim.getTank();
+	const CSimTank& otank = sim.getOtherTank();
+	captureTank(tank, prevCenter[tank.getPlayer()], out.tank);
+	captureTank(otank, prevCenter[otank.getPlayer()], out.otherTank);
+	out.target = sim.getTarget().getCenter();
+	out.lastTarget = prevTarget;
+	out.missileFocus = sim.getMissileFocus();
+	out.lastMissileFocus = prevFocus;
+
+	// the slot's own vectors: no allocation once they have been this big
+	const CProjectilePool& missiles = sim.getMissiles();
+	int n = missiles.size();
+	out.missiles.resize(n);
+	out.lastMissiles.resize(n);
+	for (int i = 0; i < n; i++) {
+		out.missiles[i] = SimVec3(missiles.getX(i), missiles.getY(i), missiles.getZ(i));
+		out.lastMissiles[i] = SimVec3(missiles.getLastX(i), missiles.getLastY(i), missiles.getLastZ(i));
+	}
+
+	out.obstacleAlive.assign(obstacleAlive.begin(), obstacleAlive.end());
+	out.obstaclesDestroyed = stats.obstaclesDestroyed;
+}
+
+// -----------------------------------------------------------------------------
+// CLatencyMeter
+// -----------------------------------------------------------------------------
+
+void CLatencyMeter::reset(void)
+{
+	m_next = 0;
+	m_filled = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void CLatencyMeter::add(long long publishNs, long long shownNs)
+{
+	double ms = (shownNs - publishNs) / 1e6;
+	m_window[m_next] = ms;
+	m_next = (m_next + 1) % WINDOW;
+	m_filled = std::min(m_filled + 1, (int)WINDOW);
+
+	double sum = 0, most = 0;
+	for (int i = 0; i < m_filled; i++) {
+		sum += m_window[i];
+		most = std::max(most, m_window[i]);
+	}
+	m_stats.samples++;
+	m_stats.lastMs = ms;
+	m_stats.averageMs = sum / m_filled;
+	m_stats.maxMs = most;
+}
@@ -0,0 +1,178 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: simThread.h
+//
+// Desc: Runs CTankSim on a thread of its own at SIM_TICK_RATE, apart from
+//       the thread that draws. After every tick the state the renderer
+//       needs is copied into a SimSnapshot and handed over through a
+//       CTripleBuffer, so the renderer always finds a complete, unchanging
+//       tick and neither thread waits for the other: a slow Present() no
+//       longer holds the game back, and a long tick does not stall the
+//       frame. Commands go the other way through a small queue and are
+//       given to the sim before its next tick. CLatencyMeter measures how
+//       old a snapshot is when the frame drawn from it is shown.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __simThreadH__
+#define __simThreadH__
+
+#include "tankSim.h"
+#include "simScript.h"
+#include "tripleBuffer.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+// steady clock in ns, the same on every thread
+long long simClockNs(void);
+
+// a tank as it is drawn: after the tick, and where it was before it
+struct SimTankState {
+	int		player;
+	bool	alive;
+	SimVec3	center;
+	SimVec3	lastCenter;		// = center when the frame must not interpolate (turn change, podium)
+	SimVec3	partCenter[CSimTank::PART_COUNT];
+	SimVec3	head;
+	float	distance;
+	bool	distanceZero;
+};
+
+// what the renderer reads of one tick, copied out of CTankSim
+struct SimSnapshot {
+	long long	tick;
+	long long	publishNs;		// simClockNs() when it was handed over
+
+	// match
+	bool		started, finished;
+	bool		originTank;		// player 0's turn
+	bool		firing, zoomingOut;
+	float		introMovement, zoomOut;
+	int			turnTime;
+	double		turnElapsed;
+	int			turns;			// changes with every turn
+	double		fireDegree, fireDistance;
+
+	// objects, each with its position before the tick for interpolation
+	SimTankState			tank, otherTank;	// tank: the player whose turn it is
+	SimVec3					target, lastTarget;
+	SimVec3					missileFocus, lastMissileFocus;
+	std::vector<SimVec3>	missiles, lastMissiles;
+
+	// arena
+	std::vector<unsigned char>	obstacleAlive;	// per CArenaLayout::buildObstacles() id
+	int							obstaclesDestroyed;
+};
+
+struct SimThreadStats {
+	long long	ticks;
+	int			lateTicks;		// started more than a tick after their time
+	long long	droppedTicks;	// skipped after falling more than maxCatchUp ticks behind
+	double		maxLateMs;
+};
+
+// -----------------------------------------------------------------------------
+// CSimThread
+// -----------------------------------------------------------------------------
+class CSimThread : public CSimListener {
+public:
+	CSimThread(void);
+	~CSimThread(void);
+
+public:
+	// sim must be init()ed or reset() (every obstacle standing). Until
+	// stop() it belongs to the thread: nobody else may call it, apart from
+	// reading what init() built and nothing changes later (firing table,
+	// collision world, getArenaObstacles()).
+	// With a bot, the bot plays both sides. maxCatchUp is how many ticks
+	// it runs back to back when it fell behind, before it drops the rest
+	void start(CTankSim* sim, CSimBot* bot = NULL, int maxCatchUp = 8);
+	void stop(void);
+	bool isRunning(void) const { return m_thread.joinable(); }
+
+	// any thread: given to the sim before its next tick, in this order
+	void post(SimCommand cmd);
+	void postDrag(float dx, float dy);
+
+	// reader (one thread): the newest snapshot. It stays as it is until the
+	// next acquire(), which may return a newer one
+	const SimSnapshot& acquire(void);
+
+	SimThreadStats getStats(void) const;
+
+	// the snapshot of sim as it is now (prev*: positions before the tick)
+	static void capture(const CTankSim& sim, const SimVec3 prevCenter[2], const SimVec3& prevTarget,
+		const SimVec3& prevFocus, const std::vector<unsigned char>& obstacleAlive, SimSnapshot& out);
+
+private:
+	struct Command {
+		int		cmd;		// SimCommand, -1 = drag
+		float	dx, dy;
+	};
+
+	void threadMain(void);
+	void giveCommands(void);
+	void runTick(void);
+	void savePositions(void);
+
+	// CSimListener (on the sim thread)
+	void onObstacleDestroyed(int id, const float bmin[3], const float bmax[3]);
+	void onMissileFired(const SimVec3& pos) { m_prevFocus = pos; }
+	// the tanks swapped: no interpolation across it
+	void onTurnChanged(void) { savePositions(); }
+
+	CTankSim*					m_sim;
+	CSimBot*					m_bot;
+	int							m_maxCatchUp;
+	std::thread					m_thread;
+	std::atomic<bool>			m_stop;
+
+	std::mutex					m_commandMutex;
+	std::vector<Command>		m_commands;		// posted, not given yet
+	std::vector<Command>		m_taken;		// sim thread's copy
+	std::vector<SimCommand>		m_botCommands;
+
+	// sim thread
+	SimVec3						m_prevCenter[2];	// per player
+	SimVec3						m_prevTarget, m_prevFocus;
+	std::vector<unsigned char>	m_obstacleAlive;
+	CTripleBuffer<SimSnapshot>	m_snapshots;
+
+	mutable std::mutex			m_statsMutex;
+	SimThreadStats				m_stats;
+};
+
+// -----------------------------------------------------------------------------
+// CLatencyMeter: sim -> display latency
+// -----------------------------------------------------------------------------
+
+// over the last CLatencyMeter::WINDOW frames
+struct LatencyStats {
+	long long	samples;	// since reset()
+	double		lastMs;
+	double		averageMs;
+	double		maxMs;
+};
+
+class CLatencyMeter {
+public:
+	enum { WINDOW = 120 };
+
+	CLatencyMeter(void) { reset(); }
+
+public:
+	void reset(void);
+	// a frame made from a snapshot published at publishNs was shown at shownNs
+	void add(long long publishNs, long long shownNs);
+	const LatencyStats& getStats(void) const { return m_stats; }
+
+private:
+	double			m_window[WINDOW];
+	int				m_next;
+	int				m_filled;
+	LatencyStats	m_stats;
+};
+
+#endif // __simThreadH__
@@ -0,0 +1,225 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: simdMath.h
+//
+// Desc: 16 byte vector and matrix types for the render side, with
+//       SSE versions of the operations a frame repeats (matrix products,
+//       point transforms, translation fast paths). Matrices keep the
+//       D3DXMATRIX convention of simMath.h (row vectors, translation in the
+//       last row), so data() goes to D3D or CRenderQueue as it is. Without
+//       SSE the same functions run as plain C++.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __simdMathH__
+#define __simdMathH__
+
+#include "simMath.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define SIMD_MATH_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+// The types are not declared alignas(16): before C++17 std::vector (walls,
+// obstacles) does not honour an alignment above the default one, 8 bytes
+// on x86, so such an object in a vector would be undefined behaviour. The
+// loads and stores are unaligned instead, which costs the same as aligned
+// ones on every SSE2 CPU the game runs on when the data happens to be.
+
+// a vec3 padded to 16 bytes, so it loads as one register (pad is 0)
+struct SimdVec3 {
+	float x, y, z, pad;
+
+	SimdVec3(void) : x(0), y(0), z(0), pad(0) {}
+	SimdVec3(float ix, float iy, float iz) : x(ix), y(iy), z(iz), pad(0) {}
+	explicit SimdVec3(const SimVec3& v) : x(v.x), y(v.y), z(v.z), pad(0) {}
+
+	float operator[](int i) const { return (&x)[i]; }
+	float& operator[](int i) { return (&x)[i]; }
+	SimVec3 toSim(void) const { return SimVec3(x, y, z); }
+
+	bool operator==(const SimdVec3& v) const { return x == v.x && y == v.y && z == v.z; }
+	bool operator!=(const SimdVec3& v) const { return !(*this == v); }
+};
+
+struct SimdVec4 {
+	float x, y, z, w;
+
+	SimdVec4(void) : x(0), y(0), z(0), w(0) {}
+	SimdVec4(float ix, float iy, float iz, float iw) : x(ix), y(iy), z(iz), w(iw) {}
+	// a point (w = 1) or a direction (w = 0)
+	SimdVec4(const SimdVec3& v, float iw) : x(v.x), y(v.y), z(v.z), w(iw) {}
+
+	float operator[](int i) const { return (&x)[i]; }
+	float& operator[](int i) { return (&x)[i]; }
+};
+
+struct SimdMat4 {
+	float m[4][4];
+
+	static SimdMat4 identity(void);
+	static SimdMat4 translation(float x, float y, float z);
+	// same as D3DXMatrixRotationY
+	static SimdMat4 rotationY(float angle);
+	static SimdMat4 fromSim(const SimMat4& s);
+
+	const float* data(void) const { return &m[0][0]; }
+	float* data(void) { return &m[0][0]; }
+	bool operator==(const SimdMat4& o) const;
+	bool operator!=(const SimdMat4& o) const { return !(*this == o); }
+};
+
+// -----------------------------------------------------------------------------
+// vectors
+// -----------------------------------------------------------------------------
+
+inline SimdVec3 simdAdd(const SimdVec3& a, const SimdVec3& b) { return SimdVec3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline SimdVec3 simdSub(const SimdVec3& a, const SimdVec3& b) { return SimdVec3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline SimdVec3 simdScale(const SimdVec3& a, float s) { return SimdVec3(a.x * s, a.y * s, a.z * s); }
+inline float simdDot(const SimdVec3& a, const SimdVec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline float simdLength(const SimdVec3& v) { return sqrtf(simdDot(v, v)); }
+inline SimdVec3 simdCross(const SimdVec3& a, const SimdVec3& b)
+{
+	return SimdVec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+inline float simdDot(const SimdVec4& a, const SimdVec4& b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+
+// -----------------------------------------------------------------------------
+// matrices
+// -----------------------------------------------------------------------------
+
+inline SimdMat4 SimdMat4::identity(void)
+{
+	SimdMat4 r;
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			r.m[i][j] = (i == j) ? 1.0f : 0.0f;
+	return r;
+}
+
+inline SimdMat4 SimdMat4::translation(float x, float y, float z)
+{
+	SimdMat4 r = identity();
+	r.m[3][0] = x;
+	r.m[3][1] = y;
+	r.m[3][2] = z;
+	return r;
+}
+
+inline SimdMat4 SimdMat4::rotationY(float angle)
+{
+	SimdMat4 r = identity();
+	float c = cosf(angle), s = sinf(angle);
+	r.m[0][0] = c;
+	r.m[0][2] = -s;
+	r.m[2][0] = s;
+	r.m[2][2] = c;
+	return r;
+}
+
+inline SimdMat4 SimdMat4::fromSim(const SimMat4& s)
+{
+	SimdMat4 r;
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			r.m[i][j] = s.m[i][j];
+	return r;
+}
+
+inline bool SimdMat4::operator==(const SimdMat4& o) const
+{
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			if (m[i][j] != o.m[i][j])
+				return false;
+	return true;
+}
+
+// out = a * b (a applied first). out may be a or b
+inline void simdMultiply(SimdMat4& out, const SimdMat4& a, const SimdMat4& b)
+{
+#ifdef SIMD_MATH_USE_SSE
+	__m128 b0 = _mm_loadu_ps(b.m[0]), b1 = _mm_loadu_ps(b.m[1]);
+	__m128 b2 = _mm_loadu_ps(b.m[2]), b3 = _mm_loadu_ps(b.m[3]);
+	__m128 rows[4];
+	for (int i = 0; i < 4; i++) {
+		__m128 r = _mm_mul_ps(_mm_set1_ps(a.m[i][0]), b0);
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.m[i][1]), b1));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.m[i][2]), b2));
+		rows[i] = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.m[i][3]), b3));
+	}
+	for (int i = 0; i < 4; i++)
+		_mm_storeu_ps(out.m[i], rows[i]);
+#else
+	SimdMat4 r;
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+	out = r;
+#endif
+}
+
+inline SimdMat4 simdMultiply(const SimdMat4& a, const SimdMat4& b)
+{
+	SimdMat4 r;
+	simdMultiply(r, a, b);
+	return r;
+}
+
+// out = translation(x, y, z) * parent without the full product: only the
+// last row changes (the render transforms of boxes and spheres)
+inline void simdTranslateParent(SimdMat4& out, float x, float y, float z, const SimdMat4& parent)
+{
+#ifdef SIMD_MATH_USE_SSE
+	__m128 p0 = _mm_loadu_ps(parent.m[0]), p1 = _mm_loadu_ps(parent.m[1]);
+	__m128 p2 = _mm_loadu_ps(parent.m[2]), p3 = _mm_loadu_ps(parent.m[3]);
+	__m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(x), p0), _mm_mul_ps(_mm_set1_ps(y), p1)),
+		_mm_add_ps(_mm_mul_ps(_mm_set1_ps(z), p2), p3));
+	_mm_storeu_ps(out.m[0], p0);
+	_mm_storeu_ps(out.m[1], p1);
+	_mm_storeu_ps(out.m[2], p2);
+	_mm_storeu_ps(out.m[3], t);
+#else
+	float t[4];
+	for (int j = 0; j < 4; j++)
+		t[j] = x * parent.m[0][j] + y * parent.m[1][j] + z * parent.m[2][j] + parent.m[3][j];
+	out = parent;
+	for (int j = 0; j < 4; j++)
+		out.m[3][j] = t[j];
+#endif
+}
+
+// full 4 component product v * m
+inline SimdVec4 simdTransform(const SimdVec4& v, const SimdMat4& m)
+{
+	SimdVec4 r;
+#ifdef SIMD_MATH_USE_SSE
+	__m128 t = _mm_mul_ps(_mm_set1_ps(v.x), _mm_loadu_ps(m.m[0]));
+	t = _mm_add_ps(t, _mm_mul_ps(_mm_set1_ps(v.y), _mm_loadu_ps(m.m[1])));
+	t = _mm_add_ps(t, _mm_mul_ps(_mm_set1_ps(v.z), _mm_loadu_ps(m.m[2])));
+	t = _mm_add_ps(t, _mm_mul_ps(_mm_set1_ps(v.w), _mm_loadu_ps(m.m[3])));
+	_mm_storeu_ps(&r.x, t);
+#else
+	for (int j = 0; j < 4; j++)
+		r[j] = v.x * m.m[0][j] + v.y * m.m[1][j] + v.z * m.m[2][j] + v.w * m.m[3][j];
+#endif
+	return r;
+}
+
+// point (w = 1) through m, divided by w like D3DXVec3TransformCoord
+inline SimdVec3 simdTransformPoint(const SimdVec3& p, const SimdMat4& m)
+{
+	SimdVec4 r = simdTransform(SimdVec4(p, 1.0f), m);
+	float inv = 1.0f / r.w;
+	return SimdVec3(r.x * inv, r.y * inv, r.z * inv);
+}
+
+// point through an affine m (last column 0, 0, 0, 1): no divide
+inline SimdVec3 simdTransformAffine(const SimdVec3& p, const SimdMat4& m)
+{
+	SimdVec4 r = simdTransform(SimdVec4(p, 1.0f), m);
+	return SimdVec3(r.x, r.y, r.z);
+}
+
+#endif // __simdMathH__
@@ -0,0 +1,676 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: softRaster.cpp
+//
+// Desc: Tile binned software rasterizer (see softRaster.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "softRaster.h"
+#include "instanceBatch.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+enum { PASS_BIN, PASS_RASTER };
+
+namespace
+{
+	void multiply(const float a[16], const float b[16], float out[16])
+	{
+		for (int r = 0; r < 4; r++) {
+			for (int c = 0; c < 4; c++) {
+				out[r * 4 + c] = a[r * 4] * b[c] + a[r * 4 + 1] * b[4 + c] +
+					a[r * 4 + 2] * b[8 + c] + a[r * 4 + 3] * b[12 + c];
+			}
+		}
+	}
+
+	void identity(float m[16])
+	{
+		for (int i = 0; i < 16; i++)
+			m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+	}
+
+	unsigned packColor(float r, float g, float b)
+	{
+		return ((unsigned)(r * 255.0f + 0.5f) << 16) | ((unsigned)(g * 255.0f + 0.5f) << 8) | (unsigned)(b * 255.0f + 0.5f);
+	}
+
+	float clamp01(float v)
+	{
+		return v < 0 ? 0 : (v > 1 ? 1 : v);
+	}
+
+	// edge a -> b of a clockwise (screen, y down) triangle owns its pixels
+	// when it is a top or a left edge
+	bool isTopLeft(float ax, float ay, float bx, float by)
+	{
+		return (ay == by && bx > ax) || by < ay;
+	}
+
+	// sphere like D3DXCreateSphere: poles on z, rings from +z to -z
+	void makeSphere(float radius, int slices, int stacks, SoftMesh& mesh)
+	{
+		const float PI = 3.14159265f;
+		mesh.vertices.clear();
+		mesh.indices.clear();
+		float pole[6] = { 0, 0, radius, 0, 0, 1 };
+		mesh.vertices.insert(mesh.vertices.end(), pole, pole + 6);
+		for (int i = 1; i < stacks; i++) {
+			float phi = PI * i / stacks;
+			for (int j = 0; j < slices; j++) {
+				float theta = 2 * PI * j / slices;
+				float n[3] = { sinf(phi) * cosf(theta), sinf(phi) * sinf(theta), cosf(phi) };
+				float v[6] = { n[0] * radius, n[1] * radius, n[2] * radius, n[0], n[1], n[2] };
+				mesh.vertices.insert(mesh.vertices.end(), v, v + 6);
+			}
+		}
+		float bottom[6] = { 0, 0, -radius, 0, 0, -1 };
+		mesh.vertices.insert(mesh.vertices.end(), bottom, bottom + 6);
+
+		unsigned last = (unsigned)mesh.getVertexCount() - 1;
+		std::vector<unsigned>& idx = mesh.indices;
+		for (int j = 0; j < slices; j++) {
+			unsigned a = 1 + j, b = 1 + (j + 1) % slices;
+			idx.push_back(0); idx.push_back(a); idx.push_back(b);
+		}
+		for (int i = 0; i < stacks - 2; i++) {
+			unsigned row = 1 + i * slices, next = row + slices;
+			for (int j = 0; j < slices; j++) {
+				unsigned k = (j + 1) % slices;
+				idx.push_back(row + j); idx.push_back(next + j); idx.push_back(next + k);
+				idx.push_back(row + j); idx.push_back(next + k); idx.push_back(row + k);
+			}
+		}
+		unsigned row = 1 + (stacks - 2) * slices;
+		for (int j = 0; j < slices; j++) {
+			unsigned a = row + j, b = row + (j + 1) % slices;
+			idx.push_back(last); idx.push_back(b); idx.push_back(a);
+		}
+
+		// D3D front faces are clockwise seen from outside, i.e. the face
+		// normal (b - a) x (c - a) points away from the center
+		const float* v = &mesh.vertices[0];
+		for (size_t t = 0; t < idx.size(); t += 3) {
+			const float* a = v + idx[t] * 6;
+			const float* b = v + idx[t + 1] * 6;
+			const float* c = v + idx[t + 2] * 6;
+			float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			if (n[0] * (a[0] + b[0] + c[0]) + n[1] * (a[1] + b[1] + c[1]) + n[2] * (a[2] + b[2] + c[2]) < 0)
+				std::swap(idx[t + 1], idx[t + 2]);
+		}
+	}
+
+	// box like D3DXCreateBox: 4 vertices per face, the same faces the
+	// obstacle instance batch expands
+	void makeBox(float width, float height, float depth, SoftMesh& mesh)
+	{
+		CInstanceBatch batch;
+		batch.add(0, 0, 0, width, height, depth, 0);
+		InstanceVertex v[CInstanceBatch::VERTICES_PER_INSTANCE];
+		batch.expandSlot(0, v);
+
+		mesh.vertices.resize(CInstanceBatch::VERTICES_PER_INSTANCE * 6);
+		for (int i = 0; i < CInstanceBatch::VERTICES_PER_INSTANCE; i++) {
+			float* out = &mesh.vertices[i * 6];
+			out[0] = v[i].x; out[1] = v[i].y; out[2] = v[i].z;
+			out[3] = v[i].nx; out[4] = v[i].ny; out[5] = v[i].nz;
+		}
+		mesh.indices.clear();
+		for (unsigned f = 0; f < 6; f++) {
+			unsigned base = f * 4;
+			unsigned quad[6] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+void* CSoftMeshFactory::createMesh(const MeshKey& key, unsigned& bytes)
+{
+	SoftMesh* mesh = new SoftMesh;
+	if (key.shape == MeshKey::SPHERE)
+		makeSphere(key.size[0], key.slices, key.stacks, *mesh);
+	else
+		makeBox(key.size[0], key.size[1], key.size[2], *mesh);
+	bytes = (unsigned)(mesh->vertices.size() * sizeof(float) + mesh->indices.size() * sizeof(unsigned));
+	return mesh;
+}
+
+void CSoftMeshFactory::destroyMesh(void* mesh)
+{
+	delete static_cast<SoftMesh*>(mesh);
+}
+
+CSoftRasterizer::CSoftRasterizer(void)
+{
+	m_width = m_height = 0;
+	m_tilesX = m_tilesY = 0;
+	m_clearColor = 0;
+	identity(m_view);
+	identity(m_proj);
+	identity(m_viewProj);
+	identity(m_world);
+	m_eye[0] = m_eye[1] = m_eye[2] = 0;
+	memset(&m_material, 0, sizeof(m_material));
+	memset(m_lights, 0, sizeof(m_lights));
+	m_lightOn[0] = m_lightOn[1] = false;
+	m_fill = FILL_SOLID;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_nextTile = 0;
+
+	m_threadCount = 1;
+	m_pass = PASS_BIN;
+	m_generation = 0;
+	m_busy = 0;
+	m_stop = false;
+	m_bins.resize(1);
+}
+
+CSoftRasterizer::~CSoftRasterizer(void)
+{
+	stopWorkers();
+}
+
+void CSoftRasterizer::setThreadCount(int count)
+{
+	stopWorkers();
+	if (count <= 0)
+		count = (int)std::thread::hardware_concurrency();
+	m_threadCount = std::max(count, 1);
+
+	m_bins.assign(m_threadCount, std::vector<std::vector<int> >(m_tilesX * m_tilesY));
+	m_stop = false;
+	// workers start from the current generation, so a pass started before
+	// a worker gets scheduled is not missed
+	for (int t = 1; t < m_threadCount; t++)
+		m_workers.push_back(std::thread(&CSoftRasterizer::workerMain, this, t, m_generation));
+}
+
+void CSoftRasterizer::stopWorkers(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+		m_workers[i].join();
+	m_workers.clear();
+}
+
+void CSoftRasterizer::resize(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+	m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	m_color.assign(width * height, 0);
+	m_depth.assign(width * height, 1.0f);
+	for (size_t t = 0; t < m_bins.size(); t++)
+		m_bins[t].assign(m_tilesX * m_tilesY, std::vector<int>());
+}
+
+void CSoftRasterizer::setView(const float view[16])
+{
+	memcpy(m_view, view, sizeof(m_view));
+	multiply(m_view, m_proj, m_viewProj);
+	// the view matrix is a rotation and a translation, so the eye is
+	// minus the translation taken back through the transposed rotation
+	for (int r = 0; r < 3; r++)
+		m_eye[r] = -(view[12] * view[r * 4] + view[13] * view[r * 4 + 1] + view[14] * view[r * 4 + 2]);
+}
+
+void CSoftRasterizer::setProjection(const float proj[16])
+{
+	memcpy(m_proj, proj, sizeof(m_proj));
+	multiply(m_view, m_proj, m_viewProj);
+}
+
+void CSoftRasterizer::setLight(int i, const SoftLight& light, bool enable)
+{
+	if (i < 0 || i >= MAX_LIGHTS)
+		return;
+	m_lights[i] = light;
+	m_lightOn[i] = enable;
+}
+
+void CSoftRasterizer::beginFrame(unsigned clearColor)
+{
+	m_clearColor = clearColor;
+	m_tris.clear();
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void CSoftRasterizer::setMaterial(const RenderMaterial& material)
+{
+	m_material = material;
+}
+
+void CSoftRasterizer::setTransform(const float world[16])
+{
+	memcpy(m_world, world, sizeof(m_world));
+}
+
+void CSoftRasterizer::lightVertex(const float p[3], const float n[3], float rgb[3]) const
+{
+	// D3D fixed function, local viewer, no global ambient
+	float ambient[3] = { 0, 0, 0 }, diffuse[3] = { 0, 0, 0 }, specular[3] = { 0, 0, 0 };
+	for (int i = 0; i < MAX_LIGHTS; i++) {
+		if (!m_lightOn[i])
+			continue;
+		const SoftLight& lit = m_lights[i];
+		float l[3] = { lit.position[0] - p[0], lit.position[1] - p[1], lit.position[2] - p[2] };
+		float d = sqrtf(l[0] * l[0] + l[1] * l[1] + l[2] * l[2]);
+		if (d > lit.range || d <= 0)
+			continue;
+		float denom = lit.attenuation0 + lit.attenuation1 * d + lit.attenuation2 * d * d;
+		float att = denom > 0 ? 1.0f / denom : 1.0f;
+		for (int a = 0; a < 3; a++)
+			l[a] /= d;
+
+		for (int c = 0; c < 3; c++)
+			ambient[c] += att * lit.ambient[c];
+		float ndotl = n[0] * l[0] + n[1] * l[1] + n[2] * l[2];
+		if (ndotl <= 0)
+			continue;
+		for (int c = 0; c < 3; c++)
+			diffuse[c] += att * ndotl * lit.diffuse[c];
+
+		float v[3] = { m_eye[0] - p[0], m_eye[1] - p[1], m_eye[2] - p[2] };
+		float vl = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		if (vl <= 0)
+			continue;
+		float h[3] = { l[0] + v[0] / vl, l[1] + v[1] / vl, l[2] + v[2] / vl };
+		float hl = sqrtf(h[0] * h[0] + h[1] * h[1] + h[2] * h[2]);
+		float ndoth = hl > 0 ? (n[0] * h[0] + n[1] * h[1] + n[2] * h[2]) / hl : 0;
+		if (ndoth > 0) {
+			float s = att * powf(ndoth, m_material.power);
+			for (int c = 0; c < 3; c++)
+				specular[c] += s * lit.specular[c];
+		}
+	}
+	for (int c = 0; c < 3; c++) {
+		rgb[c] = clamp01(m_material.emissive[c] + m_material.ambient[c] * ambient[c] +
+			m_material.diffuse[c] * diffuse[c] + m_material.specular[c] * specular[c]);
+	}
+}
+
+void CSoftRasterizer::drawMesh(const void* mesh, int subset)
+{
+	const SoftMesh* m = static_cast<const SoftMesh*>(mesh);
+	if (m == NULL || subset != 0 || m->indices.empty())
+		return;
+
+	// light and transform every vertex once
+	float mvp[16];
+	multiply(m_world, m_viewProj, mvp);
+	int count = m->getVertexCount();
+	std::vector<float> clip(count * 4), rgb(count * 3);
+	for (int i = 0; i < count; i++) {
+		const float* v = &m->vertices[i * 6];
+		float p[3], n[3];
+		for (int a = 0; a < 3; a++) {
+			p[a] = v[0] * m_world[a] + v[1] * m_world[4 + a] + v[2] * m_world[8 + a] + m_world[12 + a];
+			n[a] = v[3] * m_world[a] + v[4] * m_world[4 + a] + v[5] * m_world[8 + a];
+		}
+		float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (len > 0) {
+			n[0] /= len;
+			n[1] /= len;
+			n[2] /= len;
+		}
+		lightVertex(p, n, &rgb[i * 3]);
+		for (int a = 0; a < 4; a++)
+			clip[i * 4 + a] = v[0] * mvp[a] + v[1] * mvp[4 + a] + v[2] * mvp[8 + a] + mvp[12 + a];
+	}
+
+	for (size_t t = 0; t < m->indices.size(); t += 3) {
+		float c[3][4], col[3][3];
+		for (int k = 0; k < 3; k++) {
+			unsigned i = m->indices[t + k];
+			memcpy(c[k], &clip[i * 4], sizeof(c[k]));
+			memcpy(col[k], &rgb[i * 3], sizeof(col[k]));
+		}
+		m_stats.triangles++;
+		addClipped(c, col);
+	}
+}
+
+void CSoftRasterizer::addClipped(const float clip[3][4], const float rgb[3][3])
+{
+	// outside one frustum plane with all three corners
+	int outL = 0, outR = 0, outB = 0, outT = 0, outN = 0, outF = 0;
+	for (int k = 0; k < 3; k++) {
+		const float* c = clip[k];
+		outL += c[0] < -c[3];
+		outR += c[0] > c[3];
+		outB += c[1] < -c[3];
+		outT += c[1] > c[3];
+		outN += c[2] < 0;
+		outF += c[2] > c[3];
+	}
+	if (outL == 3 || outR == 3 || outB == 3 || outT == 3 || outN == 3 || outF == 3) {
+		m_stats.culled++;
+		return;
+	}
+	if (outN == 0) {
+		addTriangle(clip, rgb);
+		return;
+	}
+
+	// cut against the near plane (z >= 0); x and y are left to the pixel
+	// bounds, which only need w > 0
+	m_stats.clipped++;
+	float poly[4][4], col[4][3];
+	int n = 0;
+	for (int k = 0; k < 3; k++) {
+		const float* a = clip[k];
+		const float* b = clip[(k + 1) % 3];
+		if (a[2] >= 0) {
+			memcpy(poly[n], a, sizeof(poly[n]));
+			memcpy(col[n], rgb[k], sizeof(col[n]));
+			n++;
+		}
+		if ((a[2] >= 0) != (b[2] >= 0)) {
+			float t = a[2] / (a[2] - b[2]);
+			for (int i = 0; i < 4; i++)
+				poly[n][i] = a[i] + (b[i] - a[i]) * t;
+			for (int i = 0; i < 3; i++)
+				col[n][i] = rgb[k][i] + (rgb[(k + 1) % 3][i] - rgb[k][i]) * t;
+			n++;
+		}
+	}
+	for (int k = 1; k + 1 < n; k++) {
+		float c[3][4], cc[3][3];
+		memcpy(c[0], poly[0], sizeof(c[0]));
+		memcpy(c[1], poly[k], sizeof(c[1]));
+		memcpy(c[2], poly[k + 1], sizeof(c[2]));
+		memcpy(cc[0], col[0], sizeof(cc[0]));
+		memcpy(cc[1], col[k], sizeof(cc[1]));
+		memcpy(cc[2], col[k + 1], sizeof(cc[2]));
+		addTriangle(c, cc);
+	}
+}
+
+void CSoftRasterizer::addTriangle(const float clip[3][4], const float rgb[3][3])
+{
+	Triangle t;
+	for (int k = 0; k < 3; k++) {
+		float w = clip[k][3];
+		if (w <= 1e-6f) {
+			m_stats.culled++;
+			return;
+		}
+		Vertex& v = t.v[k];
+		v.x = (clip[k][0] / w * 0.5f + 0.5f) * m_width;
+		v.y = (0.5f - clip[k][1] / w * 0.5f) * m_height;
+		v.z = clip[k][2] / w;
+		v.r = rgb[k][0];
+		v.g = rgb[k][1];
+		v.b = rgb[k][2];
+	}
+
+	// D3DCULL_CCW: counter-clockwise on screen is a back face
+	float area = (t.v[1].x - t.v[0].x) * (t.v[2].y - t.v[0].y) - (t.v[1].y - t.v[0].y) * (t.v[2].x - t.v[0].x);
+	if (area <= 0) {
+		m_stats.culled++;
+		return;
+	}
+
+	float minX = std::min(t.v[0].x, std::min(t.v[1].x, t.v[2].x));
+	float maxX = std::max(t.v[0].x, std::max(t.v[1].x, t.v[2].x));
+	float minY = std::min(t.v[0].y, std::min(t.v[1].y, t.v[2].y));
+	float maxY = std::max(t.v[0].y, std::max(t.v[1].y, t.v[2].y));
+	t.minX = std::max((int)floorf(minX), 0);
+	t.minY = std::max((int)floorf(minY), 0);
+	t.maxX = std::min((int)ceilf(maxX), m_width - 1);
+	t.maxY = std::min((int)ceilf(maxY), m_height - 1);
+	if (t.minX > t.maxX || t.minY > t.maxY) {
+		m_stats.culled++;
+		return;
+	}
+	m_tris.push_back(t);
+}
+
+void CSoftRasterizer::endFrame(void)
+{
+	if (m_width == 0)
+		return;
+	for (size_t t = 0; t < m_bins.size(); t++) {
+		for (size_t b = 0; b < m_bins[t].size(); b++)
+			m_bins[t][b].clear();
+	}
+	runPass(PASS_BIN);
+	for (size_t t = 0; t < m_bins.size(); t++) {
+		for (size_t b = 0; b < m_bins[t].size(); b++)
+			m_stats.binned += (int)m_bins[t][b].size();
+	}
+	m_nextTile = 0;
+	runPass(PASS_RASTER);
+}
+
+void CSoftRasterizer::binTriangles(int thread)
+{
+	int count = (int)m_tris.size();
+	int first = (int)((long long)count * thread / m_threadCount);
+	int last = (int)((long long)count * (thread + 1) / m_threadCount);
+	std::vector<std::vector<int> >& bins = m_bins[thread];
+	for (int i = first; i < last; i++) {
+		const Triangle& t = m_tris[i];
+		for (int ty = t.minY / TILE_SIZE; ty <= t.maxY / TILE_SIZE; ty++) {
+			for (int tx = t.minX / TILE_SIZE; tx <= t.maxX / TILE_SIZE; tx++)
+				bins[ty * m_tilesX + tx].push_back(i);
+		}
+	}
+}
+
+void CSoftRasterizer::rasterizeTile(int tile)
+{
+	int x0 = (tile % m_tilesX) * TILE_SIZE;
+	int y0 = (tile / m_tilesX) * TILE_SIZE;
+	int x1 = std::min(x0 + TILE_SIZE, m_width);
+	int y1 = std::min(y0 + TILE_SIZE, m_height);
+	for (int y = y0; y < y1; y++) {
+		std::fill(&m_color[y * m_width + x0], &m_color[y * m_width + x1], m_clearColor);
+		std::fill(&m_depth[y * m_width + x0], &m_depth[y * m_width + x1], 1.0f);
+	}
+
+	// bins of thread 0 hold the earliest triangles, so this is draw order
+	for (size_t b = 0; b < m_bins.size(); b++) {
+		const std::vector<int>& bin = m_bins[b][tile];
+		for (size_t k = 0; k < bin.size(); k++) {
+			const Triangle& t = m_tris[bin[k]];
+			if (m_fill == FILL_SOLID) {
+				fillTriangle(t, x0, y0, x1, y1);
+			}
+			else {
+				drawLine(t.v[0], t.v[1], x0, y0, x1, y1);
+				drawLine(t.v[1], t.v[2], x0, y0, x1, y1);
+				drawLine(t.v[2], t.v[0], x0, y0, x1, y1);
+			}
+		}
+	}
+}
+
+void CSoftRasterizer::fillTriangle(const Triangle& t, int x0, int y0, int x1, int y1)
+{
+	const Vertex& a = t.v[0];
+	const Vertex& b = t.v[1];
+	const Vertex& c = t.v[2];
+	int minX = std::max(t.minX, x0), maxX = std::min(t.maxX, x1 - 1);
+	int minY = std::max(t.minY, y0), maxY = std::min(t.maxY, y1 - 1);
+	if (minX > maxX || minY > maxY)
+		return;
+
+	// edge functions, each one positive inside; e0 is opposite a
+	float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	float inv = 1.0f / area;
+	float e0dx = -(c.y - b.y), e0dy = c.x - b.x;
+	float e1dx = -(a.y - c.y), e1dy = a.x - c.x;
+	float e2dx = -(b.y - a.y), e2dy = b.x - a.x;
+	// pixels exactly on an edge belong to top and left edges only
+	bool own0 = isTopLeft(b.x, b.y, c.x, c.y);
+	bool own1 = isTopLeft(c.x, c.y, a.x, a.y);
+	bool own2 = isTopLeft(a.x, a.y, b.x, b.y);
+
+	float px = minX + 0.5f, py = minY + 0.5f;
+	float row0 = (c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x);
+	float row1 = (a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x);
+	float row2 = (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+
+	for (int y = minY; y <= maxY; y++) {
+		float w0 = row0, w1 = row1, w2 = row2;
+		unsigned* color = &m_color[y * m_width];
+		float* depth = &m_depth[y * m_width];
+		for (int x = minX; x <= maxX; x++) {
+			if ((w0 > 0 || (w0 == 0 && own0)) && (w1 > 0 || (w1 == 0 && own1)) && (w2 > 0 || (w2 == 0 && own2))) {
+				float l0 = w0 * inv, l1 = w1 * inv, l2 = w2 * inv;
+				float z = l0 * a.z + l1 * b.z + l2 * c.z;
+				if (z <= depth[x]) {
+					depth[x] = z;
+					color[x] = packColor(l0 * a.r + l1 * b.r + l2 * c.r,
+						l0 * a.g + l1 * b.g + l2 * c.g,
+						l0 * a.b + l1 * b.b + l2 * c.b);
+				}
+			}
+			w0 += e0dx;
+			w1 += e1dx;
+			w2 += e2dx;
+		}
+		row0 += e0dy;
+		row1 += e1dy;
+		row2 += e2dy;
+	}
+}
+
+void CSoftRasterizer::drawLine(const Vertex& a, const Vertex& b, int x0, int y0, int x1, int y1)
+{
+	// clip the segment to the tile first, so a long edge binned to many
+	// tiles only walks its pixels inside each of them
+	float dx = b.x - a.x, dy = b.y - a.y;
+	float t0 = 0, t1 = 1;
+	float p[4] = { -dx, dx, -dy, dy };
+	float q[4] = { a.x - x0, (x1 - 0.001f) - a.x, a.y - y0, (y1 - 0.001f) - a.y };
+	for (int i = 0; i < 4; i++) {
+		if (p[i] == 0) {
+			if (q[i] < 0)
+				return;
+			continue;
+		}
+		float r = q[i] / p[i];
+		if (p[i] < 0)
+			t0 = std::max(t0, r);
+		else
+			t1 = std::min(t1, r);
+	}
+	if (t0 > t1)
+		return;
+
+	int steps = (int)ceilf(std::max(fabsf(dx), fabsf(dy)) * (t1 - t0)) + 1;
+	for (int s = 0; s <= steps; s++) {
+		float t = t0 + (t1 - t0) * s / steps;
+		int x = (int)(a.x + dx * t);
+		int y = (int)(a.y + dy * t);
+		if (x < x0 || x >= x1 || y < y0 || y >= y1)
+			continue;
+		float z = a.z + (b.z - a.z) * t;
+		int i = y * m_width + x;
+		if (z <= m_depth[i]) {
+			m_depth[i] = z;
+			m_color[i] = packColor(a.r + (b.r - a.r) * t, a.g + (b.g - a.g) * t, a.b + (b.b - a.b) * t);
+		}
+	}
+}
+
+void CSoftRasterizer::doPass(int pass, int thread)
+{
+	if (pass == PASS_BIN) {
+		binTriangles(thread);
+		return;
+	}
+	int tiles = m_tilesX * m_tilesY;
+	for (;;) {
+		int tile = m_nextTile++;
+		if (tile >= tiles)
+			break;
+		rasterizeTile(tile);
+	}
+}
+
+void CSoftRasterizer::runPass(int pass)
+{
+	if (m_workers.empty()) {
+		doPass(pass, 0);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pass = pass;
+		m_busy = (int)m_workers.size();
+		m_generation++;
+	}
+	m_wake.notify_all();
+	doPass(pass, 0);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this] { return m_busy == 0; });
+}
+
+void CSoftRasterizer::workerMain(int thread, unsigned seen)
+{
+	for (;;) {
+		int pass;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this, seen] { return m_stop || m_generation != seen; });
+			if (m_stop)
+				return;
+			seen = m_generation;
+			pass = m_pass;
+		}
+		doPass(pass, thread);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (--m_busy == 0)
+				m_done.notify_one();
+		}
+	}
+}
+
+unsigned CSoftRasterizer::getChecksum(void) const
+{
+	unsigned h = 2166136261u;
+	for (size_t i = 0; i < m_color.size(); i++) {
+		unsigned c = m_color[i];
+		for (int k = 0; k < 3; k++) {
+			h ^= (c >> (k * 8)) & 0xff;
+			h *= 16777619u;
+		}
+	}
+	return h;
+}
+
+bool CSoftRasterizer::writePpm(const char* path) const
+{
+	FILE* fp = fopen(path, "wb");
+	if (fp == NULL)
+		return false;
+	fprintf(fp, "P6\n%d %d\n255\n", m_width, m_height);
+	std::vector<unsigned char> row(m_width * 3);
+	for (int y = 0; y < m_height; y++) {
+		for (int x = 0; x < m_width; x++) {
+			unsigned c = m_color[y * m_width + x];
+			row[x * 3] = (unsigned char)(c >> 16);
+			row[x * 3 + 1] = (unsigned char)(c >> 8);
+			row[x * 3 + 2] = (unsigned char)c;
+		}
+		if (m_width > 0)
+			fwrite(&row[0], 1, row.size(), fp);
+	}
+	fclose(fp);
+	return true;
+}
@@ -0,0 +1,155 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: softRaster.h
+//
+// Desc: Software render backend for machines without a D3D device. It covers
+//       the fixed function subset the game uses: world/view/projection
+//       transform, Gouraud shaded point lights with D3D's lighting formula,
+//       a depth buffer, back face culling and solid or wireframe fill.
+//       Draw calls only transform and light their triangles; endFrame()
+//       bins them into screen tiles and rasterizes the tiles on all worker
+//       threads. Each tile keeps submission order, so the image does not
+//       depend on the thread count.
+//       CSoftMeshFactory makes the box and sphere meshes the backend draws,
+//       laid out like D3DXCreateBox / D3DXCreateSphere.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __softRasterH__
+#define __softRasterH__
+
+#include "renderQueue.h"
+#include "meshCache.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// position + normal per vertex, clockwise front faces (D3D)
+struct SoftMesh {
+	std::vector<float>		vertices;	// x, y, z, nx, ny, nz
+	std::vector<unsigned>	indices;
+	int getVertexCount(void) const { return (int)vertices.size() / 6; }
+	int getTriangleCount(void) const { return (int)indices.size() / 3; }
+};
+
+class CSoftMeshFactory : public CMeshFactory {
+public:
+	void* createMesh(const MeshKey& key, unsigned& bytes);
+	void destroyMesh(void* mesh);
+};
+
+// D3DLIGHT9 point light fields
+struct SoftLight {
+	float position[3];
+	float diffuse[4], specular[4], ambient[4];
+	float range;
+	float attenuation0, attenuation1, attenuation2;
+};
+
+struct SoftRasterStats {
+	int triangles;		// submitted by draw calls
+	int culled;			// back facing or outside the frustum
+	int clipped;		// crossed the near plane and were cut
+	int binned;			// triangle-tile pairs rasterized
+};
+
+class CSoftRasterizer : public CRenderBackend {
+public:
+	enum FillMode { FILL_SOLID, FILL_WIREFRAME };
+	enum { TILE_SIZE = 64, MAX_LIGHTS = 2 };
+
+	CSoftRasterizer(void);
+	~CSoftRasterizer(void);
+
+public:
+	// 0 = one per hardware thread; the calling thread is one of them
+	void setThreadCount(int count);
+	int getThreadCount(void) const { return m_threadCount; }
+
+	void resize(int width, int height);
+	int getWidth(void) const { return m_width; }
+	int getHeight(void) const { return m_height; }
+
+	// row major, like D3DXMATRIX
+	void setView(const float view[16]);
+	void setProjection(const float proj[16]);
+	void setLight(int i, const SoftLight& light, bool enable);
+	void setFillMode(FillMode mode) { m_fill = mode; }
+
+	// drops the triangles of the last frame; the buffers are cleared per
+	// tile while rasterizing
+	void beginFrame(unsigned clearColor);
+	// bins and rasterizes every triangle drawn since beginFrame()
+	void endFrame(void);
+
+	// CRenderBackend; meshes come from CSoftMeshFactory
+	void setMaterial(const RenderMaterial& material);
+	void setTransform(const float world[16]);
+	void drawMesh(const void* mesh, int subset);
+
+	// 0x00RRGGBB like D3DCOLOR_XRGB, top row first
+	const unsigned* getColor(void) const { return m_width ? &m_color[0] : 0; }
+	const float* getDepth(void) const { return m_width ? &m_depth[0] : 0; }
+	// FNV-1a of the color buffer, for comparing images
+	unsigned getChecksum(void) const;
+	bool writePpm(const char* path) const;
+	const SoftRasterStats& getStats(void) const { return m_stats; }
+
+private:
+	struct Vertex {
+		float x, y, z;			// screen x, y and z / w
+		float r, g, b;
+	};
+	struct Triangle {
+		Vertex v[3];
+		int minX, minY, maxX, maxY;		// pixel bounds, clamped to the screen
+	};
+
+	void lightVertex(const float p[3], const float n[3], float rgb[3]) const;
+	void addTriangle(const float clip[3][4], const float rgb[3][3]);
+	void addClipped(const float clip[3][4], const float rgb[3][3]);
+
+	void binTriangles(int thread);
+	void rasterizeTile(int tile);
+	void fillTriangle(const Triangle& t, int x0, int y0, int x1, int y1);
+	void drawLine(const Vertex& a, const Vertex& b, int x0, int y0, int x1, int y1);
+
+	// runs pass on every thread (0 = caller) and waits for all of them
+	void runPass(int pass);
+	void workerMain(int thread, unsigned generation);
+	void doPass(int pass, int thread);
+	void stopWorkers(void);
+
+	int							m_width, m_height;
+	int							m_tilesX, m_tilesY;
+	std::vector<unsigned>		m_color;
+	std::vector<float>			m_depth;
+	unsigned					m_clearColor;
+
+	float						m_view[16], m_proj[16], m_viewProj[16];
+	float						m_world[16];
+	float						m_eye[3];
+	RenderMaterial				m_material;
+	SoftLight					m_lights[MAX_LIGHTS];
+	bool						m_lightOn[MAX_LIGHTS];
+	FillMode					m_fill;
+
+	std::vector<Triangle>		m_tris;
+	// m_bins[thread][tile]: triangles of the thread's share that touch the tile
+	std::vector<std::vector<std::vector<int> > > m_bins;
+	std::atomic<int>			m_nextTile;
+	SoftRasterStats				m_stats;
+
+	int							m_threadCount;
+	std::vector<std::thread>	m_workers;
+	std::mutex					m_mutex;
+	std::condition_variable		m_wake, m_done;
+	int							m_pass;			// pass the workers run next
+	unsigned					m_generation;	// bumped per pass
+	int							m_busy;			// workers still in the pass
+	bool						m_stop;
+};
+
+#endif // __softRasterH__
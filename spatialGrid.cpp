@@ -0,0 +1,173 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: spatialGrid.cpp
+//
+// Desc: Uniform XZ grid broadphase (see spatialGrid.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "spatialGrid.h"
+#include <cmath>
+
+CSpatialGrid::CSpatialGrid(void)
+{
+	m_minX = 0;
+	m_minZ = 0;
+	m_cellSize = 1.0f;
+	m_invCellSize = 1.0f;
+	m_cellsX = 0;
+	m_cellsZ = 0;
+	m_objectCount = 0;
+	m_queryStamp = 0;
+}
+
+void CSpatialGrid::init(float minX, float minZ, float width, float depth, float cellSize)
+{
+	m_minX = minX;
+	m_minZ = minZ;
+	m_cellSize = cellSize;
+	m_invCellSize = 1.0f / cellSize;
+	m_cellsX = (int)ceil(width * m_invCellSize);
+	m_cellsZ = (int)ceil(depth * m_invCellSize);
+	if (m_cellsX < 1) m_cellsX = 1;
+	if (m_cellsZ < 1) m_cellsZ = 1;
+
+	m_cells.clear();
+	m_cells.resize(m_cellsX * m_cellsZ);
+	m_ranges.clear();
+	m_stamp.clear();
+	m_objectCount = 0;
+	m_queryStamp = 0;
+}
+
+void CSpatialGrid::clear(void)
+{
+	for (size_t i = 0; i < m_cells.size(); i++)
+		m_cells[i].clear();
+	m_ranges.clear();
+	m_stamp.clear();
+	m_objectCount = 0;
+}
+
+float CSpatialGrid::clampCell(float c, float limit)
+{
+	// written so that NaN also ends up in cell 0
+	if (!(c > 0.0f))
+		return 0.0f;
+	return c < limit ? c : limit;
+}
+
+void CSpatialGrid::toCellRange(float minX, float minZ, float maxX, float maxZ, CellRange& range) const
+{
+	// anything outside the grid is clamped into the border cells (clamped
+	// as floats first, so far away or huge coordinates cannot overflow int)
+	float limitX = (float)m_cellsX, limitZ = (float)m_cellsZ;
+	float fx0 = clampCell((minX - m_minX) * m_invCellSize, limitX);
+	float fz0 = clampCell((minZ - m_minZ) * m_invCellSize, limitZ);
+	float fx1 = clampCell((maxX - m_minX) * m_invCellSize, limitX);
+	float fz1 = clampCell((maxZ - m_minZ) * m_invCellSize, limitZ);
+	range.x0 = (int)floor(fx0);
+	range.z0 = (int)floor(fz0);
+	range.x1 = (int)floor(fx1);
+	range.z1 = (int)floor(fz1);
+
+	if (range.x1 >= m_cellsX) range.x1 = m_cellsX - 1;
+	if (range.z1 >= m_cellsZ) range.z1 = m_cellsZ - 1;
+	if (range.x0 >= m_cellsX) range.x0 = m_cellsX - 1;
+	if (range.z0 >= m_cellsZ) range.z0 = m_cellsZ - 1;
+	if (range.x0 > range.x1) range.x0 = range.x1;
+	if (range.z0 > range.z1) range.z0 = range.z1;
+}
+
+void CSpatialGrid::insert(int id, float minX, float minZ, float maxX, float maxZ)
+{
+	if (id < 0)
+		return;
+	if (id >= (int)m_ranges.size()) {
+		CellRange empty = { 0, 0, -1, -1, false };
+		m_ranges.resize(id + 1, empty);
+		m_stamp.resize(id + 1, 0);
+	}
+	if (m_ranges[id].inserted)
+		remove(id);
+
+	CellRange& range = m_ranges[id];
+	toCellRange(minX, minZ, maxX, maxZ, range);
+	range.inserted = true;
+
+	for (int cz = range.z0; cz <= range.z1; cz++) {
+		for (int cx = range.x0; cx <= range.x1; cx++)
+			m_cells[cellIndex(cx, cz)].push_back(id);
+	}
+	m_objectCount++;
+}
+
+void CSpatialGrid::remove(int id)
+{
+	if (!contains(id))
+		return;
+
+	CellRange& range = m_ranges[id];
+	for (int cz = range.z0; cz <= range.z1; cz++) {
+		for (int cx = range.x0; cx <= range.x1; cx++) {
+			std::vector<int>& cell = m_cells[cellIndex(cx, cz)];
+			for (size_t k = 0; k < cell.size(); k++) {
+				if (cell[k] == id) {
+					// order inside a cell does not matter
+					cell[k] = cell.back();
+					cell.pop_back();
+					break;
+				}
+			}
+		}
+	}
+	range.inserted = false;
+	m_objectCount--;
+}
+
+bool CSpatialGrid::contains(int id) const
+{
+	return id >= 0 && id < (int)m_ranges.size() && m_ranges[id].inserted;
+}
+
+void CSpatialGrid::query(float minX, float minZ, float maxX, float maxZ, std::vector<int>& out) const
+{
+	queryMarked(minX, minZ, maxX, maxZ, out, m_stamp, m_queryStamp);
+}
+
+void CSpatialGrid::query(float minX, float minZ, float maxX, float maxZ, std::vector<int>& out, GridQueryMarks& marks) const
+{
+	if (marks.stamp.size() < m_stamp.size())
+		marks.stamp.resize(m_stamp.size(), 0);
+	queryMarked(minX, minZ, maxX, maxZ, out, marks.stamp, marks.queryStamp);
+}
+
+void CSpatialGrid::queryMarked(float minX, float minZ, float maxX, float maxZ, std::vector<int>& out,
+	std::vector<unsigned int>& stamp, unsigned int& queryStamp) const
+{
+	if (m_cells.empty())
+		return;
+
+	if (++queryStamp == 0) {
+		// stamp wrapped around, forget every old mark
+		for (size_t i = 0; i < stamp.size(); i++)
+			stamp[i] = 0;
+		queryStamp = 1;
+	}
+
+	CellRange range;
+	toCellRange(minX, minZ, maxX, maxZ, range);
+
+	for (int cz = range.z0; cz <= range.z1; cz++) {
+		for (int cx = range.x0; cx <= range.x1; cx++) {
+			const std::vector<int>& cell = m_cells[cellIndex(cx, cz)];
+			for (size_t k = 0; k < cell.size(); k++) {
+				int id = cell[k];
+				if (stamp[id] != queryStamp) {
+					stamp[id] = queryStamp;
+					out.push_back(id);
+				}
+			}
+		}
+	}
+}
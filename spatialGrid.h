@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: spatialGrid.h
+//
+// Desc: Uniform grid over the XZ plane used as a collision broadphase.
+//       Objects are registered by id (index into the owner's array) with
+//       their XZ bounds and can be removed again when they are destroyed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __spatialGridH__
+#define __spatialGridH__
+
+#include <vector>
+
+// duplicate marks of one query caller (see CSpatialGrid::query)
+struct GridQueryMarks {
+	std::vector<unsigned int>	stamp;
+	unsigned int				queryStamp;
+
+	GridQueryMarks(void) : queryStamp(0) {}
+};
+
+class CSpatialGrid {
+public:
+	CSpatialGrid(void);
+	~CSpatialGrid(void) {}
+
+public:
+	// covers [minX, minX + width] x [minZ, minZ + depth] with square cells
+	void init(float minX, float minZ, float width, float depth, float cellSize);
+	void clear(void);
+
+	void insert(int id, float minX, float minZ, float maxX, float maxZ);
+	void remove(int id);
+	bool contains(int id) const;
+
+	// appends every id whose cells overlap the given XZ rectangle (no duplicates)
+	void query(float minX, float minZ, float maxX, float maxZ, std::vector<int>& out) const;
+	// the same with the caller's duplicate marks instead of the grid's, so
+	// several threads can query at once (the other query is one thread at
+	// a time). Same ids in the same order
+	void query(float minX, float minZ, float maxX, float maxZ, std::vector<int>& out, GridQueryMarks& marks) const;
+
+	int getCellCountX(void) const { return m_cellsX; }
+	int getCellCountZ(void) const { return m_cellsZ; }
+	float getCellSize(void) const { return m_cellSize; }
+	int getObjectCount(void) const { return m_objectCount; }
+
+private:
+	struct CellRange {
+		int x0, z0, x1, z1;
+		bool inserted;
+	};
+
+	static float clampCell(float c, float limit);
+	void toCellRange(float minX, float minZ, float maxX, float maxZ, CellRange& range) const;
+	int cellIndex(int cx, int cz) const { return cz * m_cellsX + cx; }
+	void queryMarked(float minX, float minZ, float maxX, float maxZ, std::vector<int>& out,
+		std::vector<unsigned int>& stamp, unsigned int& queryStamp) const;
+
+	float					m_minX;
+	float					m_minZ;
+	float					m_cellSize;
+	float					m_invCellSize;
+	int						m_cellsX;
+	int						m_cellsZ;
+	int						m_objectCount;
+
+	std::vector<std::vector<int> >	m_cells;
+	std::vector<CellRange>			m_ranges;	// per id, which cells it was put in
+
+	// query() marks visited ids with the current stamp to skip duplicates
+	mutable std::vector<unsigned int>	m_stamp;
+	mutable unsigned int				m_queryStamp;
+};
+
+#endif // __spatialGridH__
@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: sphereLod.cpp
+//
+// Desc: Sphere level of detail selection (see sphereLod.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "sphereLod.h"
+#include <cstring>
+
+// the old single mesh was 50 x 50 for everything
+static const CSphereLod::Level s_levels[SPHERE_LOD_LEVELS] = {
+	{ 50, 50, 64.0f },
+	{ 24, 16, 20.0f },
+	{ 12, 8, 6.0f },
+	{ 8, 5, 0.0f }
+};
+
+CSphereLod::CSphereLod(void)
+{
+	m_hysteresis = 0.15f;
+	beginFrame();
+}
+
+const CSphereLod::Level& CSphereLod::getLevel(int level)
+{
+	return s_levels[level];
+}
+
+int CSphereLod::getTriangles(int level)
+{
+	return 2 * s_levels[level].slices * (s_levels[level].stacks - 1);
+}
+
+float CSphereLod::projectRadius(float radius, float viewDepth, float projScale, float viewportHeight)
+{
+	// the camera is inside or right next to the sphere
+	if (viewDepth <= radius)
+		return viewportHeight;
+	return radius * projScale * 0.5f * viewportHeight / viewDepth;
+}
+
+int CSphereLod::select(float pixels, int current) const
+{
+	if (current < 0 || current >= SPHERE_LOD_LEVELS) {
+		// nothing drawn yet, no margin
+		int level = 0;
+		while (level < SPHERE_LOD_LEVELS - 1 && pixels < s_levels[level].minPixels)
+			level++;
+		return level;
+	}
+	// finer: past the next level's threshold by the margin
+	while (current > 0 && pixels >= s_levels[current - 1].minPixels * (1.0f + m_hysteresis))
+		current--;
+	// coarser: below this level's threshold by the margin
+	while (current < SPHERE_LOD_LEVELS - 1 && pixels < s_levels[current].minPixels * (1.0f - m_hysteresis))
+		current++;
+	return current;
+}
+
+void CSphereLod::beginFrame(void)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void CSphereLod::count(int level)
+{
+	m_stats.spheres++;
+	m_stats.triangles += getTriangles(level);
+	m_stats.fullTriangles += getTriangles(0);
+	m_stats.perLevel[level]++;
+}
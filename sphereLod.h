@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: sphereLod.h
+//
+// Desc: Tessellation levels for sphere meshes, picked per object each frame
+//       from the sphere's projected radius in pixels. A level only changes
+//       once the radius is a margin past the threshold, so a sphere sitting
+//       near a boundary does not pop between two meshes every frame.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __sphereLodH__
+#define __sphereLodH__
+
+#define SPHERE_LOD_LEVELS 4
+
+struct SphereLodStats {
+	int spheres;
+	int triangles;			// triangles actually submitted
+	int fullTriangles;		// triangles at level 0 for every sphere
+	int perLevel[SPHERE_LOD_LEVELS];
+};
+
+class CSphereLod {
+public:
+	struct Level {
+		int slices, stacks;
+		float minPixels;	// smallest projected radius drawn at this level
+	};
+
+	CSphereLod(void);
+	~CSphereLod(void) {}
+
+public:
+	// level 0 is the finest
+	static const Level& getLevel(int level);
+	// faces D3DXCreateSphere makes for the level
+	static int getTriangles(int level);
+	// projected radius in pixels; projScale is the projection's _22 and
+	// viewDepth the view space z of the center
+	static float projectRadius(float radius, float viewDepth, float projScale, float viewportHeight);
+
+	// fraction of a threshold the radius has to pass it by before switching
+	void setHysteresis(float fraction) { m_hysteresis = fraction; }
+	float getHysteresis(void) const { return m_hysteresis; }
+
+	// level for a sphere drawn at current last frame (-1 = first frame)
+	int select(float pixels, int current) const;
+
+	// per-frame triangle counters
+	void beginFrame(void);
+	void count(int level);
+	const SphereLodStats& getStats(void) const { return m_stats; }
+
+private:
+	float			m_hysteresis;
+	SphereLodStats	m_stats;
+};
+
+#endif // __sphereLodH__
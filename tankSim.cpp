@@ -0,0 +1,659 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: tankSim.cpp
+//
+// Desc: Game rules, tanks and aim target of the simulation core
+//       (see tankSim.h).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "tankSim.h"
+#include <cmath>
+#include <algorithm>
+
+// -----------------------------------------------------------------------------
+// CSimTank
+// -----------------------------------------------------------------------------
+
+CSimTank::CSimTank(int player)
+{
+	m_player = player;
+	m_velocityX = 0;
+	m_velocityZ = 0;
+	m_created = false;
+	m_isDistanceZero = false;
+	m_distance = TANK_DISTANCE;
+}
+
+SimVec3 CSimTank::getPartSize(int i)
+{
+	switch (i) {
+	case 0: return SimVec3(0.7f, 0.375f, 1.5f);
+	case 1: return SimVec3(0.55f, 0.32f, 0.825f);
+	case 2: return SimVec3(0.12f, 0.12f, 1.4f);
+	case 3:
+	case 4: return SimVec3(0.12f, 0.2f, 1.4f);
+	default: return SimVec3(0.122f, 0.2f, 1.35f);
+	}
+}
+
+SimVec3 CSimTank::getPartOffset(int i) const
+{
+	switch (i) {
+	case 1: return SimVec3(0, 0.35f, m_player == 1 ? 0.3f : -0.3f);
+	case 2: return SimVec3(0, 0.35f, 0);
+	case 3: return SimVec3(-0.24375f, -0.28f, 0);
+	case 4: return SimVec3(0.24375f, -0.28f, 0);
+	case 5: return SimVec3(-0.24375f, -0.24f, 0);
+	case 6: return SimVec3(0.24375f, -0.24f, 0);
+	default: return SimVec3(0, 0, 0);
+	}
+}
+
+void CSimTank::create(void)
+{
+	// part boxes are registered once in tank space; moving only changes the origin
+	m_collider.clear();
+	for (int i = 0; i < PART_COUNT; i++) {
+		SimVec3 o = getPartOffset(i);
+		SimVec3 s = getPartSize(i);
+		m_collider.addChild(o.x, o.y, o.z, s.x, s.y, s.z, i < 3 ? TANK_GROUP_HULL : TANK_GROUP_TRACKS);
+	}
+	m_collider.setOrigin(m_center.x, m_center.y, m_center.z);
+	m_created = true;
+}
+
+void CSimTank::setPosition(float x, float y, float z)
+{
+	m_center = SimVec3(x, y, z);
+	m_collider.setOrigin(x, y, z);
+}
+
+void CSimTank::getFootprint(float& minX, float& minZ, float& maxX, float& maxZ) const
+{
+	float bmin[3], bmax[3];
+	m_collider.getBounds(TANK_GROUP_HULL, bmin, bmax);
+	minX = bmin[0];
+	minZ = bmin[2];
+	maxX = bmax[0];
+	maxZ = bmax[2];
+}
+
+bool CSimTank::bodyOverlaps(const CSimTank& other) const
+{
+	float amin[3], amax[3], bmin[3], bmax[3];
+	m_collider.getChildBounds(0, amin, amax);
+	other.m_collider.getChildBounds(0, bmin, bmax);
+	for (int a = 0; a < 3; a++) {
+		if (bmin[a] > amax[a] || bmax[a] < amin[a])
+			return false;
+	}
+	return true;
+}
+
+bool CSimTank::hitsObstacle(const CAabbStore& boxes, int i) const
+{
+	if (!boxes.isAlive(i))
+		return false;
+	float bmin[3], bmax[3];
+	boxes.getBox(i, bmin, bmax);
+	return m_collider.overlapsBox(bmin, bmax, TANK_GROUP_HULL);
+}
+
+bool CSimTank::update(float timeDiff, const CAabbStore& obstacleBoxes, const CSpatialGrid& obstacleGrid,
+	const CSimTank& other, const CCollisionWorld& world)
+{
+	if (!m_created)
+		return false;
+	SimVec3 cord = m_center;
+
+	float tX = cord.x + SIM_MOVE_SCALE * timeDiff * m_velocityX;
+	float tZ = cord.z + SIM_MOVE_SCALE * timeDiff * m_velocityZ;
+
+	// the tank stops at obstacles, the other tank and the walls
+	setPosition(tX, cord.y, tZ);
+	// only the obstacles in the grid cells under the tank can be hit
+	float minX, minZ, maxX, maxZ;
+	getFootprint(minX, minZ, maxX, maxZ);
+	m_nearby.clear();
+	obstacleGrid.query(minX, minZ, maxX, maxZ, m_nearby);
+	for (size_t k = 0; k < m_nearby.size(); k++) {
+		if (hitsObstacle(obstacleBoxes, m_nearby[k])) {
+			tX = cord.x;
+			tZ = cord.z;
+			break;
+		}
+	}
+	if (other.isAlive() && bodyOverlaps(other)) {
+		tX = cord.x;
+		tZ = cord.z;
+	}
+	float bmin[3], bmax[3];
+	m_collider.getChildBounds(0, bmin, bmax);
+	if (world.overlaps(bmin, bmax, CCollisionWorld::KIND_WALL)) {
+		tX = cord.x;
+		tZ = cord.z;
+	}
+	setPosition(tX, cord.y, tZ);
+
+	if ((m_center.x != m_lastCoord.x || m_center.z != m_lastCoord.z) && m_distance > 0 && !m_isDistanceZero) {
+		m_distance = m_distance - (float)sqrt(pow(m_center.x - m_lastCoord.x, 2) + pow(m_center.z - m_lastCoord.z, 2));
+		m_lastCoord = m_center;
+	}
+	if (m_distance <= 0)
+		m_isDistanceZero = true;
+	if (m_isDistanceZero && m_distance <= 0) {
+		setPower(0, 0);
+		m_distance = 0.1f;
+		return true;
+	}
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// CSimTarget
+// -----------------------------------------------------------------------------
+
+void CSimTarget::linkTank(const CSimTank* tank)
+{
+	m_tank = tank;
+	m_tankLastX = tank->getCenter().x;
+	m_tankLastZ = tank->getCenter().z;
+}
+
+void CSimTarget::update(float timeDiff)
+{
+	SimVec3 cord = m_center;
+	double tankX = m_tank->getCenter().x;
+	double tankZ = m_tank->getCenter().z;
+
+	float tX = cord.x + SIM_MOVE_SCALE * timeDiff * m_velocity.x;
+	float tY = cord.y + SIM_MOVE_SCALE * timeDiff * m_velocity.y;
+	float tZ = cord.z + SIM_MOVE_SCALE * timeDiff * m_velocity.z;
+
+	// never below the floor
+	if (tY < 0 + M_RADIUS)
+		tY = M_RADIUS;
+
+	// follows the tank
+	tX += (float)(tankX - m_tankLastX);
+	tZ += (float)(tankZ - m_tankLastZ);
+	setCenter(tX, tY, tZ);
+
+	// an axis that left the range around the tank stops, and the target is
+	// nudged back toward the tank so the next key can move it again
+	if (fabs(tankX - tX) > MAX_BLUEBALL_WIDTH) {
+		m_velocity.x = 0;
+		double epsilon = 0.00001;
+		if (tX > tankX) epsilon *= -1;
+		setCenter((float)(tX + epsilon), tY, tZ);
+	}
+	double diffFromTankZ = fabs(tankZ - tZ);
+	if (diffFromTankZ > MAX_BLUEBALL_RADIUS || diffFromTankZ < MIN_BLUEBALL_RADIUS) {
+		m_velocity.z = 0;
+		double epsilon = 0.00001;
+		if (tZ > tankZ) epsilon *= -1;
+		setCenter(tX, tY, (float)(tZ + epsilon));
+	}
+
+	m_tankLastX = tankX;
+	m_tankLastZ = tankZ;
+}
+
+// -----------------------------------------------------------------------------
+// CTankSim
+// -----------------------------------------------------------------------------
+
+CTankSim::CTankSim(void)
+	: m_tank(0), m_otank(1)
+{
+	m_listener = 0;
+	m_missileTag = 0;
+	m_focusTag = -1;
+	m_simTime = m_startTime = m_currTime = m_timeDiff = 0;
+	m_turnTime = TURN_TIME_MS;
+	m_started = m_finished = false;
+	m_introMovement = 0;
+	m_isOriginTank = true;
+	m_isFire = m_shotSettling = m_zoomOutTiming = false;
+	m_zoomOutSpeed = 0;
+	m_tankSpeed = TANK_SPEED_NORMAL;
+	m_fireDegree = m_fireDistance = 0;
+	m_stats.ticks = 0;
+	m_stats.turns = m_stats.shots = m_stats.obstaclesDestroyed = 0;
+}
+
+void CTankSim::init(void)
+{
+	ProjectileModel model;
+	model.gravity = (float)MISSILE_GRAVITY_RATE;
+	model.decreaseRate = (float)MISSILE_DECREASE_RATE;
+	model.moveScale = SIM_MOVE_SCALE;
+	model.groundHeight = (float)M_RADIUS;
+	model.expand = (float)M_RADIUS * 0.8f;	// margin of the old CWall::hasIntersected(CSphere&)
+	m_missiles.init(MISSILE_CAPACITY, model);
+
+	CArenaLayout::buildObstacles(m_arenaObstacles);
+	buildCollisionWorld();
+	reset();
+	buildFiringTable();
+}
+
+void CTankSim::reset(void)
+{
+	m_tank = CSimTank(0);
+	m_tank.setPosition(0, 0.38f, -WORLD_DEPTH / 2 + 5);
+	m_tank.create();
+	m_tank.setLastCoord(m_tank.getCenter());
+	m_otank = CSimTank(1);
+	m_otank.setPosition(0, 0.38f, WORLD_DEPTH / 2 - 5);
+	m_otank.create();
+	m_otank.setLastCoord(m_otank.getCenter());
+
+	m_target = CSimTarget();
+	m_target.linkTank(&m_tank);
+	// 0.01 off the tank's x: the firing quadrant math breaks on a zero x difference
+	m_target.setCenter(m_tank.getCenter().x - 0.01f, (float)M_RADIUS + 3, m_tank.getCenter().z + 5.0f);
+
+	m_missiles.clear();
+	m_missileTag = 0;
+	m_focusTag = -1;
+	m_missileFocus = SimVec3();
+
+	m_obstacles.clear();
+	m_obstacles.reserve((int)m_arenaObstacles.size());
+	for (size_t i = 0; i < m_arenaObstacles.size(); i++) {
+		SimObstacle o = { m_arenaObstacles[i], (int)i };
+		m_obstacles.add(o);
+	}
+	buildObstacleIndex();
+
+	m_simTime = m_startTime = m_currTime = m_timeDiff = 0;
+	m_turnTime = TURN_TIME_MS;
+	m_started = m_finished = false;
+	m_introMovement = 0;
+	m_isOriginTank = true;
+	m_isFire = m_shotSettling = m_zoomOutTiming = false;
+	m_zoomOutSpeed = 0;
+	m_tankSpeed = TANK_SPEED_NORMAL;
+
+	// zero, so the first tick computes the aim
+	m_fireDegree = m_fireDistance = 0;
+	m_lastHead = m_lastTarget = SimVec3();
+
+	m_stats.ticks = 0;
+	m_stats.turns = m_stats.shots = m_stats.obstaclesDestroyed = 0;
+}
+
+// The missile flight only depends on the fire degree/distance and the launch
+// height, and every tick has the same timeDelta, so the whole table is built once.
+void CTankSim::buildFiringTable(void)
+{
+	FiringModel model;
+	model.power = (float)MISSILE_POWER;
+	model.gravity = (float)MISSILE_GRAVITY_RATE;
+	model.decreaseRate = (float)MISSILE_DECREASE_RATE;
+	model.moveScale = SIM_MOVE_SCALE;
+	model.tickDelta = SIM_TICK_DELTA;
+	model.launchHeight = m_tank.getHead().y;
+	model.groundHeight = (float)M_RADIUS;
+	model.maxTicks = FIRING_TABLE_MAX_TICKS;
+	m_firingTable.build(model, FIRING_TABLE_MAX_DEGREE, FIRING_TABLE_DEGREE_STEP,
+		FIRING_TABLE_MAX_DISTANCE, FIRING_TABLE_DISTANCE_STEP);
+}
+
+// boundary walls and floor never move: the BVH is built once
+void CTankSim::buildCollisionWorld(void)
+{
+	std::vector<ArenaBox> walls;
+	CArenaLayout::buildWalls(walls);
+	m_collisionWorld.clear();
+	for (size_t i = 0; i < walls.size(); i++) {
+		float bmin[3], bmax[3];
+		walls[i].getBounds(bmin, bmax);
+		m_collisionWorld.add(bmin, bmax, i + 1 < walls.size() ? CCollisionWorld::KIND_WALL : CCollisionWorld::KIND_FLOOR);
+	}
+	m_collisionWorld.build();
+}
+
+// registers the live obstacles in the broadphase grid and the packed boxes
+void CTankSim::buildObstacleIndex(void)
+{
+	m_obstacleGrid.init(-WORLD_WIDTH / 2 - 1.0f, -WORLD_DEPTH / 2 - 1.0f, WORLD_WIDTH + 2.0f, WORLD_DEPTH + 2.0f, OBSTACLE_GRID_CELL_SIZE);
+	m_obstacleBoxes.clear();
+	m_obstacleBoxes.reserve(m_obstacles.size());
+	for (int i = 0; i < m_obstacles.size(); i++) {
+		float bmin[3], bmax[3];
+		m_obstacles.at(i).box.getBounds(bmin, bmax);
+		m_obstacleBoxes.add(bmin[0], bmin[1], bmin[2], bmax[0], bmax[1], bmax[2]);
+		if (m_obstacles.isLiveAt(i))
+			m_obstacleGrid.insert(i, bmin[0], bmin[2], bmax[0], bmax[2]);
+		else
+			m_obstacleBoxes.kill(i);
+	}
+}
+
+bool CTankSim::destroyObstacle(PoolHandle h)
+{
+	int i = m_obstacles.indexOf(h);
+	if (i < 0)
+		return false;
+	if (m_listener != 0) {
+		float bmin[3], bmax[3];
+		m_obstacleBoxes.getBox(i, bmin, bmax);
+		m_listener->onObstacleDestroyed(m_obstacles.at(i).id, bmin, bmax);
+	}
+	m_obstacles.remove(h);
+	m_obstacleGrid.remove(i);
+	m_obstacleBoxes.kill(i);
+	m_stats.obstaclesDestroyed++;
+	return true;
+}
+
+// Once enough obstacles are destroyed the live ones move to the front and the
+// grid and boxes are rebuilt. Dense indices change, so only between ticks
+void CTankSim::compactObstacles(void)
+{
+	if (!m_obstacles.needsCompaction())
+		return;
+	m_obstacles.compact();
+	buildObstacleIndex();
+}
+
+void CTankSim::queryObstaclesInSphere(float x, float y, float z, float radius, std::vector<int>& out)
+{
+	m_candidates.clear();
+	m_obstacleGrid.query(x - radius, z - radius, x + radius, z + radius, m_candidates);
+	float r = radius * 0.8f;	// margin of the old CWall::hasIntersected(x, y, z, radius)
+	for (size_t k = 0; k < m_candidates.size(); k++) {
+		int i = m_candidates[k];
+		if (m_obstacleBoxes.overlapsBox(i, x - r, y - r, z - r, x + r, y + r, z + r))
+			out.push_back(i);
+	}
+}
+
+// destroys everything in the blast radius, plus the obstacle that was hit
+int CTankSim::explodeObstacles(const SimVec3& c, PoolHandle hit)
+{
+	m_blast.clear();
+	queryObstaclesInSphere(c.x, c.y, c.z, MISSILE_EXPOLSION_RADIUS, m_blast);
+	float r = MISSILE_EXPOLSION_RADIUS * 0.8f;
+	int hitIndex = m_obstacles.indexOf(hit);
+	if (hitIndex >= 0
+		&& !m_obstacleBoxes.overlapsBox(hitIndex, c.x - r, c.y - r, c.z - r, c.x + r, c.y + r, c.z + r))
+		m_blast.push_back(hitIndex);
+
+	for (size_t k = 0; k < m_blast.size(); k++)
+		destroyObstacle(m_obstacles.handleAt(m_blast[k]));
+	return (int)m_blast.size();
+}
+
+// toward the aim target: horizontal speed from the ground distance, vertical
+// speed from the fire degree
+void CTankSim::fire(void)
+{
+	SimVec3 targetpos = m_target.getCenter();
+	SimVec3 whitepos = m_tank.getHead();
+	double theta = acos(
+		sqrt(pow(targetpos.x - whitepos.x, 2)) /
+		sqrt(pow(targetpos.x - whitepos.x, 2) + pow(targetpos.z - whitepos.z, 2))
+	);		// first quadrant
+	if (targetpos.z - whitepos.z <= 0 && targetpos.x - whitepos.x >= 0) { theta = -theta; }	// fourth
+	if (targetpos.z - whitepos.z >= 0 && targetpos.x - whitepos.x <= 0) { theta = PI - theta; }	// second
+	if (targetpos.z - whitepos.z <= 0 && targetpos.x - whitepos.x <= 0) { theta = PI + theta; }	// third
+	double distance_land = m_fireDistance;
+	double theta_sky = m_fireDegree * PI / 180;
+	double distance_sky = sqrt(pow(targetpos.x - whitepos.x, 2) + pow(targetpos.y - whitepos.y, 2) + pow(targetpos.z - whitepos.z, 2));
+
+	int tag = ++m_missileTag;
+	if (m_missiles.spawn(whitepos.x, whitepos.y, whitepos.z, (float)(distance_land * cos(theta) * MISSILE_POWER),
+		(float)(distance_sky * sin(theta_sky)), (float)(distance_land * sin(theta) * MISSILE_POWER), tag) < 0)
+		return;
+	m_focusTag = tag;
+	m_missileFocus = whitepos;
+	m_stats.shots++;
+	if (m_listener != 0)
+		m_listener->onMissileFired(whitepos);
+}
+
+// moves every missile one tick and handles what each one hit first
+// (walls, floor: gone; obstacle: explosion; other tank: game over)
+void CTankSim::updateMissiles(float timeDelta)
+{
+	if (!missilesInFlight())
+		return;
+
+	m_missiles.integrate(timeDelta);
+	m_hits.clear();
+	m_missiles.collide(m_collisionWorld, m_obstacleGrid, m_obstacleBoxes,
+		m_otank.isAlive() ? &m_otank.getCollider() : 0, m_hits);
+
+	int focus = m_missiles.find(m_focusTag);
+	if (focus >= 0)
+		m_missileFocus = SimVec3(m_missiles.getX(focus), m_missiles.getY(focus), m_missiles.getZ(focus));
+
+	for (size_t k = 0; k < m_hits.size(); k++) {
+		const ProjectileHit& hit = m_hits[k];
+		SimVec3 p(hit.x, hit.y, hit.z);
+		if (hit.tag == m_focusTag)
+			m_missileFocus = p;
+		switch (hit.kind) {
+		case CProjectilePool::HIT_OBSTACLE:
+			explodeObstacles(p, m_obstacles.handleAt(hit.index));
+			break;
+		case CProjectilePool::HIT_TARGET:
+			if (m_otank.isAlive()) {
+				m_otank.destroy();
+				m_finished = true;
+				if (m_listener != 0)
+					m_listener->onGameOver();
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+// the tanks swap places in m_tank / m_otank, so m_tank is always the player
+// whose turn it is
+void CTankSim::switchTurn(void)
+{
+	m_tank.setPower(0, 0);
+	m_tank.setIsDistanceZero(false);
+	std::swap(m_tank, m_otank);
+	m_target.linkTank(&m_tank);
+	m_otank.resetDistance();
+	m_isFire = false;
+	m_shotSettling = false;
+	m_turnTime = TURN_TIME_MS;
+	m_tankSpeed = TANK_SPEED_NORMAL;
+	m_zoomOutTiming = false;
+	m_zoomOutSpeed = 0;
+	m_startTime = m_currTime;
+
+	// the target starts 5 ahead of the tank, toward the other side
+	m_target.setCenter(m_tank.getCenter().x - 0.01f, (float)M_RADIUS + 3,
+		m_tank.getCenter().z + (m_isOriginTank ? -5.0f : 5.0f));
+	m_isOriginTank = !m_isOriginTank;
+	m_stats.turns++;
+	if (m_listener != 0)
+		m_listener->onTurnChanged();
+}
+
+void CTankSim::updateAim(void)
+{
+	SimVec3 head = m_tank.getHead();
+	SimVec3 target = m_target.getCenter();
+	if (head != m_lastHead || target != m_lastTarget) {
+		double old = m_fireDegree;
+		double oldDistance = m_fireDistance;
+		double ground = sqrt(pow(target.x - head.x, 2) + pow(target.z - head.z, 2));
+		double radian = acos(ground / sqrt(pow(target.x - head.x, 2) + pow(target.y - head.y, 2) + pow(target.z - head.z, 2)));
+		m_fireDegree = radian * 180 / PI;
+		m_fireDistance = ground;
+		if ((m_fireDegree != old || m_fireDistance != oldDistance) && m_listener != 0)
+			m_listener->onAimChanged(m_fireDegree, m_fireDistance);
+	}
+	m_lastHead = head;
+	m_lastTarget = target;
+}
+
+void CTankSim::tick(float timeDelta)
+{
+	m_simTime += SIM_TICK_MS;
+	m_stats.ticks++;
+
+	if (!missilesInFlight()) {
+		m_currTime = m_simTime;
+		m_timeDiff = m_currTime - m_startTime;
+	}
+
+	if (missilesInFlight()) {
+		m_isFire = true;
+		m_tank.setPower(0, 0);
+	}
+
+	if (m_isFire && !missilesInFlight() && !m_shotSettling) {
+		m_startTime = m_currTime;
+		m_timeDiff = 0;
+		m_turnTime = SHOT_SETTLE_MS;
+		m_shotSettling = true;
+		m_zoomOutTiming = true;
+	}
+
+	if (!m_started) {
+		m_introMovement += (float)(m_timeDiff * INTRO_CAMERA_SPEED);
+		m_startTime = m_currTime;
+		if (m_introMovement > WORLD_DEPTH)
+			m_started = true;
+	}
+	else if (m_finished) {
+		// the winner stands on the podium
+		m_tank.setPosition(0.0f, PODIUM_HEIGHT + 0.40f, 0.0f);
+		return;
+	}
+
+	if (m_zoomOutTiming)
+		m_zoomOutSpeed += ZOOM_OUT_SPEED;
+
+	if (m_timeDiff > m_turnTime)
+		switchTurn();
+
+	if (m_tank.update(timeDelta, m_obstacleBoxes, m_obstacleGrid, m_otank, m_collisionWorld))
+		m_tankSpeed = TANK_SPEED_SLOWED;
+	updateMissiles(timeDelta);
+	m_target.update(timeDelta);
+	if (m_otank.isAlive() && m_otank.update(timeDelta, m_obstacleBoxes, m_obstacleGrid, m_tank, m_collisionWorld))
+		m_tankSpeed = TANK_SPEED_SLOWED;
+	compactObstacles();
+
+	updateAim();
+}
+
+bool CTankSim::command(SimCommand cmd)
+{
+	// always: starting and letting go of keys
+	switch (cmd) {
+	case SIM_CMD_START:
+		if (m_started)
+			return false;
+		m_started = true;
+		return true;
+	case SIM_CMD_FIRE:
+		if (!m_started) {
+			m_started = true;
+			return true;
+		}
+		if (m_isFire)
+			return false;
+		fire();
+		return true;
+	case SIM_CMD_TANK_STOP_X:
+		m_tank.setPower(0, m_tank.getVelocityZ());
+		return true;
+	case SIM_CMD_TANK_STOP_Z:
+		m_tank.setPower(m_tank.getVelocityX(), 0);
+		return true;
+	case SIM_CMD_AIM_STOP_X:
+		m_target.setPower(0, m_target.getVelocity().y, m_target.getVelocity().z);
+		return true;
+	case SIM_CMD_AIM_STOP_Y:
+		m_target.setPower(m_target.getVelocity().x, 0, m_target.getVelocity().z);
+		return true;
+	case SIM_CMD_AIM_STOP_Z:
+		m_target.setPower(m_target.getVelocity().x, m_target.getVelocity().y, 0);
+		return true;
+	default:
+		break;
+	}
+
+	// moves: only while aiming
+	if (m_isFire || !m_started)
+		return false;
+	// player 1 looks down -z, so its left, right, forward and back are mirrored
+	double side = m_isOriginTank ? 1 : -1;
+	double speed = m_tankSpeed * 5;
+	SimVec3 tank = m_tank.getCenter();
+	SimVec3 target = m_target.getCenter();
+	SimVec3 v = m_target.getVelocity();
+	switch (cmd) {
+	case SIM_CMD_TANK_FORWARD:
+		m_tank.setPower(m_tank.getVelocityX(), side * speed);
+		return true;
+	case SIM_CMD_TANK_BACK:
+		m_tank.setPower(m_tank.getVelocityX(), -side * speed);
+		return true;
+	case SIM_CMD_TANK_LEFT:
+		m_tank.setPower(-side * speed, m_tank.getVelocityZ());
+		return true;
+	case SIM_CMD_TANK_RIGHT:
+		m_tank.setPower(side * speed, m_tank.getVelocityZ());
+		return true;
+	case SIM_CMD_AIM_LEFT:
+		if ((tank.x - target.x) * side >= MAX_BLUEBALL_WIDTH)
+			return false;
+		m_target.setPower(-side * BLUEBALL_VELOCITY, v.y, v.z);
+		return true;
+	case SIM_CMD_AIM_RIGHT:
+		if ((target.x - tank.x) * side >= MAX_BLUEBALL_WIDTH)
+			return false;
+		m_target.setPower(side * BLUEBALL_VELOCITY, v.y, v.z);
+		return true;
+	case SIM_CMD_AIM_FORWARD:
+		if ((target.z - tank.z) * side >= MAX_BLUEBALL_RADIUS)
+			return false;
+		m_target.setPower(v.x, v.y, side * BLUEBALL_VELOCITY);
+		return true;
+	case SIM_CMD_AIM_BACK:
+		if ((target.z - tank.z) * side <= MIN_BLUEBALL_RADIUS)
+			return false;
+		m_target.setPower(v.x, v.y, -side * BLUEBALL_VELOCITY);
+		return true;
+	case SIM_CMD_AIM_UP:
+		m_target.setPower(v.x, BLUEBALL_VELOCITY, v.z);
+		return true;
+	case SIM_CMD_AIM_DOWN:
+		m_target.setPower(v.x, -BLUEBALL_VELOCITY, v.z);
+		return true;
+	default:
+		return false;
+	}
+}
+
+void CTankSim::dragAim(float dx, float dy)
+{
+	if (!m_isOriginTank) {
+		dx = -dx;
+		dy = -dy;
+	}
+	SimVec3 c = m_target.getCenter();
+	SimVec3 tank = m_tank.getCenter();
+	double nx = c.x + dx * (-0.007f);
+	double nz = c.z + dy * (0.007f);
+	if (fabs(tank.x - nx) > MAX_BLUEBALL_WIDTH)
+		nx = c.x;
+	if (fabs(tank.z - nz) < MIN_BLUEBALL_RADIUS || fabs(tank.z - nz) > MAX_BLUEBALL_RADIUS)
+		nz = c.z;
+	m_target.setCenter((float)nx, c.y, (float)nz);
+}
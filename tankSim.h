@@ -0,0 +1,330 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: tankSim.h
+//
+// Desc: The game rules without a device: two tanks, the aim target, the
+//       missiles, the destructible obstacles and the turn clock. The game
+//       turns key presses into SimCommand values, calls tick() at
+//       SIM_TICK_RATE and draws whatever state it finds afterwards; the
+//       headless tool (tankSimMain.cpp) drives the same class from a script.
+//       Anything the renderer has to mirror (destroyed obstacles, turn
+//       changes) is reported through CSimListener.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __tankSimH__
+#define __tankSimH__
+
+#include "simMath.h"
+#include "handlePool.h"
+#include "spatialGrid.h"
+#include "aabbStore.h"
+#include "collisionWorld.h"
+#include "compoundCollider.h"
+#include "projectiles.h"
+#include "firingTable.h"
+#include "arenaLayout.h"
+#include <vector>
+
+#define M_RADIUS 0.06   // ball radius
+#define PI 3.14159265
+
+#define BLUEBALL_VELOCITY 0.8 // aim target speed
+#define MAX_BLUEBALL_RADIUS 15  // how far ahead the aim target may go
+#define MIN_BLUEBALL_RADIUS 0.4 // how close to the tank it may come
+#define MAX_BLUEBALL_WIDTH 1 // how far the aim target may go sideways
+
+#define MISSILE_POWER 1.25
+#define MISSILE_GRAVITY_RATE 3.5
+#define MISSILE_DECREASE_RATE 0.9985  // missile drag
+#define MISSILE_EXPOLSION_RADIUS M_RADIUS+1.5 // blast radius
+#define MISSILE_CAPACITY 256 // missiles in flight at once
+
+#define WORLD_WIDTH 24
+#define WORLD_DEPTH 100
+
+#define OBSTACLE_GRID_CELL_SIZE 2.0f // broadphase grid cell size
+#define TANK_DISTANCE 30
+#define TANK_GROUP_HULL 1 // body, turret, barrel (hit obstacles)
+#define TANK_GROUP_TRACKS 2 // tracks (only hit by missiles)
+#define TANK_SPEED_NORMAL 0.45
+#define TANK_SPEED_SLOWED 0.05 // once TANK_DISTANCE is used up
+#define SIM_MOVE_SCALE 3.3f // velocity scale of tanks, aim target and missiles (TIME_SCALE of the old ballUpdate)
+
+#define SIM_TICK_RATE 120.0f // simulation ticks per second
+#define SIM_TICK_MS (1000.0 / SIM_TICK_RATE)
+#define SIM_TIME_SCALE 0.7f // game time per real second (the old timeDelta = ms * 0.0007)
+#define SIM_TICK_DELTA (SIM_TIME_SCALE / SIM_TICK_RATE) // timeDelta of one tick()
+#define ZOOM_OUT_SPEED 0.0018f // camera zoom out per tick after the missile exploded
+#define INTRO_CAMERA_SPEED 0.01f // intro camera travel per ms
+#define TURN_TIME_MS 20000 // one turn
+#define SHOT_SETTLE_MS 3000 // from the last explosion to the next turn
+#define PODIUM_HEIGHT 1.2f // the winner is put on a podium this high at the origin
+
+#define FIRING_TABLE_MAX_DEGREE 89.0f // firing table range (shots outside are simulated)
+#define FIRING_TABLE_DEGREE_STEP 1.0f
+#define FIRING_TABLE_MAX_DISTANCE 16.0f
+#define FIRING_TABLE_DISTANCE_STEP 0.25f
+#define FIRING_TABLE_MAX_TICKS 20000
+
+// What a player can do. The tank and aim directions are seen from the
+// player's own side of the arena, like the keys: forward is toward the
+// other tank for both players
+enum SimCommand {
+	SIM_CMD_START,			// skip the intro
+	SIM_CMD_FIRE,			// fire at the aim target (also skips the intro)
+	SIM_CMD_TANK_FORWARD,
+	SIM_CMD_TANK_BACK,
+	SIM_CMD_TANK_LEFT,
+	SIM_CMD_TANK_RIGHT,
+	SIM_CMD_TANK_STOP_X,	// key up: A, D
+	SIM_CMD_TANK_STOP_Z,	// key up: W, S
+	SIM_CMD_AIM_LEFT,
+	SIM_CMD_AIM_RIGHT,
+	SIM_CMD_AIM_FORWARD,
+	SIM_CMD_AIM_BACK,
+	SIM_CMD_AIM_UP,
+	SIM_CMD_AIM_DOWN,
+	SIM_CMD_AIM_STOP_X,
+	SIM_CMD_AIM_STOP_Y,
+	SIM_CMD_AIM_STOP_Z,
+	SIM_COMMAND_COUNT
+};
+
+// Events the renderer (or a headless driver) mirrors; all of them are
+// raised from inside tick() or command(), on the thread that called it
+class CSimListener {
+public:
+	virtual ~CSimListener(void) {}
+	// id is the obstacle's place in CArenaLayout::buildObstacles()
+	virtual void onObstacleDestroyed(int /*id*/, const float /*bmin*/[3], const float /*bmax*/[3]) {}
+	virtual void onMissileFired(const SimVec3& /*pos*/) {}
+	// right after the tanks swapped, before they move this tick
+	virtual void onTurnChanged(void) {}
+	virtual void onGameOver(void) {}
+	// fire degree / distance changed (aim preview)
+	virtual void onAimChanged(double /*degree*/, double /*distance*/) {}
+};
+
+// -----------------------------------------------------------------------------
+// CSimTank: seven part boxes moving together (body, turret, barrel, tracks)
+// -----------------------------------------------------------------------------
+class CSimTank {
+public:
+	enum { PART_COUNT = 7 };
+
+	// player 0 starts at -z facing +z, player 1 the other way
+	explicit CSimTank(int player = 0);
+
+public:
+	void create(void);
+	void destroy(void) { m_created = false; }
+	bool isAlive(void) const { return m_created; }
+	int getPlayer(void) const { return m_player; }
+
+	// size (width, height, depth) and center offset of each part
+	static SimVec3 getPartSize(int i);
+	SimVec3 getPartOffset(int i) const;
+	SimVec3 getPartCenter(int i) const { return m_center + getPartOffset(i); }
+	SimMat4 getPartTransform(int i) const
+	{
+		SimVec3 c = getPartCenter(i);
+		return SimMat4::translation(c.x, c.y, c.z);
+	}
+
+	void setPosition(float x, float y, float z);
+	SimVec3 getCenter(void) const { return m_center; }
+	SimVec3 getHead(void) const { return getPartCenter(1); }
+	const CCompoundCollider& getCollider(void) const { return m_collider; }
+	// XZ bounds of the parts used for obstacle collision (body, turret, barrel)
+	void getFootprint(float& minX, float& minZ, float& maxX, float& maxZ) const;
+
+	// same test as the old CWall::hasIntersected(CWall&) on the two bodies
+	bool bodyOverlaps(const CSimTank& other) const;
+
+	void setPower(double vx, double vz) { m_velocityX = (float)vx; m_velocityZ = (float)vz; }
+	double getVelocityX(void) const { return m_velocityX; }
+	double getVelocityZ(void) const { return m_velocityZ; }
+
+	void resetDistance(void) { m_distance = TANK_DISTANCE; }
+	void setLastCoord(const SimVec3& pos) { m_lastCoord = pos; }
+	float getDistance(void) const { return m_distance; }
+	void setIsDistanceZero(bool isDist) { m_isDistanceZero = isDist; }
+	bool getIsDistanceZero(void) const { return m_isDistanceZero; }
+
+	// one tick: moves, stops at obstacles, the other tank and the walls,
+	// and spends the move distance. True when the distance ran out this
+	// tick (the caller slows the tank down)
+	bool update(float timeDiff, const CAabbStore& obstacleBoxes, const CSpatialGrid& obstacleGrid,
+		const CSimTank& other, const CCollisionWorld& world);
+
+private:
+	bool hitsObstacle(const CAabbStore& boxes, int i) const;
+
+	int					m_player;
+	SimVec3				m_center;
+	float				m_velocityX, m_velocityZ;
+	bool				m_created;
+	bool				m_isDistanceZero;
+	float				m_distance;
+	SimVec3				m_lastCoord;
+	CCompoundCollider	m_collider;	// part boxes in tank space
+	std::vector<int>	m_nearby;	// grid query result (kept to reuse its storage)
+};
+
+// -----------------------------------------------------------------------------
+// CSimTarget: the aim point (blue ball), dragged along with its tank
+// -----------------------------------------------------------------------------
+class CSimTarget {
+public:
+	CSimTarget(void) : m_tank(0), m_tankLastX(0), m_tankLastZ(0) {}
+
+public:
+	void linkTank(const CSimTank* tank);
+	const CSimTank* getTank(void) const { return m_tank; }
+
+	void setCenter(float x, float y, float z) { m_center = SimVec3(x, y, z); }
+	SimVec3 getCenter(void) const { return m_center; }
+	void setPower(double vx, double vy, double vz) { m_velocity = SimVec3((float)vx, (float)vy, (float)vz); }
+	SimVec3 getVelocity(void) const { return m_velocity; }
+
+	// one tick: moves, follows the tank, and stops an axis that leaves the
+	// range around the tank
+	void update(float timeDiff);
+
+private:
+	SimVec3				m_center;
+	SimVec3				m_velocity;
+	const CSimTank*		m_tank;
+	double				m_tankLastX, m_tankLastZ;
+};
+
+// -----------------------------------------------------------------------------
+// CTankSim: one match
+// -----------------------------------------------------------------------------
+struct SimObstacle {
+	ArenaBox box;
+	int id;				// index in CArenaLayout::buildObstacles()
+};
+
+struct SimStats {
+	long long ticks;
+	int turns;
+	int shots;
+	int obstaclesDestroyed;
+};
+
+class CTankSim {
+public:
+	CTankSim(void);
+	~CTankSim(void) {}
+
+public:
+	// builds the firing table and the arena, and starts a match
+	void init(void);
+	// a new match on the same arena (the firing table is kept)
+	void reset(void);
+	void setListener(CSimListener* listener) { m_listener = listener; }
+
+	// false when the command does not apply right now (e.g. moving while a
+	// missile is in flight)
+	bool command(SimCommand cmd);
+	// right mouse drag by (dx, dy) pixels: moves the aim target on the
+	// ground within its range
+	void dragAim(float dx, float dy);
+
+	// one fixed step; timeDelta is SIM_TICK_DELTA in the game
+	void tick(float timeDelta);
+
+	// match state
+	bool isStarted(void) const { return m_started; }
+	bool isFinished(void) const { return m_finished; }
+	float getIntroMovement(void) const { return m_introMovement; }
+	bool isOriginTank(void) const { return m_isOriginTank; }	// player 0's turn
+	bool isFiring(void) const { return m_isFire; }
+	bool isZoomingOut(void) const { return m_zoomOutTiming; }
+	float getZoomOut(void) const { return m_zoomOutSpeed; }
+	int getTurnTime(void) const { return m_turnTime; }
+	double getTurnElapsed(void) const { return m_timeDiff; }
+	double getTankSpeed(void) const { return m_tankSpeed; }
+	const SimStats& getStats(void) const { return m_stats; }
+
+	// objects; getTank() is always the player whose turn it is
+	const CSimTank& getTank(void) const { return m_tank; }
+	const CSimTank& getOtherTank(void) const { return m_otank; }
+	const CSimTank& getPlayerTank(int player) const { return m_tank.getPlayer() == player ? m_tank : m_otank; }
+	const CSimTarget& getTarget(void) const { return m_target; }
+	const CProjectilePool& getMissiles(void) const { return m_missiles; }
+	bool missilesInFlight(void) const { return m_missiles.size() > 0; }
+	// the missile the camera follows (its last position once it is gone)
+	SimVec3 getMissileFocus(void) const { return m_missileFocus; }
+
+	// aim
+	double getFireDegree(void) const { return m_fireDegree; }
+	double getFireDistance(void) const { return m_fireDistance; }
+	const CFiringTable& getFiringTable(void) const { return m_firingTable; }
+
+	// arena. Obstacle dense indices (grid, boxes) change on compaction,
+	// which only happens inside tick(); ids do not
+	const CCollisionWorld& getCollisionWorld(void) const { return m_collisionWorld; }
+	const CAabbStore& getObstacleBoxes(void) const { return m_obstacleBoxes; }
+	const CSpatialGrid& getObstacleGrid(void) const { return m_obstacleGrid; }
+	int getObstacleCount(void) const { return m_obstacles.size(); }
+	int getLiveObstacleCount(void) const { return m_obstacles.liveCount(); }
+	int getObstacleId(int dense) const { return m_obstacles.at(dense).id; }
+	const std::vector<ArenaBox>& getArenaObstacles(void) const { return m_arenaObstacles; }
+
+private:
+	void buildFiringTable(void);
+	void buildCollisionWorld(void);
+	void buildObstacleIndex(void);
+	bool destroyObstacle(PoolHandle h);
+	void compactObstacles(void);
+	void queryObstaclesInSphere(float x, float y, float z, float radius, std::vector<int>& out);
+	int explodeObstacles(const SimVec3& c, PoolHandle hit);
+	void fire(void);
+	void updateMissiles(float timeDelta);
+	void switchTurn(void);
+	void updateAim(void);
+
+	CSimListener*				m_listener;
+
+	// objects
+	CSimTank					m_tank, m_otank;
+	CSimTarget					m_target;
+	CProjectilePool				m_missiles;
+	int							m_missileTag;	// grows with every shot
+	int							m_focusTag;		// missile the camera follows
+	SimVec3						m_missileFocus;
+
+	// arena
+	std::vector<ArenaBox>		m_arenaObstacles;
+	CHandlePool<SimObstacle>	m_obstacles;
+	CSpatialGrid				m_obstacleGrid;	// index = m_obstacles dense index
+	CAabbStore					m_obstacleBoxes;	// index = m_obstacles dense index
+	CCollisionWorld				m_collisionWorld;	// boundary walls and floor
+	CFiringTable				m_firingTable;
+
+	// turn clock (ms). simTime grows by SIM_TICK_MS per tick, so it does not
+	// depend on the frame rate
+	double						m_simTime, m_startTime, m_currTime, m_timeDiff;
+	int							m_turnTime;
+	bool						m_started, m_finished;
+	float						m_introMovement;
+	bool						m_isOriginTank;
+	bool						m_isFire;
+	bool						m_shotSettling;	// missiles gone, waiting for the turn to end
+	bool						m_zoomOutTiming;
+	float						m_zoomOutSpeed;
+	double						m_tankSpeed;
+
+	// aim
+	double						m_fireDegree, m_fireDistance;
+	SimVec3						m_lastHead, m_lastTarget;
+
+	std::vector<ProjectileHit>	m_hits;
+	std::vector<int>			m_blast, m_candidates;
+	SimStats					m_stats;
+};
+
+#endif // __tankSimH__
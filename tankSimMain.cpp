@@ -0,0 +1,156 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: tankSimMain.cpp
+//
+// Desc: Headless driver of the simulation core (no window, no D3D). Plays
+//       complete matches from a command script or with the scripted bot
+//       and prints the outcome and tick throughput. "-bench" does what it
+//       does for the game; "-check" runs one benchmark that checks its
+//       results and exits with 1 if the check fails (the ctest tests).
+//
+//       tanksim [-matches n] [-seed n] [-max-ticks n]
+//               [-script file | -record file] [-bench] [-check name]
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "tankSim.h"
+#include "simScript.h"
+#include "benchmark.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define DEFAULT_MATCHES 10
+#define DEFAULT_MAX_TICKS 1000000	// about 2.3 hours of game time
+
+// the benchmarks that check what they measure
+struct CheckEntry {
+	const char* name;
+	bool (*run)(FILE* fp);
+};
+static const CheckEntry s_checks[] = {
+	{ "spatial-grid", bench::SpatialGrid },
+	{ "explosion", bench::Explosion },
+	{ "aabb-batch", bench::AabbBatch },
+	{ "arena-walls", bench::ArenaWalls },
+	{ "obstacle-pool", bench::ObstaclePool },
+	{ "projectiles", bench::Projectiles },
+	{ "tank-collider", bench::TankCollider },
+	{ "render-queue", bench::RenderQueue },
+	{ "mesh-cache", bench::MeshCache },
+	{ "instancing", bench::Instancing },
+	{ "chunked-mesh", bench::ChunkedMesh },
+	{ "frustum-cull", bench::FrustumCull },
+	{ "soft-raster", bench::SoftRaster },
+	{ "hud-text", bench::HudText },
+	{ "occlusion", bench::Occlusion },
+	{ "pvs", bench::Pvs },
+	{ "match-replay", bench::Matches },
+	{ "entities", bench::Entities },
+	{ "jobs", bench::Jobs },
+};
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: tanksim [-matches n] [-seed n] [-max-ticks n] [-script file | -record file] [-bench] [-check name]\n"
+		"  -matches n     matches to play (default %d)\n"
+		"  -seed n        bot seed of the first match, the next ones count up (default 1)\n"
+		"  -max-ticks n   a match without a winner stops here (default %d)\n"
+		"  -script file   replay the commands in file instead of the bot\n"
+		"  -record file   write the bot's commands of the last match to file\n"
+		"  -bench         run the benchmarks into benchmark.txt\n"
+		"  -check name    run one checked benchmark, exit 1 if it fails:\n"
+		"                 spatial-grid, explosion, aabb-batch, arena-walls, obstacle-pool,\n"
+		"                 projectiles, tank-collider, render-queue, mesh-cache, instancing,\n"
+		"                 chunked-mesh, frustum-cull, soft-raster, hud-text, occlusion, pvs,\n"
+		"                 match-replay, entities, jobs\n",
+		DEFAULT_MATCHES, DEFAULT_MAX_TICKS);
+}
+
+int main(int argc, char** argv)
+{
+	int matches = DEFAULT_MATCHES;
+	unsigned seed = 1;
+	long long maxTicks = DEFAULT_MAX_TICKS;
+	const char* scriptPath = NULL;
+	const char* recordPath = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "-matches") == 0 && hasValue)
+			matches = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-seed") == 0 && hasValue)
+			seed = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "-max-ticks") == 0 && hasValue)
+			maxTicks = atoll(argv[++i]);
+		else if (strcmp(argv[i], "-script") == 0 && hasValue)
+			scriptPath = argv[++i];
+		else if (strcmp(argv[i], "-record") == 0 && hasValue)
+			recordPath = argv[++i];
+		else if (strcmp(argv[i], "-bench") == 0) {
+			FILE* fp = fopen("benchmark.txt", "w");
+			if (fp == NULL)
+				return 1;
+			bool ok = bench::RunAll(fp);
+			fclose(fp);
+			return ok ? 0 : 1;
+		}
+		else if (strcmp(argv[i], "-check") == 0 && hasValue) {
+			const char* name = argv[++i];
+			for (size_t k = 0; k < sizeof(s_checks) / sizeof(s_checks[0]); k++) {
+				if (strcmp(s_checks[k].name, name) == 0) {
+					bool ok = s_checks[k].run(stdout);
+					printf("%s: %s\n", name, ok ? "PASS" : "FAIL");
+					return ok ? 0 : 1;
+				}
+			}
+			fprintf(stderr, "tanksim: no check named %s\n", name);
+			return 2;
+		}
+		else {
+			usage();
+			return 2;
+		}
+	}
+
+	CSimScript script;
+	if (scriptPath != NULL && !script.load(scriptPath)) {
+		fprintf(stderr, "tanksim: cannot read script %s\n", scriptPath);
+		return 1;
+	}
+
+	CTankSim sim;
+	sim.init();
+	CSimScript record;
+	long long totalTicks = 0;
+	double totalMs = 0;
+	int wins[2] = { 0, 0 };
+
+	printf("%6s %8s %6s %6s %6s %10s %10s %10s\n", "match", "winner", "turns", "shots", "boxes", "ticks", "ms", "us/tick");
+	for (int m = 0; m < matches; m++) {
+		CSimBot bot(seed + m);
+		SimMatchResult r;
+		runSimMatch(sim, scriptPath != NULL ? &script : NULL, &bot, recordPath != NULL ? &record : NULL, maxTicks, r);
+		char winner[16];
+		if (r.winner < 0)
+			strcpy(winner, "-");
+		else
+			sprintf(winner, "P%d", r.winner + 1);
+		printf("%6d %8s %6d %6d %6d %10lld %10.1f %10.2f\n", m + 1, winner, r.turns, r.shots, r.obstaclesDestroyed,
+			r.ticks, r.ms, r.ticks ? r.ms * 1e3 / r.ticks : 0.0);
+		if (r.winner >= 0)
+			wins[r.winner]++;
+		totalTicks += r.ticks;
+		totalMs += r.ms;
+	}
+	printf("%d matches: P1 %d, P2 %d, no winner %d; %lld ticks in %.1f ms = %.0f ticks/s (%.0fx real time)\n",
+		matches, wins[0], wins[1], matches - wins[0] - wins[1], totalTicks, totalMs,
+		totalMs > 0 ? totalTicks * 1e3 / totalMs : 0.0, totalMs > 0 ? totalTicks * 1e3 / totalMs / SIM_TICK_RATE : 0.0);
+
+	if (recordPath != NULL && scriptPath == NULL && !record.save(recordPath)) {
+		fprintf(stderr, "tanksim: cannot write %s\n", recordPath);
+		return 1;
+	}
+	return 0;
+}
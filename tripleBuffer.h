@@ -0,0 +1,66 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: tripleBuffer.h
+//
+// Desc: Lock-free hand over of the newest value from one writer thread to
+//       one reader thread. There are three slots: the writer fills its back
+//       slot and swaps it with the middle one, the reader swaps its front
+//       slot with the middle one when that holds something newer. Neither
+//       side ever waits for the other, and the reader's front slot stays
+//       untouched until it asks for a newer one; values the reader was too
+//       slow to see are simply replaced.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __tripleBufferH__
+#define __tripleBufferH__
+
+#include <atomic>
+
+template <class T>
+class CTripleBuffer {
+public:
+	CTripleBuffer(void) : m_middle(1), m_back(0), m_front(2) {}
+
+public:
+	// writer: fill getBack(), then publish() it. Afterwards getBack() is
+	// another slot with an older value in it
+	T& getBack(void) { return m_slots[m_back]; }
+	void publish(void)
+	{
+		// the exchange releases the writes to the slot and gets back the
+		// one the reader is not using
+		m_back = m_middle.exchange(m_back | FRESH) & INDEX_MASK;
+	}
+
+	// reader: takes the newest published value if there is one; true when
+	// getFront() changed
+	bool update(void)
+	{
+		if (!(m_middle.load() & FRESH))
+			return false;
+		m_front = m_middle.exchange(m_front) & INDEX_MASK;
+		return true;
+	}
+	const T& getFront(void) const { return m_slots[m_front]; }
+
+	// single threaded set up (before either side runs): every slot = value
+	void reset(const T& value)
+	{
+		for (int i = 0; i < 3; i++)
+			m_slots[i] = value;
+		m_middle = 1;
+		m_back = 0;
+		m_front = 2;
+	}
+
+private:
+	enum { INDEX_MASK = 3, FRESH = 4 };	// middle slot index, and "not read yet"
+
+	T					m_slots[3];
+	std::atomic<int>	m_middle;
+	int					m_back;		// writer's
+	int					m_front;	// reader's
+};
+
+#endif // __tripleBufferH__
@@ -11,15 +11,35 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "d3dUtility.h"
+#include "spatialGrid.h"
+#include "aabbStore.h"
+#include "firingTable.h"
+#include "collisionWorld.h"
+#include "handlePool.h"
+#include "projectiles.h"
+#include "compoundCollider.h"
+#include "renderQueue.h"
+#include "meshCache.h"
+#include "chunkedBatch.h"
+#include "frustum.h"
+#include "sphereLod.h"
+#include "arenaLayout.h"
+#include "hudText.h"
+#include "occlusionCuller.h"
+#include "tankSim.h"
+#include "lazyTransform.h"
+#include "entityRegistry.h"
+#include "jobSystem.h"
+#include "simThread.h"
+#include "benchmark.h"
 #include <vector>
 #include <ctime>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <cassert>
 #include <random>
 #include <string>
-#include <sstream>
-#include <iomanip>
 
 using namespace std;
 
@@ -28,7 +48,6 @@ IDirect3DDevice9* Device = NULL;
 // window size
 const int Width = 1920;
 const int Height = 1080;
-double TANK_SPEED = 0.45;
 
 // -----------------------------------------------------------------------------
 // Transform matrices
@@ -36,393 +55,149 @@ double TANK_SPEED = 0.45;
 D3DXMATRIX g_mWorld;
 D3DXMATRIX g_mView;
 D3DXMATRIX g_mProj;
+CTransformFrame g_worldFrame; // g_mWorld, ü world  ̰ տ   ä 
 
-#define M_RADIUS 0.06   // ball radius
-#define PI 3.14159265
-#define M_HEIGHT 0.01
-
-
-#define BLUEBALL_VELOCITY 0.8 // blueball  ӵ
-#define MAX_BLUEBALL_RADIUS 15  // blueball  ־  ִ
-#define MIN_BLUEBALL_RADIUS 0.4 // blueball  ̻ ־ ϴ ()
-#define MAX_BLUEBALL_WIDTH 1 // blueball  ־  ִ ()
-
-#define MISSILE_POWER 1.25
-#define MISSILE_GRAVITY_RATE 3.5
-#define MISSILE_DECREASE_RATE 0.9985  // ̻ 
-#define MISSILE_EXPOLSION_RADIUS M_RADIUS+1.5 // ̻  ݰ
-
-#define WORLD_WIDTH 24
-#define WORLD_DEPTH 100
-//#define DECREASE_RATE 0.9975
-//#define TANK_VELOCITY_RATE 0.99
-//#define BORDER_WIDTH 0.12f // ڸ  
-
-#define NUM_OBSTACLE 20
-#define TANK_DISTANCE 30
-
-
-bool GAME_START = false;
-bool GAME_FINISH = false;
-float MOVEMENT = 0.0f;
-float CAMERA_SPEED = 0.01;
-float Tank_spawn_point[3] = { 0, 0.2f, -WORLD_DEPTH / 2 + 5 };
-int camera_option = 0;
 // -----------------------------------------------------------------------------
-// CSphere class definition
+// Shared meshes ( ũ ڽ/ mesh ϳ  )
 // -----------------------------------------------------------------------------
-
-class CSphere {
-	//private
-protected:
-	float					center_x, center_y, center_z;
-	float                   m_radius;
-	float					m_velocity_x;
-	float					m_velocity_y;
-	float					m_velocity_z;
-	bool					created;  // 忡 ϴ
-
-public:
-	CSphere(void)
-	{
-		D3DXMatrixIdentity(&m_mLocal);
-		ZeroMemory(&m_mtrl, sizeof(m_mtrl));
-		m_radius = 0;
-		m_velocity_x = 0;
-		m_velocity_y = 0;
-		m_velocity_z = 0;
-
-		m_pSphereMesh = NULL;
-	}
-	~CSphere(void) {}
-
+class CD3DMeshFactory : public CMeshFactory {
 public:
-	bool create(IDirect3DDevice9* pDevice, D3DXCOLOR color = d3d::WHITE)
-	{
-		if (NULL == pDevice)
-			return false;
-
-		m_mtrl.Ambient = color;
-		m_mtrl.Diffuse = color;
-		m_mtrl.Specular = color;
-		m_mtrl.Emissive = d3d::BLACK;
-		m_mtrl.Power = 5.0f;
-
-		created = true;
-
-		if (FAILED(D3DXCreateSphere(pDevice, getRadius(), 50, 50, &m_pSphereMesh, NULL)))
-			return false;
-		return true;
-	}
-
-	bool getCreated() { return created; }
-
-	void destroy(void)
-	{
-		created = false;
-		if (m_pSphereMesh != NULL) {
-			m_pSphereMesh->Release();
-			m_pSphereMesh = NULL;
-		}
-	}
-
-	void draw(IDirect3DDevice9* pDevice, const D3DXMATRIX& mWorld)
-	{
-		if (NULL == pDevice)
-			return;
-		if (!created) return;
-		pDevice->SetTransform(D3DTS_WORLD, &mWorld);
-		pDevice->MultiplyTransform(D3DTS_WORLD, &m_mLocal);
-		pDevice->SetMaterial(&m_mtrl);
-		m_pSphereMesh->DrawSubset(0);
-	}
-
-
-	bool hasIntersected(CSphere& ball)
-	{
-		D3DXVECTOR3 sphereCenter = ball.getCenter();
-		float sphereRadius = ball.getRadius();
-		D3DXVECTOR3 ballCenter = getCenter();
-		float ballRadius = getRadius();
-		// Check for intersection along each axis (X, Y, Z)
-		bool intersectX = (sphereCenter.x + sphereRadius >= ballCenter.x - ballRadius) &&
-			(sphereCenter.x - sphereRadius <= ballCenter.x + ballRadius);
-		bool intersectY = (sphereCenter.y + sphereRadius >= ballCenter.y - ballRadius) &&
-			(sphereCenter.y - sphereRadius <= ballCenter.y + ballRadius);
-		bool intersectZ = (sphereCenter.z + sphereRadius >= ballCenter.z - ballRadius) &&
-			(sphereCenter.z - sphereRadius <= ballCenter.z + ballRadius);
-		return intersectX && intersectY && intersectZ;
-	}
-
-	void hitBy() {
-		if (center_y <= M_RADIUS) {
-			destroy();
-		}
-	}
-
-	void Out()
-	{
-		if (center_x >= 4.5 - M_RADIUS || center_x <= -4.5 + M_RADIUS || center_z >= 3 - M_RADIUS || center_z <= -3 + M_RADIUS)
-			if (center_y <= M_RADIUS)
-				destroy();
-	}
-
-	void ballUpdate(float timeDiff)
-	{
-		if (!created) return;
-		const float TIME_SCALE = 3.3;
-		D3DXVECTOR3 cord = this->getCenter();
-		double vx = abs(this->getVelocity_X());
-		double vy = abs(this->getVelocity_Y());
-		double vz = abs(this->getVelocity_Z());
+	CD3DMeshFactory(void) { m_pDevice = NULL; }
+	void setDevice(IDirect3DDevice9* pDevice) { m_pDevice = pDevice; }
 
-		float tX = cord.x + TIME_SCALE * timeDiff * m_velocity_x;
-		float tY = cord.y + TIME_SCALE * timeDiff * m_velocity_y;
-		float tZ = cord.z + TIME_SCALE * timeDiff * m_velocity_z;
-
-		if (tY < 0 + M_RADIUS)
-			tY = M_RADIUS;
-		// y 0 Ϸ  ʵ (ӽ)
-
-		this->setCenter(tX, tY, tZ);
-		Out();	// ̻   ٴڿ   
-
-		//this->setPower(this->getVelocity_X() * DECREASE_RATE, this->getVelocity_Z() * DECREASE_RATE);
-		double rate = 1 - (1 - MISSILE_DECREASE_RATE) * timeDiff * 400;
-		if (rate < 0)
-			rate = 0;
-		this->setPower(getVelocity_X() * rate, getVelocity_Y() - MISSILE_GRAVITY_RATE * timeDiff, getVelocity_Z() * rate);
-
-	}
-
-	double getVelocity_X() { return this->m_velocity_x; }
-	double getVelocity_Y() { return this->m_velocity_y; }
-	double getVelocity_Z() { return this->m_velocity_z; }
-
-
-	void setPower(double vx, double vz)
+	void* createMesh(const MeshKey& key, unsigned& bytes)
 	{
-		this->m_velocity_x = vx;
-		this->m_velocity_z = vz;
-
-	}
-
-	void setPower(double vx, double vy, double vz)
-	{
-		this->m_velocity_x = vx;
-		this->m_velocity_y = vy;
-		this->m_velocity_z = vz;
-	}
-
-	void setCenter(float x, float y, float z)
-	{
-		D3DXMATRIX m;
-		center_x = x;	center_y = y;	center_z = z;
-		D3DXMatrixTranslation(&m, x, y, z);
-		setLocalTransform(m);
-	}
-
-	float getRadius(void)  const { return (float)(M_RADIUS); }
-	const D3DXMATRIX& getLocalTransform(void) const { return m_mLocal; }
-	void setLocalTransform(const D3DXMATRIX& mLocal) { m_mLocal = mLocal; }
-	D3DXVECTOR3 getCenter(void) const
+		ID3DXMesh* mesh = NULL;
+		if (m_pDevice == NULL)
+			return NULL;
+		HRESULT hr = key.shape == MeshKey::SPHERE ?
+			D3DXCreateSphere(m_pDevice, key.size[0], key.slices, key.stacks, &mesh, NULL) :
+			D3DXCreateBox(m_pDevice, key.size[0], key.size[1], key.size[2], &mesh, NULL);
+		if (FAILED(hr))
+			return NULL;
+		DWORD indexSize = (mesh->GetOptions() & D3DXMESH_32BIT) ? 4 : 2;
+		bytes = mesh->GetNumVertices() * mesh->GetNumBytesPerVertex() + mesh->GetNumFaces() * 3 * indexSize;
+		return mesh;
+	}
+	void destroyMesh(void* mesh)
 	{
-		D3DXVECTOR3 org(center_x, center_y, center_z);
-		return org;
-	}
-
-	bool get_created() {
-		return created;
+		static_cast<ID3DXMesh*>(mesh)->Release();
 	}
 
 private:
-	D3DXMATRIX              m_mLocal;
-	D3DMATERIAL9            m_mtrl;
-	ID3DXMesh* m_pSphereMesh;
-
+	IDirect3DDevice9* m_pDevice;
 };
 
-// -----------------------------------------------------------------------------
-// CWall class definition
-// -----------------------------------------------------------------------------
-
-class CWall {
-
-private:
-
-	float					m_x;
-	float					m_y;
-	float					m_z;
-	float                   m_width;
-	float                   m_depth;
-	float					m_height;
-	bool					created;
+CD3DMeshFactory g_meshFactory;
+CMeshCache g_meshCache;
+CSphereLod g_sphereLod; //  mesh ȭ ܰ , Ӹ ׸ ﰢ 
 
-public:
-	CWall(void)
-	{
-		D3DXMatrixIdentity(&m_mLocal);
-		ZeroMemory(&m_mtrl, sizeof(m_mtrl));
-		m_width = 0;
-		m_depth = 0;
-		m_pBoundMesh = NULL;
+//  LOD ܰ躰 mesh cache  ( ̸ )
+bool acquireSphereLods(float radius, ID3DXMesh* meshes[SPHERE_LOD_LEVELS])
+{
+	bool ok = true;
+	for (int l = 0; l < SPHERE_LOD_LEVELS; l++) {
+		const CSphereLod::Level& level = CSphereLod::getLevel(l);
+		meshes[l] = static_cast<ID3DXMesh*>(g_meshCache.acquire(MeshKey::sphere(radius, level.slices, level.stacks)));
+		ok = ok && meshes[l] != NULL;
 	}
-	~CWall(void) {}
-public:
-	bool create(IDirect3DDevice9* pDevice, float ix, float iz, float iwidth, float iheight, float idepth, D3DXCOLOR color = d3d::WHITE)
-	{
-		if (NULL == pDevice)
-			return false;
-
-		m_mtrl.Ambient = color;
-		m_mtrl.Diffuse = color;
-		m_mtrl.Specular = color;
-		m_mtrl.Emissive = d3d::BLACK;
-		m_mtrl.Power = 5.0f;
-
-		m_width = iwidth;
-		m_height = iheight;
-		m_depth = idepth;
-
-		created = true;
+	return ok;
+}
 
-		if (FAILED(D3DXCreateBox(pDevice, iwidth, iheight, idepth, &m_pBoundMesh, NULL)))
-			return false;
-		return true;
-	}
-	void destroy(void)
-	{
-		created = false;
-		if (m_pBoundMesh != NULL) {
-			m_pBoundMesh->Release();
-			m_pBoundMesh = NULL;
+void releaseSphereLods(ID3DXMesh* meshes[SPHERE_LOD_LEVELS])
+{
+	for (int l = 0; l < SPHERE_LOD_LEVELS; l++) {
+		if (meshes[l] != NULL) {
+			g_meshCache.release(meshes[l]);
+			meshes[l] = NULL;
 		}
 	}
-	void draw(IDirect3DDevice9* pDevice, const D3DXMATRIX& mWorld)
-	{
-		if (NULL == pDevice)
-			return;
-		pDevice->SetTransform(D3DTS_WORLD, &mWorld);
-		pDevice->MultiplyTransform(D3DTS_WORLD, &m_mLocal);
-		pDevice->SetMaterial(&m_mtrl);
-		m_pBoundMesh->DrawSubset(0);
-	}
-
-	bool hasIntersected(CSphere& ball)
-	{
-		D3DXVECTOR3 sphereCenter = ball.getCenter();
-		float sphereRadius = ball.getRadius();
-
-		D3DXVECTOR3 wallCenter = getCenter();
-		float wallWidth = m_width;
-		float wallHeight = m_height;
-		float wallDepth = m_depth;
-
-		bool intersectX = (sphereCenter.x <= wallCenter.x + wallWidth / 2 + M_RADIUS * 0.8) &&
-			(sphereCenter.x >= wallCenter.x - wallWidth / 2 - M_RADIUS * 0.8);
-
-		bool intersectY = (sphereCenter.y <= wallCenter.y + wallHeight / 2 + M_RADIUS * 0.8) &&
-			(sphereCenter.y >= wallCenter.y - wallHeight / 2 - M_RADIUS * 0.8);
-
-		bool intersectZ = (sphereCenter.z <= wallCenter.z + wallDepth / 2 + M_RADIUS * 0.8) &&
-			(sphereCenter.z >= wallCenter.z - wallDepth / 2 - M_RADIUS * 0.8);
-
-		return intersectX && intersectY && intersectZ;
-	}
-
-	bool hasIntersected(double objX, double objY, double objZ, double radius) {
-		// (objX, objY, objZ) ִ  = radius  浹ߴ°?
-		D3DXVECTOR3 wallCenter = getCenter();
-		float wallWidth = m_width;
-		float wallHeight = m_height;
-		float wallDepth = m_depth;
-
-		bool intersectX = (objX <= wallCenter.x + wallWidth / 2 + radius * 0.8) &&
-			(objX >= wallCenter.x - wallWidth / 2 - radius * 0.8);
-
-		bool intersectY = (objY <= wallCenter.y + wallHeight / 2 + radius * 0.8) &&
-			(objY >= wallCenter.y - wallHeight / 2 - radius * 0.8);
-
-		bool intersectZ = (objZ <= wallCenter.z + wallDepth / 2 + radius * 0.8) &&
-			(objZ >= wallCenter.z - wallDepth / 2 - radius * 0.8);
-
-		return intersectX && intersectY && intersectZ;
-	}
-
-	bool hasIntersected(CWall& wall)
-	{
-		D3DXVECTOR3 Center = getCenter();
-		float width = m_width;
-		float depth = m_depth;
-		float height = m_height;
-
-		D3DXVECTOR3 wallCenter = wall.getCenter();
-		float wallWidth = wall.getWidth();
-		float wallDepth = wall.getDepth();
-		float wallHeight = wall.getHeight();
-
-		bool intersectX = (wallCenter.x - wallWidth / 2 <= Center.x + width / 2) && (wallCenter.x + wallWidth / 2 >= Center.x - width / 2);
-		bool intersectY = (wallCenter.y - wallHeight / 2 <= Center.y + height / 2) && (wallCenter.y + wallHeight / 2 >= Center.y - height / 2);
-		bool intersectZ = (wallCenter.z - wallDepth / 2 <= Center.z + depth / 2) && (wallCenter.z + wallDepth / 2 >= Center.z - depth / 2);
-
-		return intersectX && intersectY && intersectZ;
-	}
-
-	void hitBy(CSphere& ball)	// ̶ ̶ 浹ϸ  
-	{
-		if (hasIntersected(ball))
-			ball.destroy();
-	}
+}
 
-	void setPosition(float x, float y, float z)
-	{
-		D3DXMATRIX m;
-		this->m_x = x;
-		this->m_y = y;
-		this->m_z = z;
+//  ׸ LOD ܰ. m  ߽ ű world , lodLevel   ܰ
+int selectSphereLod(const SimdMat4& m, float radius, int lodLevel)
+{
+	float depth = m.m[3][0] * g_mView._13 + m.m[3][1] * g_mView._23 + m.m[3][2] * g_mView._33 + g_mView._43;
+	float pixels = CSphereLod::projectRadius(radius, depth, g_mProj._22, (float)Height);
+	int level = g_sphereLod.select(pixels, lodLevel);
+	g_sphereLod.count(level);
+	return level;
+}
 
-		D3DXMatrixTranslation(&m, x, y, z);
-		setLocalTransform(m);
-	}
+#define M_HEIGHT 0.01
+//  Ģ  (M_RADIUS, MISSILE_*, WORLD_*, SIM_TICK_*, ...) tankSim.h
 
-	D3DXVECTOR3 getCenter(void) const
-	{
-		D3DXVECTOR3 org(m_x, m_y, m_z);
-		return org;
-	}
+//#define DECREASE_RATE 0.9975
+//#define TANK_VELOCITY_RATE 0.99
+//#define BORDER_WIDTH 0.12f // ڸ  
 
-	void setRotation(float angle)
-	{
-		D3DXMatrixRotationY(&m_mLocal, angle);
-	}
+#define NUM_OBSTACLE 20
+#define OBSTACLE_CHUNK_SIZE 8.0f // ֹ mesh ġ chunk ũ ( ϳ ǵ帮 chunk ִ 4)
+#define SIM_MAX_CATCHUP_STEPS 8 // simulation thread з     ִ tick 
+#define AIM_ARC_POINTS 48 //    
 
-	bool get_created() { return created; }
 
-	float getWidth(void) const { return m_width; };
-	float getDepth(void) const { return m_depth; };
-	float getHeight(void) const { return m_height; }
+int camera_option = 0;
+// -----------------------------------------------------------------------------
+// Drawable entities
+// -----------------------------------------------------------------------------
 
-	//private :
-protected:
-	void setLocalTransform(const D3DXMATRIX& mLocal) { m_mLocal = mLocal; }
+// , ٴ, ֹ, ũ ǰ, , ̻   entity.
+// ġ, ڽ, mesh material   ȣ  迭 ְ,  layer  ־
+// ý Լ layer ϳ   ʷ 
+CEntityRegistry g_entities;
+vector<int> g_drawList; // ̹ ׸  (׸  )
 
-	D3DXMATRIX              m_mLocal;
-	D3DMATERIAL9            m_mtrl;
-	ID3DXMesh* m_pBoundMesh;
-};
+RenderMaterial makeMaterial(D3DXCOLOR color)
+{
+	D3DMATERIAL9 mtrl;
+	ZeroMemory(&mtrl, sizeof(mtrl));
+	mtrl.Ambient = color;
+	mtrl.Diffuse = color;
+	mtrl.Specular = color;
+	mtrl.Emissive = d3d::BLACK;
+	mtrl.Power = 5.0f;
+	return reinterpret_cast<const RenderMaterial&>(mtrl);
+}
 
-// -----------------------------------------------------------------------------
-// CObstacle class definition
-// -----------------------------------------------------------------------------
+// ڽ ϳ ( ũ ڽ mesh  ). ϸ NullEntity
+Entity createBoxEntity(const ArenaBox& box, D3DXCOLOR color, int layer)
+{
+	const void* mesh = g_meshCache.acquire(MeshKey::box(box.size[0], box.size[1], box.size[2]));
+	if (mesh == NULL)
+		return NullEntity();
+	return createDrawable(g_entities, SimVec3(box.center[0], box.center[1], box.center[2]),
+		SimVec3(box.size[0], box.size[1], box.size[2]), &mesh, 1, makeMaterial(color), layer);
+}
 
-class CObstacle : public CWall {
-public:
-	void hitBy(CSphere& missile) {
-		missile.destroy();
-		destroy();
+//  ϳ, LOD ܰ踶 mesh . ϸ NullEntity
+Entity createSphereEntity(const SimVec3& center, float radius, D3DXCOLOR color, int layer)
+{
+	ID3DXMesh* lods[SPHERE_LOD_LEVELS];
+	if (!acquireSphereLods(radius, lods)) {
+		releaseSphereLods(lods);
+		return NullEntity();
+	}
+	const void* meshes[SPHERE_LOD_LEVELS];
+	for (int l = 0; l < SPHERE_LOD_LEVELS; l++)
+		meshes[l] = lods[l];
+	return createDrawable(g_entities, center, SimVec3(radius * 2, radius * 2, radius * 2),
+		meshes, SPHERE_LOD_LEVELS, makeMaterial(color), layer);
+}
 
+// mesh cache ְ entity  (̹  ̸ ƹ ϵ  )
+void destroyEntity(Entity& e)
+{
+	RenderComponent* r = g_entities.findRenderable(e);
+	if (r != NULL) {
+		for (int l = 0; l < SPHERE_LOD_LEVELS; l++) {
+			if (r->mesh[l] != NULL)
+				g_meshCache.release(const_cast<void*>(r->mesh[l]));
+		}
 	}
-};
+	g_entities.destroy(e);
+	e = NullEntity();
+}
 
 // -----------------------------------------------------------------------------
 // CLight class definition
@@ -436,7 +211,9 @@ public:
 		m_index = i++;
 		D3DXMatrixIdentity(&m_mLocal);
 		::ZeroMemory(&m_lit, sizeof(m_lit));
-		m_pMesh = NULL;
+		for (int l = 0; l < SPHERE_LOD_LEVELS; l++)
+			m_pLodMesh[l] = NULL;
+		m_lodLevel = -1;
 		m_bound._center = D3DXVECTOR3(0.0f, 0.0f, 0.0f);
 		m_bound._radius = 0.0f;
 	}
@@ -446,7 +223,7 @@ public:
 	{
 		if (NULL == pDevice)
 			return false;
-		if (FAILED(D3DXCreateSphere(pDevice, radius, 10, 10, &m_pMesh, NULL)))
+		if (!acquireSphereLods(radius, m_pLodMesh))
 			return false;
 
 		m_bound._center = lit.Position;
@@ -469,10 +246,7 @@ public:
 	}
 	void destroy(void)
 	{
-		if (m_pMesh != NULL) {
-			m_pMesh->Release();
-			m_pMesh = NULL;
-		}
+		releaseSphereLods(m_pLodMesh);
 	}
 	bool setLight(IDirect3DDevice9* pDevice, const D3DXMATRIX& mWorld)
 	{
@@ -493,11 +267,11 @@ public:
 	{
 		if (NULL == pDevice)
 			return;
-		D3DXMATRIX m;
-		D3DXMatrixTranslation(&m, m_lit.Position.x, m_lit.Position.y, m_lit.Position.z);
-		pDevice->SetTransform(D3DTS_WORLD, &m);
+		SimdMat4 m = SimdMat4::translation(m_lit.Position.x, m_lit.Position.y, m_lit.Position.z);
+		pDevice->SetTransform(D3DTS_WORLD, reinterpret_cast<const D3DMATRIX*>(m.data()));
 		pDevice->SetMaterial(&d3d::WHITE_MTRL);
-		m_pMesh->DrawSubset(0);
+		m_lodLevel = selectSphereLod(m, m_bound._radius, m_lodLevel);
+		m_pLodMesh[m_lodLevel]->DrawSubset(0);
 	}
 
 	D3DXVECTOR3 getPosition(void) const { return D3DXVECTOR3(m_lit.Position); }
@@ -506,559 +280,596 @@ private:
 	DWORD               m_index;
 	D3DXMATRIX          m_mLocal;
 	D3DLIGHT9           m_lit;
-	ID3DXMesh* m_pMesh;
+	ID3DXMesh*          m_pLodMesh[SPHERE_LOD_LEVELS];
+	int                 m_lodLevel;
 	d3d::BoundingSphere m_bound;
 	bool created;
 };
 
 // -----------------------------------------------------------------------------
-// Tank class definition
+// Tank models
 // -----------------------------------------------------------------------------
 
-class Tank {
-protected:
-	float					m_velocity_x;
-	float					m_velocity_z;
-	bool					isO;
-	bool					isDistanceZero;
-	CWall tank_part[7];
-	bool created;
-	float distance;
-	D3DXVECTOR3 last_coord;
-public:
-	Tank(bool isOtank) {
-		m_velocity_x = 0;
-		m_velocity_z = 0;
-		isO = isOtank;
-		distance = TANK_DISTANCE;
-		isDistanceZero = FALSE;
-	}
+D3DXVECTOR3 toD3D(const SimVec3& v) { return D3DXVECTOR3(v.x, v.y, v.z); }
+SimVec3 toSim(const D3DXVECTOR3& v) { return SimVec3(v.x, v.y, v.z); }
 
-	bool create(IDirect3DDevice9* pDevice, float ix, float iz, D3DXCOLOR color = d3d::WHITE) {
-		if (!tank_part[0].create(pDevice, ix, iz, 0.7f, 0.375f, 1.5f, color)) {
-			return false;
-		}
-		if (!tank_part[1].create(pDevice, ix, iz, 0.55f, 0.32f, 0.825f, color)) {
-			return false;
-		}
-		if (!tank_part[2].create(pDevice, ix, iz, 0.12f, 0.12f, 1.4f, color)) {
-			return false;
-		}
-		if (!tank_part[3].create(pDevice, ix, iz, 0.12f, 0.2, 1.4f, d3d::BLACK)) {
-			return false;
-		}
-		if (!tank_part[4].create(pDevice, ix, iz, 0.12f, 0.2, 1.4f, d3d::BLACK)) {
-			return false;
-		}
-		if (!tank_part[5].create(pDevice, ix, iz, 0.122f, 0.2, 1.35f, d3d::DARKSLATEGRAY)) {
-			return false;
-		}
-		if (!tank_part[6].create(pDevice, ix, iz, 0.122f, 0.2, 1.35f, d3d::DARKSLATEGRAY)) {
+// ũ ǰ 7 ڽ entity  (, 浹 CSimTank)
+bool createTankModel(Entity parts[CSimTank::PART_COUNT], D3DXCOLOR color)
+{
+	for (int i = 0; i < CSimTank::PART_COUNT; i++) {
+		D3DXCOLOR c = i < 3 ? color : (i < 5 ? d3d::BLACK : d3d::DARKSLATEGRAY);
+		SimVec3 size = CSimTank::getPartSize(i);
+		ArenaBox box = { { 0, 0, 0 }, { size.x, size.y, size.z } };
+		parts[i] = createBoxEntity(box, c, RENDER_LAYER_ACTOR);
+		if (!g_entities.isValid(parts[i]))
 			return false;
-		}
-		created = true;
-		return true;
-	}
-
-	void setPosition(float x, float y, float z) {
-		tank_part[0].setPosition(x, y, z);
-		if (isO)
-			tank_part[1].setPosition(x, y + 0.35f, z + 0.3f);
-		else
-			tank_part[1].setPosition(x, y + 0.35f, z - 0.3f);
-		tank_part[2].setPosition(x, y + 0.35f, z);
-		tank_part[3].setPosition(x - 0.24375, y - 0.28f, z);
-		tank_part[4].setPosition(x + 0.24375, y - 0.28f, z);
-		tank_part[5].setPosition(x - 0.24375, y - 0.24f, z);
-		tank_part[6].setPosition(x + 0.24375, y - 0.24f, z);
-
-	}
-
-	void setIsDistanceZero(bool isDist) {
-		isDistanceZero = isDist;
-	}
-
-	bool getIsDistanceZero() {
-		return isDistanceZero;
-	}
-
-	bool get_created()
-	{
-		return created;
 	}
+	return true;
+}
 
-	void destroy()
-	{
-		for (int i = 0; i < 3; i++)
-			tank_part[i].destroy();
-		created = false;
-	}
+void destroyTankModel(Entity parts[CSimTank::PART_COUNT])
+{
+	for (int i = 0; i < CSimTank::PART_COUNT; i++)
+		destroyEntity(parts[i]);
+}
 
-	bool hasIntersected(CSphere& missile)
-	{
-		return tank_part[0].hasIntersected(missile) || tank_part[1].hasIntersected(missile) || tank_part[2].hasIntersected(missile) || tank_part[3].hasIntersected(missile)
-			|| tank_part[4].hasIntersected(missile) || tank_part[5].hasIntersected(missile) || tank_part[6].hasIntersected(missile);
+// ǰ ũ ġ ΰ,  tick ġ(lastCenter)  ŭ ǰ .
+// ũ   ׸ ġ ״ζ ĵ ٽ  .
+// μ ũ ˵(3 ~ 6) 
+void syncTankModel(Entity parts[CSimTank::PART_COUNT], const SimTankState& tank)
+{
+	SimVec3 moved = tank.center - tank.lastCenter;
+	for (int i = 0; i < CSimTank::PART_COUNT; i++) {
+		SimVec3 c = tank.partCenter[i];
+		moveEntity(g_entities, parts[i], c, c - moved);
+		g_entities.setHidden(parts[i], !tank.alive && i < 3);
 	}
+}
 
-	bool hasIntersected(CObstacle& obstacle)
-	{
-		return tank_part[0].hasIntersected(obstacle) || tank_part[1].hasIntersected(obstacle) || tank_part[2].hasIntersected(obstacle);
-	}
+// -----------------------------------------------------------------------------
+// Global variables
+// -----------------------------------------------------------------------------
+//  Ģ (ũ, , ̻, ֹ 浹,  ð). ⼭  ׸.
+// Setup  g_simThread Ƿ,  ڷδ init()  (ź Ÿ ǥ, 浹 BVH, ֹ ġ) 
+CTankSim g_sim;
+CSimThread g_simThread; // g_sim ڱ thread SIM_TICK_RATE  tick snapshot Ѱ
+CLatencyMeter g_latency; // snapshot     ȭ鿡  
+// ׸  ̹   snapshot  (applySimEvents )
+vector<unsigned char> g_obstacleShown; // ֹ ȣ  ׸  1
+int g_shownDestroyed = 0;
+int g_shownTurns = 0;
+double g_shownDegree = -1, g_shownDistance = -1;
+// WndProc   snapshot 
+bool g_started = false;
+bool g_originTank = true;
+vector<Entity> g_worldWalls; // ѷ ٴ, g_sim 浹 BVH ڽ ȣ  (ٴ )
+
+//  : ߻  +x   ǥ, ߻ ġ 
+struct AimVertex {
+	float x, y, z;
+	D3DCOLOR color;
+};
+#define AIM_VERTEX_FVF (D3DFVF_XYZ | D3DFVF_DIFFUSE)
+AimVertex g_aimArc[AIM_ARC_POINTS];
+//  ֹ (), CArenaLayout ȣ . μ snapshot 
+vector<Entity> g_obstacleEntities;
+// ֹ chunk ļ vertex buffer ϳ  chunk   ׸
+#define OBSTACLE_VERTEX_FVF (D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_DIFFUSE)
+CInstanceBatch g_obstacleBatch;
+CChunkedBatch g_obstacleChunks;
+IDirect3DVertexBuffer9* g_obstacleVB = NULL;
+IDirect3DIndexBuffer9* g_obstacleIB = NULL;
+
+Entity g_blueball; //  (ġ snapshot target)
+CLight	g_light;
+CLight	g_light2;
+Entity g_tankParts[2][CSimTank::PART_COUNT]; // ÷̾ ȣ 
+Entity g_podium; //  ȭ鿡 ׸
 
-	void hitBy(CSphere& missile)
-	{
-		if (hasIntersected(missile)) {
-			missile.destroy();
-			destroy();
-		}
-	}
+// ̻ ȣ  entity ϳ.   Ҵ ŭ  ΰ   
+// ( ڸ  ̻  entity LOD ܰ踦 ̾)
+vector<Entity> g_missiles;
 
-	void draw(IDirect3DDevice9* pDevice, const D3DXMATRIX& mWorld)
-	{
-		tank_part[0].draw(pDevice, mWorld);
-		tank_part[1].draw(pDevice, mWorld);
-		tank_part[2].draw(pDevice, mWorld);
-		tank_part[3].draw(pDevice, mWorld);
-		tank_part[4].draw(pDevice, mWorld);
-		tank_part[5].draw(pDevice, mWorld);
-		tank_part[6].draw(pDevice, mWorld);
-	}
+//  ť   D3D ġ 
+class CD3DRenderBackend : public CRenderBackend {
+public:
+	CD3DRenderBackend(void) { m_pDevice = NULL; }
+	void setDevice(IDirect3DDevice9* pDevice) { m_pDevice = pDevice; }
 
-	D3DXVECTOR3 getCenter(void) const
+	void setMaterial(const RenderMaterial& material)
 	{
-		return tank_part[0].getCenter();
+		m_pDevice->SetMaterial(reinterpret_cast<const D3DMATERIAL9*>(&material));
 	}
-
-	D3DXVECTOR3 getHead(void) const
+	void setTransform(const float world[16])
 	{
-		return tank_part[1].getCenter();
-	}
-
-	void tankUpdate(float timeDiff, vector<CObstacle>& obstacles, Tank& otank, vector<vector<CWall> > walls)
-	{
-		if (!created) return;
-		const float TIME_SCALE = 3.3;
-		D3DXVECTOR3 cord = this->getCenter();
-
-		float tX = cord.x + TIME_SCALE * timeDiff * m_velocity_x;
-		float tZ = cord.z + TIME_SCALE * timeDiff * m_velocity_z;
-
-		// tank   ʰ
-
-		// tank ֹ, ũ,  浹ϸ 
-		this->setPosition(tX, cord.y, tZ);
-		for (int i = 0; i < obstacles.size(); i++) {
-			if (obstacles[i].get_created()) {
-				if (hasIntersected(obstacles[i])) {
-					tX = cord.x;
-					tZ = cord.z;
-					break;
-				}
-			}
-		}
-		if (otank.tank_part[0].get_created()) {
-			if (tank_part[0].hasIntersected(otank.tank_part[0])) {
-				tX = cord.x;
-				tZ = cord.z;
-			}
-		}
-		for (int i = 0; i < walls.size(); i++) {
-			for (int j = 0; j < walls[i].size(); j++) {
-				if (tank_part[0].hasIntersected(walls[i][j])) {
-					tX = cord.x;
-					tZ = cord.z;
-					break;
-				}
-			}
-		}
-		this->setPosition(tX, cord.y, tZ);
-
-		if ((this->getCenter()[0] != last_coord[0] || this->getCenter()[2] != last_coord[2]) && distance > 0 && !isDistanceZero) {
-			distance = distance - sqrt(pow(this->getCenter()[0] - last_coord[0], 2) + pow(this->getCenter()[2] - last_coord[2], 2));
-			last_coord = this->getCenter();
-		}
-		if (distance <= 0) {
-			isDistanceZero = TRUE;
-		}
-		if (isDistanceZero && distance <= 0) {
-			setPower(0, 0);
-			TANK_SPEED = 0.05;
-			distance = 0.1;
-		}
-
-		//this->setPower(this->getVelocity_X() * DECREASE_RATE, this->getVelocity_Z() * DECREASE_RATE);
-		//double rate = 1 - (1 - TANK_VELOCITY_RATE) * timeDiff * 400;
-		double rate = 1;
-		if (rate < 0)
-			rate = 0;
-		this->setPower(getVelocity_X() * rate, getVelocity_Z() * rate);//߷  ٽ  
+		m_pDevice->SetTransform(D3DTS_WORLD, reinterpret_cast<const D3DMATRIX*>(world));
 	}
-
-	double getVelocity_X() { return this->m_velocity_x; }
-	double getVelocity_Z() { return this->m_velocity_z; }
-
-
-	void setPower(double vx, double vz)
+	void drawMesh(const void* mesh, int subset)
 	{
-		this->m_velocity_x = vx;
-		this->m_velocity_z = vz;
-
+		static_cast<ID3DXMesh*>(const_cast<void*>(mesh))->DrawSubset(subset);
 	}
 
-	void setDistance() {
-		distance = TANK_DISTANCE;
-	}
-	void setLastCoord(D3DXVECTOR3 pos) {
-		last_coord = pos;
-	}
-
-	float getDistance() {
-		return distance;
-	}
+private:
+	IDirect3DDevice9* m_pDevice;
 };
+static_assert(sizeof(RenderMaterial) == sizeof(D3DMATERIAL9), "RenderMaterial must match D3DMATERIAL9");
+
+CRenderQueue g_renderQueue; // Ӹ ü ׸  
+CD3DRenderBackend g_d3dBackend;
+CFrustum g_frustum; // ̹  ī޶ þ (g_mWorld  ǥ, 浹 ڽ )
+FrustumStats g_cullStats; // ̹ ӿ þ ˻ ü  / ̴ ü 
+COcclusionCuller g_occlusion; //  ػ CPU depth: ֹ   chunk, ũ ׸  (worker thread ˻)
+vector<float> g_occlusionChunks; // ˻ chunk ڽ (min xyz, max xyz)
+bool g_occludersDirty = true; // ֹ μ  ڽ ٽ 
+CJobSystem g_jobs; // ϵ thread ŭ (׸  )
+const unsigned char* g_chunkVisible = NULL; // endOcclusion  (chunk 0̸ )
+ID3DXFont* TITLEfont = NULL; //    ü (,  ȭ)
+ID3DXFont* ENDfont = NULL;
+ID3DXFont* PLAYERfont = NULL;
+//   HUD : ٸ  ,  ״θ ٽ  ʰ atlas  忡 sprite   ׸
+#define HUD_FONT_HEIGHT 40
+#define HUD_ATLAS_WIDTH 512
+enum HudLine { HUD_TIME, HUD_DEGREE, HUD_FIRE_DISTANCE, HUD_TANK_DISTANCE, HUD_STATS, HUD_OCCLUSION, HUD_LATENCY };
+CGlyphAtlas g_hudAtlas;
+CHudText g_hud;
+IDirect3DTexture9* g_hudTexture = NULL;
+ID3DXSprite* g_hudSprite = NULL;
+bool g_showStats = false; // F3: ׸  ﰢ , þ ø , simulation  ǥ
 
 // -----------------------------------------------------------------------------
-// CBlueBall class definition
+// Functions
 // -----------------------------------------------------------------------------
-class CBlueBall : public CSphere
-{
-private:
-	double radius; // ִ 
-	Tank* linkedTank; //  ũ
-	double tankLastX, tankLastZ; // ũ  ǥ
-public:
-	CBlueBall(void) {
-		radius = MAX_BLUEBALL_RADIUS;
-	}
-	double getDistanceFromTank() {
-		// Ķ ũ Ÿ
-		double x = getCenter().x,
-			y = getCenter().y,
-			z = getCenter().z;
-		double tx = linkedTank->getCenter().x,
-			ty = 0,
-			tz = linkedTank->getCenter().z;
-		return sqrt(pow(x - tx, 2) + pow(y - ty, 2) + pow(z - tz, 2));
-	}
 
-	bool hasIntersected(CSphere& ball)
-	{
-		return false;
-	}
+//    (/Ÿ ٲ  ȣ)
+void updateAimPreview(double degree, double distance)
+{
+	const CFiringTable& table = g_sim.getFiringTable();
+	float ground[AIM_ARC_POINTS], height[AIM_ARC_POINTS];
+	table.sampleArc((float)degree, (float)distance, AIM_ARC_POINTS, ground, height);
 
-	double getRadius() { return radius; }
-	double getMaxRadius() { return radius; }
-	void setRadius(double r) { if (r > 0) radius = r; }
-	//void setMaxRadius(double r) { if (r > 0)maxRadius = r; }
-	void linkTank(Tank* const t) {
-		linkedTank = t;
-		tankLastX = linkedTank->getCenter().x;
-		tankLastZ = linkedTank->getCenter().z;
+	float launch = table.getModel().launchHeight;
+	for (int i = 0; i < AIM_ARC_POINTS; i++) {
+		g_aimArc[i].x = ground[i];
+		g_aimArc[i].y = height[i] - launch;
+		g_aimArc[i].z = 0;
+		g_aimArc[i].color = (i == AIM_ARC_POINTS - 1) ? D3DCOLOR_XRGB(255, 0, 0) : D3DCOLOR_XRGB(255, 255, 255);
 	}
+}
 
-
-	void ballUpdate(float timeDiff)
-	{
-		if (!created) return;
-		const float TIME_SCALE = 3.3;
-		D3DXVECTOR3 cord = this->getCenter();
-		double vx = abs(this->getVelocity_X());
-		double vy = abs(this->getVelocity_Y());
-		double vz = abs(this->getVelocity_Z());
-
-		double tankX = linkedTank->getCenter().x;
-		double tankZ = linkedTank->getCenter().z;
-
-		float tX = cord.x + TIME_SCALE * timeDiff * m_velocity_x;
-		float tY = cord.y + TIME_SCALE * timeDiff * m_velocity_y;
-		float tZ = cord.z + TIME_SCALE * timeDiff * m_velocity_z;
-
-		// y 0 Ϸ  ʵ (ӽ)
-		if (tY < 0 + M_RADIUS)
-			tY = M_RADIUS;
-
-		// ġ 
-		// ũ ̸ blueball 
-		double tankdX = tankX - tankLastX;
-		double tankdZ = tankZ - tankLastZ;
-		tX += tankdX;
-		tZ += tankdZ;
-		this->setCenter(tX, tY, tZ);
-
-		// ӵ 
-		double rate = 1;
-		this->setPower(getVelocity_X() * rate, getVelocity_Y() * rate, getVelocity_Z() * rate);
-
-		// Ķ  , ش  ӵ 0 
-		double diffFromTankX = fabs(tankX - tX);
-		double diffFromTankZ = fabs(tankZ - tZ);
-		if (diffFromTankX > MAX_BLUEBALL_WIDTH) {
-			// X  
-			this->setPower(0, getVelocity_Y() * rate, getVelocity_Z() * rate);
-
-			//  ġ    
-			double epsilon = 0.00001;
-			if (tX > tankX) epsilon *= -1; 
-			this->setCenter(tX + epsilon, tY, tZ);
-		}
-		if (diffFromTankZ > MAX_BLUEBALL_RADIUS || diffFromTankZ < MIN_BLUEBALL_RADIUS) {
-			// Z  
-			this->setPower(getVelocity_X() * rate, getVelocity_Y() * rate, 0);
-			//  ġ   յڷ 
-			double epsilon = 0.00001;
-			if (tZ > tankZ) epsilon *= -1;
-			this->setCenter(tX, tY, tZ + epsilon);
+// HUD  atlas: 40px Tahoma GDI   texture  ( ĭ )
+bool createHudAtlas(void)
+{
+	HDC dc = CreateCompatibleDC(NULL);
+	HFONT font = CreateFont(HUD_FONT_HEIGHT, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+		OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH | FF_DONTCARE, "Tahoma");
+	HGDIOBJ oldFont = SelectObject(dc, font);
+
+	// ڴ code point  ( ĭ U+00B0, ҽ  ڵ )
+	WCHAR glyphs[CGlyphAtlas::GLYPH_COUNT];
+	int advances[CGlyphAtlas::GLYPH_COUNT];
+	for (int i = 0; i < CGlyphAtlas::GLYPH_COUNT; i++) {
+		if (CGlyphAtlas::FIRST_CHAR + i == (unsigned char)HUD_DEGREE_SIGN[0])
+			glyphs[i] = L'\u00B0';
+		else
+			glyphs[i] = (WCHAR)(CGlyphAtlas::FIRST_CHAR + i);
+		SIZE size;
+		GetTextExtentPoint32W(dc, &glyphs[i], 1, &size);
+		advances[i] = size.cx;
+	}
+	TEXTMETRIC tm;
+	GetTextMetrics(dc, &tm);
+	g_hudAtlas.layout(advances, tm.tmHeight, HUD_ATLAS_WIDTH);
+	int w = g_hudAtlas.getWidth(), h = g_hudAtlas.getHeight();
+
+	//  DIB  ۾  ⸦ alpha ű
+	BITMAPINFO bi;
+	::ZeroMemory(&bi, sizeof(bi));
+	bi.bmiHeader.biSize = sizeof(bi.bmiHeader);
+	bi.bmiHeader.biWidth = w;
+	bi.bmiHeader.biHeight = -h;	// top-down
+	bi.bmiHeader.biPlanes = 1;
+	bi.bmiHeader.biBitCount = 32;
+	bi.bmiHeader.biCompression = BI_RGB;
+	void* bits = NULL;
+	HBITMAP bitmap = CreateDIBSection(dc, &bi, DIB_RGB_COLORS, &bits, NULL, 0);
+	bool ok = bitmap != NULL;
+	HGDIOBJ oldBitmap = ok ? SelectObject(dc, bitmap) : NULL;
+	if (ok) {
+		memset(bits, 0, w * h * 4);
+		SetBkMode(dc, TRANSPARENT);
+		SetTextColor(dc, RGB(255, 255, 255));
+		for (int i = 0; i < CGlyphAtlas::GLYPH_COUNT; i++) {
+			const HudGlyph& g = g_hudAtlas.getGlyph((char)(CGlyphAtlas::FIRST_CHAR + i));
+			TextOutW(dc, g.x, g.y, &glyphs[i], 1);
+		}
+		GdiFlush();
+		ok = SUCCEEDED(Device->CreateTexture(w, h, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &g_hudTexture, NULL));
+	}
+	if (ok) {
+		D3DLOCKED_RECT locked;
+		ok = SUCCEEDED(g_hudTexture->LockRect(0, &locked, NULL, 0));
+		if (ok) {
+			for (int y = 0; y < h; y++) {
+				const DWORD* src = (const DWORD*)bits + y * w;
+				DWORD* dst = (DWORD*)((BYTE*)locked.pBits + y * locked.Pitch);
+				for (int x = 0; x < w; x++)
+					dst[x] = ((src[x] >> 8) & 0xff) << 24 | 0x00ffffff;
+			}
+			g_hudTexture->UnlockRect(0);
 		}
+	}
+	if (oldBitmap)
+		SelectObject(dc, oldBitmap);
+	SelectObject(dc, oldFont);
+	if (bitmap)
+		DeleteObject(bitmap);
+	DeleteObject(font);
+	DeleteDC(dc);
 
-		tankLastX = tankX;
-		tankLastZ = tankZ;
-	}
-
-};
-
-// -----------------------------------------------------------------------------
-// Global variables
-// -----------------------------------------------------------------------------
-CWall	g_legoPlane;
-vector<CWall> lwall1;
-vector<CWall> swall1;
-vector<CWall> lwall2;
-vector<CWall> swall2;
-vector<vector<CWall> > g_legoWall;//ѷ
-vector<CObstacle> obstacle_wall; //  ֹ ()
-
-CBlueBall	g_target_blueball;
-CLight	g_light;
-CLight	g_light2;
-Tank tank(0);
-Tank otank(1);
-bool winner;
-CWall podium;
-
-CSphere missile;   // c   ̻
-ID3DXFont* DEGREEfont = NULL;
-ID3DXFont* FIREDISTANCEfont = NULL;
-ID3DXFont* TITLEfont = NULL;
-ID3DXFont* TIMEfont = NULL; //    ü
-ID3DXFont* ENDfont = NULL;
-ID3DXFont* PLAYERfont = NULL;
-ID3DXFont* DISTANCEfont = NULL;
-
-double fireDegree = 0; // blueball - ũ  
-double fireDistance = 0; // blueball - ũ  Ÿ ( )
-
-D3DXVECTOR3 tankLastCoord; // ũ   ġ
-D3DXVECTOR3 blueballLastCoord; // bleuball   ġ
-
-// -----------------------------------------------------------------------------
-// Functions
-// -----------------------------------------------------------------------------
-
-void updateFireDegree() {
-	D3DXVECTOR3 targetCoord = g_target_blueball.getCenter(); // blue ball ġ
-	D3DXVECTOR3 tankCoord = tank.getHead(); // ũ ġ
-	double radian = acos(
-		sqrt(pow(targetCoord.x - tankCoord.x, 2) + pow(targetCoord.z - tankCoord.z, 2)) /
-		sqrt(pow(targetCoord.x - tankCoord.x, 2) + pow(targetCoord.y - tankCoord.y, 2) + pow(targetCoord.z - tankCoord.z, 2))
-	);
-	fireDegree = radian * 180 / PI;
+	return ok && SUCCEEDED(D3DXCreateSprite(Device, &g_hudSprite));
 }
 
-void updateFireDistance() {
-	D3DXVECTOR3 targetCoord = g_target_blueball.getCenter(); // blue ball ġ
-	D3DXVECTOR3 tankCoord = tank.getHead(); // ũ ġ
-	fireDistance = sqrt(pow(tankCoord.x - targetCoord.x, 2) + pow(tankCoord.z - targetCoord.z, 2));  //  Ÿ
+// ̹  HUD  θ sprite   ׸ (ٲ   quad ״)
+void drawHud(void)
+{
+	int count = g_hud.buildQuads(g_hudAtlas);
+	if (count == 0)
+		return;
+	const HudQuad* quads = g_hud.getQuads();
+	g_hudSprite->Begin(D3DXSPRITE_ALPHABLEND);
+	for (int i = 0; i < count; i++) {
+		const HudQuad& q = quads[i];
+		RECT src = { q.srcX, q.srcY, q.srcX + q.width, q.srcY + q.height };
+		D3DXVECTOR3 pos((float)q.x, (float)q.y, 0.0f);
+		g_hudSprite->Draw(g_hudTexture, &src, NULL, &pos, q.color);
+	}
+	g_hudSprite->End();
 }
 
-bool createDWall(float partitionWidth, float partitionHeight, float partitonDepth,
-	int partitionCount_land, int partitionCount_sky,
-	float x, float y, float z,
-	D3DXCOLOR wallColor = d3d::WHITE) {
-	// (partitionCount_land * partitionCount_sky) ũ  .
-	//  partition ũ (partitionWidth, partitionHeight, partitionDepth)
-	for (int i = 0; i < partitionCount_land; i++) {
-		for (int j = 0; j < partitionCount_sky; j++) {
-			// ǥ 
-			float nx, ny, nz;
-			nx = x;
-			ny = y + partitionHeight * j;
-			nz = z + partitonDepth * i;
-			// ֹ  & ġ
-			CObstacle partition;
-			if (false == partition.create(Device, -1, -1, partitionWidth, partitionHeight, partitonDepth, wallColor)) return false;
-			partition.setPosition(nx, ny, nz);
-			obstacle_wall.push_back(partition);
-			//  
-		}
-	}
-	return true;
-}
 
-//  ֹ 
-bool createWWall(float partitionWidth, float partitionHeight, float partitonDepth,
-	int partitionCount_land, int partitionCount_sky,
-	float x, float y, float z,
-	D3DXCOLOR wallColor = d3d::WHITE) {
-	// (partitionCount_land * partitionCount_sky) ũ  .
-	//  partition ũ (partitionWidth, partitionHeight, partitionDepth)
-	for (int i = 0; i < partitionCount_land; i++) {
-		for (int j = 0; j < partitionCount_sky; j++) {
-			// ǥ 
-			float nx, ny, nz;
-			nx = x + partitionWidth * i;
-			ny = y + partitionHeight * j;
-			nz = z;
-			// ֹ  & ġ
-			CObstacle partition;
-			if (false == partition.create(Device, -1, -1, partitionWidth, partitionHeight, partitonDepth, wallColor)) return false;
-			partition.setPosition(nx, ny, nz);
-			obstacle_wall.push_back(partition);
-			//  
-		}
-	}
-	return true;
+//   ߻   head ġ ׸
+void drawAimPreview(const D3DXVECTOR3& head, const D3DXVECTOR3& target)
+{
+	D3DXMATRIX rot, trans, world;
+	float heading = atan2f(target.z - head.z, target.x - head.x);
+	D3DXMatrixRotationY(&rot, -heading);
+	D3DXMatrixTranslation(&trans, head.x, head.y, head.z);
+	world = rot * trans * g_mWorld;
+
+	Device->SetTransform(D3DTS_WORLD, &world);
+	Device->SetRenderState(D3DRS_LIGHTING, FALSE);
+	Device->SetTexture(0, NULL);
+	Device->SetFVF(AIM_VERTEX_FVF);
+	Device->DrawPrimitiveUP(D3DPT_LINESTRIP, AIM_ARC_POINTS - 1, g_aimArc, sizeof(AimVertex));
+	Device->SetRenderState(D3DRS_LIGHTING, TRUE);
 }
 
 
-bool createWall(D3DXCOLOR wallColor) // create wall
+// ֹ chunk   vertex buffer ø (createMap   )
+bool createObstacleBuffers()
 {
-	CWall wall;
-
-	for (int i = -1; i <= 1; i += 2) {
-		//յ 
-		if (false == wall.create(Device, -1, -1, WORLD_WIDTH - 1, 2.0f, 1.0f, wallColor)) return false;
-		wall.setPosition(0.0f, 1.0f, (float)i * WORLD_DEPTH / 2);
-		lwall1.push_back(wall);
-		//յ 
-		if (false == wall.create(Device, -1, -1, 1.0f, 2.5f, 1.5f, wallColor)) return false;
-		wall.setPosition(0, 1.25f, (float)i * WORLD_DEPTH / 2);
-		swall1.push_back(wall);
-		// 
-		if (false == wall.create(Device, -1, -1, 1.0f, 2.0f, WORLD_DEPTH - 1, wallColor)) return false;
-		wall.setPosition((float)i * WORLD_WIDTH / 2, 1.0f, 0.0f);
-		lwall2.push_back(wall);
-	}
-
-	for (int i = -1; i <= 1; i += 2) {
-		for (int j = -2; j <= 2; j++) {
-			//߰ 
-			if (false == wall.create(Device, -1, -1, 1.5f, 2.5f, 2.0f, wallColor)) return false;
-			wall.setPosition((float)i * WORLD_WIDTH / 2, 1.25f, (float)j * WORLD_DEPTH / 6);
-			swall2.push_back(wall);
-		}
-
-		for (int j = -1; j <= 1; j += 2) {
-			// 
-			if (false == wall.create(Device, -1, -1, 1.5f, 3.0f, 1.5f, wallColor)) return false;
-			wall.setPosition((float)i * WORLD_WIDTH / 2, 1.5f, (float)j * WORLD_DEPTH / 2);
-			swall2.push_back(wall);
-		}
+	static vector<unsigned short> indices;
+	g_obstacleChunks.build(g_obstacleBatch, -WORLD_WIDTH / 2 - 1.0f, -WORLD_DEPTH / 2 - 1.0f,
+		WORLD_WIDTH + 2.0f, WORLD_DEPTH + 2.0f, OBSTACLE_CHUNK_SIZE);
+	int boxes = g_obstacleChunks.getBoxCount();
+	if (boxes == 0)
+		return false;
+	g_occlusionChunks.clear();
+	for (int c = 0; c < g_obstacleChunks.getChunkCount(); c++) {
+		const CChunkedBatch::Chunk& chunk = g_obstacleChunks.getChunk(c);
+		g_occlusionChunks.insert(g_occlusionChunks.end(), chunk.bmin, chunk.bmin + 3);
+		g_occlusionChunks.insert(g_occlusionChunks.end(), chunk.bmax, chunk.bmax + 3);
 	}
+	g_occludersDirty = true;
 
-	g_legoWall.push_back(lwall1);
-	g_legoWall.push_back(lwall2);
-	g_legoWall.push_back(swall1);
-	g_legoWall.push_back(swall2);
+	UINT vbBytes = boxes * CInstanceBatch::VERTICES_PER_INSTANCE * sizeof(InstanceVertex);
+	if (FAILED(Device->CreateVertexBuffer(vbBytes, D3DUSAGE_WRITEONLY, OBSTACLE_VERTEX_FVF, D3DPOOL_MANAGED, &g_obstacleVB, NULL)))
+		return false;
+	CInstanceBatch::buildIndices(indices);
+	UINT ibBytes = (UINT)(indices.size() * sizeof(unsigned short));
+	if (FAILED(Device->CreateIndexBuffer(ibBytes, D3DUSAGE_WRITEONLY, D3DFMT_INDEX16, D3DPOOL_MANAGED, &g_obstacleIB, NULL))) {
+		g_obstacleVB->Release();
+		g_obstacleVB = NULL;
+		return false;
+	}
 
+	void* p;
+	if (SUCCEEDED(g_obstacleVB->Lock(0, vbBytes, &p, 0))) {
+		for (int c = 0; c < g_obstacleChunks.getChunkCount(); c++) {
+			int first = g_obstacleChunks.getChunk(c).first;
+			g_obstacleChunks.rebuildChunk(c, g_obstacleBatch, (InstanceVertex*)p + first * CInstanceBatch::VERTICES_PER_INSTANCE);
+		}
+		g_obstacleVB->Unlock();
+	}
+	if (SUCCEEDED(g_obstacleIB->Lock(0, ibBytes, &p, 0))) {
+		memcpy(p, &indices[0], ibBytes);
+		g_obstacleIB->Unlock();
+	}
+	g_obstacleBatch.clearDirty();
+	g_obstacleChunks.clearDirty();
 	return true;
 }
 
-bool createMap()
+void destroyObstacleBuffers()
 {
-	float w = WORLD_WIDTH;
-	float d = WORLD_DEPTH;
-
-	// 
-	createWall(d3d::WHITE);
-
-	// ٴ
-	if (false == g_legoPlane.create(Device, -1, -1, WORLD_WIDTH, 0.03f, WORLD_DEPTH, d3d::WHITER_SAND)) return false;
-	g_legoPlane.setPosition(0.0f, -0.0006f / 5, 0.0f);
+	if (g_obstacleVB != NULL) {
+		g_obstacleVB->Release();
+		g_obstacleVB = NULL;
+	}
+	if (g_obstacleIB != NULL) {
+		g_obstacleIB->Release();
+		g_obstacleIB = NULL;
+	}
+	g_occlusion.waitCull();
+	g_obstacleBatch.clear();
+	g_obstacleChunks.clear();
+	g_occlusionChunks.clear();
+}
 
-	// ֹ
-	createWWall(0.4f, 0.7f, 1.0f, 18, 3, -w / 2 + 0.85f, 0.35f, d / 6, d3d::LIGHTGRAY);
-	createWWall(1.5f, 0.5f, 1.5f, 1, 5, -w / 2 + 7.95f, 0.25f, d / 6, d3d::LIGHTGRAY);
-	createDWall(0.4f, 0.7f, 1.0f, 10, 3, -w / 2 + 7.95f, 0.35f, d / 6 - 10.25f, d3d::LIGHTGRAY);
-	createWWall(1.5f, 0.5f, 1.5f, 1, 5, -w / 2 + 7.95f, 0.25f, d / 6 - 11.5f, d3d::LIGHTGRAY);
+// μ  ֹ   depth ׸ chunk ˻ϴ  worker thread ѱ.
+// ī޶  (updateFrustum ) θ,  endOcclusion 
+void beginOcclusion()
+{
+	if (g_occludersDirty) {
+		static vector<bool> alive;
+		static vector<ArenaBox> occluders;
+		static vector<float> boxes;
+		alive.resize(g_obstacleBatch.getSlotCount());
+		for (int i = 0; i < alive.size(); i++)
+			alive[i] = g_obstacleBatch.isLive(i);
+		CArenaLayout::buildOccluders(alive, occluders);
+		boxes.resize(occluders.size() * 6);
+		for (int i = 0; i < occluders.size(); i++)
+			occluders[i].getBounds(&boxes[i * 6], &boxes[i * 6 + 3]);
+		g_occlusion.setOccluders(boxes.empty() ? NULL : &boxes[0], (int)occluders.size());
+		g_occludersDirty = false;
+	}
+	D3DXMATRIX m = g_mWorld * g_mView * g_mProj;
+	g_occlusion.beginCull((const float*)&m, g_occlusionChunks.empty() ? NULL : &g_occlusionChunks[0], (int)g_occlusionChunks.size() / 6);
+	g_chunkVisible = NULL;
+}
 
-	createWWall(0.4f, 0.7f, 1.0f, 18, 3, -w / 2 + 0.85f, 0.35f, -d / 6, d3d::LIGHTGRAY);
-	createWWall(1.5f, 0.5f, 1.5f, 1, 5, -w / 2 + 7.95f, 0.25f, -d / 6, d3d::LIGHTGRAY);
-	createDWall(0.4f, 0.7f, 1.0f, 10, 3, -w / 2 + 7.95f, 0.35f, -d / 6 + 1.25f, d3d::LIGHTGRAY);
-	createWWall(1.5f, 0.5f, 1.5f, 1, 5, -w / 2 + 7.95f, 0.25f, -d / 6 + 11.25f, d3d::LIGHTGRAY);
+// worker  ٸ;  ڷδ g_occlusion.isVisible ƹ ڽ ˻ 
+void endOcclusion()
+{
+	g_chunkVisible = g_occlusion.waitCull();
+}
 
-	createWWall(1.5f, 0.5f, 1.5f, 1, 5, 0, 0.25f, -d / 3, d3d::LIGHTGRAY);
-	createWWall(0.4f, 0.7f, 1.0f, 15, 3, 0.95f, 0.35f, -d / 3, d3d::LIGHTGRAY);
-	createWWall(1.5f, 0.5f, 1.5f, 1, 5, 7.5f, 0.25f, -d / 3, d3d::LIGHTGRAY);
-	createDWall(0.8f, 0.7f, 1.0f, 25, 3, 7.5f, 0.35f, -d / 3 + 1.25f, d3d::LIGHTGRAY);
-	createWWall(1.5f, 0.5f, 1.5f, 1, 5, 7.5f, 0.25f, -d / 3 + 26.5f, d3d::LIGHTGRAY);
-	createWWall(0.4f, 0.7f, 1.0f, 15, 3, 0.95f, 0.35f, -d / 3 + 26.5f, d3d::LIGHTGRAY);
-	createWWall(1.5f, 0.5f, 1.5f, 1, 5, 0, 0.25f, -d / 3 + 26.5f, d3d::LIGHTGRAY);
+// ī޶   Ӹ   þ  ٽ 
+void updateFrustum()
+{
+	D3DXMATRIX m = g_mWorld * g_mView * g_mProj;
+	g_frustum.extract((const float*)&m);
+	g_cullStats.tested = 0;
+	g_cullStats.visible = 0;
+}
 
-	createWWall(1.5f, 0.5f, 1.5f, 1, 5, 0, 0.25f, d / 3, d3d::LIGHTGRAY);
-	createWWall(0.4f, 0.7f, 1.0f, 15, 3, 0.95f, 0.35f, d / 3, d3d::LIGHTGRAY);
-	createWWall(1.5f, 0.5f, 1.5f, 1, 5, 7.5f, 0.25f, d / 3, d3d::LIGHTGRAY);
-	createDWall(0.8f, 0.7f, 1.0f, 25, 3, 7.5f, 0.35f, d / 3 - 25.25f, d3d::LIGHTGRAY);
-	createWWall(1.5f, 0.5f, 1.5f, 1, 5, 7.5f, 0.25f, d / 3 - 26.5f, d3d::LIGHTGRAY);
-	createWWall(0.4f, 0.7f, 1.0f, 15, 3, 0.95f, 0.35f, d / 3 - 26.5f, d3d::LIGHTGRAY);
-	createWWall(1.5f, 0.5f, 1.5f, 1, 5, 0, 0.25f, d / 3 - 26.5f, d3d::LIGHTGRAY);
+// world  ġ g_worldFrame ٲ  ó ׸  ٽ .
+// list g_entities  ȣ ( ̿ entity ų ְų ű )
+void drawEntities(const vector<int>& list)
+{
+	if (!list.empty())
+		submitEntities(g_entities, &list[0], (int)list.size(), g_worldFrame, selectSphereLod, g_renderQueue);
+}
 
+// ׸  ϳ (job ϳ ä; 赵 job   buildDrawLists ħ)
+struct DrawListPart {
+	vector<int> entities; // g_entities  ȣ
+	vector<int> chunks; // ֹ chunk ȣ (chunk buffer  )
+	FrustumStats stats;
+};
+DrawListPart g_wallPart, g_actorPart, g_obstaclePart;
+CTaskGraph g_frameGraph; //  :  | occlusion  -> ũ , ֹ
 
-	createWWall(1.2f, 0.5f, 1.2f, 1, 8, -2.0f, 0.25f, 3.0f, d3d::LIGHTGRAY);
-	createWWall(1.2f, 0.5f, 1.2f, 1, 8, -2.0f, 0.25f, -3.0f, d3d::LIGHTGRAY);
-	createWWall(1.2f, 0.5f, 1.2f, 1, 7, -1.0f, 0.25f, 4.0f, d3d::LIGHTGRAY);
-	createWWall(1.2f, 0.5f, 1.2f, 1, 7, -1.0f, 0.25f, -4.0f, d3d::LIGHTGRAY);
-	createWWall(1.2f, 0.5f, 1.2f, 1, 9, -3.0f, 0.25f, 1.5f, d3d::LIGHTGRAY);
-	createWWall(1.2f, 0.5f, 1.2f, 1, 9, -3.0f, 0.25f, -1.5f, d3d::LIGHTGRAY);
+void clearPart(DrawListPart& part)
+{
+	part.entities.clear();
+	part.chunks.clear();
+	part.stats.tested = 0;
+	part.stats.visible = 0;
+}
 
-	//  
-	createWWall(1.2f, 0.8f, 1.2f, 1, 5, 3.0f, 0.4f, 3.0f, d3d::LIGHTGRAY);
+// ֹ   entity list  (endOcclusion ڿ θ)
+void removeHidden(vector<int>& list)
+{
+	const CAabbStore& boxes = g_entities.getBoxes();
+	int n = 0;
+	for (int k = 0; k < list.size(); k++) {
+		float bmin[3], bmax[3];
+		boxes.getBox(list[k], bmin, bmax);
+		if (!g_occlusion.isVisible(bmin, bmax))
+			continue;
+		list[n++] = list[k];
+	}
+	list.resize(n);
+}
 
-	createWWall(0.4f, 0.4f, 0.5f, 10, 1, 3.8f, 1.2f, 3.0f, d3d::LIGHTGRAY);
-	createWWall(0.4f, 0.4f, 0.5f, 10, 1, 3.8f, 2.0f, 3.0f, d3d::LIGHTGRAY);
-	createWWall(0.4f, 0.4f, 0.5f, 10, 1, 3.8f, 2.8f, 3.0f, d3d::LIGHTGRAY);
+// ѷ ٴ: BVH þ  subtree ° ǳʶ
+void cullWorldWalls(DrawListPart& part)
+{
+	static vector<int> visibleList; //  job 
+	visibleList.clear();
+	const CCollisionWorld& world = g_sim.getCollisionWorld();
+	int visible = world.cullFrustum(g_frustum, CCollisionWorld::KIND_ALL, visibleList);
+	part.stats.tested += world.getBoxCount();
+	part.stats.visible += visible;
+	for (int k = 0; k < visible; k++)
+		part.entities.push_back(g_entities.getRow(g_worldWalls[visibleList[k]]));
+}
 
-	createWWall(1.2f, 0.8f, 1.2f, 1, 5, 8.2f, 0.4f, 3.0f, d3d::LIGHTGRAY);
+// ũ ǰ, , ̻: þ ̰ ֹ    ͸
+void cullActors(DrawListPart& part)
+{
+	cullEntities(g_entities, g_frustum, RENDER_LAYER_ACTOR, part.entities, &part.stats);
+	removeHidden(part.entities);
+}
 
-	createDWall(0.4f, 0.4f, 0.4f, 12, 1, 8.2f, 1.2f, -2.2f, d3d::LIGHTGRAY);
-	createDWall(0.4f, 0.4f, 0.4f, 12, 1, 8.2f, 2.0f, -2.2f, d3d::LIGHTGRAY);
-	createDWall(0.4f, 0.4f, 0.4f, 12, 1, 8.2f, 2.8f, -2.2f, d3d::LIGHTGRAY);
+// ֹ: þ ̰   chunk (buffer  ó ϳ)
+void cullObstacles(DrawListPart& part)
+{
+	if (g_obstacleVB == NULL) {
+		cullEntities(g_entities, g_frustum, RENDER_LAYER_OBSTACLE, part.entities, &part.stats);
+		removeHidden(part.entities);
+		return;
+	}
+	for (int c = 0; c < g_obstacleChunks.getChunkCount(); c++) {
+		const CChunkedBatch::Chunk& chunk = g_obstacleChunks.getChunk(c);
+		if (chunk.live == 0)
+			continue;
+		part.stats.tested++;
+		if (!g_frustum.testBox(chunk.bmin, chunk.bmax))
+			continue;
+		part.stats.visible++;
+		if (g_chunkVisible != NULL && !g_chunkVisible[c])
+			continue;	//  ֹ  
+		part.chunks.push_back(c);
+	}
+}
 
-	createWWall(1.2f, 0.8f, 1.2f, 1, 5, 8.2f, 0.4f, -3.0f, d3d::LIGHTGRAY);
+void runWallTask(void* context, int begin, int end) { cullWorldWalls(g_wallPart); }
+void runOcclusionTask(void* context, int begin, int end) { endOcclusion(); }
+void runActorTask(void* context, int begin, int end) { cullActors(g_actorPart); }
+void runObstacleTask(void* context, int begin, int end) { cullObstacles(g_obstaclePart); }
 
-	createWWall(0.4f, 0.4f, 0.5f, 10, 1, 3.8f, 1.2f, -3.0f, d3d::LIGHTGRAY);
-	createWWall(0.4f, 0.4f, 0.5f, 10, 1, 3.8f, 2.0f, -3.0f, d3d::LIGHTGRAY);
-	createWWall(0.4f, 0.4f, 0.5f, 10, 1, 3.8f, 2.8f, -3.0f, d3d::LIGHTGRAY);
+// Setup   . ϵ   ʰ, ũ ֹ occlusion  ٸ
+void buildFrameGraph()
+{
+	g_frameGraph.clear();
+	g_frameGraph.add(runWallTask, NULL);
+	int occlusion = g_frameGraph.add(runOcclusionTask, NULL);
+	int actors = g_frameGraph.add(runActorTask, NULL);
+	int obstacles = g_frameGraph.add(runObstacleTask, NULL);
+	g_frameGraph.precede(occlusion, actors);
+	g_frameGraph.precede(occlusion, obstacles);
+}
 
-	createWWall(1.2f, 0.8f, 1.2f, 1, 5, 3.0f, 0.4f, -3.0f, d3d::LIGHTGRAY);
+// ̹ ӿ ׸  job system   (D3D ȣ ; ׸ main thread).
+// updateObstacleChunks  θ
+void buildDrawLists()
+{
+	clearPart(g_wallPart);
+	clearPart(g_actorPart);
+	clearPart(g_obstaclePart);
+	g_jobs.run(g_frameGraph);
 
-	createDWall(0.4f, 0.4f, 0.4f, 12, 1, 3.0f, 1.2f, -2.2f, d3d::LIGHTGRAY);
-	createDWall(0.4f, 0.4f, 0.4f, 12, 1, 3.0f, 2.0f, -2.2f, d3d::LIGHTGRAY);
-	createDWall(0.4f, 0.4f, 0.4f, 12, 1, 3.0f, 2.8f, -2.2f, d3d::LIGHTGRAY);
+	const DrawListPart* parts[3] = { &g_wallPart, &g_actorPart, &g_obstaclePart };
+	for (int i = 0; i < 3; i++) {
+		g_cullStats.tested += parts[i]->stats.tested;
+		g_cullStats.visible += parts[i]->stats.visible;
+	}
+}
 
-	//  Ʒ 
+void drawWorldWalls()
+{
+	drawEntities(g_wallPart.entities);
+}
 
-	createWWall(1.4f, 0.5f, 1.4f, 1, 5, -w / 2 + 14.4f, 0.25f, -d / 4 + 13.4f, d3d::LIGHTGRAY);
-	createDWall(0.5f, 0.7f, 1.0f, 12, 3, -w / 2 + 14.4f, 0.35f, -d / 4 + 1.2f, d3d::LIGHTGRAY);
-	createWWall(1.4f, 0.5f, 1.4f, 1, 5, -w / 2 + 14.4f, 0.25f, -d / 4, d3d::LIGHTGRAY);
-	createWWall(0.5f, 0.7f, 1.0f, 16, 3, -w / 2 + 5.95f, 0.25f, -d / 4, d3d::LIGHTGRAY);
+void drawActors()
+{
+	drawEntities(g_actorPart.entities);
+}
 
-	createWWall(1.4f, 0.5f, 1.4f, 1, 5, -w / 2 + 5.0f, 0.25f, -d / 4, d3d::LIGHTGRAY);
-	createDWall(0.5f, 0.7f, 1.0f, 14, 3, -w / 2 + 5.0f, 0.35f, -d / 4 - 14.2f, d3d::LIGHTGRAY);
-	createWWall(1.4f, 0.5f, 1.4f, 1, 5, -w / 2 + 5.0f, 0.25f, -d / 4 - 15.4f, d3d::LIGHTGRAY);
-	createWWall(0.5f, 0.7f, 1.0f, 20, 3, -w / 2 + 5.95f, 0.35f, -d / 4 - 15.4f, d3d::LIGHTGRAY);
-	createWWall(1.4f, 0.5f, 1.4f, 1, 5, -w / 2 + 16.4f, 0.25f, -d / 4 - 15.4f, d3d::LIGHTGRAY);
+// ֹ ı chunk ٽ ħ (chunk  ٲǷ buildDrawLists )
+void updateObstacleChunks()
+{
+	if (g_obstacleVB == NULL)
+		return;
+	const UINT boxBytes = CInstanceBatch::VERTICES_PER_INSTANCE * sizeof(InstanceVertex);
+	g_obstacleChunks.takeDirtySlots(g_obstacleBatch);
+	const vector<int>& dirty = g_obstacleChunks.getDirtyChunks();
+	for (int k = 0; k < dirty.size(); k++) {
+		const CChunkedBatch::Chunk& chunk = g_obstacleChunks.getChunk(dirty[k]);
+		void* p;
+		if (SUCCEEDED(g_obstacleVB->Lock(chunk.first * boxBytes, chunk.capacity * boxBytes, &p, 0))) {
+			g_obstacleChunks.rebuildChunk(dirty[k], g_obstacleBatch, (InstanceVertex*)p);
+			g_obstacleVB->Unlock();
+		}
+	}
+	g_obstacleChunks.clearDirty();
+}
 
-	createWWall(1.4f, 0.5f, 1.4f, 1, 5, -w / 2 + 14.4f, 0.25f, d / 4 - 13.4f, d3d::LIGHTGRAY);
-	createDWall(0.5f, 0.7f, 1.0f, 12, 3, -w / 2 + 14.4f, 0.35f, d / 4 - 12.2f, d3d::LIGHTGRAY);
-	createWWall(1.4f, 0.5f, 1.4f, 1, 5, -w / 2 + 14.4f, 0.25f, d / 4, d3d::LIGHTGRAY);
-	createWWall(0.5f, 0.7f, 1.0f, 16, 3, -w / 2 + 5.95f, 0.25f, d / 4, d3d::LIGHTGRAY);
+// ̴ chunk   ׸.
+//   Ƿ material     
+void drawObstacles()
+{
+	if (g_obstacleVB == NULL) {
+		// buffer   ó ϳ
+		drawEntities(g_obstaclePart.entities);
+		return;
+	}
+
+	D3DMATERIAL9 mtrl;
+	ZeroMemory(&mtrl, sizeof(mtrl));
+	mtrl.Power = 5.0f;	// makeMaterial 
+	Device->SetMaterial(&mtrl);
+	Device->SetTransform(D3DTS_WORLD, &g_mWorld);
+	Device->SetRenderState(D3DRS_COLORVERTEX, TRUE);
+	Device->SetRenderState(D3DRS_DIFFUSEMATERIALSOURCE, D3DMCS_COLOR1);
+	Device->SetRenderState(D3DRS_AMBIENTMATERIALSOURCE, D3DMCS_COLOR1);
+	Device->SetRenderState(D3DRS_SPECULARMATERIALSOURCE, D3DMCS_COLOR1);
+	Device->SetFVF(OBSTACLE_VERTEX_FVF);
+	Device->SetStreamSource(0, g_obstacleVB, 0, sizeof(InstanceVertex));
+	Device->SetIndices(g_obstacleIB);
+
+	const vector<int>& visible = g_obstaclePart.chunks;
+	for (int k = 0; k < visible.size(); k++) {
+		const CChunkedBatch::Chunk& chunk = g_obstacleChunks.getChunk(visible[k]);
+		for (int first = 0; first < chunk.live; first += CInstanceBatch::INSTANCES_PER_DRAW) {
+			int count = min(chunk.live - first, (int)CInstanceBatch::INSTANCES_PER_DRAW);
+			Device->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, (chunk.first + first) * CInstanceBatch::VERTICES_PER_INSTANCE, 0,
+				count * CInstanceBatch::VERTICES_PER_INSTANCE, 0, count * CInstanceBatch::INDICES_PER_INSTANCE / 3);
+		}
+	}
+
+	// D3D ⺻ ǵ (mesh   Ƿ material )
+	Device->SetRenderState(D3DRS_AMBIENTMATERIALSOURCE, D3DMCS_MATERIAL);
+	Device->SetRenderState(D3DRS_SPECULARMATERIALSOURCE, D3DMCS_COLOR2);
+}
 
-	createWWall(1.4f, 0.5f, 1.4f, 1, 5, -w / 2 + 5.0f, 0.25f, d / 4, d3d::LIGHTGRAY);
-	createDWall(0.5f, 0.7f, 1.0f, 14, 3, -w / 2 + 5.0f, 0.35f, d / 4 + 1.2f, d3d::LIGHTGRAY);
-	createWWall(1.4f, 0.5f, 1.4f, 1, 5, -w / 2 + 5.0f, 0.25f, d / 4 + 15.4f, d3d::LIGHTGRAY);
-	createWWall(0.5f, 0.7f, 1.0f, 20, 3, -w / 2 + 5.95f, 0.25f, d / 4 + 15.4f, d3d::LIGHTGRAY);
-	createWWall(1.4f, 0.5f, 1.4f, 1, 5, -w / 2 + 16.4f, 0.25f, d / 4 + 15.4f, d3d::LIGHTGRAY);
+// ̻ entity snapshot ̻   (ġ  tick ̹ tick ̷ )
+void syncMissiles(const SimSnapshot& s)
+{
+	const vector<SimVec3>& missiles = s.missiles;
+	while (g_missiles.size() < missiles.size()) {
+		Entity e = createSphereEntity(SimVec3(0, 0, 0), (float)M_RADIUS, d3d::BLACK, RENDER_LAYER_ACTOR);
+		if (!g_entities.isValid(e))
+			break;
+		g_missiles.push_back(e);
+	}
+	for (int i = 0; i < g_missiles.size(); i++) {
+		bool hidden = i >= missiles.size();
+		g_entities.setHidden(g_missiles[i], hidden);
+		if (!hidden)
+			moveEntity(g_entities, g_missiles[i], missiles[i], s.lastMissiles[i]);
+	}
+}
 
+bool createMap()
+{
+	// ѷ ٴ (g_sim 浹 BVH  CArenaLayout  BVH ڽ ȣ ٷ ã)
+	vector<ArenaBox> walls;
+	CArenaLayout::buildWalls(walls);
+	g_worldWalls.clear();
+	for (int i = 0; i < walls.size(); i++) {
+		bool floor = i == walls.size() - 1;
+		Entity e = createBoxEntity(walls[i], floor ? d3d::WHITER_SAND : d3d::WHITE, RENDER_LAYER_WORLD);
+		if (!g_entities.isValid(e)) return false;
+		g_worldWalls.push_back(e);
+	}
+
+	// ֹ (ġǥ arenaLayout.cpp, g_sim  ڽ ȣ  ״ )
+	const vector<ArenaBox>& boxes = g_sim.getArenaObstacles();
+	g_obstacleEntities.assign(boxes.size(), NullEntity());
+	for (int i = 0; i < boxes.size(); i++) {
+		const ArenaBox& b = boxes[i];
+		Entity e = createBoxEntity(b, d3d::LIGHTGRAY, RENDER_LAYER_OBSTACLE);
+		if (!g_entities.isValid(e)) return false;
+		DestructibleComponent d;
+		d.id = i;
+		d.batchSlot = g_obstacleBatch.add(b.center[0], b.center[1], b.center[2], b.size[0], b.size[1], b.size[2], (D3DCOLOR)d3d::LIGHTGRAY);
+		g_entities.setDestructible(e, d);
+		g_obstacleEntities[i] = e;
+	}
 
 	return true;
 }
@@ -1066,16 +877,13 @@ bool createMap()
 
 void destroyAllLegoBlock(void)
 {
-	for (int q = 0; q < obstacle_wall.size(); q++) {
-		if (obstacle_wall[q].get_created() != FALSE) {
-			obstacle_wall[q].destroy();
-		}
-	}
-	g_legoPlane.destroy();
-	for (int i = 0; i < g_legoWall.size(); i++) {
-		for (int j = 0; j < g_legoWall[i].size(); j++)
-			g_legoWall[i][j].destroy();
-	}
+	for (int q = 0; q < g_obstacleEntities.size(); q++)
+		destroyEntity(g_obstacleEntities[q]);	// μ  ̹ 
+	g_obstacleEntities.clear();
+	destroyObstacleBuffers();
+	for (int i = 0; i < g_worldWalls.size(); i++)
+		destroyEntity(g_worldWalls[i]);
+	g_worldWalls.clear();
 }
 
 // initialization
@@ -1083,31 +891,17 @@ bool Setup()
 {
 	int i;
 
+	g_d3dBackend.setDevice(Device);
+	g_meshFactory.setDevice(Device);
+	g_meshCache.setFactory(&g_meshFactory);
+
 	//  ---------------------
-	if (FAILED(D3DXCreateFont(Device, 40, 0, FW_NORMAL, 1, false, DEFAULT_CHARSET,
-		OUT_DEFAULT_PRECIS, DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, "Tahoma", &DEGREEfont)))
-	{
-		::MessageBox(0, "D3DXCreateFont() - FAILED", 0, 0);
-		return false;
-	}
-	if (FAILED(D3DXCreateFont(Device, 40, 0, FW_NORMAL, 1, false, DEFAULT_CHARSET,
-		OUT_DEFAULT_PRECIS, DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, "Tahoma", &FIREDISTANCEfont)))
-	{
-		::MessageBox(0, "D3DXCreateFont() - FAILED", 0, 0);
-		return false;
-	}
 	if (FAILED(D3DXCreateFont(Device, 350, 0, FW_NORMAL, 1, false, DEFAULT_CHARSET,
 		OUT_DEFAULT_PRECIS, DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, "Tahoma", &TITLEfont)))
 	{
 		::MessageBox(0, "D3DXCreateFont() - FAILED", 0, 0);
 		return false;
 	}
-	if (FAILED(D3DXCreateFont(Device, 40, 0, FW_NORMAL, 1, false, DEFAULT_CHARSET,
-		OUT_DEFAULT_PRECIS, DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, "Tahoma", &TIMEfont)))
-	{
-		::MessageBox(0, "D3DXCreateFont() - FAILED", 0, 0);
-		return false;
-	}
 	if (FAILED(D3DXCreateFont(Device, 150, 0, FW_NORMAL, 1, false, DEFAULT_CHARSET,
 		OUT_DEFAULT_PRECIS, DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, "Tahoma", &ENDfont)))
 	{
@@ -1120,40 +914,44 @@ bool Setup()
 		::MessageBox(0, "D3DXCreateFont() - FAILED", 0, 0);
 		return false;
 	}
-	if (FAILED(D3DXCreateFont(Device, 40, 0, FW_NORMAL, 1, false, DEFAULT_CHARSET,
-		OUT_DEFAULT_PRECIS, DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, "Tahoma", &DISTANCEfont)))
-	{
-		::MessageBox(0, "D3DXCreateFont() - FAILED", 0, 0);
+	if (false == createHudAtlas()) {
+		::MessageBox(0, "createHudAtlas() - FAILED", 0, 0);
 		return false;
 	}
+	g_hud.setLine(HUD_TIME, 10, 10);
+	g_hud.setLine(HUD_DEGREE, 10, 50);
+	g_hud.setLine(HUD_FIRE_DISTANCE, 10, 90);
+	g_hud.setLine(HUD_TANK_DISTANCE, 10, 130);
+	g_hud.setLine(HUD_STATS, 10, Height - 60);
+	g_hud.setLine(HUD_OCCLUSION, 10, Height - 100);
+	g_hud.setLine(HUD_LATENCY, 10, Height - 140);
 	// ------------------------------
 
 	D3DXMatrixIdentity(&g_mWorld);
 	D3DXMatrixIdentity(&g_mView);
 	D3DXMatrixIdentity(&g_mProj);
 
-	if (false == tank.create(Device, -1, -1, d3d::BROWN)) return false;
-	tank.setPosition(0, 0.38f, -WORLD_DEPTH / 2 + 5);
-	tank.setLastCoord(tank.getCenter());
+	if (false == createTankModel(g_tankParts[0], d3d::BROWN)) return false;
+	if (false == createTankModel(g_tankParts[1], d3d::GREEN)) return false;
 
-	if (false == otank.create(Device, -1, -1, d3d::GREEN)) return false;
-	otank.setPosition(0, 0.38f, WORLD_DEPTH / 2 - 5);
-	otank.setLastCoord(otank.getCenter());
-
-	// tank blue ball 
-	g_target_blueball.linkTank(&tank);
+	// ũ, , ֹ 浹 ڽ, ̻, ź Ÿ ǥ
+	g_sim.init();
+	// ϵ thread ϳ: Ӹ ׸  
+	g_jobs.setThreadCount(0);
+	buildFrameGraph();
 
 	// , ٴ 
 	createMap();
+	createObstacleBuffers();
 	// ֹ 
 
 	// create blue ball for set direction
-	if (false == g_target_blueball.create(Device, d3d::RED)) return false;
-	//g_target_blueball.setCenter(.0f, (float)M_RADIUS + 3, .0f);
-	g_target_blueball.setCenter(tank.getCenter().x - 0.01f, (float)M_RADIUS + 3, tank.getCenter().z + 5.0f);
+	g_blueball = createSphereEntity(g_sim.getTarget().getCenter(), (float)M_RADIUS, d3d::RED, RENDER_LAYER_ACTOR);
+	if (!g_entities.isValid(g_blueball)) return false;
 
-	if (false == podium.create(Device, -1, -1, 2.0f, 1.2f, 2.0f, d3d::GOLD)) return false;
-	podium.setPosition(0.0f, 0.6f, 0.0f);
+	ArenaBox podiumBox = { { 0.0f, PODIUM_HEIGHT / 2, 0.0f }, { 2.0f, PODIUM_HEIGHT, 2.0f } };
+	g_podium = createBoxEntity(podiumBox, d3d::GOLD, RENDER_LAYER_WORLD);
+	if (!g_entities.isValid(g_podium)) return false;
 
 	// light setting 
 	D3DLIGHT9 lit;
@@ -1192,34 +990,35 @@ bool Setup()
 
 	g_light.setLight(Device, g_mWorld);
 	g_light2.setLight(Device, g_mWorld);
+
+	//  g_sim simulation thread  ( g_simThread.post, ´ snapshot)
+	g_obstacleShown.assign(g_sim.getArenaObstacles().size(), 1);
+	g_shownDestroyed = 0;
+	g_shownTurns = g_sim.getStats().turns;
+	g_latency.reset();
+	g_simThread.start(&g_sim, NULL, SIM_MAX_CATCHUP_STEPS);
 	return true;
 }
 
 void Cleanup(void)
 {
+	g_simThread.stop();
+	g_jobs.setThreadCount(1);	// worker thread 
 	destroyAllLegoBlock();
+	for (int i = 0; i < g_missiles.size(); i++)
+		destroyEntity(g_missiles[i]);
+	g_missiles.clear();
 	g_light.destroy();
 	g_light2.destroy();
 
-	tank.destroy();
-	otank.destroy();
-	g_target_blueball.destroy();
-	podium.destroy();
-
-	tank.destroy();
-	otank.destroy();
-	g_target_blueball.destroy();
-	podium.destroy();
+	destroyTankModel(g_tankParts[0]);
+	destroyTankModel(g_tankParts[1]);
+	destroyEntity(g_blueball);
+	destroyEntity(g_podium);
+	g_entities.clear();
+	g_meshCache.clear();	//   mesh
 
 	//  ----------------------------
-	if (DEGREEfont != NULL) {
-		DEGREEfont->Release();
-		DEGREEfont = NULL;
-	}
-	if (FIREDISTANCEfont != NULL) {
-		FIREDISTANCEfont->Release();
-		FIREDISTANCEfont = NULL;
-	}
 	if (TITLEfont != NULL) {
 		TITLEfont->Release();
 		TITLEfont = NULL;
@@ -1232,14 +1031,13 @@ void Cleanup(void)
 		PLAYERfont->Release();
 		PLAYERfont = NULL;
 	}
-	if (DISTANCEfont != NULL) {
-		DISTANCEfont->Release();
-		DISTANCEfont = NULL;
+	if (g_hudSprite != NULL) {
+		g_hudSprite->Release();
+		g_hudSprite = NULL;
 	}
-	if (TIMEfont != NULL)
-	{
-		TIMEfont->Release();
-		TIMEfont = NULL;
+	if (g_hudTexture != NULL) {
+		g_hudTexture->Release();
+		g_hudTexture = NULL;
 	}
 	//--------------------------------------
 }
@@ -1250,300 +1048,248 @@ float y_camera = 0.8f;
 float back_camera = 1;
 float camera_prefix = 0.05f;
 
-bool isOriginTank = TRUE;
-
-bool isFire = FALSE;
-
-int turnTime = 20000;
-
-bool threeTime = FALSE;
-bool zoomOutTiming = FALSE;
-
-double startTime = (double)timeGetTime();
-double currTime = (double)timeGetTime();
-double timediff = currTime - startTime;
+// entity snapshot ġ ű  tick alphaŭ   ׸ 
+void syncEntities(const SimSnapshot& s, float alpha)
+{
+	syncTankModel(g_tankParts[s.tank.player], s.tank);
+	syncTankModel(g_tankParts[s.otherTank.player], s.otherTank);
+	moveEntity(g_entities, g_blueball, s.target, s.lastTarget);
+	syncMissiles(s);
+	interpolateEntities(g_entities, alpha);
+}
 
-float zoomOutSpeed = 0.0;
+//  tick ġ  ġ alpha  ,  ġ 󸶳  ִ
+D3DXVECTOR3 lerpOffset(const D3DXVECTOR3& prev, const D3DXVECTOR3& cur, float alpha)
+{
+	return (prev - cur) * (1.0f - alpha);
+}
 
+// snapshot ٲ   ׸   ؾ ϴ .
+//  Ͱ ϹǷ ׸ ̿  snapshot ־ ߸ 
+void applySimEvents(const SimSnapshot& s)
+{
+	if (s.obstaclesDestroyed != g_shownDestroyed) {
+		for (int id = 0; id < s.obstacleAlive.size(); id++) {
+			if (s.obstacleAlive[id] || !g_obstacleShown[id])
+				continue;
+			g_obstacleShown[id] = 0;
+			Entity& e = g_obstacleEntities[id];
+			const DestructibleComponent* d = g_entities.findDestructible(e);
+			if (d != NULL)
+				g_obstacleBatch.remove(d->batchSlot);
+			destroyEntity(e);
+			g_occludersDirty = true;
+		}
+		g_shownDestroyed = s.obstaclesDestroyed;
+	}
+	if (s.turns != g_shownTurns) {
+		camera_option = 0;
+		back_camera = 1;
+		x_camera = 0.0f;
+		y_camera = 0.5f;
+		g_shownTurns = s.turns;
+	}
+	if (s.fireDegree != g_shownDegree || s.fireDistance != g_shownDistance) {
+		updateAimPreview(s.fireDegree, s.fireDistance);
+		g_shownDegree = s.fireDegree;
+		g_shownDistance = s.fireDistance;
+	}
+	g_started = s.started;
+	g_originTank = s.originTank;
+}
 
-// timeDelta represents the time between the current image frame and the last image frame.
-// the distance of moving balls should be "velocity * timeDelta"
-bool Display(float timeDelta)
+// Draws one frame of snapshot s. alpha (0 ~ 1) is how far the frame is between
+// the tick before s and s itself; moving objects are drawn interpolated by that amount.
+bool Render(const SimSnapshot& s, float alpha)
 {
-	int i = 0;
-	int j = 0;
 	D3DXVECTOR3 pos;
 	D3DXVECTOR3 target;
 	D3DXVECTOR3 up;
 
-	if (!missile.getCreated()) {
-		currTime = (double)timeGetTime();
-		timediff = currTime - startTime;
-	}
-
-	if (missile.getCreated()) {
-		isFire = TRUE;
-		tank.setPower(0, 0);
-	}
-
-	if (isFire && !missile.getCreated() && !threeTime) {
-		startTime = currTime;
-		timediff = 0;
-		turnTime = 3000;
-		threeTime = TRUE;
-		zoomOutTiming = TRUE;
-
-	}
+	if (Device == NULL)
+		return false;
 
-	if (GAME_START == false) {
-		pos = D3DXVECTOR3(20.0f, 12.0f, -WORLD_DEPTH / 2 + MOVEMENT);
-		target = D3DXVECTOR3(0.0f, 0.0f, -WORLD_DEPTH / 2 + MOVEMENT);
+	const SimTankState& tank = s.tank;
+	bool isOriginTank = s.originTank;
+	bool isFire = s.firing;
+	D3DXVECTOR3 missileFocus = toD3D(s.missileFocus);
+	D3DXVECTOR3 blueball = toD3D(s.target);
+	g_worldFrame.set((const float*)&g_mWorld);	// ״θ ü world ĵ ״ 
+
+	D3DXVECTOR3 tankOffset = lerpOffset(toD3D(tank.lastCenter), toD3D(tank.center), alpha);
+	D3DXVECTOR3 missileOffset = lerpOffset(toD3D(s.lastMissileFocus), missileFocus, alpha);
+	D3DXVECTOR3 blueballOffset = lerpOffset(toD3D(s.lastTarget), blueball, alpha);
+	D3DXVECTOR3 head = toD3D(tank.head) + tankOffset;
+	D3DXVECTOR3 missileCenter = missileFocus + missileOffset;
+	D3DXVECTOR3 blueballCenter = blueball + blueballOffset;
+	syncEntities(s, alpha);
+
+	if (!s.started) {
+		pos = D3DXVECTOR3(20.0f, 12.0f, -WORLD_DEPTH / 2 + s.introMovement);
+		target = D3DXVECTOR3(0.0f, 0.0f, -WORLD_DEPTH / 2 + s.introMovement);
 		up = D3DXVECTOR3(0.0f, 2.0f, 0.0f);
-
-
-
-		MOVEMENT = MOVEMENT + timediff * CAMERA_SPEED;
-		startTime = currTime;
-		if (MOVEMENT > WORLD_DEPTH) {
-			GAME_START = true;
-		}
-
 	}
-	else if (GAME_FINISH) {
-		tank.setPosition(0.0f, podium.getCenter()[1] + podium.getHeight() / 2 + 0.40, 0.0f);
-		pos = D3DXVECTOR3(0.0f, tank.getHead()[1] + 0.5f, -5 + 10 * isOriginTank);
-		target = D3DXVECTOR3(0.0f, tank.getHead()[1], 0.0f);
+	else if (s.finished) {
+		pos = D3DXVECTOR3(0.0f, tank.head.y + 0.5f, -5 + 10 * isOriginTank);
+		target = D3DXVECTOR3(0.0f, tank.head.y, 0.0f);
 		up = D3DXVECTOR3(0.0f, 2.0f, 0.0f);
 		D3DXMatrixLookAtLH(&g_mView, &pos, &target, &up);
 		Device->SetTransform(D3DTS_VIEW, &g_mView);
-		if (Device)
-		{
-			Device->Clear(0, 0, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, 0x00afafaf, 1.0f, 0);
-			Device->BeginScene();
-			RECT screenRect;
-			GetClientRect(GetDesktopWindow(), &screenRect);
-			RECT rect = { screenRect.right / 2 - 180, Height / 7, screenRect.right, screenRect.bottom };
-			ENDfont->DrawText(NULL, "Winner", -1, &rect, DT_NOCLIP, D3DCOLOR_XRGB(0, 0, 0));
-			rect = { screenRect.right / 2 - 85, Height / 7 + 150,screenRect.right, screenRect.bottom };
-			if (isOriginTank) {
-				PLAYERfont->DrawText(NULL, "PLAYER1", -1, &rect, DT_NOCLIP, D3DCOLOR_XRGB(0, 0, 0));
-			}
-			else {
-				PLAYERfont->DrawText(NULL, "PLAYER2", -1, &rect, DT_NOCLIP, D3DCOLOR_XRGB(0, 0, 0));
-			}
-			g_legoPlane.draw(Device, g_mWorld);
-			for (int i = 0; i < g_legoWall.size(); i++)
-			{
-				for (int j = 0; j < g_legoWall[i].size(); j++)
-					g_legoWall[i][j].draw(Device, g_mWorld);
-			}
-			podium.draw(Device, g_mWorld);
-			tank.draw(Device, g_mWorld);
-			Device->EndScene();
-			Device->Present(0, 0, 0, 0);
-			Device->SetTexture(0, NULL);
+		updateFrustum();
+		g_sphereLod.beginFrame();
+
+		Device->Clear(0, 0, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, 0x00afafaf, 1.0f, 0);
+		Device->BeginScene();
+		RECT screenRect;
+		GetClientRect(GetDesktopWindow(), &screenRect);
+		RECT rect = { screenRect.right / 2 - 180, Height / 7, screenRect.right, screenRect.bottom };
+		ENDfont->DrawText(NULL, "Winner", -1, &rect, DT_NOCLIP, D3DCOLOR_XRGB(0, 0, 0));
+		rect = { screenRect.right / 2 - 85, Height / 7 + 150,screenRect.right, screenRect.bottom };
+		if (isOriginTank) {
+			PLAYERfont->DrawText(NULL, "PLAYER1", -1, &rect, DT_NOCLIP, D3DCOLOR_XRGB(0, 0, 0));
 		}
+		else {
+			PLAYERfont->DrawText(NULL, "PLAYER2", -1, &rect, DT_NOCLIP, D3DCOLOR_XRGB(0, 0, 0));
+		}
+		g_renderQueue.begin(pos.x, pos.y, pos.z);
+		clearPart(g_wallPart);
+		cullWorldWalls(g_wallPart);
+		drawWorldWalls();
+		g_drawList.clear();
+		for (int i = 0; i < CSimTank::PART_COUNT; i++)
+			g_drawList.push_back(g_entities.getRow(g_tankParts[tank.player][i]));
+		g_drawList.push_back(g_entities.getRow(g_podium));
+		drawEntities(g_drawList);
+		g_renderQueue.flush(g_d3dBackend);
+		Device->EndScene();
+		Device->Present(0, 0, 0, 0);
+		Device->SetTexture(0, NULL);
 		return true;
 
 	}
 	else if (isFire == true) {
-		pos = D3DXVECTOR3(missile.getCenter()[0], missile.getCenter()[1] + 0.9f, missile.getCenter()[2] + 1.5f - 3.0f * isOriginTank);
-		target = D3DXVECTOR3(missile.getCenter()[0], missile.getCenter()[1], missile.getCenter()[2]);
+		pos = D3DXVECTOR3(missileCenter[0], missileCenter[1] + 0.9f, missileCenter[2] + 1.5f - 3.0f * isOriginTank);
+		target = D3DXVECTOR3(missileCenter[0], missileCenter[1], missileCenter[2]);
 	}
 	else {
 		if (camera_option == 0) {
 			if (isOriginTank) {
-				pos = D3DXVECTOR3(tank.getHead()[0], tank.getHead()[1] + 2.0f, tank.getHead()[2] - back_camera * 4.4f);
+				pos = D3DXVECTOR3(head[0], head[1] + 2.0f, head[2] - back_camera * 4.4f);
 			}
 			else {
-				pos = D3DXVECTOR3(tank.getHead()[0], tank.getHead()[1] + 2.0f, tank.getHead()[2] + back_camera * 4.4f);
+				pos = D3DXVECTOR3(head[0], head[1] + 2.0f, head[2] + back_camera * 4.4f);
 			}
 
-			target = D3DXVECTOR3(tank.getHead()[0] + x_camera, tank.getHead()[1] + y_camera, tank.getHead()[2]);
+			target = D3DXVECTOR3(head[0] + x_camera, head[1] + y_camera, head[2]);
 		}
 		else if (camera_option == 1) {
 			pos = D3DXVECTOR3(70.0, 30.0, 0.0);
 			target = D3DXVECTOR3(0, 1, 0);
 		}
 		else {
-			pos = D3DXVECTOR3(tank.getHead()[0], tank.getHead()[1] + 0.5f, tank.getHead()[2] + 0.4f - 0.8f * isOriginTank);
-			if (abs(tank.getHead()[2] - g_target_blueball.getCenter()[2]) < 5) {
-				target = D3DXVECTOR3(g_target_blueball.getCenter()[0], g_target_blueball.getCenter()[1], g_target_blueball.getCenter()[2]);
+			pos = D3DXVECTOR3(head[0], head[1] + 0.5f, head[2] + 0.4f - 0.8f * isOriginTank);
+			if (abs(head[2] - blueballCenter[2]) < 5) {
+				target = D3DXVECTOR3(blueballCenter[0], blueballCenter[1], blueballCenter[2]);
 			}
 			else {
-				target = D3DXVECTOR3(g_target_blueball.getCenter()[0], g_target_blueball.getCenter()[1] - 2.0f, g_target_blueball.getCenter()[2]);
+				target = D3DXVECTOR3(blueballCenter[0], blueballCenter[1] - 2.0f, blueballCenter[2]);
 			}
 		}
 	}
 
-	if (zoomOutTiming) {
-		pos = D3DXVECTOR3(missile.getCenter()[0], missile.getCenter()[1] + 0.9f + zoomOutSpeed, missile.getCenter()[2] + 1.5f - 3.0f * isOriginTank);
-		target = D3DXVECTOR3(missile.getCenter().x, missile.getCenter().y, missile.getCenter().z);
-		zoomOutSpeed += 0.0018f;
+	if (s.zoomingOut) {
+		pos = D3DXVECTOR3(missileCenter[0], missileCenter[1] + 0.9f + s.zoomOut, missileCenter[2] + 1.5f - 3.0f * isOriginTank);
+		target = D3DXVECTOR3(missileCenter.x, missileCenter.y, missileCenter.z);
 	}
 
 	up = D3DXVECTOR3(0.0f, 2.0f, 0.0f);
 	D3DXMatrixLookAtLH(&g_mView, &pos, &target, &up);
 	Device->SetTransform(D3DTS_VIEW, &g_mView);
+	updateFrustum();
+	beginOcclusion();
+	g_sphereLod.beginFrame();
 
-
-	if (Device)
-	{
-
-		if (timediff > turnTime) {
-			tank.setPower(0, 0);
-			tank.setIsDistanceZero(FALSE);
-			Tank tempTank = tank;
-			tank = otank;
-			otank = tempTank;
-			g_target_blueball.linkTank(&tank);
-			camera_option = 0;
-			back_camera = 1;
-			otank.setDistance();
-			x_camera = 0.0f;
-			y_camera = 0.5f;
-			isFire = FALSE;
-			threeTime = FALSE;
-			turnTime = 20000;
-			TANK_SPEED = 0.45;
-			zoomOutTiming = FALSE;
-			zoomOutSpeed = 0.0;
-
-			startTime = currTime;
-
-			if (isOriginTank) {
-				g_target_blueball.setCenter(tank.getCenter().x - 0.01f, (float)M_RADIUS + 3, tank.getCenter().z - 5.0f);
-				// 0.01f   и п 0 ԵǴ 찡 øǾ x ̰ 0   ߻ϱ .
-				isOriginTank = FALSE;
-			}
-			else {
-				g_target_blueball.setCenter(tank.getCenter().x - 0.01f, (float)M_RADIUS + 3, tank.getCenter().z + 5.0f);
-				isOriginTank = TRUE;
-			}
-		}
-
-		Device->Clear(0, 0, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, 0x00afafaf, 1.0f, 0);
-		Device->BeginScene();
+	Device->Clear(0, 0, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, 0x00afafaf, 1.0f, 0);
+	Device->BeginScene();
 
 
-		// -------------------------------------------------------------------------------------
-		if (GAME_START) {
-			RECT rect = { 10, 10, 0, 0 };  //  ġ (10, 10) 
-			if ((turnTime / 1000) - static_cast<int>(timediff / 1000) > 5) {
-				string time = "TIME: " + to_string((turnTime / 1000) - static_cast<int>(timediff / 1000));
-				TIMEfont->DrawText(NULL, time.c_str(), -1, &rect, DT_NOCLIP, D3DCOLOR_XRGB(0, 0, 0));
-			}
-			else {
-				string time = "TIME: " + to_string((turnTime / 1000) - static_cast<int>(timediff / 1000));
-				TIMEfont->DrawText(NULL, time.c_str(), -1, &rect, DT_NOCLIP, D3DCOLOR_XRGB(255, 0, 0));
-			}
+	//  ( ۿ , ׸ drawHud  )-----------------------------------
+	g_hud.beginFrame();
+	if (s.started) {
+		int remain = (s.turnTime / 1000) - static_cast<int>(s.turnElapsed / 1000);
+		g_hud.printInt(HUD_TIME, remain > 5 ? D3DCOLOR_XRGB(0, 0, 0) : D3DCOLOR_XRGB(255, 0, 0), "TIME: ", remain);
+	}
+	if (s.started && !isFire) {
+		g_hud.printFixed(HUD_DEGREE, D3DCOLOR_XRGB(0, 0, 0), "FIRE Degree: ", s.fireDegree, 2, HUD_DEGREE_SIGN);
+		g_hud.printFixed(HUD_FIRE_DISTANCE, D3DCOLOR_XRGB(0, 0, 0), "FIRE Distance: ", s.fireDistance, 2);
+		if (tank.distanceZero) {
+			g_hud.printText(HUD_TANK_DISTANCE, D3DCOLOR_XRGB(255, 0, 0), "Tank: SLOWED");
 		}
-		if (GAME_START && !isFire) {
-			RECT rect = { 10, 50, 0, 0 };
-			ostringstream oss;
-			oss << "FIRE Degree: " << fixed << setprecision(2) << fireDegree << "";
-			string s = oss.str();
-			DEGREEfont->DrawText(NULL, s.c_str(), -1, &rect, DT_NOCLIP, D3DCOLOR_XRGB(0, 0, 0));
-			rect = { 10, 90, 0, 0 };
-			oss.str("");  // Ʈ 
-			oss << "FIRE Distance: " << std::fixed << std::setprecision(2) << fireDistance;
-			s = oss.str();  //߻Ÿ ڿ
-			FIREDISTANCEfont->DrawText(NULL, s.c_str(), -1, &rect, DT_NOCLIP, D3DCOLOR_XRGB(0, 0, 0));
-			rect = { 10, 130, 0, 0 };
-			if (tank.getIsDistanceZero()) {
-				DISTANCEfont->DrawText(NULL, "Tank: SLOWED", -1, &rect, DT_NOCLIP, D3DCOLOR_XRGB(255, 0, 0));
-			}
-			else {
-				DISTANCEfont->DrawText(NULL, ("Tank Distance: " + to_string(int(tank.getDistance()))).c_str(), -1, &rect, DT_NOCLIP, D3DCOLOR_XRGB(0, 0, 0));
-			}
-
+		else {
+			g_hud.printInt(HUD_TANK_DISTANCE, D3DCOLOR_XRGB(0, 0, 0), "Tank Distance: ", int(tank.distance));
 		}
 
-		//----------------------------------------------------------------------------------------------
-
+	}
 
-		// ũ ġ 
-		tank.tankUpdate(timeDelta, obstacle_wall, otank, g_legoWall);
-		// ̻ ġ  &  浹ߴ üũ
-		missile.ballUpdate(timeDelta);
-		for (i = 0; i < g_legoWall.size(); i++) {
-			for (j = 0; j < g_legoWall[i].size(); j++)
-				g_legoWall[i][j].hitBy(missile);
-		}
+	//----------------------------------------------------------------------------------------------
 
-		// 纼 ġ 
-		g_target_blueball.ballUpdate(timeDelta);
 
-		// draw plane, walls, and spheres
-		tank.draw(Device, g_mWorld);
-		g_target_blueball.draw(Device, g_mWorld);
-		missile.draw(Device, g_mWorld);  // ̻ϵ ׸
+	// draw plane, walls, and spheres
+	// (ť Ҵٰ mesh/material/Ÿ  ؼ   ׸, þ   )
+	g_renderQueue.begin(pos.x, pos.y, pos.z);
+	updateObstacleChunks();
+	buildDrawLists();	// , ũ , ֹ   thread (occlusion  ⼭ )
+	drawWorldWalls();
+	drawActors();	// ũ, , ̻
+	drawObstacles();	// ı ȵ ֹ (chunk buffer   ť )
+	g_renderQueue.flush(g_d3dBackend);
 
-		g_legoPlane.draw(Device, g_mWorld);
-		for (int i = 0; i < g_legoWall.size(); i++)
-		{
-			for (int j = 0; j < g_legoWall[i].size(); j++)
-				g_legoWall[i][j].draw(Device, g_mWorld);
-		}
+	if (s.started && !isFire) {
+		drawAimPreview(head, blueballCenter);
+	}
 
-		if (missile.get_created() == true) {
-			missile.hitBy();
-		}
-		if (otank.get_created()) {
-			if (otank.hasIntersected(missile)) {
-				otank.hitBy(missile);
-				GAME_FINISH = true;
-				winner = true;
-			}
-			else if (otank.get_created()) {
-				otank.tankUpdate(timeDelta, obstacle_wall, tank, g_legoWall);
-				otank.draw(Device, g_mWorld);
-			}
-		}
+	if (g_showStats) {
+		const SphereLodStats& lod = g_sphereLod.getStats();
+		g_hud.format(HUD_STATS, D3DCOLOR_XRGB(0, 0, 0), "Spheres: %d  Tris: %d / %d  LOD: %d %d %d %d  Visible: %d / %d",
+			lod.spheres, lod.triangles, lod.fullTriangles, lod.perLevel[0], lod.perLevel[1], lod.perLevel[2], lod.perLevel[3],
+			g_cullStats.visible, g_cullStats.tested);
+		const OcclusionStats& occ = g_occlusion.getStats();
+		g_hud.format(HUD_OCCLUSION, D3DCOLOR_XRGB(0, 0, 0), "Occluders: %d  Occluded chunks: %d / %d (%.0f%%)",
+			occ.occluders, occ.occluded, occ.tested, occ.getOccludedRatio() * 100);
+		const LatencyStats& lat = g_latency.getStats();
+		SimThreadStats sim = g_simThread.getStats();
+		g_hud.format(HUD_LATENCY, D3DCOLOR_XRGB(0, 0, 0), "Sim->display: %.1f ms (avg %.1f, max %.1f)  Late ticks: %d  Dropped: %d",
+			lat.lastMs, lat.averageMs, lat.maxMs, sim.lateTicks, (int)sim.droppedTicks);
+	}
+	drawHud();
 
-		// ֹ() ı üũ & ı ȵǸ ׸
-		for (int i = 0; i < obstacle_wall.size(); i++) {
-			if (obstacle_wall[i].get_created()) {
-				if (obstacle_wall[i].hasIntersected(missile)) {
-					obstacle_wall[i].hitBy(missile);
-					//  ֹ ı, Ѵ (= ֺ ֹ ٽ ׸)
-					
-					for (int j = 0; j < obstacle_wall.size(); j++) {
-						if (obstacle_wall[j].hasIntersected(missile.getCenter().x, missile.getCenter().y, missile.getCenter().z, MISSILE_EXPOLSION_RADIUS)) {
-							obstacle_wall[j].hitBy(missile);
-						}
-					}
-				}
-				else if (obstacle_wall[i].get_created()) {
-					obstacle_wall[i].draw(Device, g_mWorld);
-				}
-			}
-		}
+	if (!s.started) {
+		// ȭ ũ 
+		RECT screenRect;
+		GetClientRect(GetDesktopWindow(), &screenRect);
+		// ȭ ߾ӿ ؽƮ 
+		RECT rect = { 0, screenRect.bottom / 4, screenRect.right, screenRect.bottom };
+		TITLEfont->DrawText(NULL, "Tank Game", -1, &rect, DT_CENTER, D3DCOLOR_XRGB(0, 0, 0));
+	}
 
-		D3DXVECTOR3 tankCoord = tank.getHead();
-		D3DXVECTOR3 blueballCoord = g_target_blueball.getCenter();
-		if (tankCoord != tankLastCoord || blueballCoord != blueballLastCoord) {
-			// ũ 纼 ,   Ÿ 
-			updateFireDegree();
-			updateFireDistance();
-		}
-		tankLastCoord = tankCoord;
-		blueballLastCoord = blueballCoord;
-		if (GAME_START == false) {
-			// ȭ ũ 
-			RECT screenRect;
-			GetClientRect(GetDesktopWindow(), &screenRect);
-			// ȭ ߾ӿ ؽƮ 
-			RECT rect = { 0, screenRect.bottom / 4, screenRect.right, screenRect.bottom };
-			TITLEfont->DrawText(NULL, "Tank Game", -1, &rect, DT_CENTER, D3DCOLOR_XRGB(0, 0, 0));
-		}
 
 
+	Device->EndScene();
+	Device->Present(0, 0, 0, 0);
+	Device->SetTexture(0, NULL);
+	return true;
+}
 
-		Device->EndScene();
-		Device->Present(0, 0, 0, 0);
-		Device->SetTexture(0, NULL);
-	}
+// ޽  :   snapshot ޾ ׸. simulation thread   
+// ٸ ʰ, alpha  snapshot    ð 
+bool Display(float timeDelta)
+{
+	const SimSnapshot& s = g_simThread.acquire();
+	applySimEvents(s);
+	float alpha = (float)((simClockNs() - s.publishNs) / (1e9 / SIM_TICK_RATE));
+	if (!Render(s, min(max(alpha, 0.0f), 1.0f)))
+		return false;
+	g_latency.add(s.publishNs, simClockNs());	// Present  
 	return true;
 }
 
@@ -1568,11 +1314,14 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 			// esc 
 			::DestroyWindow(hwnd);
 			break;
+		case VK_F3:
+			g_showStats = !g_showStats;
+			break;
 		case VK_RETURN:
 			//  
 			//    ,  ϰ 
-			if (!GAME_START) {
-				GAME_START = true;
+			if (!g_started) {
+				g_simThread.post(SIM_CMD_START);
 				break;
 			}
 			// ü   
@@ -1583,177 +1332,39 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 			}
 			break;
 		case VK_SPACE:
-		{	// ̽ 
-			// Ķ   ̻ ߻
-			if (!isFire && GAME_START) {
-				D3DXVECTOR3 targetpos = g_target_blueball.getCenter();
-				D3DXVECTOR3	whitepos = tank.getHead();
-				double theta = acos(
-					sqrt(pow(targetpos.x - whitepos.x, 2)) /
-					sqrt(pow(targetpos.x - whitepos.x, 2) + pow(targetpos.z - whitepos.z, 2))
-				);		// ⺻ 1 и
-				if (targetpos.z - whitepos.z <= 0 && targetpos.x - whitepos.x >= 0) { theta = -theta; }	//4 и
-				if (targetpos.z - whitepos.z >= 0 && targetpos.x - whitepos.x <= 0) { theta = PI - theta; } //2 и
-				if (targetpos.z - whitepos.z <= 0 && targetpos.x - whitepos.x <= 0) { theta = PI + theta; } // 3 и
-				double distance_land = fireDistance;  //  
-				double theta_sky = fireDegree * PI / 180;  //  
-				double distance_sky = sqrt(pow(targetpos.x - whitepos.x, 2) + pow(targetpos.y - whitepos.y, 2) + pow(targetpos.z - whitepos.z, 2));  // yǥ  Ÿ
-				missile.destroy();
-				missile.create(Device, d3d::BLACK);
-				missile.setCenter(whitepos.x, whitepos.y, whitepos.z);
-				missile.setPower(distance_land * cos(theta) * MISSILE_POWER, distance_sky * sin(theta_sky), distance_land * sin(theta) * MISSILE_POWER);
-				break;
-			}
-			//    ,  ϰ 
-			if (!GAME_START) {
-				GAME_START = true;
-			}
+			// ̽ 
+			// Ķ   ̻ ߻ (   ,  )
+			g_simThread.post(SIM_CMD_FIRE);
 			break;
-		}
-
+		// Ķ  ̱ (  õ)
 		case VK_LEFT:
-		{
-			if (!isFire && GAME_START) {
-				// Ű  ư
-				CBlueBall* moveTarget = &g_target_blueball;
-				Tank* shooter = &tank;
-				double velocity = -1 * BLUEBALL_VELOCITY;
-				D3DXVECTOR3 tankcoord = shooter->getCenter();
-				D3DXVECTOR3 targetcoord = moveTarget->getCenter();
-				double dx = tankcoord.x - targetcoord.x;
-				if (!isOriginTank) {
-					velocity *= -1;
-					dx *= -1;
-				}
-				if (dx < MAX_BLUEBALL_WIDTH) moveTarget->setPower(velocity, moveTarget->getVelocity_Y(), moveTarget->getVelocity_Z());
-			}
+			g_simThread.post(SIM_CMD_AIM_LEFT);
 			break;
-		}
-
 		case VK_RIGHT:
-		{
-			if (!isFire && GAME_START) {
-				// Ű  ư
-				CBlueBall* moveTarget = &g_target_blueball;
-				Tank* shooter = &tank;
-				double velocity = BLUEBALL_VELOCITY;
-				D3DXVECTOR3 tankcoord = shooter->getCenter();
-				D3DXVECTOR3 targetcoord = moveTarget->getCenter();
-				double dx = targetcoord.x - tankcoord.x;
-				if (!isOriginTank) {
-					velocity *= -1;
-					dx *= -1;
-				}
-				if (dx < MAX_BLUEBALL_WIDTH) moveTarget->setPower(velocity, moveTarget->getVelocity_Y(), moveTarget->getVelocity_Z());
-			}
+			g_simThread.post(SIM_CMD_AIM_RIGHT);
 			break;
-		}
-
 		case VK_UP:
-		{
-			if (!isFire && GAME_START) {
-				// Ű  ư
-				CBlueBall* moveTarget = &g_target_blueball;
-				Tank* shooter = &tank;
-				double velocity = BLUEBALL_VELOCITY;
-				D3DXVECTOR3 tankcoord = shooter->getCenter();
-				D3DXVECTOR3 targetcoord = moveTarget->getCenter();
-				double dz = targetcoord.z - tankcoord.z;
-				if (!isOriginTank) {
-					velocity *= -1;
-					dz *= -1;
-				}
-				if (dz < MAX_BLUEBALL_RADIUS)
-					moveTarget->setPower(moveTarget->getVelocity_X(), moveTarget->getVelocity_Y(), velocity);
-			}
+			g_simThread.post(SIM_CMD_AIM_FORWARD);
 			break;
-		}
-
 		case VK_DOWN:
-		{
-			if (!isFire && GAME_START) {
-				// Ű Ʒ ư
-				CBlueBall* moveTarget = &g_target_blueball;
-				Tank* shooter = &tank;
-				double velocity = -BLUEBALL_VELOCITY;
-				D3DXVECTOR3 tankcoord = shooter->getCenter();
-				D3DXVECTOR3 targetcoord = moveTarget->getCenter();
-				double dz = targetcoord.z - tankcoord.z;
-				if (!isOriginTank) {
-					velocity *= -1;
-					dz *= -1;
-				}
-				if (dz > MIN_BLUEBALL_RADIUS) moveTarget->setPower(moveTarget->getVelocity_X(), moveTarget->getVelocity_Y(), velocity);
-			}
+			g_simThread.post(SIM_CMD_AIM_BACK);
 			break;
-		}
-
+		// W, A, S, D: ũ ̵ (̻ ư  õ)
 		case 0x57:
-		{
-			if (!isFire && GAME_START) {
-				// W
-				Tank* moveTarget = &tank;  //  
-				double speed = TANK_SPEED;
-				if (isOriginTank) {
-					moveTarget->setPower(moveTarget->getVelocity_X(), speed * 5);
-				}
-				else {
-					moveTarget->setPower(moveTarget->getVelocity_X(), -speed * 5);
-				}
-			}
+			g_simThread.post(SIM_CMD_TANK_FORWARD);
 			break;
-		}
-
 		case 0x41:
-		{
-			if (!isFire && GAME_START) {
-				// A
-				Tank* moveTarget = &tank;  //  
-				double speed = TANK_SPEED;
-				if (isOriginTank) {
-					moveTarget->setPower(-speed * 5, moveTarget->getVelocity_Z());
-				}
-				else {
-					moveTarget->setPower(speed * 5, moveTarget->getVelocity_Z());
-				}
-			}
+			g_simThread.post(SIM_CMD_TANK_LEFT);
 			break;
-		}
-
 		case 0x53:
-		{
-			if (!isFire && GAME_START) {
-				// S
-				Tank* moveTarget = &tank;  //  
-				double speed = TANK_SPEED;
-				if (isOriginTank) {
-					moveTarget->setPower(moveTarget->getVelocity_X(), -speed * 5);
-				}
-				else {
-					moveTarget->setPower(moveTarget->getVelocity_X(), speed * 5);
-				}
-
-			}
+			g_simThread.post(SIM_CMD_TANK_BACK);
 			break;
-		}
 		case 0x44:
-		{
-			if (!isFire && GAME_START) {
-				// D
-				Tank* moveTarget = &tank;;  //  
-				double speed = TANK_SPEED;
-				if (isOriginTank) {
-					moveTarget->setPower(speed * 5, moveTarget->getVelocity_Z());
-				}
-				else {
-					moveTarget->setPower(-speed * 5, moveTarget->getVelocity_Z());
-				}
-			}
+			g_simThread.post(SIM_CMD_TANK_RIGHT);
 			break;
-		}
 		case 0x56:
 		{
-			if (GAME_START) {
+			if (g_started) {
 				// v ư  
 				if (camera_option == 0) { camera_option = 1; }
 				else if (camera_option == 1) { camera_option = 2; }
@@ -1763,32 +1374,20 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		}
 		case 0x10:
 		case 0x51:
-		{
-			if (!isFire && GAME_START) {
-				// Shift, QŰ
-				// blueball ø
-				CBlueBall* moveTarget = &g_target_blueball;
-				double velocity = BLUEBALL_VELOCITY;
-				moveTarget->setPower(moveTarget->getVelocity_X(), velocity, moveTarget->getVelocity_Z());
-			}
+			// Shift, QŰ
+			// blueball ø
+			g_simThread.post(SIM_CMD_AIM_UP);
 			break;
-		}
 		case 0x45:
 		case 0x11:
-		{
-			if (!isFire && GAME_START) {
-				// CtrlŰ, EŰ
-				// blueball 
-				CBlueBall* moveTarget = &g_target_blueball;
-				double velocity = -1 * BLUEBALL_VELOCITY;
-				moveTarget->setPower(moveTarget->getVelocity_X(), velocity, moveTarget->getVelocity_Z());
-			}
+			// CtrlŰ, EŰ
+			// blueball 
+			g_simThread.post(SIM_CMD_AIM_DOWN);
 			break;
-		}
 
 		case 0x43:
 		{
-			if (GAME_START) {
+			if (g_started) {
 				back_camera = back_camera * -1;
 			}
 			break;
@@ -1796,8 +1395,8 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
 		case 0x61:
 		{
-			if (GAME_START) {
-				if (isOriginTank) {
+			if (g_started) {
+				if (g_originTank) {
 					x_camera = x_camera - camera_prefix;
 				}
 				else {
@@ -1809,15 +1408,15 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		}
 		case 0x62:
 		{
-			if (GAME_START) {
+			if (g_started) {
 				y_camera = y_camera - camera_prefix;
 			}
 			break;
 		}
 		case 0x63:
 		{
-			if (GAME_START) {
-				if (isOriginTank) {
+			if (g_started) {
+				if (g_originTank) {
 					x_camera = x_camera + camera_prefix;
 				}
 				else {
@@ -1830,8 +1429,8 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		}
 		case 0x64:
 		{
-			if (GAME_START) {
-				if (isOriginTank) {
+			if (g_started) {
+				if (g_originTank) {
 					x_camera = x_camera - camera_prefix;
 				}
 				else {
@@ -1842,7 +1441,7 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		}
 		case 0x65:
 		{
-			if (GAME_START) {
+			if (g_started) {
 				x_camera = 0.0f;
 				y_camera = 0.5f;
 			}
@@ -1850,8 +1449,8 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		}
 		case 0x66:
 		{
-			if (GAME_START) {
-				if (isOriginTank) {
+			if (g_started) {
+				if (g_originTank) {
 					x_camera = x_camera + camera_prefix;
 				}
 				else {
@@ -1862,8 +1461,8 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		}
 		case 0x67:
 		{
-			if (GAME_START) {
-				if (isOriginTank) {
+			if (g_started) {
+				if (g_originTank) {
 					x_camera = x_camera - camera_prefix;
 				}
 				else {
@@ -1875,15 +1474,15 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		}
 		case 0x68:
 		{
-			if (GAME_START) {
+			if (g_started) {
 				y_camera = y_camera + camera_prefix;
 			}
 			break;
 		}
 		case 0x69:
 		{
-			if (GAME_START) {
-				if (isOriginTank) {
+			if (g_started) {
+				if (g_originTank) {
 					x_camera = x_camera + camera_prefix;
 				}
 				else {
@@ -1902,48 +1501,33 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		switch (wParam) {
 		case 0x44:
 		case 0x41:
-		{
-			// A, DŰ 	
-			Tank* moveTarget = &tank;  //  
-			moveTarget->setPower(0, moveTarget->getVelocity_Z());
+			// A, DŰ 
+			g_simThread.post(SIM_CMD_TANK_STOP_X);
 			break;
-		}
 		case 0x57:
 		case 0x53:
-		{
 			// W, SŰ 
-			Tank* moveTarget = &tank;  //  
-			moveTarget->setPower(moveTarget->getVelocity_X(), 0);
+			g_simThread.post(SIM_CMD_TANK_STOP_Z);
 			break;
-		}
 		case 0x10:
 		case 0x51:
 		case 0x45:
 		case 0x11:
-		{
 			// Shift, Q, Ctrl, EŰ 
 			// blueball Ͽ 
-			CBlueBall* moveTarget = &g_target_blueball;
-			moveTarget->setPower(moveTarget->getVelocity_X(), 0, moveTarget->getVelocity_Z());
+			g_simThread.post(SIM_CMD_AIM_STOP_Y);
 			break;
-		}
 		case VK_UP:
 		case VK_DOWN:
-		{
 			// Ű , Ʒ ư 
-			CBlueBall* moveTarget = &g_target_blueball;
-			moveTarget->setPower(moveTarget->getVelocity_X(), moveTarget->getVelocity_Y(), 0);
+			g_simThread.post(SIM_CMD_AIM_STOP_Z);
 			break;
-		}
 		case VK_LEFT:
 		case VK_RIGHT:
-		{
 			// Ű ,  ư 
-			CBlueBall* moveTarget = &g_target_blueball;
-			moveTarget->setPower(0, moveTarget->getVelocity_Y(), moveTarget->getVelocity_Z());
+			g_simThread.post(SIM_CMD_AIM_STOP_X);
 			break;
 		}
-		}
 		break;
 	}
 
@@ -1988,30 +1572,8 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 			isReset = true;
 			// Ŭ
 			// blue ball ̱
-			if (LOWORD(wParam) & MK_RBUTTON) {
-
-				if (isOriginTank) {
-					dx = (old_x - new_x);// * 0.01f;
-					dy = (old_y - new_y);// * 0.01f;
-				}
-				else {
-					dx = -(old_x - new_x);// * 0.01f;
-					dy = -(old_y - new_y);// * 0.01f;
-				}
-
-				D3DXVECTOR3 coord3d = g_target_blueball.getCenter();
-				double nx = coord3d.x + dx * (-0.007f);
-				double ny = coord3d.y;
-				double nz = coord3d.z + dy * (0.007f);
-				Tank* curTank = &tank;
-				if (fabs(curTank->getCenter().x - nx) > MAX_BLUEBALL_WIDTH) {
-					nx = coord3d.x;
-				}
-				if (fabs(curTank->getCenter().z - nz) < MIN_BLUEBALL_RADIUS || fabs(curTank->getCenter().z - nz) > MAX_BLUEBALL_RADIUS) {
-					nz = coord3d.z;
-				}
-				g_target_blueball.setCenter(nx, ny, nz);
-			}
+			if (LOWORD(wParam) & MK_RBUTTON)
+				g_simThread.postDrag((float)(old_x - new_x), (float)(old_y - new_y));
 			old_x = new_x;
 			old_y = new_y;
 
@@ -2031,6 +1593,16 @@ int WINAPI WinMain(HINSTANCE hinstance,
 {
 	srand(static_cast<unsigned int>(time(NULL)));
 
+	// "-bench" runs the headless benchmarks only (results in benchmark.txt)
+	if (cmdLine != NULL && strstr(cmdLine, "-bench") != NULL) {
+		FILE* fp = fopen("benchmark.txt", "w");
+		if (fp != NULL) {
+			bench::RunAll(fp);
+			fclose(fp);
+		}
+		return 0;
+	}
+
 	if (!d3d::InitD3D(hinstance,
 		Width, Height, true, D3DDEVTYPE_HAL, &Device))
 	{